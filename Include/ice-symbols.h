@@ -70,6 +70,7 @@
 #define HTYPE_TYPEDEF           0x06    // All typedefs bound to one source file
 #define HTYPE_IGNORE            0x07    // This header should be ignored and skipped
 #define HTYPE_RELOC             0x08    // Relocation section
+#define HTYPE_UNWIND            0x09    // Stack unwind rows
 #define HTYPE__END              0x00    // (End of the array of headers)
 
 typedef struct
@@ -343,5 +344,40 @@ typedef struct
     //     ...
 } PACKED TSYMRELOC;
 
+
+//----------------------------------------------------------------------------
+// HTYPE_UNWIND
+// Stack unwind rows made from the call frame information.
+//----------------------------------------------------------------------------
+//
+// Rows are sorted by address and each one applies up to the next one. The
+// canonical frame address (CFA) is the value of ESP before the call, so the
+// return address is always at CFA-4. Addresses are offsets from the .text
+// section for object files (kernel modules). A row with UNWIND_CFA_NONE
+// ends a function or marks code that the rows can not describe.
+
+#define UNWIND_CFA_NONE         0       // No information
+#define UNWIND_CFA_ESP          1       // CFA = ESP + wCfaOffset
+#define UNWIND_CFA_EBP          2       // CFA = EBP + wCfaOffset
+
+typedef struct
+{
+    DWORD dwAddress;                    // First address that the row applies to
+    WORD wCfaOffset;                    // Offset to add to the CFA register
+    BYTE bCfaReg;                       // CFA register, UNWIND_CFA_*
+    BYTE bEbpOffset;                    // Caller's EBP is saved at CFA-bEbpOffset, 0 if not saved
+
+} PACKED TSYMUNWIND1;
+
+typedef struct
+{
+    TSYMHEADER h;                       // Section header
+
+    DWORD nRows;                        // Number of unwind rows
+
+    TSYMUNWIND1 list[1];                // Array of unwind rows
+    //     ...
+} PACKED TSYMUNWIND;
+
 #endif //  _ICE_SYMBOLS_H_
 
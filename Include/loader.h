@@ -70,6 +70,9 @@ extern int nVerbose;                    // Verbose level
 #define OPT_HELP            0x00004000  // Help command
 #define OPT_VERBOSE         0x00008000  // Option verbose, make output informative
 #define OPT_CHECK           0x00010000  // Symbol test command
+#define OPT_FOLLOW          0x00020000  // Follow the history buffer live
+#define OPT_FOLDED          0x00040000  // pFolded -> save the call stack profile
+#define OPT_SCREEN          0x00080000  // pScreen -> save the headless screen
 
 #define VERBOSE0            // 0 (default) simply means no extra output is desired
 #define VERBOSE1            if(nVerbose==3 || nVerbose==2 || nVerbose==1)
@@ -58,6 +58,10 @@
 ******************************************************************************/
 
 #define MAX_AUXBUF       256            // Maximum fill/search string len
+#define BLOCK_CHUNK      4096           // Bytes read or written at a time
+
+static BYTE blockBuf1[BLOCK_CHUNK];     // Buffers for the block operations
+static BYTE blockBuf2[BLOCK_CHUNK];
 
 /******************************************************************************
 *                                                                             *
@@ -65,6 +69,38 @@
 *                                                                             *
 ******************************************************************************/
 
+/******************************************************************************
+*                                                                             *
+*   static void BlockWrite(PTADDRDESC pAddr, BYTE *pBuf, DWORD len)           *
+*                                                                             *
+*******************************************************************************
+*
+*   Writes a buffer to memory, skipping over the pages that are not present.
+*
+*   Where:
+*       pAddr is the address to write to; it is advanced past the buffer
+*       pBuf is the data to write
+*       len is the number of bytes to write
+*
+******************************************************************************/
+static void BlockWrite(PTADDRDESC pAddr, BYTE *pBuf, DWORD len)
+{
+    DWORD n;
+
+    while( len )
+    {
+        n = AddrWriteBlock(pAddr, pBuf, len, FALSE);
+
+        // If the write stopped short, skip the rest of that page
+        if( n < len )
+            n += MIN(4096 - ((pAddr->offset + n) & 0xFFF), len - n);
+
+        pAddr->offset += n;
+        pBuf += n;
+        len -= n;
+    }
+}
+
 
 /******************************************************************************
 *                                                                             *
@@ -160,15 +196,17 @@ BOOL cmdFill(char *args, int subClass)
                 dprinth(1, "%s", str);
             }
 #endif
-            i = 0;
-            while( len-- )
+            // Repeat the fill string over the block buffer and write it out
+            for(i=0; i<BLOCK_CHUNK; i++)
+                blockBuf1[i] = auxBuf[i % index];
+
+            while( len )
             {
-                AddrSetByte(&Addr, auxBuf[i], FALSE);
-                Addr.offset++;
+                // Keep the chunks a multiple of the fill string
+                i = MIN(len, BLOCK_CHUNK - BLOCK_CHUNK % index);
 
-                // Wrap the index around the fill buffer
-                if( ++i==index )
-                    i = 0;
+                BlockWrite(&Addr, blockBuf1, i);
+                len -= i;
             }
         }
     }
@@ -200,6 +238,8 @@ BOOL cmdSearch(char *args, int subClass)
     static BOOL fIgnoreCase;            // Case-insensitive ASCII search?
 
     DWORD value, remains, matching;
+    DWORD dwBufStart = 0;               // Address of the bytes in the buffer
+    DWORD nBuf = 0;                     // Number of bytes in the buffer
 
 
     // Did we ask for a subsequent search?
@@ -304,9 +344,20 @@ DoSearch:
 
             while( searchLen )
             {
-                if( AddrIsPresent(&Addr) )
+                // Read the rest of the page when we step outside the buffer
+                if( Addr.offset - dwBufStart >= nBuf )
+                {
+                    // If we pressed ESC, break the search (if it's taking too long)
+                    if( GetKey(FALSE)==ESC )
+                        break;
+
+                    dwBufStart = Addr.offset;
+                    nBuf = AddrReadBlock(&Addr, blockBuf1, MIN(searchLen, 4096 - (Addr.offset & 0xFFF)));
+                }
+
+                if( nBuf )
                 {
-                    value = AddrGetByte(&Addr);
+                    value = blockBuf1[Addr.offset - dwBufStart];
                     // If we are doing a case-insensitive search, make ASCII a lowercased
                     // to match what we got in the buffer
                     if( fIgnoreCase )
@@ -348,10 +399,6 @@ DoSearch:
 
                         break;
                     }
-
-                    // If we pressed ESC, break the search (if it's taking too long)
-                    if( GetKey(FALSE)==ESC )
-                        break;
                 }
                 else
                 {
@@ -389,6 +436,7 @@ BOOL cmdCompare(char *args, int subClass)
 {
     TADDRDESC Addr1, Addr2;             // Block 1 and 2 addresses
     DWORD len;                          // Length of the block to compare
+    DWORD n, i;                         // Chunk length and index
     BYTE b1, b2;                        // Temp bytes from each block
     BOOL fExtended = FALSE;             // Extended option?
     int nLine = 1;                      // Standard dprinth line counter
@@ -430,11 +478,24 @@ BOOL cmdCompare(char *args, int subClass)
                         {
                             Addr2.sel = evalSel;
 
-                            // Start block compare
-                            while( len-- )
+                            // Start block compare, a chunk at a time; bytes that
+                            // can not be read are compared as 0xFF. A chunk does
+                            // not cross a page of either block, so a page that is
+                            // not present does not hide the present ones after it
+                            for(i=n=0; len; len--, i++)
                             {
-                                b1 = AddrGetByte(&Addr1);
-                                b2 = AddrGetByte(&Addr2);
+                                if( i==n )
+                                {
+                                    n = MIN(len, 4096 - (Addr1.offset & 0xFFF));
+                                    n = MIN(n, 4096 - (Addr2.offset & 0xFFF));
+                                    i = 0;
+
+                                    AddrReadBlock(&Addr1, blockBuf1, n);
+                                    AddrReadBlock(&Addr2, blockBuf2, n);
+                                }
+
+                                b1 = blockBuf1[i];
+                                b2 = blockBuf2[i];
 
                                 // Two ways of displaying data: by default display only
                                 // addresses that dont match. Extended way displays all.
@@ -485,6 +546,7 @@ BOOL cmdMove(char *args, int subClass)
 {
     TADDRDESC AddrSrc, AddrDest;        // Source and destination address
     DWORD len;                          // Length in bytes to move
+    DWORD n;                            // Length of a chunk
 
     // The format is: source L len dest. All parameters are mandatory.
 
@@ -516,29 +578,41 @@ BOOL cmdMove(char *args, int subClass)
                             AddrDest.sel = evalSel;
 
                             // Start a smart block move: If the destination address is
-                            // after the source, start from the tail and decrement.
-                            // Otherwise, start from the head and increment. That will
+                            // after the source, start from the tail chunk and go down.
+                            // Otherwise, start from the head chunk and go up. Since
+                            // every chunk is read before it is written, that will
                             // take care of overlapping blocks.
 
                             if( AddrDest.offset > AddrSrc.offset )
                             {
-                                AddrSrc.offset += len - 1;
-                                AddrDest.offset += len - 1;
+                                AddrSrc.offset += len;
+                                AddrDest.offset += len;
 
-                                while( len-- )
+                                while( len )
                                 {
-                                    AddrSetByte(&AddrDest, AddrGetByte(&AddrSrc), FALSE);
-                                    AddrSrc.offset--;
-                                    AddrDest.offset--;
+                                    n = MIN(len, BLOCK_CHUNK);
+
+                                    AddrSrc.offset -= n;
+                                    AddrDest.offset -= n;
+
+                                    AddrReadBlock(&AddrSrc, blockBuf1, n);
+                                    BlockWrite(&AddrDest, blockBuf1, n);
+
+                                    AddrDest.offset -= n;
+                                    len -= n;
                                 }
                             }
                             else
                             {
-                                while( len-- )
+                                while( len )
                                 {
-                                    AddrSetByte(&AddrDest, AddrGetByte(&AddrSrc), FALSE);
-                                    AddrSrc.offset++;
-                                    AddrDest.offset++;
+                                    n = MIN(len, BLOCK_CHUNK);
+
+                                    AddrReadBlock(&AddrSrc, blockBuf1, n);
+                                    BlockWrite(&AddrDest, blockBuf1, n);
+
+                                    AddrSrc.offset += n;
+                                    len -= n;
                                 }
                             }
                         }
@@ -50,10 +50,15 @@
 *                                                                             *
 ******************************************************************************/
 
+// Glyphs are stored one after another, ysize rows each. A row is stored
+// in bpl bytes, the leftmost pixel being the MSB of the first byte.
+
 typedef struct
 {
     BYTE *Bitmap;                       // Address of the font bitmap
     int ysize;                          // Font height in pixels
+    int xsize;                          // Font width in pixels
+    int bpl;                            // Bytes per glyph row
 } TFont;
 
 extern TFont Font[MAX_FONTS];
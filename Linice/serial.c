@@ -78,6 +78,7 @@ typedef struct                          // Define serial connection structure
     int baud;                           // Baud rate number
     int rate;                           // Baud rate translated
     DWORD sent;                         // Number of bytes sent over the port
+    DWORD received;                     // Number of bytes received over the port
     DWORD parity, overrun, framing, brk;// Number of these errors
     int head, tail;                     // Head and Tail of the buffer:
     BYTE outBuffer[MAX_SERIAL_BUFFER];  // Serial output asynchronous buffer
@@ -194,7 +195,7 @@ BOOL SerialInit(int com, int baud)
 
 #endif // SERIAL_POLLING
 
-        Serial.sent = 0;
+        Serial.sent = Serial.received = 0;
         Serial.parity = Serial.overrun = Serial.framing = Serial.brk = 0;
         Serial.head = 0;
         Serial.tail = 0;
@@ -230,8 +231,8 @@ BOOL SerialInit(int com, int baud)
 void SerialPrintStat()
 {
     if( pOut == &outVT100 )
-        dprinth(1, "Serial is VT100: COM%d %x baud (IRQ=%d IO=%X) Sent: %d P%d O%d F%d B%d  %s",
-            Serial.com, Serial.baud, Serial.irq, Serial.port, Serial.sent,
+        dprinth(1, "Serial is VT100: COM%d %x baud (IRQ=%d IO=%X) Sent: %d Received: %d P%d O%d F%d B%d  %s",
+            Serial.com, Serial.baud, Serial.irq, Serial.port, Serial.sent, Serial.received,
             Serial.parity, Serial.overrun, Serial.framing, Serial.brk, smode );
     else
         dprinth(1, "Serial is OFF");
@@ -291,11 +292,14 @@ void SerialHandler(int IRQ)
                     outp(Serial.port + 0, data);
                     lastData = data;
                     Serial.sent++;
+                    deb.Stat[deb.cpu].nSerialSent++;
                 }
                 break;
 
             case 0x02:      // Data received in input buffer
                     data = inp(Serial.port);
+                    Serial.received++;
+                    deb.Stat[deb.cpu].nSerialReceived++;
 
                     // We dont support mouse yet, so assume it is a serial
                     // remote terminal sending us a character which we will
@@ -315,6 +319,7 @@ void SerialHandler(int IRQ)
                     if( status & (1<<1) ) Serial.overrun++;
                     if( status & (1<<3) ) Serial.framing++;
                     if( status & (1<<4) ) Serial.brk++;
+                    deb.Stat[deb.cpu].nSerialErrors++;
 
                     // Resend the data byte
                     outp(Serial.port + 0, lastData);
@@ -338,6 +343,8 @@ BYTE SerialIn()
         if( (status & 1)==1 )
         {
             value = inp(Serial.port);
+            Serial.received++;
+            deb.Stat[deb.cpu].nSerialReceived++;
 
             return( value );
         }
@@ -376,6 +383,7 @@ void SerialOut(BYTE data)
             // Transmitter buffer is empty..
             outp(Serial.port + 0, data);
             Serial.sent++;
+            deb.Stat[deb.cpu].nSerialSent++;
 
             return;
         }
@@ -394,6 +402,7 @@ void SerialOut(BYTE data)
         // Transmitter buffer is empty..
         outp(Serial.port + 0, data);
         Serial.sent++;
+        deb.Stat[deb.cpu].nSerialSent++;
     }
     else
     {
@@ -83,10 +83,14 @@ static int fRegistered = 0;             // Flag that we are registered
 static int DotCommand(char *pCommand)
 {
     TLINICEREGS *cpuRegs;               // Debugee current register state
+    TLINICEDISASM dis[4];               // Disassembled instructions
     char key;                           // Key that we depressed
     char buf[80];                       // Temp line buffer
     int dump;                           // Temp dump buffer
     int result;                         // Result of an argument expression
+    unsigned int offset;                // Offset from a symbol
+    char *pSym;                         // Symbol name
+    int i, n;
 
     // If there was any expression specified as an argument, evaluate it
     // Note that the space that separates command from the rest of the arguments
@@ -110,6 +114,8 @@ static int DotCommand(char *pCommand)
         ext.dprint(" 1 .. Disassemble at CS:EIP");
         ext.dprint(" 2 .. Dump int at kernel DS:ESI");
         ext.dprint(" 3 .. Show GDT of CS");
+        ext.dprint(" 4 .. Show symbol at CS:EIP");
+        ext.dprint(" 5 .. Disassemble 4 instructions at CS:EIP");
         ext.dprint(" 9 .. Exit this menu");
         ext.dprint("");                 // Empty line
 
@@ -127,18 +133,12 @@ static int DotCommand(char *pCommand)
                 ext.dprint("%s", buf);
             break;
 
-            case '2':   // Dump 8 bytes at DS:ESI
-                // Verify the address is accessible. If the given selector
-                // is 0, kernel DS will be used instead.
-                if( ext.MemVerify(0, cpuRegs->esi, 8) )
-                {
-                    // This will of course default to kernel DS.
-                    // Since kernel DS can addresses 4Gb, that is not the problem
-                    // in most of the cases when we need a memory access.
-                    dump = *(int *)cpuRegs->esi;
-
+            case '2':   // Dump int at DS:ESI
+                // The read is guarded and returns the number of bytes that
+                // could be read. If the given selector is 0, kernel DS will
+                // be used instead.
+                if( ext.MemRead(&dump, 0, cpuRegs->esi, sizeof(dump))==sizeof(dump) )
                     ext.dprint("*esi = %08X", dump);
-                }
                 else
                     ext.dprint("*DS:ESI is not accessible!");
             break;
@@ -147,6 +147,20 @@ static int DotCommand(char *pCommand)
                 sprintf(buf, "gdt %x", cpuRegs->cs);
                 ext.Execute(buf);
             break;
+
+            case '4':   // Show symbol at CS:EIP
+                pSym = ext.SymName(cpuRegs->eip, &offset);
+                if( pSym )
+                    ext.dprint("%s+%X", pSym, offset);
+                else
+                    ext.dprint("No symbol at %08X", cpuRegs->eip);
+            break;
+
+            case '5':   // Disassemble a block of instructions
+                n = ext.DisasmBlock(dis, 4, cpuRegs->cs, cpuRegs->eip);
+                for(i=0; i<n; i++)
+                    ext.dprint("%08X  %s", dis[i].offset, dis[i].text);
+            break;
         }
     }
     while( key!='9' );
@@ -67,12 +67,17 @@ MODULE_LICENSE("GPL");
 #include <asm/pgtable.h>
 #include <linux/vmalloc.h>
 #include <linux/pci.h>
+#include <linux/fb.h>
+#include <linux/sched.h>
+#include <linux/string.h>
 
 #ifdef SMP
 #include <asm/smp.h>
 #include <asm/mtrr.h>
 #include <asm/mpspec.h>
 #include <asm/pgalloc.h>
+#include <asm/hw_irq.h>
+#include <asm/apic.h>
 #endif
 
 #ifdef _PCIHDR
@@ -193,6 +198,101 @@ int ice_smp_processor_id(void)
 #endif // SMP
 }
 
+/******************************************************************************
+*   Locates the register frame that the call-function IPI saved on the
+*   current kernel stack and returns the state of the interrupted code.
+*   pStack is an address within the stack frame of the IPI callback.
+******************************************************************************/
+int ice_get_ipi_regs(void *pStack, TIPIREGS *pIpi)
+{
+#if defined(SMP) && defined(CALL_FUNCTION_VECTOR)
+    unsigned long p = (unsigned long) pStack & ~3;
+    unsigned long top = ((unsigned long) pStack & ~(THREAD_SIZE-1)) + THREAD_SIZE;
+    struct pt_regs *regs;
+
+    for(; p + sizeof(struct pt_regs) <= top; p += 4)
+    {
+        regs = (struct pt_regs *) p;
+
+        if( (regs->orig_eax==~CALL_FUNCTION_VECTOR || regs->orig_eax==CALL_FUNCTION_VECTOR-256)
+          && ((regs->xcs & 0xFFFF)==__KERNEL_CS || (regs->xcs & 0xFFFF)==__USER_CS) )
+        {
+            pIpi->eax = regs->eax;
+            pIpi->ebx = regs->ebx;
+            pIpi->ecx = regs->ecx;
+            pIpi->edx = regs->edx;
+            pIpi->esi = regs->esi;
+            pIpi->edi = regs->edi;
+            pIpi->ebp = regs->ebp;
+            pIpi->eip = regs->eip;
+            pIpi->eflags = regs->eflags;
+            pIpi->cs  = regs->xcs & 0xFFFF;
+            pIpi->ds  = regs->xds & 0xFFFF;
+            pIpi->es  = regs->xes & 0xFFFF;
+
+            // Kernel code does not push the stack on the interrupt
+            if( user_mode(regs) )
+            {
+                pIpi->esp = regs->esp;
+                pIpi->ss  = regs->xss & 0xFFFF;
+            }
+            else
+            {
+                pIpi->esp = (unsigned long) &regs->esp;
+                pIpi->ss  = __KERNEL_DS;
+            }
+
+            return( 1 );
+        }
+    }
+#endif // SMP
+    return( 0 );
+}
+
+int ice_smp_num_cpus(void)
+{
+#ifdef SMP
+    return( num_online_cpus() );
+#else
+    return( 1 );
+#endif // SMP
+}
+
+/******************************************************************************
+*   Sends an NMI to all other CPUs through the local APIC. NMI is delivered
+*   even to the CPUs that are running with interrupts disabled.
+*   Returns 0 if this kernel can not do that.
+******************************************************************************/
+int ice_send_nmi_allbutself(void)
+{
+#if defined(SMP) && defined(CONFIG_X86_LOCAL_APIC)
+    unsigned long flags;
+
+    local_irq_save(flags);
+    apic_wait_icr_idle();
+    apic_write_around(APIC_ICR, APIC_DEST_ALLBUT | APIC_DEST_LOGICAL | APIC_DM_NMI);
+    local_irq_restore(flags);
+
+    return( 1 );
+#else
+    return( 0 );
+#endif // SMP
+}
+
+unsigned int ice_get_cpu_khz(void)
+{
+    return( cpu_khz );
+}
+
+unsigned int ice_get_cpu_model(void)
+{
+    // Family and model of the boot CPU, or 0 if it does not have MSRs
+    if( !cpu_has_msr )
+        return( 0 );
+
+    return( (boot_cpu_data.x86 << 8) | (boot_cpu_data.x86_model & 0xFF) );
+}
+
 
 DWORD ice_io_apic_read(int n, DWORD reg)
 {
@@ -237,10 +337,78 @@ typedef int (*PFNIOCTL)(struct inode *inode, struct file *file, unsigned int ioc
 extern int DriverOpen(void);
 extern int DriverClose(void);
 extern int DriverIOCTL(void *, void *, unsigned int, unsigned long);
+extern void *DriverMmap(unsigned long offset, unsigned long size, int *pfReadOnly);
+extern void DriverMunmap(void *pBase);
+
+static void ice_vm_open(struct vm_area_struct *vma)
+{
+    int fReadOnly;
+
+    DriverMmap(vma->vm_pgoff << PAGE_SHIFT, vma->vm_end - vma->vm_start, &fReadOnly);
+}
+
+static void ice_vm_close(struct vm_area_struct *vma)
+{
+    DriverMunmap(vma->vm_private_data);
+}
+
+// Mapped regions are allocated using vmalloc, so we fault in page by page
+
+static struct page *ice_vm_nopage(struct vm_area_struct *vma, unsigned long address, int *type)
+{
+    struct page *page;
+    unsigned long offset = address - vma->vm_start;
+
+    if( offset >= vma->vm_end - vma->vm_start )
+        return( NOPAGE_SIGBUS );
+
+    page = vmalloc_to_page((char *)vma->vm_private_data + offset);
+    get_page(page);
+
+    if( type )
+        *type = VM_FAULT_MINOR;
+
+    return( page );
+}
+
+static struct vm_operations_struct ice_vm_ops = {
+    open:       ice_vm_open,
+    close:      ice_vm_close,
+    nopage:     ice_vm_nopage,
+};
+
+static int ice_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    void *pBase;
+    int fReadOnly = 0;
+
+    pBase = DriverMmap(vma->vm_pgoff << PAGE_SHIFT, vma->vm_end - vma->vm_start, &fReadOnly);
+    if( pBase==NULL )
+        return( -EINVAL );
+
+    // Read-only regions can not be mapped writable, not even later
+    if( fReadOnly )
+    {
+        if( vma->vm_flags & VM_WRITE )
+        {
+            DriverMunmap(pBase);
+            return( -EACCES );
+        }
+
+        vma->vm_flags &= ~VM_MAYWRITE;
+    }
+
+    vma->vm_private_data = pBase;
+    vma->vm_ops = &ice_vm_ops;
+    vma->vm_flags |= VM_RESERVED;
+
+    return( 0 );
+}
 
 static struct file_operations ice_fops = {
     owner:      THIS_MODULE,
     ioctl:      (PFNIOCTL)DriverIOCTL,
+    mmap:       ice_mmap,
     open:       (PFNOPEN)DriverOpen,
     release:    (PFNCLOSE)DriverClose,
 };
@@ -299,11 +467,98 @@ void ice_iounmap(void *pMemory)
     iounmap(pMemory);
 }
 
+#ifdef CONFIG_FB
+
+// Framebuffer drivers that pan by only writing the display start, without
+// sleeping or taking locks. Others, like the KMS (drm) framebuffers that
+// take the modeset locks, are not panned from within the debugger.
+
+static const char *sFbPanSafe[] = { "VESA VGA", "VGA16 VGA", "MATROX", "ATI Radeon", NULL };
+
+static int ice_fb_pan_safe(const char *id)
+{
+    int i;
+
+    for(i=0; sFbPanSafe[i]; i++)
+        if( !strncmp(id, sFbPanSafe[i], strlen(sFbPanSafe[i])) )
+            return( 1 );
+
+    return( 0 );
+}
+
+int ice_get_fb_info(TFBINFO *pFb)
+{
+    struct fb_info *info = registered_fb[0];
+
+    if( num_registered_fb > 0 && info )
+    {
+        pFb->smem_start     = info->fix.smem_start;
+        pFb->smem_len       = info->fix.smem_len;
+        pFb->xres           = info->var.xres;
+        pFb->yres           = info->var.yres;
+        pFb->xres_virtual   = info->var.xres_virtual;
+        pFb->yres_virtual   = info->var.yres_virtual;
+        pFb->yoffset        = info->var.yoffset;
+        pFb->line_length    = info->fix.line_length;
+        pFb->bits_per_pixel = info->var.bits_per_pixel;
+        pFb->red_offset     = info->var.red.offset;
+        pFb->red_length     = info->var.red.length;
+        pFb->green_offset   = info->var.green.offset;
+        pFb->green_length   = info->var.green.length;
+        pFb->blue_offset    = info->var.blue.offset;
+        pFb->blue_length    = info->var.blue.length;
+        pFb->fPan = info->fbops->fb_pan_display!=NULL && info->fix.ypanstep && ice_fb_pan_safe(info->fix.id);
+
+        return( 0 );
+    }
+
+    return( -1 );
+}
+
+int ice_fb_pan(unsigned int yoffset)
+{
+    struct fb_info *info = registered_fb[0];
+    struct fb_var_screeninfo var;
+
+    if( num_registered_fb > 0 && info && info->fbops->fb_pan_display && ice_fb_pan_safe(info->fix.id) )
+    {
+        var = info->var;
+        var.yoffset = yoffset;
+
+        return( info->fbops->fb_pan_display(&var, info) );
+    }
+
+    return( -1 );
+}
+
+#else // CONFIG_FB
+
+int ice_get_fb_info(TFBINFO *pFb)
+{
+    return( -1 );
+}
+
+int ice_fb_pan(unsigned int yoffset)
+{
+    return( -1 );
+}
+
+#endif // CONFIG_FB
+
 unsigned int ice_page_offset(void)
 {
     return( PAGE_OFFSET );
 }
 
+#ifndef THREAD_SIZE
+#define THREAD_SIZE     (2*PAGE_SIZE)
+#endif
+
+unsigned int ice_thread_size(void)
+{
+    return( THREAD_SIZE );
+}
+
 long ice_copy_to_user(void *p1, void *p2, int len)
 {
     return( copy_to_user(p1, p2, len) );
@@ -33,9 +33,14 @@
 //////////////////////////////////////////////////////////////////////////////
 // PRIVATE STRUCTURES
 //////////////////////////////////////////////////////////////////////////////
-#define LINICEEXTVERSION        0x100           // Current extension interface version
+#define LINICEEXTVERSION        0x200           // Current extension interface version
 #define LINICEEXTSIZE       sizeof(TLINICEEXT)  // Current extension interface structure size
 
+// Version 1 extensions register the structure only up to the v2 services
+
+#define LINICEEXTVERSION1       0x100           // Version 1 extension interface
+#define LINICEEXTSIZE1      ((int)&((TLINICEEXT *)0)->MemRead)
+
 //////////////////////////////////////////////////////////////////////////////
 // TYPED STRUCTURE DEFINITIONS
 //////////////////////////////////////////////////////////////////////////////
@@ -64,6 +69,42 @@ typedef struct tagLiniceRegs
     unsigned int   eflags;
 } TLINICEREGS;
 
+// Define one disassembled instruction as returned by the DisasmBlock service
+
+#define LINICEEXT_DISASM_LEN    96      // Size of the instruction text
+
+typedef struct tagLiniceDisasm
+{
+    unsigned int   offset;              // Address of the instruction
+    int            len;                 // Instruction length in bytes
+    char           text[LINICEEXT_DISASM_LEN];
+
+} TLINICEDISASM;
+
+// Define a variable as returned by the ReadVar service
+
+#define LINICEEXT_TYPE_LEN      80      // Size of the type name
+
+typedef struct tagLiniceVar
+{
+    unsigned int   address;             // Address of the variable, 0 if it is not in memory
+    int            size;                // Size of the variable in bytes
+    char           type[LINICEEXT_TYPE_LEN];
+
+} TLINICEVAR;
+
+// Breakpoint types and access verbs for the BpSet service
+
+#define LINICEBP_BPX            1       // Execution breakpoint
+#define LINICEBP_BPIO           3       // IO port breakpoint
+#define LINICEBP_BPMB           4       // Memory byte breakpoint
+#define LINICEBP_BPMW           5       // Memory word breakpoint
+#define LINICEBP_BPMD           7       // Memory dword breakpoint
+
+#define LINICEBP_R              1       // Break on read
+#define LINICEBP_W              2       // Break on write
+#define LINICEBP_RW             3       // Break on read or write
+
 //////////////////////////////////////////////////////////////////////////////
 // CALLBACK FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
@@ -77,6 +118,16 @@ typedef void (*PEXT_NOTIFY)(int Notification);
 
 typedef int (*PEXT_QUERYTOKEN)(int *pResult, char *pToken, int len);
 
+// Called when a breakpoint set by the BpSet service, or one that the BpAttach
+// service attached it to, hits. It is called at the trap time in place of the
+// DO statements, so no command strings are parsed on that path.
+
+typedef int (*PEXT_BREAKPOINT)(TLINICEREGS *pRegs, int index, void *pContext);
+
+#define PEXT_BREAKPOINT_CONTINUE    0   // Let the debugee continue
+#define PEXT_BREAKPOINT_POPUP       1   // Stop in the debugger
+#define PEXT_BREAKPOINT_LOG         2   // Log the hit into the history and continue
+
 // Function called by the extension module to Linice:
 
 typedef TLINICEREGS *(*PLINICEEXT_GETREGS)(void);
@@ -87,6 +138,20 @@ typedef int (*PLINICEEXT_EXEC)(char *pCommand);
 typedef int (*PLINICEEXT_GETCH)(int fPolled);
 typedef int (*PLINICEEXT_MEMVERIFY)(int sel, int offset, int size);
 
+// Version 2 services:
+
+struct tagLiniceExt;
+
+typedef int (*PLINICEEXT_MEMREAD)(void *pDest, int sel, int offset, int size);
+typedef int (*PLINICEEXT_MEMWRITE)(int sel, int offset, void *pSrc, int size);
+typedef char *(*PLINICEEXT_SYMNAME)(unsigned int address, unsigned int *pOffset);
+typedef int (*PLINICEEXT_SYMADDRESS)(unsigned int *pAddress, char *pName);
+typedef int (*PLINICEEXT_DISASMBLOCK)(TLINICEDISASM *pList, int count, int sel, int offset);
+typedef int (*PLINICEEXT_READVAR)(TLINICEVAR *pVar, char *pExpr, void *pBuf, int size);
+typedef int (*PLINICEEXT_BPSET)(struct tagLiniceExt *pExt, int type, int sel, int offset, int access, PEXT_BREAKPOINT Callback, void *pContext);
+typedef int (*PLINICEEXT_BPCLEAR)(struct tagLiniceExt *pExt, int index);
+typedef int (*PLINICEEXT_BPATTACH)(struct tagLiniceExt *pExt, int index, PEXT_BREAKPOINT Callback, void *pContext);
+
 
 typedef struct tagLiniceExt
 {
@@ -115,6 +180,20 @@ typedef struct tagLiniceExt
     PLINICEEXT_GETCH     Getch;         // Get input character
     PLINICEEXT_MEMVERIFY MemVerify;     // Verify memory range for access
 
+//------------------------------------------------------------------
+// Version 2 services, not present in a version 1 structure
+// Selector 0 selects the kernel CS for code and kernel DS for data
+//------------------------------------------------------------------
+    PLINICEEXT_MEMREAD     MemRead;     // Read memory, returns the bytes read before a fault
+    PLINICEEXT_MEMWRITE    MemWrite;    // Write memory, returns the bytes written before a fault
+    PLINICEEXT_SYMNAME     SymName;     // Name of the symbol at or below an address, or NULL
+    PLINICEEXT_SYMADDRESS  SymAddress;  // Address of a symbol, returns 0 if not found
+    PLINICEEXT_DISASMBLOCK DisasmBlock; // Disassemble a number of instructions, returns the count
+    PLINICEEXT_READVAR     ReadVar;     // Read a typed variable, returns its size or -1
+    PLINICEEXT_BPSET       BpSet;       // Set a breakpoint with a callback, returns its index or -1
+    PLINICEEXT_BPCLEAR     BpClear;     // Clear a breakpoint set by BpSet
+    PLINICEEXT_BPATTACH    BpAttach;    // Attach a callback to any breakpoint, NULL detaches it
+
 } TLINICEEXT;
 
 // These functions are exported by Linice and should link with the module
@@ -115,6 +115,93 @@ typedef struct
 
 } PACKED TXINITPACKET;
 
+// Define symbol table staging packet that is sent before mapping the table
+
+typedef struct
+{
+    DWORD dwSize;                       // Size of the symbol table file in bytes
+    DWORD dwMapSize;                    // (Out) Size of the staging area to map
+
+} PACKED TSYMMAPPACKET;
+
+// Define packet used to fetch a range of history lines in one call
+
+typedef struct
+{
+    DWORD dwLine;                       // (In) Number of the first line to fetch
+                                        // (Out) Number of the line following the last one fetched
+    DWORD dwFirst;                      // (Out) Number of the first line fetched
+    DWORD dwLines;                      // (Out) Total number of lines ever added to the history
+    DWORD nLines;                       // (Out) Number of lines fetched
+    DWORD dwSize;                       // (In) Size of the buffer (Out) Bytes stored in the buffer
+    DWORD dwHistorySize;                // (Out) Size of the history buffer, to map it
+    char *pBuf;                         // Buffer that receives ASCIIZ lines back to back
+
+} PACKED THISBUFPACKET;
+
+// Header at the start of the history buffer, as seen through the ICE_MMAP_HISTORY
+// mapping. Line records (THISLINE) follow it. Record links are kernel addresses;
+// subtract dwBase from them to get offsets within the mapping.
+//
+// dwGen is incremented before and after every change of the history buffer,
+// so it is odd while the buffer is being changed. A reader should sample it,
+// read the lines and sample it again; if it changed, the read has to be retried.
+
+typedef struct
+{
+    DWORD dwGen;                        // Generation counter
+    DWORD dwLines;                      // Total number of lines ever added to the history
+    DWORD dwBase;                       // Kernel address of the history buffer
+    DWORD dwSize;                       // Size of the history buffer in bytes
+    DWORD dwHead;                       // Offset of the head record (next one to be written)
+    DWORD dwTail;                       // Offset of the tail record (the oldest line)
+
+} PACKED THISHEADER;
+
+typedef struct
+{
+    DWORD next;                         // Kernel address of the next line record
+    DWORD prev;                         // Kernel address of the previous line record
+    BYTE bSize;                         // Size of the whole record
+    char line[1];                       // ASCIIZ line itself
+
+} PACKED THISLINE;
+
+// Define packet used to fetch the sampled call stacks as folded stacks
+
+typedef struct
+{
+    DWORD dwNode;                       // (In) Call tree node to start with
+                                        // (Out) Node to continue with
+    DWORD dwNodes;                      // (Out) Index past the last node of the tree
+    DWORD dwSamples;                    // (Out) Number of call stack samples
+    DWORD dwSize;                       // (In) Size of the buffer (Out) Bytes stored in the buffer
+    char *pBuf;                         // Buffer that receives the folded stack lines
+
+} PACKED TPROFPACKET;
+
+// Define packet used to fetch the screen of the headless output driver
+
+typedef struct
+{
+    DWORD dwSizeX, dwSizeY;             // (Out) Screen width and height
+    DWORD dwX, dwY;                     // (Out) Cursor coordinates
+    DWORD dwFrames;                     // (Out) Number of frames drawn
+    DWORD dwFrameBytes;                 // (Out) Bytes sent to the driver in the last frame
+    DWORD dwFrameCells;                 // (Out) Cells written in the last frame
+    DWORD dwBytes;                      // (Out) Total bytes sent to the driver
+    DWORD dwCells;                      // (Out) Total cells written
+    DWORD dwSize;                       // (In) Size of the buffer (Out) Bytes stored in the buffer
+    WORD *pBuf;                         // Buffer that receives the screen cells, row by row,
+                                        // as character + (attribute << 8); may be NULL
+
+} PACKED TSCREENPACKET;
+
+// Offsets (in bytes) to pass to mmap() for various mappable regions
+
+#define ICE_MMAP_SYMBOLS        0x00000000  // Symbol table staging area
+#define ICE_MMAP_HISTORY        0x10000000  // History buffer (read only)
+
 
 /////////////////////////////////////////////////////////////////
 // DEVICE IO CONTROL CODES
@@ -152,6 +239,32 @@ typedef struct
 //      Sent by the linsym multiple times to retrieve line by line of the
 //      history buffer. When finished, call returns error instead of 0.
 //
+//  ICE_IOCTL_HISBUF_BULK
+//      Sent by the linsym to fetch as many history lines as fit into the
+//      given buffer, starting with the given line number. Lines that were
+//      already released from the history are skipped. Returns a short read
+//      if the history changed while copying; simply call it again.
+//
+//  ICE_IOCTL_SYM_STAGE
+//      Sent by the linsym to reserve a page aligned symbol table staging
+//      area in the symbol pool. The area is then mapped using mmap() at the
+//      offset ICE_MMAP_SYMBOLS and the symbol file is read directly into it.
+//      Size of 0 releases the staging area.
+//
+//  ICE_IOCTL_SYM_COMMIT
+//      Sent by the linsym after the staging area has been filled and
+//      unmapped. Validates the table and links it in, same as ADD_SYM.
+//
+//  ICE_IOCTL_PROFILE_FOLDED
+//      Sent by the linsym to fetch the sampled call stacks, one line per
+//      stack in the folded format ("caller;callee count"). Call it again
+//      with the returned node number until it reaches the end of the tree.
+//
+//  ICE_IOCTL_SCREEN
+//      Sent by the linsym to fetch the content of the headless output
+//      driver screen and its drawing statistics. The screen is kept even
+//      after switching to another display, so it can be read after a crash.
+//
 
 #define ICE_IOC_MAGIC       'I'         // Magic IOctl number (8 bits)
 
@@ -163,6 +276,11 @@ typedef struct
 #define ICE_IOCTL_XDGA          _IOC(_IOC_WRITE, ICE_IOC_MAGIC, 0x86, sizeof(TXINITPACKET))
 #define ICE_IOCTL_HISBUF_RESET  _IOC(_IOC_WRITE, ICE_IOC_MAGIC, 0x87, 0)
 #define ICE_IOCTL_HISBUF        _IOC(_IOC_READ,  ICE_IOC_MAGIC, 0x88, MAX_STRING)
+#define ICE_IOCTL_SYM_STAGE     _IOC(_IOC_WRITE|_IOC_READ, ICE_IOC_MAGIC, 0x89, sizeof(TSYMMAPPACKET))
+#define ICE_IOCTL_SYM_COMMIT    _IOC(_IOC_WRITE, ICE_IOC_MAGIC, 0x8A, 0)
+#define ICE_IOCTL_HISBUF_BULK   _IOC(_IOC_WRITE|_IOC_READ, ICE_IOC_MAGIC, 0x8B, sizeof(THISBUFPACKET))
+#define ICE_IOCTL_PROFILE_FOLDED _IOC(_IOC_WRITE|_IOC_READ, ICE_IOC_MAGIC, 0x8C, sizeof(TPROFPACKET))
+#define ICE_IOCTL_SCREEN        _IOC(_IOC_WRITE|_IOC_READ, ICE_IOC_MAGIC, 0x8D, sizeof(TSCREENPACKET))
 
 
 #endif //  _ICE_IOCTL_H_
@@ -91,6 +91,11 @@
 //
 #define MAX_BREAKPOINTS     256
 
+//////////////////////////////////////////////////////////////////////
+// Define maximum number of pages watched by page protection (bits in a DWORD)
+//
+#define MAX_WATCH_PAGES     32
+
 //////////////////////////////////////////////////////////////////////
 // Define number of bytes per line for data dump command.
 // This is hard-coded at 16 since data edit functions depend on that.
@@ -117,8 +122,23 @@
 //  8x8
 //  8x14
 //  8x16
+//  font converted by tools/Font/fontgen (make FONT=file)
 //
+#ifdef FONT_EXTRA
+#define MAX_FONTS           4
+#else
 #define MAX_FONTS           3
+#endif
+
+// Maximum width of a font in pixels (multiple of 8)
+//
+#define MAX_FONT_X          32
+
+// Fonts are scaled up by an integer factor on high resolution displays:
+// by one for each this many lines of the display, up to the maximum scale
+//
+#define FONT_SCALE_YRES     1024
+#define MAX_FONT_SCALE      4
 
 //////////////////////////////////////////////////////////////////////
 // Define if the serial out connection will use polling method or
@@ -142,11 +162,55 @@
 //
 #define TIMER_CARRET        20
 
+//////////////////////////////////////////////////////////////////////
+// Linice code image integrity check: number of 4K blocks we keep the
+// checksums of, number of blocks verified on each popup from a step or
+// trace and the background verify rate while waiting for a key (out of 100Hz)
+//
+#define MAX_IMAGE_BLOCKS    1024
+#define IMAGE_VERIFY_BLOCKS 4
+#define TIMER_IMAGE         5
+
 //////////////////////////////////////////////////////////////////////
 // Number of IO APIC interrupt redirection registers that we keep
 //
 #define MAX_IOAPICREG       16
 
+//////////////////////////////////////////////////////////////////////
+// Maximum number of CPUs whose state we keep on a SMP break
+//
+#define MAX_CPU             16
+
+//////////////////////////////////////////////////////////////////////
+// Number of timer samples that the profiler keeps for each CPU, and
+// the number of distinct symbols and modules it can list
+//
+#define MAX_PROFILE_SAMPLES 1024
+#define MAX_PROFILE_SYMS    256
+#define MAX_PROFILE_MODULES 32
+
+//////////////////////////////////////////////////////////////////////
+// Number of nodes in the sampled call tree and the maximum number
+// of frames that are walked for a call stack sample
+//
+#define MAX_CALL_NODES      2048
+#define MAX_CALL_DEPTH      16
+
+//////////////////////////////////////////////////////////////////////
+// Size of the printk() capture ring of each CPU (power of 2), the
+// number of arguments and the string size kept for a message, and
+// the longest message line that is printed
+//
+#define MAX_PRINTK_RING     8192
+#define MAX_PRINTK_ARGS     16
+#define MAX_PRINTK_STRING   256
+#define MAX_PRINTK_LINE     512
+
+//////////////////////////////////////////////////////////////////////
+// Size of the buffer that holds the /proc/linice statistics page
+//
+#define MAX_PROC_STAT       16384
+
 //////////////////////////////////////////////////////////////////////
 // Maximum array size to expand; any more elements will be ignored
 //
@@ -162,6 +226,12 @@
 //
 #define MAX_STACK_LEVELS    16
 
+//////////////////////////////////////////////////////////////////////
+// Number of stack dwords searched for a return address when a frame
+// can not be unwound by the call frame information or the frame pointer
+//
+#define MAX_UNWIND_SCAN     256
+
 //////////////////////////////////////////////////////////////////////
 // Maximum number of arguments to the CALL command
 //
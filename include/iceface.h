@@ -81,6 +81,31 @@ typedef struct
     char *pDevice;
 } TPCI;
 
+typedef struct
+{
+    unsigned long eax, ebx, ecx, edx;
+    unsigned long esi, edi, ebp, esp;
+    unsigned long eip, eflags;
+    unsigned long cs, ss, ds, es;
+
+} TIPIREGS;
+
+typedef struct
+{
+    unsigned long smem_start;           // Physical address of the framebuffer
+    unsigned long smem_len;             // Size of the framebuffer memory
+    unsigned int xres, yres;            // Visible resolution
+    unsigned int xres_virtual, yres_virtual; // Virtual resolution
+    unsigned int yoffset;               // Currently displayed line
+    unsigned int line_length;           // Stride in bytes
+    unsigned int bits_per_pixel;
+    unsigned int red_offset, red_length;
+    unsigned int green_offset, green_length;
+    unsigned int blue_offset, blue_length;
+    int fPan;                           // Display can be panned vertically
+
+} TFBINFO;
+
 /////////////////////////////////////////////////////////////////
 // SHARED FUNCTION PROTOS
 /////////////////////////////////////////////////////////////////
@@ -97,6 +122,11 @@ extern unsigned int  ice_io_apic_read(int, unsigned int);
 extern void  ice_io_apic_write(int, unsigned int, unsigned int);
 extern int   ice_smp_processor_id(void);
 extern void  ice_smp_call_function(void (*func)(void *), void *, int, int);
+extern int   ice_get_ipi_regs(void *, TIPIREGS *);
+extern int   ice_smp_num_cpus(void);
+extern int   ice_send_nmi_allbutself(void);
+extern unsigned int ice_get_cpu_khz(void);
+extern unsigned int ice_get_cpu_model(void);
 extern int   ice_init_proc(int, int);
 extern int   ice_close_proc(void);
 extern int   ice_register_chrdev(char *);
@@ -105,7 +135,10 @@ extern int   ice_get__NR_mknod(void);
 extern int   ice_get__NR_unlink(void);
 extern void *ice_ioremap(unsigned int, unsigned int);
 extern void  ice_iounmap(void *);
+extern int   ice_get_fb_info(TFBINFO *);
+extern int   ice_fb_pan(unsigned int);
 extern unsigned int ice_page_offset(void);
+extern unsigned int ice_thread_size(void);
 extern long  ice_copy_to_user(void *, void *, int);
 extern long  ice_copy_from_user(void *, void *, int);
 extern void  ice_get_pci_info(TPCI *, void *);
@@ -68,6 +68,12 @@
 
 static int IrqRedir[0x10] = { 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F };
 
+// How long do we wait for other CPUs to stop before giving up on them. The
+// timeout is in milliseconds if the CPU speed is known, or in TSC cycles.
+
+#define SMP_FREEZE_TIMEOUT_MS   100
+#define SMP_FREEZE_TIMEOUT      200000000
+
 
 /******************************************************************************
 *                                                                             *
@@ -76,6 +82,9 @@ static int IrqRedir[0x10] = { 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x
 ******************************************************************************/
 
 extern DWORD SpinUntilReset(DWORD *pSpinlock);
+extern DWORD GetRdtsc(BYTE *buffer8);
+extern void HookNmi(void);
+extern void WatchFlush(void);
 
 
 /******************************************************************************
@@ -254,6 +263,30 @@ void IoApicUnclamp()
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   static void smpCheckIn(PTCPU pCpu, ENUM eStop)                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Publishes the rest of the state of a stopped CPU into its slot. The
+*   register snapshot must already be stored. The slot becomes valid last.
+*
+*   Where:
+*       pCpu is the slot of the CPU that we are running on
+*       eStop is the way that CPU was stopped: STOP_IPI or STOP_NMI
+*
+******************************************************************************/
+static void smpCheckIn(PTCPU pCpu, ENUM eStop)
+{
+    GetSysreg(&pCpu->sysReg);
+
+    pCpu->pRegs = &pCpu->r;
+    pCpu->pTask = ice_get_current();
+    pCpu->eStop = eStop;
+    pCpu->fValid = TRUE;
+}
+
 /******************************************************************************
 *                                                                             *
 *   void smpSpin(void *ptr)                                                   *
@@ -262,14 +295,162 @@ void IoApicUnclamp()
 *
 *   Function that is called by smpSpinOtherCpus(void) to run on all other CPUs
 *   while the primary CPU (the one that faulted into the debugger) is
-*   executing the debugger
+*   executing the debugger.
+*
+*   Before spinning, each CPU publishes the state of the code it interrupted
+*   into its deb.Cpu[] slot so the debugger can switch to it.
 *
 ******************************************************************************/
 void smpSpin(void *ptr)
 {
+    TIPIREGS Ipi;                       // Interrupted register state
+    PTCPU pCpu;                         // Our own CPU slot
+    int cpu;
+
+    cpu = ice_smp_processor_id();
+    if( cpu < MAX_CPU )
+    {
+        pCpu = &deb.Cpu[cpu];
+
+        memset(&pCpu->r, 0, sizeof(TREGS));
+
+        // Look for the IPI frame starting from our own stack frame
+        if( ice_get_ipi_regs(&ptr, &Ipi) )
+        {
+            pCpu->r.eax    = Ipi.eax;
+            pCpu->r.ebx    = Ipi.ebx;
+            pCpu->r.ecx    = Ipi.ecx;
+            pCpu->r.edx    = Ipi.edx;
+            pCpu->r.esi    = Ipi.esi;
+            pCpu->r.edi    = Ipi.edi;
+            pCpu->r.ebp    = Ipi.ebp;
+            pCpu->r.esp    = Ipi.esp;
+            pCpu->r.eip    = Ipi.eip;
+            pCpu->r.eflags = Ipi.eflags;
+            pCpu->r.cs     = Ipi.cs;
+            pCpu->r.ss     = Ipi.ss;
+            pCpu->r.ds     = Ipi.ds;
+            pCpu->r.es     = Ipi.es;
+        }
+
+        smpCheckIn(pCpu, STOP_IPI);
+    }
+
     SpinUntilReset(&deb.fRunningIce);
 
     SetSysreg(&deb.sysReg);
+
+    // Pages watched by protection may have changed while we were spinning
+    WatchFlush();
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL smpNmiFreeze(PTREGS pRegs)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Called from the NMI handler. If we sent this CPU a freeze NMI, it
+*   publishes its state and spins until the debugger releases it.
+*
+*   The CPU does not execute IRET until it is released, so it keeps NMIs
+*   blocked and another NMI (a watchdog tick, or our own) can not nest here;
+*   it is latched and taken after the release. The fNmiPending flag is
+*   cleared on the first NMI, so a late freeze NMI that arrives after the
+*   debugger has already left is dropped instead of being passed to the
+*   kernel as an unknown NMI.
+*
+*   Where:
+*       pRegs is the register frame of the interrupted code
+*
+*   Returns:
+*       TRUE if the NMI was ours
+*       FALSE if it should be chained to the kernel NMI handler
+*
+******************************************************************************/
+BOOL smpNmiFreeze(PTREGS pRegs)
+{
+    PTCPU pCpu;                         // Our own CPU slot
+    int cpu;
+
+    cpu = ice_smp_processor_id();
+    if( cpu < MAX_CPU && deb.Cpu[cpu].fNmiPending )
+    {
+        pCpu = &deb.Cpu[cpu];
+        pCpu->fNmiPending = FALSE;
+
+        if( deb.fNmiFreezing )
+        {
+            memcpy(&pCpu->r, pRegs, sizeof(TREGS));
+
+            smpCheckIn(pCpu, STOP_NMI);
+
+            SpinUntilReset(&deb.fRunningIce);
+
+            SetSysreg(&deb.sysReg);
+
+            WatchFlush();
+        }
+
+        return( TRUE );
+    }
+
+    return( FALSE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void smpWaitForCpus(void)                                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Waits for all other CPUs to publish their state, timestamping each one
+*   as it arrives. All timestamps are taken on the debugger CPU, so they do
+*   not depend on the TSCs of different CPUs being in sync.
+*
+*   A CPU that does not stop within the timeout is left with an invalid
+*   slot. If it stops later, its slot becomes valid with zero latency.
+*
+******************************************************************************/
+static void smpWaitForCpus(void)
+{
+    BYTE Tsc[8];                        // Buffer for the full TSC value
+    BOOL fSeen[MAX_CPU];                // CPUs that we have already timestamped
+    DWORD dwNow, dwTimeout;
+    int cpu, nCpus, nLeft = 0;
+
+    nCpus = ice_smp_num_cpus();
+    if( nCpus > MAX_CPU )
+        nCpus = MAX_CPU;
+
+    dwTimeout = ice_get_cpu_khz() * SMP_FREEZE_TIMEOUT_MS;
+    if( dwTimeout==0 )
+        dwTimeout = SMP_FREEZE_TIMEOUT;
+
+    for(cpu=0; cpu<nCpus; cpu++)
+    {
+        fSeen[cpu] = cpu==deb.cpu;
+        if( !fSeen[cpu] )
+            nLeft++;
+    }
+
+    do
+    {
+        dwNow = GetRdtsc(Tsc);
+
+        for(cpu=0; cpu<nCpus; cpu++)
+        {
+            if( !fSeen[cpu] && *(volatile BOOL *)&deb.Cpu[cpu].fValid )
+            {
+                deb.Cpu[cpu].dwLatency = dwNow - deb.dwEntryTsc;
+                fSeen[cpu] = TRUE;
+                nLeft--;
+            }
+        }
+    }
+    while( nLeft && dwNow - deb.dwEntryTsc < dwTimeout );
+
+    deb.dwFreezeLatency = dwNow - deb.dwEntryTsc;
 }
 
 /******************************************************************************
@@ -278,12 +459,109 @@ void smpSpin(void *ptr)
 *                                                                             *
 *******************************************************************************
 *
-*   Sends an IPI to all other CPU to start spinning on a 'fRunningIce'
-*   semaphore.
+*   Stops all other CPUs so they spin on a 'fRunningIce' semaphore. Initializes
+*   the CPU state array with the state of the debugger CPU; other CPUs fill in
+*   their own slots.
+*
+*   By default, CPUs are stopped by the call-function IPI, which a CPU only
+*   takes when it runs with interrupts enabled. With SET NMIFREEZE ON, they
+*   are stopped by an NMI IPI instead, which also stops the CPUs that are
+*   spinning with interrupts disabled.
 *
 ******************************************************************************/
 void smpSpinOtherCpus(void)
 {
-    ice_smp_call_function(smpSpin, NULL, TRUE, 0);
+    PTCPU pCpu;
+    int cpu;
+
+    for(cpu=0; cpu<MAX_CPU; cpu++)
+    {
+        deb.Cpu[cpu].fValid = FALSE;
+        deb.Cpu[cpu].dwLatency = 0;
+    }
+
+    deb.cpuCur = deb.cpu;
+    deb.dwFreezeLatency = 0;
+
+    if( deb.cpu < MAX_CPU )
+    {
+        pCpu = &deb.Cpu[deb.cpu];
+
+        memcpy(&pCpu->sysReg, &deb.sysReg, sizeof(TSysreg));
+
+        pCpu->pRegs = deb.r;
+        pCpu->pTask = ice_get_current();
+        pCpu->eStop = STOP_BREAK;
+        pCpu->fValid = TRUE;
+    }
+
+    if( deb.fSmp )
+    {
+        if( deb.fNmiFreeze )
+        {
+            // Mark the NMIs as ours before sending them
+            for(cpu=0; cpu<MAX_CPU; cpu++)
+                deb.Cpu[cpu].fNmiPending = cpu!=deb.cpu;
+
+            deb.fNmiFreezing = TRUE;
+
+            HookNmi();
+
+            if( !ice_send_nmi_allbutself() )
+            {
+                // This kernel can not send NMI; use the regular IPI
+                deb.fNmiFreezing = FALSE;
+
+                for(cpu=0; cpu<MAX_CPU; cpu++)
+                    deb.Cpu[cpu].fNmiPending = FALSE;
+
+                ice_smp_call_function(smpSpin, NULL, TRUE, 0);
+            }
+        }
+        else
+            ice_smp_call_function(smpSpin, NULL, TRUE, 0);
+
+        smpWaitForCpus();
+    }
 }
 
+/******************************************************************************
+*                                                                             *
+*   BOOL smpSwitchCpu(UINT cpu)                                               *
+*                                                                             *
+*******************************************************************************
+*
+*   Switches the debugger view (registers, code, stack and locals windows and
+*   the symbol context) to the state of a given CPU. All other CPUs keep
+*   spinning on the same 'fRunningIce' semaphore.
+*
+*   Register changes made while viewing a spinning CPU apply to its snapshot
+*   only; the debugger CPU is always the one that resumes the execution.
+*
+*   Where:
+*       cpu is the logical CPU number to switch to
+*
+*   Returns:
+*       TRUE if switched
+*       FALSE if that CPU has not published its state
+*
+******************************************************************************/
+BOOL smpSwitchCpu(UINT cpu)
+{
+    if( cpu < MAX_CPU && deb.Cpu[cpu].fValid )
+    {
+        deb.cpuCur = cpu;
+        deb.r = deb.Cpu[cpu].pRegs;
+
+        // Dont highlight register differences between the CPUs
+        memcpy(&deb.r_prev, deb.r, sizeof(TREGS));
+
+        SetSymbolContext(deb.r->cs, deb.r->eip);
+
+        deb.fRedraw = TRUE;
+
+        return( TRUE );
+    }
+
+    return( FALSE );
+}
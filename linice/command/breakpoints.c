@@ -47,6 +47,8 @@
 #include "intel.h"                      // Include processor specific stuff
 #include "ice.h"                        // Include main debugger structures
 
+#include "LiniceExt.h"                  // Include extension include file
+
 /******************************************************************************
 *                                                                             *
 *   Global Variables                                                          *
@@ -78,6 +80,24 @@ extern char *pCmdEdit;                  // Push edit line string
 #define BP_TYPE_BPMW    0x05            // Breakpoint is BPMW  (subClass 5)
 #define BP_TYPE_BPMD    0x07            // Breakpoint is BPMD  (subClass 7)
 
+// Define the trap path timing of a breakpoint. Only the trap paths that continue
+// without popping up are measured: those are what a conditional breakpoint
+// costs the running system. Sums are 64 bit (low, high dword).
+
+#define MAX_BP_HIST         32          // Log2 latency histogram buckets
+
+typedef struct
+{
+    DWORD nSamples;                     // Number of trap paths measured
+    DWORD Cond[2];                      // Cycles spent evaluating the IF condition
+    DWORD Do[2];                        // Cycles spent executing the DO commands
+    DWORD Arm[2];                       // Cycles spent disarming and arming the breakpoints
+    DWORD Total[2];                     // Cycles from the trap entry to the return
+    DWORD Max;                          // Longest trap path in cycles
+    DWORD Hist[MAX_BP_HIST];            // Number of trap paths by log2 of their cycles
+
+} TBPPROF;
+
 // Define a breakpoint entry structure
 
 typedef struct
@@ -94,6 +114,7 @@ typedef struct
     BYTE DrRequest;                     // Debug register that the user explicitly requested (bitmask)
     BYTE DrUse;                         // Debug register that is actually assigned (bitmask)
                                         // Also specifies the use of HW breakpoint as opposed to an embedded INT3
+    BYTE DrAlloc;                       // Debug register reserved when the bp was defined (bitmask)
     TADDRDESC address;                  // Breakpoint address (sel:offset)
     WORD file_id;                       // Source code file_id
     WORD line;                          // Source code line number
@@ -108,6 +129,18 @@ typedef struct
     DWORD CurHits;                      // Number of timer we hit it before it popup (clear after popup)
     DWORD CurMisses;                    // Number of times we evaluated to FALSE before it popup (clear after popup)
 
+    DWORD Heat;                         // Decaying count of hits and faults, selects BPM for debug registers
+    DWORD HeatEvents;                   // Hits and faults counted into the heat so far
+
+    TBPPROF Prof;                       // Trap path timing
+
+    PEXT_BREAKPOINT Callback;           // Extension function called instead of the DO statements
+    void *pContext;                     // Argument passed to the callback
+    TLINICEEXT *pOwner;                 // Extension that set the callback
+    DWORD nCalls;                       // Number of times the callback was called
+    DWORD CallCycles[2];                // Cycles spent in the callback (64 bit sum)
+    DWORD CallMax;                      // Longest callback in cycles
+
 } TBP;
 
 /*
@@ -124,6 +157,9 @@ typedef struct
             Access: 3 (RW), 2 (R), 1 (W)
             Size: 0 (B), 1 (W), 3 (D)
             DrRequest register use: 1 (DR0), 2 (DR1), 4 (DR2), 8 (DR3)
+            When there are more BPM than free debug registers, the ones that
+            trigger most often get the registers and the rest are watched by
+            page protection (vwatch.c)
 
 */
 
@@ -139,6 +175,14 @@ static DWORD dr[8];                     // Temp stored verification values
 
 static BOOL fBpLog = FALSE;             // Current expression contained BPLOG
 
+static TBP *pBpLifted = NULL;           // INT3 breakpoint lifted to trace over it with breakpoints armed
+
+// Trap path timing of the current debugger entry
+static TBP *pBpProf = NULL;             // Breakpoint that evaluated to continue, or NULL
+static DWORD dwCondCycles;              // Cycles spent evaluating its condition
+static DWORD dwDoCycles;                // Cycles spent executing its DO commands
+static DWORD dwArmCycles;               // Cycles spent disarming and arming
+
 // BPIO types (stored in the Access field)
 static const char *sBpio[] = { "", "R ", "W ", "RW " };
 
@@ -161,6 +205,14 @@ static const UINT dr7mask[] = { 0, 3, 0xC, 0, 0x30, 0, 0, 0, 0xC0 };
 extern DWORD GetHex(char **psString);
 extern void CalcMemAccessChecksum();
 extern void SetDebugReg(TSysreg * pSys);
+extern DWORD GetRdtsc(BYTE *buffer8);
+extern BOOL WatchVerify(DWORD dwAddress, UINT nLen);
+extern BOOL WatchArm(int index, DWORD dwAddress, UINT nLen, BOOL fWrite);
+extern void WatchProtect(void);
+extern int  WatchDisarm(void);
+extern void WatchRelease(DWORD dwStart, UINT size);
+extern TWATCHSTAT *WatchGetStat(int index);
+extern void WatchClearStat(int index);
 
 /******************************************************************************
 *                                                                             *
@@ -180,6 +232,31 @@ DWORD fnBpTotal(DWORD arg) { return( deb.bpIndex>=0? bp[deb.bpIndex].Hits : 0 );
 DWORD fnBpIndex(DWORD arg) { return( deb.bpIndex ); };
 DWORD fnBpLog(DWORD arg)   { return( (fBpLog = TRUE) ); }
 
+/******************************************************************************
+*                                                                             *
+*   DWORD AvgCycles(DWORD *pSum, DWORD n)                                     *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the average of a 64 bit sum of cycles (see ADD_CYCLES) over n
+*   samples. The sum and the count are scaled down together until the sum
+*   fits 32 bits.
+*
+******************************************************************************/
+DWORD AvgCycles(DWORD *pSum, DWORD n)
+{
+    DWORD lo = pSum[0], hi = pSum[1];
+
+    while( hi )
+    {
+        lo = (lo >> 1) | (hi << 31);
+        hi >>= 1;
+        n >>= 1;
+    }
+
+    return( n? lo / n : 0 );
+}
+
 /******************************************************************************
 *                                                                             *
 *   BOOL IsNeedHwBp(BYTE Type)                                                *
@@ -354,7 +431,7 @@ static BOOL VerifyBreakpoint(TBP *pBp)
         }
 
         // Assign the requested resource
-        pBp->DrUse = pBp->DrRequest;
+        pBp->DrUse = pBp->DrAlloc = pBp->DrRequest;
         GlAvail &= ~pBp->DrUse;
     }
     else
@@ -362,6 +439,10 @@ static BOOL VerifyBreakpoint(TBP *pBp)
     {
         if( GlAvail==0 )
         {
+            // Memory breakpoints can still be watched by page protection
+            if( pBp->Type!=BP_TYPE_BPIO && WatchVerify(pBp->address.offset, pBp->Size + 1) )
+                return( TRUE );
+
             PostError(ERR_DRUSEDUP, 0);     // All debug registers used error
             return( FALSE );
         }
@@ -374,6 +455,7 @@ static BOOL VerifyBreakpoint(TBP *pBp)
         else
         if( GlAvail & 8 )   pBp->DrUse = 8;
 
+        pBp->DrAlloc = pBp->DrUse;
         GlAvail &= ~pBp->DrUse;
     }
 
@@ -456,8 +538,9 @@ BOOL cmdBp(char *args, int subClass)
                             bp[index].Flags &= ~BP_ENABLED;
 
                             // Free the hardware bp resource
+                            GlAvail |= bp[index].DrAlloc;
+                            bp[index].DrAlloc = 0;
                             bp[index].DrUse = 0;
-                            GlAvail |= bp[index].DrUse;
                         }
 
                         // Now we will do actual clear for those cases
@@ -475,7 +558,7 @@ BOOL cmdBp(char *args, int subClass)
                         // Dont re-enable breakpoints that are already enabled
                         if( !(bp[index].Flags & BP_ENABLED) )
                         {
-                            if( VerifyBreakpoint(bp) )
+                            if( VerifyBreakpoint(&bp[index]) )
                             {
                                 bp[index].Flags |= BP_ENABLED;
                             }
@@ -545,6 +628,10 @@ static char *GetBpFormatStringList(TBP *pBp)
     if( pBp->pDO )
         pBuf += sprintf(pBuf, " DO %s", pBp->pDO);
 
+    // Breakpoints set by an extension name the extension
+    if( pBp->Callback )
+        pBuf += sprintf(pBuf, " CALL .%s", pBp->pOwner->pDotName);
+
     return(Buf);
 }
 
@@ -628,11 +715,12 @@ BOOL cmdBl(char *args, int subClass)
         {
             if( bp[index].Flags & BP_USED )
             {
-                dprinth(nLine++, "%02X  Flags=%d Type=%d DrRequest=%X DrUse=%X Access=%d Size=%d",
+                dprinth(nLine++, "%02X  Flags=%d Type=%d DrRequest=%X DrAlloc=%X DrUse=%X Access=%d Size=%d",
                     index,
                     bp[index].Flags,
                     bp[index].Type,
                     bp[index].DrRequest,
+                    bp[index].DrAlloc,
                     bp[index].DrUse,
                     bp[index].Access,
                     bp[index].Size );
@@ -713,13 +801,18 @@ BOOL BPstat(int index, int n)
 {
     static int nLine;                   // Local line counter
     TBP *p = &bp[index];                // Get the pointer to a current bp
+    TBPPROF *pProf = &p->Prof;          // Trap path timing
+    TWATCHSTAT *pStat;                  // Page protection overhead of a BPM
+    DWORD dwMost;                       // Largest histogram bucket
+    char sBar[MAX_BP_HIST+1];           // Histogram bar
+    int i;
 
     if( n==1 ) nLine = 1;               // Reset the line counter in the first call
 
     if(dprinth(nLine++, "Breakpoint Statistics for #%02X %s", index, (p->Flags & BP_ENABLED)?"" : "(disabled)")
     && dprinth(nLine++, "   %s", GetBpFormatStringList(p) )
     && dprinth(nLine++, "   Cond    %s", p->pIF? p->pIF : "No" )
-    && dprinth(nLine++, "   Action  %s", p->pDO? p->pDO : "No" )
+    && dprinth(nLine++, "   Action  %s", p->pDO? p->pDO : p->Callback? p->pOwner->pDotName : "No" )
     && dprinth(nLine++, "Totals")
     && dprinth(nLine++, "   Hits    %X", p->Hits )
     && dprinth(nLine++, "   Breaks  %X", p->Breaks )
@@ -730,7 +823,58 @@ BOOL BPstat(int index, int n)
     && dprinth(nLine++, "Current")
     && dprinth(nLine++, "   Hits    %X", p->CurHits )
     && dprinth(nLine++, "   Misses  %X", p->CurMisses ))
-        return( TRUE );
+    {
+        // Trap path timing of the hits that did not pop up, in average cycles
+        if( pProf->nSamples )
+        {
+            if(!dprinth(nLine++, "Latency (cycles, %u samples)", pProf->nSamples )
+            || !dprinth(nLine++, "   Cond    %u", AvgCycles(pProf->Cond, pProf->nSamples) )
+            || !dprinth(nLine++, "   Action  %u", AvgCycles(pProf->Do, pProf->nSamples) )
+            || !dprinth(nLine++, "   Arm     %u", AvgCycles(pProf->Arm, pProf->nSamples) )
+            || !dprinth(nLine++, "   Total   %u (max %u)", AvgCycles(pProf->Total, pProf->nSamples), pProf->Max ))
+                return( FALSE );
+
+            // Histogram of the total, one line per used power of 2 bucket
+            for(dwMost=1, i=0; i<MAX_BP_HIST; i++ )
+                if( pProf->Hist[i] > dwMost )
+                    dwMost = pProf->Hist[i];
+
+            for(i=0; i<MAX_BP_HIST; i++ )
+            {
+                if( pProf->Hist[i] )
+                {
+                    memset(sBar, '#', MAX_BP_HIST);
+                    sBar[1 + ((dwMost < 0x04000000)? pProf->Hist[i] * (MAX_BP_HIST - 1) / dwMost
+                                                   : pProf->Hist[i] / (dwMost / (MAX_BP_HIST - 1)))] = 0;
+
+                    if(!dprinth(nLine++, "   2^%-2d   %8X %s", i, pProf->Hist[i], sBar ))
+                        return( FALSE );
+                }
+            }
+        }
+
+        // Every call of an extension callback is timed, including the ones that stopped
+        if( p->nCalls )
+        {
+            if(!dprinth(nLine++, "Callback (cycles, %u calls)", p->nCalls )
+            || !dprinth(nLine++, "   Average %u", AvgCycles(p->CallCycles, p->nCalls) )
+            || !dprinth(nLine++, "   Max     %u", p->CallMax ))
+                return( FALSE );
+        }
+
+        if( p->Type < BP_TYPE_BPMB )
+            return( TRUE );
+
+        // Memory breakpoints also show what watching them by page protection costs
+        pStat = WatchGetStat(index);
+
+        if(dprinth(nLine++, "Watch")
+        && dprinth(nLine++, "   Heat    %X", p->Heat )
+        && dprinth(nLine++, "   Faults  %X", pStat->Faults )
+        && dprinth(nLine++, "   Matches %X", pStat->Matches )
+        && dprinth(nLine++, "   Cycles  %u per fault", AvgCycles(pStat->Cycles, pStat->Faults) ))
+            return( TRUE );
+    }
 
     return(FALSE);
 }
@@ -781,6 +925,115 @@ BOOL cmdBstat(char *args, int subClass)
     return(TRUE);
 }
 
+/******************************************************************************
+*                                                                             *
+*   static int BreakpointSet(TADDRDESC Addr, int type, int access, TBP *pOpt) *
+*                                                                             *
+*******************************************************************************
+*
+*   Sets up a breakpoint slot and activates the breakpoint. It will be armed
+*   when the debugee runs.
+*
+*   The first available slot is used, unless the variable 'hint' selects a
+*   slot. That is done with the BPE edit breakpoint where we want to store
+*   into the same index.
+*
+*   Where:
+*       Addr is the breakpoint address, or the port for BPIO
+*       type is the breakpoint type (BP_TYPE_*)
+*       access is the access verb of BPIO and BPM (1 - R, 2 - W, 3 - RW)
+*       pOpt is the breakpoint with the options set: pCmd and optionally
+*           pIF, pDO, DrRequest and Flags. The slot takes over pCmd only
+*           if the breakpoint is set.
+*
+*   Returns:
+*       Index of the breakpoint slot that was used
+*       -1 if the breakpoint could not be set; the error has been posted
+*
+******************************************************************************/
+static int BreakpointSet(TADDRDESC Addr, int type, int access, TBP *pOpt)
+{
+    TBP *pBp;                           // Pointer to the breakpoint slot
+    TSYMFNSCOPE *pFnScope;
+    TSYMFNLIN *pFnLin;
+    int index;
+
+    if( hint >= 0 )
+    {
+        index = hint;                   // Use that breakpoint
+        hint = -1;                      // Reset the hint
+
+        // If we are reusing a breakpoint slot, release its command line
+        if( bp[index].pCmd )
+            freeHeap(deb.hHeap, bp[index].pCmd);
+    }
+    else
+    {
+        // Find the first available slot for the new breakpoint
+        for(index=0; index<MAX_BREAKPOINTS; index++ )
+        {
+            if( !(bp[index].Flags & BP_USED) )
+                break;
+        }
+    }
+
+    if( index>=MAX_BREAKPOINTS )
+    {
+        PostError(ERR_BP_TOO_MANY, 0);  // No more breakpoints available
+        return( -1 );
+    }
+
+    pBp = &bp[index];
+
+    // Rebuild the breakpoint entry from the options
+    memcpy(pBp, pOpt, sizeof(TBP));
+    WatchClearStat(index);
+
+    pBp->Type    = type;
+    pBp->address = Addr;
+
+    if( type==BP_TYPE_BPIO || type==BP_TYPE_BPMB || type==BP_TYPE_BPMW || type==BP_TYPE_BPMD )
+        pBp->Access = access;
+
+    // Specify the size parameter that is valid for memory breakpoints
+    if( type==BP_TYPE_BPMB || type==BP_TYPE_BPMW || type==BP_TYPE_BPMD )
+        pBp->Size = type - BP_TYPE_BPMB;        // 0 (B), 1 (W), 3 (D)
+
+    // For BPX breakpoints, set a possible file_id and line number
+    if( type==BP_TYPE_BPX )
+    {
+        pFnScope = SymAddress2FnScope(pBp->address.sel, pBp->address.offset);
+        if( pFnScope )
+        {
+            pBp->file_id = pFnScope->file_id;
+
+            pFnLin = SymAddress2FnLin(pBp->address.sel, pBp->address.offset);
+            SymFnLin2Line(&pBp->line, pFnLin, pBp->address.offset);
+        }
+
+        // Also, for BPX breakpoints, redraw the screen since we may want to
+        // highlight differently the code pane (source or machine)
+
+        deb.fRedraw = TRUE;
+    }
+
+    //------------------------------------------------------------------
+    // Perform validity check for all types of breakpoints
+    //------------------------------------------------------------------
+    if( VerifyBreakpoint(pBp)==TRUE )
+    {
+        // Finalize the breakpoint as valid and active
+        pBp->Flags |= BP_USED | BP_ENABLED;
+
+        return( index );
+    }
+
+    // Clear the breakpoint entry; the caller still owns the command line
+    memset(pBp, 0, sizeof(TBP));
+
+    return( -1 );
+}
+
 /******************************************************************************
 *                                                                             *
 *   BOOL cmdBpx(char *args, int subClass)                                     *
@@ -811,8 +1064,10 @@ BOOL cmdBstat(char *args, int subClass)
 ******************************************************************************/
 BOOL cmdBpx(char *args, int subClass)
 {
-    TBP *pBp;                           // Pointer to the current breakpoint
-    int index, dummy;
+    TBP Opt;                            // Options of the new breakpoint
+    TADDRDESC Addr;                     // Address of the new breakpoint
+    char *pCmd;                         // Copy of the command line
+    int index, dummy, access = 0;
 
     // Special case if we are in the code edit mode and no arguments are given,
     // toggle the breakpoint at the selected line
@@ -845,212 +1100,139 @@ BOOL cmdBpx(char *args, int subClass)
     }
 
 
-    // Find the first empty slot that we will use. If the variable 'hint' was
-    // set, we override and use that particular index. That is done with the
-    // BPE edit breakpoint where we want to store into the same index
-    if( hint >= 0 )
+    // Allocate space to copy the command line string
+    if( (pCmd = mallocHeap(deb.hHeap, strlen(args)+1)) )
     {
-        index = hint;                   // Use that breakpoint
-        hint = -1;                      // Reset the hint
+        // Copy the breakpoint line into the new buffer
+        strcpy(pCmd, args);
 
-        pBp = &bp[index];               // Assign the pointer to the old bp
+        // Start parsing a copy of the command line
+        args = pCmd;
 
-        // If we are reusing a breakpoint slot, clear some variables
+        // The options are collected here and copied into the breakpoint slot
+        memset(&Opt, 0, sizeof(TBP));
+        Opt.pCmd = pCmd;
 
-        if( pBp->pCmd )
-            freeHeap(deb.hHeap, pBp->pCmd);
-    }
-    else
-    {
-        // Find the first available slot for the new breakpoint
-        for(index=0; index<MAX_BREAKPOINTS; index++ )
-        {
-            if( !(bp[index].Flags & BP_USED) )
-                break;
-        }
-    }
-
-    // `index' now selects a breakpoint slot
-
-    if( index<MAX_BREAKPOINTS )
-    {
-        pBp = &bp[index];               // Assign the pointer to a new bp
-
-        // Clear the breakpoint entry since we will rebuild it
-        memset(pBp, 0, sizeof(TBP));
+        // Get the mandatory address portion: selector portion is CS by default
+        evalSel = deb.r->cs;
 
-        // Allocate space to copy the command line string
-        if( (pBp->pCmd = mallocHeap(deb.hHeap, strlen(args)+1)) )
+        // Evaluate expression for the address portion
+        if( Expression(&Addr.offset, args, &args))
         {
-            // Copy the breakpoint line into the new buffer
-            strcpy(pBp->pCmd, args);
-
-            // Start parsing a copy of the command line
-            args = pBp->pCmd;
-
-            // Set the breakpoint type
-            pBp->Type = subClass;
-
-            // Get the mandatory address portion: selector portion is CS by default
-            evalSel = deb.r->cs;
-
-            // Evaluate expression for the address portion
-            if( Expression(&pBp->address.offset, args, &args))
+            // Verify that the selector is readable and valid
+            if( VerifySelector(evalSel) )
             {
-                // Verify that the selector is readable and valid
-                if( VerifySelector(evalSel) )
-                {
-                    pBp->address.sel = evalSel;
+                Addr.sel = evalSel;
 
-                    // With BPIO and BPM, we can specify an optional access verb here
-                    if( subClass==BP_TYPE_BPIO || subClass==BP_TYPE_BPMB
-                     || subClass==BP_TYPE_BPMW || subClass==BP_TYPE_BPMD )
+                // With BPIO and BPM, we can specify an optional access verb here
+                if( subClass==BP_TYPE_BPIO || subClass==BP_TYPE_BPMB
+                 || subClass==BP_TYPE_BPMW || subClass==BP_TYPE_BPMD )
+                {
+                    if( !strnicmp(args, "RW", 2) )
                     {
-                        if( !strnicmp(args, "RW", 2) )
-                        {
-                            args += 2;
-                            pBp->Access = 3;
-                        }
-                        else
-                        if( !strnicmp(args, "R", 1) )
-                        {
-                            args += 1;
-                            pBp->Access = 1;
-                        }
-                        else
-                        if( !strnicmp(args, "W", 1) )
-                        {
-                            args += 1;
-                            pBp->Access = 2;
-                        }
-                        else
-                            pBp->Access = 3;        // default is "RW"
+                        args += 2;
+                        access = 3;
                     }
-
-                    while( *args==' ' ) args++;     // Skip spaces
-
-                    // Specify the size parameter that is valid for memory breakpoints
-                    if( subClass==BP_TYPE_BPMB || subClass==BP_TYPE_BPMW || subClass==BP_TYPE_BPMD )
+                    else
+                    if( !strnicmp(args, "R", 1) )
                     {
-                        pBp->Size = subClass - BP_TYPE_BPMB;        // 0 (B), 1 (W), 3 (D)
+                        args += 1;
+                        access = 1;
                     }
-
-                    // User can always assign an optional HW breakpoint register as his choice, DR0..DR3
-                    if( !strnicmp(args, "DR", 2) )
+                    else
+                    if( !strnicmp(args, "W", 1) )
                     {
-                        if( *(args+2)=='0' ) pBp->DrRequest = 1;
-                        else
-                        if( *(args+2)=='1' ) pBp->DrRequest = 2;
-                        else
-                        if( *(args+2)=='2' ) pBp->DrRequest = 4;
-                        else
-                        if( *(args+2)=='3' ) pBp->DrRequest = 8;
-                        else
-                        {
-                            PostError(ERR_DRINVALID, 0);
-                            goto bpx_failed;
-                        }
-
-                        args += 3;                                  // Skip the DRx token
-
-                        while( *args==' ' ) args++;                 // Skip spaces
+                        args += 1;
+                        access = 2;
                     }
+                    else
+                        access = 3;         // default is "RW"
+                }
 
-                    //------------------------------------------------------------------
-                    // If the next character is "O", accept it as a flag for One-time breakpoint
-                    if( !strnicmp(args, "O", 1) )
-                    {
-                        args += 1;                                  // Skip the flag token
-                        while( *args==' ' ) args++;                 // Skip spaces
-
-                        pBp->Flags |= BP_ONETIME;                   // Set a one time breakpoint flag
-                    }
+                while( *args==' ' ) args++;     // Skip spaces
 
-                    //------------------------------------------------------------------
-                    // If the next statement is "IF", accept it
-                    if( !strnicmp(args, "IF", 2) )
+                // User can always assign an optional HW breakpoint register as his choice, DR0..DR3
+                if( !strnicmp(args, "DR", 2) )
+                {
+                    if( *(args+2)=='0' ) Opt.DrRequest = 1;
+                    else
+                    if( *(args+2)=='1' ) Opt.DrRequest = 2;
+                    else
+                    if( *(args+2)=='2' ) Opt.DrRequest = 4;
+                    else
+                    if( *(args+2)=='3' ) Opt.DrRequest = 8;
+                    else
                     {
-                        // Store a pointer to the IF expression statement
-                        args += 2;
-                        pBp->pIF = args;
-
-                        // Massage the pointer to IF<expression> to skip heading spaces
-                        while( *pBp->pIF==' ' ) pBp->pIF++;
-
-                        // Dummy evalute the expression to skip it
-                        Expression(&dummy, args, &args);
-
-                        // ("DO" will sometimes evaluate as 0xD + 'O' by our eval. Fix it)
-                        if( !strnicmp(args-1, "DO", 2) ) args--;
-
-                        // Terminate "IF" expression substring
-                        if(*(args-1)==' ')
-                            *(args-1) = 0;
+                        PostError(ERR_DRINVALID, 0);
+                        goto bpx_failed;
                     }
 
-                    //------------------------------------------------------------------
-                    // If the next statement is "DO", accept it
-                    if( !strnicmp(args, "DO", 2) )
-                    {
-                        // Store a pointer to DO statements
-                        args += 2;
-                        pBp->pDO = args;
-
-                        // Massage the pointer to DO<cmd> to skip heading spaces
-                        while( *pBp->pDO==' ' ) pBp->pDO++;
-                    }
+                    args += 3;                                  // Skip the DRx token
 
-                    // For BPX breakpoints, set a possible file_id and line number
-                    if( subClass==BP_TYPE_BPX )
-                    {
-                        TSYMFNSCOPE *pFnScope;
-                        TSYMFNLIN *pFnLin;
+                    while( *args==' ' ) args++;                 // Skip spaces
+                }
 
-                        pFnScope = SymAddress2FnScope(pBp->address.sel, pBp->address.offset);
-                        if( pFnScope )
-                        {
-                            pBp->file_id = pFnScope->file_id;
+                //------------------------------------------------------------------
+                // If the next character is "O", accept it as a flag for One-time breakpoint
+                if( !strnicmp(args, "O", 1) )
+                {
+                    args += 1;                                  // Skip the flag token
+                    while( *args==' ' ) args++;                 // Skip spaces
 
-                            pFnLin = SymAddress2FnLin(pBp->address.sel, pBp->address.offset);
-                            SymFnLin2Line(&pBp->line, pFnLin, pBp->address.offset);
-                        }
+                    Opt.Flags |= BP_ONETIME;                    // Set a one time breakpoint flag
+                }
 
-                        // Also, for BPX breakpoints, redraw the screen since we may want to
-                        // highlight differently the code pane (source or machine)
+                //------------------------------------------------------------------
+                // If the next statement is "IF", accept it
+                if( !strnicmp(args, "IF", 2) )
+                {
+                    // Store a pointer to the IF expression statement
+                    args += 2;
+                    Opt.pIF = args;
 
-                        deb.fRedraw = TRUE;
-                    }
+                    // Massage the pointer to IF<expression> to skip heading spaces
+                    while( *Opt.pIF==' ' ) Opt.pIF++;
 
-                    //------------------------------------------------------------------
-                    // Perform validity check for all types of breakpoints
-                    //------------------------------------------------------------------
-                    if( VerifyBreakpoint(pBp)==TRUE )
-                    {
-                        // If everything went OK, we activate a new breakpoint
+                    // Dummy evalute the expression to skip it
+                    Expression(&dummy, args, &args);
 
-                        // Finalize the breakpoint as valid and active
-                        pBp->Flags |= BP_USED | BP_ENABLED;
+                    // ("DO" will sometimes evaluate as 0xD + 'O' by our eval. Fix it)
+                    if( !strnicmp(args-1, "DO", 2) ) args--;
 
-                        return(TRUE);
-                    }
+                    // Terminate "IF" expression substring
+                    if(*(args-1)==' ')
+                        *(args-1) = 0;
                 }
-                // Else do not define a new breakpoint, but clean up the slot
-bpx_failed:;
-            }
-            else
-                PostError(ERR_SYNTAX, 0);   // Syntax error evaluating
 
-            // Free the buffer since setting a bp failed
-            freeHeap(deb.hHeap, pBp->pCmd);
+                //------------------------------------------------------------------
+                // If the next statement is "DO", accept it
+                if( !strnicmp(args, "DO", 2) )
+                {
+                    // Store a pointer to DO statements
+                    args += 2;
+                    Opt.pDO = args;
 
-            // Clear the breakpoint entry
-            memset(pBp, 0, sizeof(TBP));
+                    // Massage the pointer to DO<cmd> to skip heading spaces
+                    while( *Opt.pDO==' ' ) Opt.pDO++;
+                }
+
+                // Set up the breakpoint slot and activate it
+                if( BreakpointSet(Addr, subClass, access, &Opt) >= 0 )
+                    return(TRUE);
+            }
+            // Else do not define a new breakpoint
+bpx_failed:;
         }
         else
-            PostError(ERR_INT_OUTOFMEM, 0); // Internal error: out of memory
+            PostError(ERR_SYNTAX, 0);   // Syntax error evaluating
+
+        // Free the buffer since setting a bp failed
+        freeHeap(deb.hHeap, pCmd);
     }
     else
-        PostError(ERR_BP_TOO_MANY, 0);      // No more breakpoints available
+        PostError(ERR_INT_OUTOFMEM, 0); // Internal error: out of memory
+
+    hint = -1;                          // The edited breakpoint is kept
 
     return(TRUE);
 }
@@ -1174,6 +1356,11 @@ void ArmBreakpoints(void)
     TBP *pBp;                           // Pointer to a breakpoint to use
     BYTE avail;                         // Available hw breakpoints
     UINT dr;                            // Temp debug register
+    DWORD dwEvents;                     // Hits and faults of a memory breakpoint
+    DWORD dwStart;                      // Time stamp at the start
+    BYTE Tsc[8];
+
+    dwStart = GetRdtsc(Tsc);
 
     // Reset debug registers
     deb.sysReg.dr7 = 3 << 8;            // LE GE set recommended
@@ -1198,28 +1385,63 @@ void ArmBreakpoints(void)
     }
     else
     {
-        // While there are more hardware breakpoints availables, distribute them
-        if( GlAvail )
+        // Breakpoints that requested a particular debug register always get it
+        avail = HWBPMASK;
+
+        for(index=0; index<MAX_BREAKPOINTS; index++ )
         {
-            avail = GlAvail;
+            if( (bp[index].Flags & BP_ENABLED) && bp[index].DrRequest )
+            {
+                bp[index].DrUse = bp[index].DrRequest;
+                avail &= ~bp[index].DrUse;
+            }
+        }
 
-            index = 0;
-            while( index<MAX_BREAKPOINTS && avail )
+        // IO breakpoints can only use debug registers
+        for(index=0; index<MAX_BREAKPOINTS && avail; index++ )
+        {
+            if( (bp[index].Flags & BP_ENABLED) && bp[index].Type==BP_TYPE_BPIO && bp[index].DrUse==0 )
+                avail &= ~(bp[index].DrUse = avail & -avail);
+        }
+
+        // Memory breakpoints that trigger most often get the debug registers and the
+        // rest are watched by page protection. Faults on their pages count as well,
+        // since they cost about as much as the hits.
+        for(index=0; index<MAX_BREAKPOINTS; index++ )
+        {
+            if( (bp[index].Flags & BP_ENABLED) && bp[index].Type>=BP_TYPE_BPMB )
             {
-                if( (bp[index].Flags & BP_ENABLED) && (bp[index].DrUse==0) )
-                {
-                    if( avail & 1 ) bp[index].DrUse = 1;
-                    else
-                    if( avail & 2 ) bp[index].DrUse = 2;
-                    else
-                    if( avail & 4 ) bp[index].DrUse = 4;
-                    else
-                    if( avail & 8 ) bp[index].DrUse = 8;
+                dwEvents = bp[index].Hits + WatchGetStat(index)->Faults;
+
+                bp[index].Heat = (bp[index].Heat >> 1) + (dwEvents - bp[index].HeatEvents);
+                bp[index].HeatEvents = dwEvents;
+            }
+        }
 
-                    avail &= ~bp[index].DrUse;
+        while( avail )
+        {
+            pBp = NULL;
+
+            for(index=0; index<MAX_BREAKPOINTS; index++ )
+            {
+                if( (bp[index].Flags & BP_ENABLED) && bp[index].Type>=BP_TYPE_BPMB && bp[index].DrUse==0 )
+                {
+                    if( pBp==NULL || bp[index].Heat > pBp->Heat )
+                        pBp = &bp[index];
                 }
-                index++;
             }
+
+            if( pBp==NULL )
+                break;
+
+            avail &= ~(pBp->DrUse = avail & -avail);
+        }
+
+        // Execute breakpoints use the debug registers that are left instead of INT3
+        for(index=0; index<MAX_BREAKPOINTS && avail; index++ )
+        {
+            if( (bp[index].Flags & BP_ENABLED) && bp[index].Type==BP_TYPE_BPX && bp[index].DrUse==0 )
+                avail &= ~(bp[index].DrUse = avail & -avail);
         }
 
         //=================================================================================
@@ -1256,6 +1478,10 @@ void ArmBreakpoints(void)
                         break;
 
                     case BP_TYPE_BPIO:
+                        // No debug register was left for this one
+                        if( bp[index].DrUse==0 )
+                            break;
+
                         // Set the DE (Debugging Extensions) bit in CR4 so we can trap IO accesses
                         deb.sysReg.cr4 |= BITMASK(DE_BIT);
 
@@ -1275,6 +1501,14 @@ void ArmBreakpoints(void)
                     case BP_TYPE_BPMW:
                     case BP_TYPE_BPMD:
 
+                        // Without a debug register, watch it by page protection; the
+                        // access type "W" (2) watches only the writes
+                        if( bp[index].DrUse==0 )
+                        {
+                            WatchArm(index, bp[index].address.offset, bp[index].Size + 1, bp[index].Access==2);
+                            break;
+                        }
+
                         dr = bDr[bp[index].DrUse];      // Debug register number
 
                         // Set the address to trap the access to
@@ -1292,6 +1526,57 @@ void ArmBreakpoints(void)
                 }
             }
         }
+
+        // Protect the pages of the virtual watchpoints
+        WatchProtect();
+    }
+
+    dwArmCycles += GetRdtsc(Tsc) - dwStart;
+}
+
+/******************************************************************************
+*                                                                             *
+*   void LiftBreakpointAtCSIP(void)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Called on a fast trace step, when the breakpoints are left armed. If an
+*   INT3 breakpoint is at the current cs:eip, its original byte is temporarily
+*   put back so the instruction can be traced. The INT3 is restored on the
+*   next debugger entry by RestoreLiftedBreakpoint().
+*
+*   This is the delayed arm done for a single breakpoint.
+*
+******************************************************************************/
+void LiftBreakpointAtCSIP(void)
+{
+    TBP *pBp;                           // Pointer to a breakpoint at cs:eip
+
+    if( (pBp = IsBreakpointAtCSIP()) && !pBp->DrUse )
+    {
+        AddrSetByte(&pBp->address, pBp->origValue, TRUE);
+
+        pBpLifted = pBp;
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void RestoreLiftedBreakpoint(void)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Places back the INT3 of a breakpoint that was lifted by the last fast
+*   trace step, if any.
+*
+******************************************************************************/
+void RestoreLiftedBreakpoint(void)
+{
+    if( pBpLifted )
+    {
+        AddrSetByte(&pBpLifted->address, 0xCC, TRUE);
+
+        pBpLifted = NULL;
     }
 }
 
@@ -1325,6 +1610,17 @@ void DisarmBreakpoints(void)
 {
     int index;
     BOOL fDecrementEIP = FALSE;         // Signal to decrement EIP once
+    DWORD dwStart;                      // Time stamp at the start
+    BYTE Tsc[8];
+
+    dwStart = GetRdtsc(Tsc);
+
+    // Start timing a new trap path
+    pBpProf = NULL;
+    dwCondCycles = dwDoCycles = 0;
+
+    // All INT3 breakpoints need to be in place to be disarmed
+    RestoreLiftedBreakpoint();
 
     // Disarm walking the opposite way to allow possible duplicate breakpoints
 
@@ -1377,7 +1673,7 @@ void DisarmBreakpoints(void)
 
                     if( bp[index].Flags & BP_INTERNAL )
                     {
-                        GlAvail |= bp[index].DrUse;
+                        GlAvail |= bp[index].DrAlloc;
 
                         // Clear the breakpoint entry - internal breakpoints dont have the command string
                         memset(&bp[index], 0, sizeof(TBP));
@@ -1403,6 +1699,10 @@ void DisarmBreakpoints(void)
     if( fDecrementEIP )
         deb.r->eip -= 1;
 
+    // Remove the page protection of the virtual watchpoints; one of them may have hit
+    if( (index = WatchDisarm()) >= 0 )
+        deb.bpIndex = index;
+
     // Clear all DrUse bits since we will redistribute them when we arm them
     for(index=0; index<MAX_BREAKPOINTS; index++ )
     {
@@ -1425,6 +1725,8 @@ void DisarmBreakpoints(void)
     deb.sysReg.dr7 = 0;
 
     SetSysreg(&deb.sysReg);             // Write out DR7
+
+    dwArmCycles = GetRdtsc(Tsc) - dwStart;
 }
 
 /******************************************************************************
@@ -1449,6 +1751,10 @@ BOOL EvalBreakpoint(void)
     TBP *p;                             // Pointer to the breakpoint that hit
     DWORD result;                       // Result of evaluation
     BOOL fPopup;                        // Result of breakpoint DO evaluation
+    BOOL fResult;                       // Expression evaluated without an error
+    DWORD dwStart;                      // Time stamp at the start of the condition or action
+    int action;                         // Result of the extension callback
+    BYTE Tsc[8];
 
     fBpLog = FALSE;                     // Reset the BPLOG flag to none
 
@@ -1463,7 +1769,7 @@ BOOL EvalBreakpoint(void)
             dprinth(1, "Breakpoint due to a one-time BPX %02X, cleared.", deb.bpIndex);
 
             // Free the breakpoint resources
-            GlAvail |= p->DrUse;
+            GlAvail |= p->DrAlloc;
 
             // Free the command line of a breakpoint and IF/DO statements
             freeHeap(deb.hHeap, p->pCmd);
@@ -1473,15 +1779,22 @@ BOOL EvalBreakpoint(void)
         }
         else
         {
-            dprinth(1, "Breakpoint due to BPX %02X", deb.bpIndex);
+            // Breakpoints with a callback only print when they stop or log
+            if( !p->Callback )
+                dprinth(1, "Breakpoint due to BPX %02X", deb.bpIndex);
 
             p->Hits++;
             p->CurHits++;
+            deb.Stat[deb.cpu].nBpHits++;
 
             // If this breakpoint has IF condition, evaluate it now
             if( p->pIF )
             {
-                if( Expression(&result, p->pIF, NULL) )
+                dwStart = GetRdtsc(Tsc);
+                fResult = Expression(&result, p->pIF, NULL);
+                dwCondCycles = GetRdtsc(Tsc) - dwStart;
+
+                if( fResult )
                 {
                     if( result )
                     {
@@ -1491,6 +1804,9 @@ BOOL EvalBreakpoint(void)
                         {
                             p->Breaks++;
                             p->Logged++;// Increment the logged count
+                            deb.Stat[deb.cpu].nBpLogged++;
+
+                            pBpProf = p;
 
                             return( TRUE );
                         }
@@ -1502,26 +1818,73 @@ BOOL EvalBreakpoint(void)
 
                     p->Misses++;        // Evaluated to FALSE and miss
                     p->CurMisses++;     // Current misses
+                    deb.Stat[deb.cpu].nBpMisses++;
+
+                    pBpProf = p;
 
                     return( TRUE );     // Return to debugee
                 }
                 // Expression resulted in error in evaluation
 
                 p->Errors++;
+
+                if( p->Callback )
+                    dprinth(1, "Breakpoint due to BPX %02X", deb.bpIndex);
             }
             else
             {
                 // The breakpoint does not have IF condition; if it has a DO portion, execute it unconditionally
 bp_check_do:
+                if( p->Callback )
+                {
+                    // The extension callback takes the place of the DO statements
+                    dwStart = GetRdtsc(Tsc);
+                    action = p->Callback((TLINICEREGS *) deb.r, deb.bpIndex, p->pContext);
+                    dwDoCycles = GetRdtsc(Tsc) - dwStart;
+
+                    p->nCalls++;
+                    ADD_CYCLES(p->CallCycles, dwDoCycles, 0);
+                    if( dwDoCycles > p->CallMax )
+                        p->CallMax = dwDoCycles;
+
+                    if( action==PEXT_BREAKPOINT_CONTINUE )
+                    {
+                        p->CurMisses++;
+                        deb.Stat[deb.cpu].nBpMisses++;
+
+                        pBpProf = p;
+
+                        return( TRUE );     // Return to debugee
+                    }
+
+                    dprinth(1, "Breakpoint due to BPX %02X", deb.bpIndex);
+
+                    if( action==PEXT_BREAKPOINT_LOG )
+                    {
+                        p->Breaks++;
+                        p->Logged++;
+                        deb.Stat[deb.cpu].nBpLogged++;
+
+                        pBpProf = p;
+
+                        return( TRUE );     // Return to debugee
+                    }
+                }
+                else
                 if( p->pDO )
                 {
+                    dwStart = GetRdtsc(Tsc);
                     fPopup = CommandExecute(p->pDO);
+                    dwDoCycles = GetRdtsc(Tsc) - dwStart;
 
                     if( fPopup==FALSE )
                     {
                         // Command evaluation required to continue execution
 
                         p->CurMisses++;
+                        deb.Stat[deb.cpu].nBpMisses++;
+
+                        pBpProf = p;
 
                         return( TRUE );     // Return to debugee
                     }
@@ -1535,6 +1898,49 @@ bp_check_do:
     return( FALSE );        // Popup in the debugger
 }
 
+/******************************************************************************
+*                                                                             *
+*   void BreakpointProfile(void)                                              *
+*                                                                             *
+*******************************************************************************
+*
+*   Called at the very end of a debugger entry, just before the debugee
+*   continues. If a breakpoint evaluated to continue without popping up,
+*   the time of the whole trap path, from the entry to here, is added to its
+*   timing statistics.
+*
+******************************************************************************/
+void BreakpointProfile(void)
+{
+    TBPPROF *pProf;                     // Timing of the breakpoint
+    DWORD dwTotal;                      // Cycles of the whole trap path
+    BYTE Tsc[8];
+    int i;
+
+    if( pBpProf )
+    {
+        dwTotal = GetRdtsc(Tsc) - deb.dwEntryTsc;
+
+        pProf = &pBpProf->Prof;
+        pProf->nSamples++;
+
+        ADD_CYCLES(pProf->Cond, dwCondCycles, 0);
+        ADD_CYCLES(pProf->Do, dwDoCycles, 0);
+        ADD_CYCLES(pProf->Arm, dwArmCycles, 0);
+        ADD_CYCLES(pProf->Total, dwTotal, 0);
+
+        if( dwTotal > pProf->Max )
+            pProf->Max = dwTotal;
+
+        // Bucket is the log2 of the cycles
+        for(i=0; (dwTotal >>= 1); i++ );
+
+        pProf->Hist[i]++;
+
+        pBpProf = NULL;
+    }
+}
+
 /******************************************************************************
 *                                                                             *
 *   void BreakpointDisableRange(DWORD dwStartAddress, UINT size)              *
@@ -1578,12 +1984,218 @@ void BreakpointDisableRange(DWORD dwStartAddress, UINT size)
                         deb.sysReg.dr7 &= ~(dr7mask[bp[index].DrUse]);
                         SetDebugReg(&deb.sysReg);   // Write them back into the CPU
 
-                        GlAvail |= bp[index].DrUse;
                         bp[index].DrUse = 0;
                     }
+
+                    GlAvail |= bp[index].DrAlloc;
+                    bp[index].DrAlloc = 0;
                 }
             }
         }
+
+        // Never call into the code that is going away
+        if( dwStartAddress<=(DWORD) bp[index].Callback && (DWORD) bp[index].Callback<(dwStartAddress+size) )
+        {
+            bp[index].Callback = NULL;
+            bp[index].pOwner = NULL;
+        }
+    }
+
+    // The pages watched by protection need their page table entries back before they are freed
+    WatchRelease(dwStartAddress, size);
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL BreakpointAttachCallback(TLINICEEXT *pOwner, int index, PEXT_BREAKPOINT Callback, void *pContext)
+*                                                                             *
+*******************************************************************************
+*
+*   Attaches an extension callback to an existing breakpoint, or detaches it
+*   if the callback is NULL. If the breakpoint has an IF condition, the
+*   callback is called only when it is true. The callback timing starts
+*   anew.
+*
+*   Where:
+*       pOwner is the extension
+*       index is the breakpoint index
+*       Callback is the extension function to call, or NULL
+*       pContext is the argument to pass to the callback
+*
+*   Returns:
+*       TRUE - the callback is attached or detached
+*       FALSE - the breakpoint is not set or another extension owns it
+*
+******************************************************************************/
+BOOL BreakpointAttachCallback(TLINICEEXT *pOwner, int index, PEXT_BREAKPOINT Callback, void *pContext)
+{
+    TBP *pBp;
+
+    if( index>=0 && index<MAX_BREAKPOINTS )
+    {
+        pBp = &bp[index];
+
+        if( (pBp->Flags & BP_USED) && !(pBp->Flags & BP_INTERNAL) && (!pBp->Callback || pBp->pOwner==pOwner) )
+        {
+            // The callback goes last since the breakpoint may be armed
+            pBp->Callback = NULL;
+            pBp->pContext = pContext;
+            pBp->pOwner   = Callback? pOwner : NULL;
+            pBp->nCalls   = 0;
+            pBp->CallCycles[0] = pBp->CallCycles[1] = 0;
+            pBp->CallMax  = 0;
+            pBp->Callback = Callback;
+
+            return( TRUE );
+        }
+    }
+
+    return( FALSE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   int BreakpointSetCallback(TLINICEEXT *pOwner, int type, TADDRDESC Addr, int access, PEXT_BREAKPOINT Callback, void *pContext)
+*                                                                             *
+*******************************************************************************
+*
+*   Sets a breakpoint on behalf of an extension. The breakpoint is set up the
+*   same way as by the breakpoint command, but when it hits, the extension
+*   function is called instead of executing the DO statements.
+*
+*   Breakpoints can only be set while we are in the debugger since they are
+*   armed while the debugee runs.
+*
+*   Where:
+*       pOwner is the extension setting the breakpoint
+*       type is the breakpoint type (BP_TYPE_*)
+*       Addr is the breakpoint address, or the port for BPIO
+*       access is the access verb of BPIO and BPM (1 - R, 2 - W, 3 - RW)
+*       Callback is the extension function to call
+*       pContext is the argument to pass to the callback
+*
+*   Returns:
+*       Index of the new breakpoint
+*       -1 if the breakpoint could not be set
+*
+******************************************************************************/
+int BreakpointSetCallback(TLINICEEXT *pOwner, int type, TADDRDESC Addr, int access, PEXT_BREAKPOINT Callback, void *pContext)
+{
+    TBP Opt;                            // Options of the new breakpoint
+    int index;
+
+    if( !deb.fRunningIce || !Callback || access<1 || access>3 )
+        return( -1 );
+
+    // Form the command line that the breakpoint is listed and edited with
+    switch( type )
+    {
+        case BP_TYPE_BPX:
+            sprintf(Buf, "%04X:%08X", Addr.sel, Addr.offset);
+            break;
+
+        case BP_TYPE_BPIO:
+            Addr.sel = deb.r->cs;
+            sprintf(Buf, "%X %s", Addr.offset, sBpio[access]);
+            break;
+
+        case BP_TYPE_BPMB:
+        case BP_TYPE_BPMW:
+        case BP_TYPE_BPMD:
+            sprintf(Buf, "%04X:%08X %s", Addr.sel, Addr.offset, sBpio[access]);
+            break;
+
+        default:
+            return( -1 );
+    }
+
+    if( !VerifySelector(Addr.sel) )
+        return( -1 );
+
+    memset(&Opt, 0, sizeof(TBP));
+
+    if( (Opt.pCmd = mallocHeap(deb.hHeap, strlen(Buf)+1))==NULL )
+        return( -1 );
+
+    strcpy(Opt.pCmd, Buf);
+
+    // An extension does not use the slot that BPE is about to edit
+    hint = -1;
+
+    if( (index = BreakpointSet(Addr, type, access, &Opt)) >= 0 )
+    {
+        BreakpointAttachCallback(pOwner, index, Callback, pContext);
+
+        return( index );
+    }
+
+    freeHeap(deb.hHeap, Opt.pCmd);
+
+    return( -1 );
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL BreakpointClearCallback(TLINICEEXT *pOwner, int index)               *
+*                                                                             *
+*******************************************************************************
+*
+*   Clears a breakpoint that an extension has set.
+*
+*   Where:
+*       pOwner is the extension that set the breakpoint
+*       index is the breakpoint index
+*
+*   Returns:
+*       TRUE - the breakpoint is cleared
+*       FALSE - the breakpoint was not set by that extension, or we are not
+*               in the debugger
+*
+******************************************************************************/
+BOOL BreakpointClearCallback(TLINICEEXT *pOwner, int index)
+{
+    char sIndex[4];                     // Index as an argument to the command
+
+    if( deb.fRunningIce && index>=0 && index<MAX_BREAKPOINTS && bp[index].Callback && bp[index].pOwner==pOwner )
+    {
+        sprintf(sIndex, "%02X", index);
+
+        cmdBp(sIndex, 0);               // Subclass 0 is BC, clear breakpoint
+
+        return( TRUE );
+    }
+
+    return( FALSE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void BreakpointReleaseOwner(TLINICEEXT *pOwner)                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Releases all breakpoints of an extension that is going away. In the
+*   debugger they are cleared; otherwise they are armed and only lose their
+*   callback, so they will stop in the debugger when they hit.
+*
+*   Where:
+*       pOwner is the extension
+*
+******************************************************************************/
+void BreakpointReleaseOwner(TLINICEEXT *pOwner)
+{
+    int index;
+
+    for(index=0; index<MAX_BREAKPOINTS; index++ )
+    {
+        if( bp[index].Callback && bp[index].pOwner==pOwner )
+        {
+            if( !BreakpointClearCallback(pOwner, index) )
+            {
+                bp[index].Callback = NULL;
+                bp[index].pOwner = NULL;
+            }
+        }
     }
 }
 
@@ -111,6 +111,9 @@ extern BOOL cmdWhat         (char *args, int subClass);      // symbols.c
 extern BOOL cmdReg          (char *args, int subClass);      // registers.c
 extern BOOL cmdLocals       (char *args, int subClass);      // locals.c
 extern BOOL cmdStack        (char *args, int subClass);      // stack.c
+extern BOOL cmdShow         (char *args, int subClass);      // tracelog.c
+extern BOOL cmdProfile      (char *args, int subClass);      // profile.c
+extern BOOL cmdPrintk       (char *args, int subClass);      // printk.c
 extern BOOL cmdWatch        (char *args, int subClass);      // watch.c
 extern BOOL cmdGdt          (char *args, int subClass);      // sysinfo.c
 extern BOOL cmdLdt          (char *args, int subClass);      // sysinfo.c
@@ -158,7 +161,7 @@ TCommand Cmd[] = {
 //{  "A",        1, 0, Unsupported,    "Assemble [Address]", "ex: A CS:1236",    0 },
 //{  "ADDR",     4, 0, Unsupported,    "ADDR [context-handle | task | *]", "ex: ADDR 80FD602C",   0 },
 {    "ALTKEY",   6, 0, cmdAltkey,      "ALTKEY [ALT letter | CTRL letter]", "ex: ALTKEY ALT D",   0 },
-{    "ALTSCR",   6, 3, cmdDisplay,     "ALTSCR [MONO | VGA | XWIN | OFF]", "ex: ALTSCR MONO",    0 },
+{    "ALTSCR",   6, 3, cmdDisplay,     "ALTSCR [MONO | VGA | XWIN | HEADLESS | OFF]", "ex: ALTSCR MONO",    0 },
 {    "ASCII",    5, 0, cmdAscii,       "ASCII", "ex: ASCII", 0 },
 {    "BC",       2, 0, cmdBp,          "BC list | *", "ex: BC *", 0 },
 {    "BD",       2, 1, cmdBp,          "BD list | *", "ex: BD 1,3,4", 0 },
@@ -180,7 +183,7 @@ TCommand Cmd[] = {
 {    "CLS",      3, 0, cmdCls,         "CLS clear window", "ex: CLS", 0 },
 {    "CODE",     4, 0, cmdCode,        "CODE [ON | OFF]", "ex: CODE OFF", 0 },
 {    "COLOR",    5, 0, cmdColor,       "COLOR [normal bold reverse help line | - ]", "ex: COLOR 30 3E 1F 1E 34", 0 },
-{    "CPU",      3, 0, cmdCpu,         "CPU [s | r]", "ex: CPU", 0 },
+{    "CPU",      3, 0, cmdCpu,         "CPU [s | r | * | cpu#]", "ex: CPU 1", 0 },
 {    "D",        1, 0, cmdDdump,       "D [address [L length]]", "ex: D B0000",   0 },
 {    "DATA",     4, 0, cmdData,        "DATA [data-window-number]", "ex: DATA 2", 0 },
 //{  "DEVICE",   6, 0, Unsupported,    "DEVICE [device-name | address]", "ex: DEVICE /dev/hda",   0 },
@@ -206,6 +209,7 @@ TCommand Cmd[] = {
 {    "H",        1, 0, cmdHelp,        "Help [command]", "ex: H R",  0 },
 {    "HALT",     4, 0, cmdHalt,        "HALT System APM Off", "ex: HALT",    0 },
 {    "HBOOT",    5, 0, cmdHboot,       "HBOOT System boot (total reset)", "ex: HBOOT",    0 },
+{    "HEADLESS", 8, 4, cmdDisplay,     "HEADLESS Switch to memory-only text output", "ex: HEADLESS",   0 },
 {    "HERE",     4, 0, cmdHere,        "HERE Go to current cursor line", "ex: HERE", 0 },
 {    "HELP",     4, 0, cmdHelp,        "Help [command]", "ex: HELP R",  0 },
 {    "I",        1, 1, cmdIn,          "I port", "ex: I 21",  0 },
@@ -240,7 +244,9 @@ TCommand Cmd[] = {
 {    "POKEB",    5, 0, cmdPoke,        "POKEB address value", "ex: POKEB F8000000 AA", 0 },
 {    "POKED",    5, 2, cmdPoke,        "POKED address value", "ex: POKED F8000000 12345678", 0 },
 {    "POKEW",    5, 1, cmdPoke,        "POKEW address value", "ex: POKEW F8000000 55AA", 0 },
+{    "PRINTK",   6, 0, cmdPrintk,      "PRINTK [ON | OFF | CLEAR] | LEVEL n | MODULE [name | *]", "ex: PRINTK LEVEL 4", 0 },
 //{  "PRN",      3, 0, Unsupported,    "PRN [LPTx | COMx]", "ex: PRN LPT1", 0 },
+{    "PROFILE",  7, 0, cmdProfile,     "PROFILE [ON | OFF | CLEAR | cpu] | CALLS [ON | OFF]", "ex: PROFILE CALLS ON", 0 },
 {    "PROC",     4, 0, cmdProc,        "PROC [-xo] [task-name]", "ex: PROC -x Explorer", 0 },
 //{  "QUERY",    5, 0, Unsupported,    "QUERY [[-x] address]", "ex: QUERY eip", 0 },
 {    "R",        1, 0, cmdReg,         "R [-d | register-name | register-name [=] value]", "ex: R EAX=50", 0 },
@@ -248,7 +254,7 @@ TCommand Cmd[] = {
 {    "S",        1, 0, cmdSearch,      "Search [-c] address L length data-string", "ex: S 0 L ffffff 'Help',0D,0A", 0 },
 {    "SERIAL",   6, 0, cmdSerial,      "SERIAL [ON|VT100 [com-port] [baud-rate] | OFF]", "ex: SERIAL ON 2 19200", 0 },
 {    "SET",      3, 0, cmdSet,         "SET [setvariable] [ON | OFF] [value]", "ex: SET FAULTS ON",   0 },
-//{  "SHOW",     4, 0, Unsupported,    "SHOW [B | start] [L length]", "ex: SHOW 100", 0 },
+{    "SHOW",     4, 0, cmdShow,        "SHOW [B | start] [L length] | LBR [ON | OFF]", "ex: SHOW 100", 0 },
 {    "SRC",      3, 0, cmdSrc,         "SRC Toggle between source, mixed & code", "ex: SRC",  0 },
 //{  "SS",       2, 0, Unsupported,    "SS [line-number] ['search-string']", "ex: SS 40 'if (i==3)'", 0 },
 {    "STACK",    5, 0, cmdStack,       "STACK [-v] [SS:EBP]", "ex: STACK",  0 },
@@ -279,7 +285,7 @@ TCommand Cmd[] = {
 //{  "XRSET",    5, 0, Unsupported,    "XRSET", "ex: XRSET", 0 },
 //{  "XT",       2, 0, Unsupported,    "XT [r]", "ex: XT", 0 },
 //{  "XFRAME",   6, 0, Unsupported,    "XFRAME [frame address]", "ex: XFRAME EBP",    0 },
-{    "XWIN",     4, 2, cmdDisplay,     "XWIN Switch to DGA-compatible X-Window display", "ex: XWIN",   0 },
+{    "XWIN",     4, 2, cmdDisplay,     "XWIN Switch to X-Window or kernel framebuffer display", "ex: XWIN",   0 },
 {    "ZAP",      3, 0, cmdZap,         "ZAP Zap embeded INT1 or INT3", "ex: ZAP", 0 },
 {    NULL,       0, 0, NULL,           NULL, 0 }
 };
@@ -335,7 +341,7 @@ char *sHelp[] = {
    "LDT    - Display local descriptor table",
    "IDT    - Display interrupt descriptor Table",
    "TSS    - Display task state segment",
-   "CPU    - Display cpu register information",
+   "CPU    - Display cpu register information or switch to another cpu",
    "PCI    - Display PCI device information",
    "MODULE - Display kernel module list",
    "PAGE   - Display page table information",
@@ -345,6 +351,8 @@ char *sHelp[] = {
 /* "THREAD - Display thread information", */
 /* "ADDR   - Display/change address contexts", */
    "PROC   - Display process information",
+   "PRINTK - Capture and display kernel printk messages",
+   "PROFILE- Sample timer interrupts and display the profile",
 /* "QUERY  - Display a processes virtual address space map", */
    "WHAT   - Identify the type of an expression",
 /* "DEVICE - Display info about a device", */
@@ -417,8 +425,9 @@ char *sHelp[] = {
    " WINDOW CONTROL",
    "VGA    - Switch to a VGA text display",
    "MDA    - Switch to a MDA (Monochrome) text display",
-   "XWIN   - Redirect console to a DGA frame buffer",
+   "XWIN   - Switch to X-Window or kernel framebuffer display",
    "SERIAL - Redirect console to a serial terminal",
+   "HEADLESS-Switch to a memory-only text display",
    "CLS    - Clear window",
    "RS     - Restore program screen",
    "ALTSCR - Change to alternate display",
@@ -432,8 +441,8 @@ char *sHelp[] = {
 /* "SS     - Search source module for string", */
    "TYPES  - List all types, or display type definition",
    "LOCALS - Display locals currently in scope",
-/* " BACK TRACE COMMANDS", */
-/* "SHOW   - Display from backtrace buffer", */
+   " BACK TRACE COMMANDS",
+   "SHOW   - Display execution history (B, start, L) or LBR records",
 /* "TRACE  - Enter back trace simulation mode", */
 /* "XT     - Step in trace simulation mode", */
 /* "XP     - Program step in trace simulation mode", */
@@ -638,8 +647,9 @@ void CommandBuildHelpIndex()
         // Search the help string array for the command
         while( sHelp[j] != NULL )
         {
-            // If names exactly match, copy the pointer
-            if( *(sHelp[j]+pCmd->nLen)==' ' )
+            // If names exactly match, copy the pointer. Long names are
+            // followed by the dash instead of a space.
+            if( *(sHelp[j]+pCmd->nLen)==' ' || *(sHelp[j]+pCmd->nLen)=='-' )
             {
                 if( !strnicmp(sHelp[j], pCmd->sCmd, pCmd->nLen) )
                 {
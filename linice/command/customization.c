@@ -58,6 +58,7 @@ extern TOUT outVga;                     // VGA output device
 extern TOUT outMda;                     // MDA output device
 extern TOUT outVT100;                   // Serial VT100 output device
 extern TOUT outDga;                     // DGA X-Window frame buffer output device
+extern TOUT outHeadless;                // Headless memory output device
 
 /******************************************************************************
 *                                                                             *
@@ -94,6 +95,7 @@ static TSETVAR SetVar[] = {
 { "autoon",   6, &deb.fTableAutoOn, VAR_BOOL , 0 },   // TABLE AUTOON | AUTOOFF
 { "pfprotect",9, &deb.fPfProtect,   VAR_BOOL , 0 },   // Internal: PF Protect
 { "syscall",  7, &deb.fSyscall,     VAR_BOOL , 0 },   // Display system calls from with our hook
+{ "nmifreeze",9, &deb.fNmiFreeze,   VAR_BOOL , 0 },   // Stop other CPUs using NMI IPI
 { NULL, }
 };
 
@@ -118,6 +120,7 @@ static char Buf[MAX_STRING];            // Temp line buffer to send line to edit
 ******************************************************************************/
 
 extern void MdaInit();
+extern void HeadlessInit();
 extern BOOL SerialInit(int com, int baud);
 extern int InitVT100(void);
 extern void SerialPrintStat();
@@ -1052,8 +1055,9 @@ Proceed:
 *       subClass is one of the following:
 *           0   - VGA
 *           1   - MDA (Monochrome display)
-*           2   - XWIN (DGA X-Window compatible screen)
+*           2   - XWIN (DGA X-Window or kernel framebuffer screen)
 *           3   - ALTSCR command - alternate way to switch displays
+*           4   - HEADLESS (memory-only text screen)
 *
 ******************************************************************************/
 BOOL cmdDisplay(char *args, int subClass)
@@ -1067,6 +1071,8 @@ BOOL cmdDisplay(char *args, int subClass)
         else
         if( !strcmp(args, "xwin")) subClass = 2;        // XWIN
         else
+        if( !strcmp(args, "headless")) subClass = 4;    // HEADLESS
+        else
         if( !strcmp(args, "off") ) subClass = 0;        // OFF? -> VGA
         else
         {
@@ -1080,6 +1086,9 @@ BOOL cmdDisplay(char *args, int subClass)
             else
             if( pOut==&outDga )
                 strcpy(Buf, "XWIN");
+            else
+            if( pOut==&outHeadless )
+                strcpy(Buf, "HEADLESS");
             else
                 strcpy(Buf, "SERIAL");  // Otherwise it is a serial connection..
 
@@ -1105,14 +1114,20 @@ BOOL cmdDisplay(char *args, int subClass)
             break;
 
         case 2:     // DGA-compatible X-Windows display
-            // We can switch to this driver only if xice had passed init packet,
-            // we allocated memory and initialized this subsystem
+            // We can switch to this driver only if xice had passed init packet
+            // or the kernel framebuffer was set up at init, we allocated memory
+            // and initialized this subsystem
             if( deb.pXDrawBuffer )
                 pOut = &outDga;
             else
                 dprinth(1, "Error: XWIN not initialized. Please run 'xice' to send parameters..");
             break;
 
+        case 4:     // Memory-only text screen
+            HeadlessInit();
+            pOut = &outHeadless;
+            break;
+
         default:;
     }
 
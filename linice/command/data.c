@@ -168,14 +168,24 @@ static int PrintAscii(int pos)
 void GetDataLine(PTADDRDESC pAddr)
 {
     int i, pos;
+    UINT nRead;                         // Number of bytes read in a block
 
-    // Fetch a lineful of bytes at a time and get their present flags
-    for( i=0; i<DATA_BYTES; i++)
+    // Fetch a lineful of bytes at a time and get their present flags. The
+    // read stops at a page that is not present, so skip to the next page
+    for( i=0; i<DATA_BYTES; )
     {
-        fValid[i] = AddrIsPresent(pAddr);
-        if( fValid[i]==TRUE )
-            MyData.byte[i] = AddrGetByte(pAddr);
-        pAddr->offset++;
+        nRead = AddrReadBlock(pAddr, &MyData.byte[i], DATA_BYTES - i);
+        pAddr->offset += nRead;
+
+        while( nRead-- )
+            fValid[i++] = TRUE;
+
+        while( i<DATA_BYTES )
+        {
+            fValid[i++] = FALSE;
+            if( (++pAddr->offset & 0xFFF)==0 )
+                break;
+        }
     }
 
     pos = sprintf(buf, "%04X:%08X ", pAddr->sel, pAddr->offset - DATA_BYTES);
@@ -370,8 +380,6 @@ static BYTE ReadByte(char *pStr)
 static BOOL DataGetSet(int cmd, TADDRDESC *pAddr, int pos, char key)
 {
     static char sField[80];             // Field ASCII value
-    BYTE bValue;
-    DWORD temp;
     int i;
 
     // Depending on the command, manage data buffer
@@ -380,15 +388,7 @@ static BOOL DataGetSet(int cmd, TADDRDESC *pAddr, int pos, char key)
         case DATAGETSET_READ: // Read in a field into the internal ASCII buffer
 
             // Read bytes first
-            temp = pAddr->offset;
-
-            for(i=0; i<DataField[deb.nDumpSize[deb.nData]].FWidth; i++ )
-            {
-                MyData.byte[i] = AddrGetByte(pAddr);
-                pAddr->offset++;
-            }
-
-            pAddr->offset = temp;
+            AddrReadBlock(pAddr, MyData.byte, DataField[deb.nDumpSize[deb.nData]].FWidth);
 
             // Translate into ASCII representation
             switch( deb.nDumpSize[deb.nData] )
@@ -414,16 +414,11 @@ static BOOL DataGetSet(int cmd, TADDRDESC *pAddr, int pos, char key)
                 case 2:     // WORD
                 case 4:     // DWORD
 
-                    temp = pAddr->offset;
-
-                    for(i=deb.nDumpSize[deb.nData]-1; i>=0; i--)
-                    {
-                        bValue = ReadByte(&sField[i*2]);
-                        AddrSetByte(pAddr, bValue, TRUE);
-                        pAddr->offset++;
-                    }
+                    // The most significant byte is the first in the field
+                    for(i=0; i<deb.nDumpSize[deb.nData]; i++)
+                        MyData.byte[i] = ReadByte(&sField[(deb.nDumpSize[deb.nData]-1-i)*2]);
 
-                    pAddr->offset = temp;
+                    AddrWriteBlock(pAddr, MyData.byte, deb.nDumpSize[deb.nData], TRUE);
                     break;
             }
             break;
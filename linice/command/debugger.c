@@ -60,6 +60,8 @@
 
 static char sCmd[MAX_STRING];
 
+#define DR6_HWBPMASK        0x0F        // DR6 bits of hardware breakpoints that hit
+
 
 /******************************************************************************
 *                                                                             *
@@ -67,8 +69,8 @@ static char sCmd[MAX_STRING];
 *                                                                             *
 ******************************************************************************/
 
-extern DWORD Checksum1(DWORD start, DWORD len);
 extern void DisplayMessage(void);
+extern DWORD GetRdtsc(BYTE *buffer8);
 extern void EdLin( char *sCmdLine );
 extern void ArmBreakpoints(void);
 extern void DisarmBreakpoints(void);
@@ -77,10 +79,19 @@ extern BOOL cmdStep(char *args, int subClass);
 extern BOOL MultiTrace(void);
 extern BOOL RepeatSrcTrace(void);
 extern BOOL RepeatSrcStep(void);
+extern BOOL TraceFastPath(void);
+extern void TraceReport(void);
+extern void LiftBreakpointAtCSIP(void);
+extern void RestoreLiftedBreakpoint(void);
+extern void TraceLogEnter(void);
+extern void TraceLogLeave(BOOL fRecord);
 extern void DebPrintErrorString();
 extern void DispatchExtEnter();
 extern void DispatchExtLeave();
 extern void FixupUserCallFrame(void);
+extern BOOL smpSwitchCpu(UINT cpu);
+extern int WatchHit(void);
+extern void PrintkDrain(void);
 
 
 /******************************************************************************
@@ -107,10 +118,37 @@ void DebuggerEnterBreak(void)
 {
     TADDRDESC Addr;                     // Address descriptor
     BOOL fAcceptNext;                   // Flag to continue looping inside debugger
+    BOOL fPopup = FALSE;                // The debugger screen was popped up
 
     // Abort possible single step trace state
     deb.r->eflags &= ~TF_MASK;
 
+    // Complete the execution history record of the last step
+    TraceLogEnter();
+
+    // On a single step trap that simply continues a trace, the breakpoints are left
+    // armed and the symbol context is not evaluated
+    if( deb.nInterrupt==1 && (deb.sysReg.dr6 & BITMASK(DR6_BS_BIT)) )
+    {
+        deb.nTraceSteps++;              // Count the steps to report the trace speed
+
+        if( !(deb.sysReg.dr6 & DR6_HWBPMASK) && WatchHit()<0 )
+        {
+            RestoreLiftedBreakpoint();
+
+            if( TraceFastPath() )
+            {
+                // Clear the DR6 register since CPU never does it
+                deb.sysReg.dr6 = 0;
+
+                // Trace over a breakpoint that may be at the next instruction
+                LiftBreakpointAtCSIP();
+
+                goto Trace_Continuation;
+            }
+        }
+    }
+
     //-----------------------------------------------------------------------
     {
         // If we hit our internal INT3 from the custom function call, restore the ESP and EIP
@@ -155,23 +193,31 @@ void DebuggerEnterBreak(void)
                 // execution, in which case we jump forward
                 if( EvalBreakpoint()==FALSE )
                 {
+                    fPopup = TRUE;
+
                     // Enable output driver and save background if flash is on or we are not in step or trace
                     if( deb.fFlash || !(deb.fStep || deb.fTrace) )
                     {
                         dputc(DP_ENABLE_OUTPUT);
                         dputc(DP_SAVEBACKGROUND);
                     }
-                    // Recalculate the checksum of the linice code to make sure it is not
-                    // trashed by a misbehaving debugee
-                    if( deb.LiniceChecksum != Checksum1((DWORD)ObjectStart, (DWORD)ObjectEnd - (DWORD)ObjectStart) )
+                    // Verify the checksums of the linice code to make sure it is not
+                    // trashed by a misbehaving debugee. When stepping, only check the
+                    // next few blocks; the rest is verified while we wait for a key
+                    if( !ImageVerify((deb.fStep || deb.fTrace)? IMAGE_VERIFY_BLOCKS : 0) )
                     {
                         dprinth(1, "MEMORY CORRUPTED - SYSTEM UNSTABLE. It is advisable to reboot.");
                     }
 
+                    // Print the kernel messages captured since we last left
+                    PrintkDrain();
+
                     // Recalculate window locations based on visibility and number of lines
                     // and repaint all windows
                     RecalculateDrawWindows();
                     {
+                        TraceReport();
+
                         // Reset various trace state flags
                         deb.fTrace = FALSE;
                         deb.nTraceCount = 0;
@@ -217,6 +263,10 @@ void DebuggerEnterBreak(void)
                         //========================================================================
                         // Dispatch the message that we are leaving the debugger
                         DispatchExtLeave();
+
+                        // Start counting the trace steps
+                        deb.nTraceSteps = 0;
+                        GetRdtsc((BYTE *)deb.TraceTsc);
                     }
 
                     // Restore background and disable output driver if flash is on or we are not in step or trace
@@ -225,15 +275,26 @@ void DebuggerEnterBreak(void)
                         dputc(DP_RESTOREBACKGROUND);
                         dputc(DP_DISABLE_OUTPUT);
                     }
+                    else
+                        dflush();           // Leave the last state on the screen
                 }
             }
         }
 
+        // If we were looking at a different CPU, go back to the one that
+        // broke in since that is the one that continues
+        if( deb.cpuCur!=deb.cpu )
+            smpSwitchCpu(deb.cpu);
+
         // Copy the content of the general registers in the prev buffer
         // so the next time when we enter the debugger we will be able
         // to tell what registers had changed
         memcpy(&deb.r_prev, deb.r, sizeof(TREGS));
 
+        // Likewise for the values of the locals and watch expressions
+        ListClearChanged(&deb.Local);
+        ListClearChanged(&deb.Watch);
+
 P_RET_Continuation:
 T_count_continuation:
 
@@ -241,6 +302,8 @@ T_count_continuation:
         ArmBreakpoints();
     }
 
+Trace_Continuation:
+
     // If the fTrace signal flag is set, set it in the eflags register. This
     // signals a single step over one machine instruction
     if( deb.fTrace )
@@ -259,6 +322,9 @@ T_count_continuation:
         }
     }
 
+    // Record the execution history of traced and non-stopping entries
+    TraceLogLeave(deb.fTrace || !fPopup);
+
     // Set RESUME flag on the eflags and return to the client. This way we dont
     // break on the same condition, if a hardware bp would trigger it at this address
     deb.r->eflags |= RF_MASK;
@@ -281,6 +347,8 @@ void DebuggerEnterDelayedArm(void)
 {
     // Delayed arm - arm breakpoints and continue
 
+    TraceLogEnter();
+
     ArmBreakpoints();
 
     // Clear the trace flag that was set in order for us to be here
@@ -291,6 +359,8 @@ void DebuggerEnterDelayedArm(void)
     if( deb.fTrace )
         deb.r->eflags |= TF_MASK;
 
+    TraceLogLeave(deb.fTrace);
+
     deb.fDelayedArm = FALSE;
 
     return;
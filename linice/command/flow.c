@@ -40,7 +40,10 @@
 *   Include Files                                                             *
 ******************************************************************************/
 
+#include "module-header.h"              // Include types commonly defined for a module
+
 #include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
 #include "ice.h"                        // Include main debugger structures
 #include "debug.h"                      // Include our dprintk()
 
@@ -61,6 +64,12 @@ extern DWORD StackExtraBuffer;
 ******************************************************************************/
 
 static char *pSrcEipLine = NULL;        // Cache pointer to source line for repeated src step and trace
+static WORD wSrcLineSel;                // Code block of the cached source line that contains the EIP
+static DWORD dwSrcLineStart = 0;        //  used to continue src step and trace without
+static DWORD dwSrcLineEnd = 0;          //  evaluating the symbol context (end is exclusive)
+
+#define TRACE_REPORT_STEPS  1000        // Report the trace speed after that many steps
+#define RANGE_STEP_MAX      256         // Max number of instructions to run over in one range step
 
 #define MAGIC_CALL_SIG      0x55AA00CC  // Signature dword for the CALL frame
 #define MAGIC_CALL_MASK     0xFFFF00FF  // Valid bits in the magic word
@@ -72,6 +81,7 @@ static char *pSrcEipLine = NULL;        // Cache pointer to source line for repe
 ******************************************************************************/
 
 extern void SetOneTimeBreakpoint(TADDRDESC Addr);
+extern DWORD GetRdtsc(BYTE *buffer8);
 
 // From linux/reboot.h
 
@@ -204,6 +214,171 @@ BOOL cmdGo(char *args, int subClass)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   static void CacheSrcLineRange(void)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Caches the code block of the current source line that contains the EIP.
+*   While the EIP stays within that block, source trace and step are known
+*   to be on the same line without evaluating the symbol context.
+*
+******************************************************************************/
+static void CacheSrcLineRange(void)
+{
+    wSrcLineSel = deb.r->cs;
+
+    if( !SymFnLin2LineRange(deb.pFnLin, deb.r->eip, &dwSrcLineStart, &dwSrcLineEnd) )
+        dwSrcLineStart = dwSrcLineEnd = 0;
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL IsRangeStop(PTDISASM pDis)                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks for linear instructions that a range step should not run over
+*   since they transfer control or are handled specially in a single step.
+*
+*   Where:
+*       pDis is the disassembled instruction
+*   Returns:
+*       TRUE - the instruction needs to be single stepped
+*       FALSE - the instruction is linear
+*
+******************************************************************************/
+static BOOL IsRangeStop(PTDISASM pDis)
+{
+    int i;
+
+    // Skip the instruction prefixes
+    for(i=0; i<pDis->bInstrLen-1; i++ )
+    {
+        switch( pDis->bCodes[i] )
+        {
+            case 0x26: case 0x2E: case 0x36: case 0x3E: case 0x64: case 0x65:
+            case 0x66: case 0x67: case 0xF0: case 0xF2: case 0xF3:
+                continue;
+        }
+        break;
+    }
+
+    switch( pDis->bCodes[i] )
+    {
+        case 0xF1:                      // ICEBP
+        case 0xF4:                      // HLT is skipped when traced
+            return( TRUE );
+
+        case 0x0F:
+            switch( pDis->bCodes[i+1] )
+            {
+                case 0x05:              // SYSCALL
+                case 0x07:              // SYSRET
+                case 0x0B:              // UD2
+                case 0x34:              // SYSENTER
+                case 0x35:              // SYSEXIT
+                    return( TRUE );
+            }
+            break;
+    }
+
+    return( FALSE );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static DWORD RangeStepTarget(void)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Decodes forward from the current cs:eip, within the cached code block of
+*   the source line, up to the first instruction that may transfer control or
+*   up to the end of the block. Running to that address is the same as single
+*   stepping all the linear instructions in between, since they all stay on
+*   the same source line.
+*
+*   Returns:
+*       Address to run to
+*       0 if the current instruction needs to be single stepped
+*
+******************************************************************************/
+static DWORD RangeStepTarget(void)
+{
+    TDISASM Dis;                        // Disassembler interface structure
+    TADDRDESC Addr;                     // Address of the current instruction
+    TADDRDESC Last;                     // Address of its last byte
+    int n;                              // Instruction counter
+
+    Addr.sel    = deb.r->cs;
+    Addr.offset = deb.r->eip;
+
+    if( Addr.sel!=wSrcLineSel || Addr.offset<dwSrcLineStart || Addr.offset>=dwSrcLineEnd )
+        return( 0 );
+
+    for(n=0; n<RANGE_STEP_MAX && Addr.offset<dwSrcLineEnd && AddrIsPresent(&Addr); n++ )
+    {
+        Dis.bState   = DIS_DATA32 | DIS_ADDRESS32;
+        Dis.wSel     = Addr.sel;
+        Dis.dwOffset = Addr.offset;
+        DisassemblerLen(&Dis);
+
+        Last.sel    = Addr.sel;
+        Last.offset = Addr.offset + Dis.bInstrLen - 1;
+
+        if( (Dis.bFlags & SCAN_MASK)!=SCAN_NATIVE || (Dis.bState & DIS_ILLEGALOP)
+         || !AddrIsPresent(&Last) || IsRangeStop(&Dis) )
+            break;
+
+        Addr.offset += Dis.bInstrLen;
+    }
+
+    // The breakpoint needs to be placed in a present page
+    if( Addr.offset==deb.r->eip || !AddrIsPresent(&Addr) )
+        return( 0 );
+
+    return( Addr.offset );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL ArmRangeStep(void)                                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Arms a source trace or step to run over the linear code of the current
+*   line using a non-sticky breakpoint, instead of single stepping each
+*   instruction.
+*
+*   Returns:
+*       TRUE - Range step is armed
+*       FALSE - The current instruction needs to be single stepped
+*
+******************************************************************************/
+static BOOL ArmRangeStep(void)
+{
+    TADDRDESC BpAddr;                   // Breakpoint address descriptor
+
+    BpAddr.offset = RangeStepTarget();
+
+    if( BpAddr.offset )
+    {
+        BpAddr.sel = deb.r->cs;
+        SetOneTimeBreakpoint(BpAddr);
+
+        deb.fTrace = FALSE;             // This time we are not using CPU trace facility
+
+        return( TRUE );
+    }
+
+    return( FALSE );
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   BOOL RepeatSrcTrace(void)                                                 *
@@ -224,8 +399,12 @@ BOOL RepeatSrcTrace(void)
     // Also break if we left the legal context (pFnLin is NULL in that case)
     if( deb.pFnLin && deb.pSrcEipLine==pSrcEipLine )
     {
+        CacheSrcLineRange();            // The line may have more than one code block
+
         deb.fTrace = TRUE;              // Do another trace step
 
+        ArmRangeStep();                 // .. or run to the next branch
+
         return( TRUE );                 // Continue looping
     }
 
@@ -306,6 +485,7 @@ BOOL cmdTrace(char *args, int subClass)
         // SOURCE CODE ACTIVE
 
         pSrcEipLine = deb.pSrcEipLine;  // Set the pointer cache of the current source line
+        CacheSrcLineRange();
         deb.fSrcTrace = TRUE;           // We are doing source trace
     }
 
@@ -313,6 +493,10 @@ BOOL cmdTrace(char *args, int subClass)
 
     deb.fTrace = TRUE;
 
+    // Source trace runs over the linear code of the line to the next branch
+    if( deb.fSrcTrace )
+        ArmRangeStep();
+
     return( FALSE );                    // Exit into debugee...
 }
 
@@ -382,6 +566,14 @@ static BOOL ArmStep()
     TDISASM Dis;                        // Disassembler interface structure
     TADDRDESC BpAddr;                   // Breakpoint address descriptor
 
+    // Source step runs over the linear code of the line to the next branch
+    if( deb.fSrcStep && ArmRangeStep() )
+    {
+        deb.fStep = TRUE;
+
+        return( TRUE );
+    }
+
     // Get the size in bytes of the current instruction and its flags
     Dis.bState   = DIS_DATA32 | DIS_ADDRESS32;
     Dis.wSel     = deb.r->cs;
@@ -445,6 +637,8 @@ BOOL RepeatSrcStep(void)
     // Also break if we left the legal context (pFnLin is NULL in that case)
     if( deb.pFnLin && deb.pSrcEipLine==pSrcEipLine )
     {
+        CacheSrcLineRange();            // The line may have more than one code block
+
         // Continue looping unless we hit a return while in the "P RET" mode
         return( ArmStep() );
     }
@@ -454,6 +648,116 @@ BOOL RepeatSrcStep(void)
     return( FALSE );                    // Exit breaking into the debugger
 }
 
+/******************************************************************************
+*                                                                             *
+*   BOOL TraceFastPath(void)                                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Called on a single step trap, with the breakpoints still armed, to check
+*   if a multiple trace, or a source trace or step, simply continues. In that
+*   case the debugger does not need to disarm and rearm breakpoints or to
+*   evaluate the symbol context: the source line is checked against the code
+*   block cached when the trace started, and multiple trace does not need the
+*   context unless the source mode is on.
+*
+*   Returns:
+*       TRUE - Continue tracing
+*       FALSE - Do the full debugger entry (which may still continue tracing)
+*
+******************************************************************************/
+BOOL TraceFastPath(void)
+{
+    TDISASM Dis;                        // Disassembler interface structure
+
+    // Stepping until return needs the full handling
+    if( deb.fStepRet )
+        return( FALSE );
+
+    if( deb.fSrcTrace || deb.fSrcStep )
+    {
+        // Outside the cached code block we need the context to tell the line
+        if( deb.r->cs!=wSrcLineSel || deb.r->eip<dwSrcLineStart || deb.r->eip>=dwSrcLineEnd )
+            return( FALSE );
+
+        // Linear code is run over using a breakpoint that needs to be armed
+        if( RangeStepTarget() )
+            return( FALSE );
+
+        if( deb.fSrcStep )
+        {
+            Dis.bState   = DIS_DATA32 | DIS_ADDRESS32;
+            Dis.wSel     = deb.r->cs;
+            Dis.dwOffset = deb.r->eip;
+            DisassemblerLen(&Dis);
+
+            Dis.bFlags &= SCAN_MASK;        // Mask the scan bits
+
+            // Calls and interrupts are skipped using a one-time breakpoint that needs to be armed
+            if( Dis.bFlags==SCAN_CALL || Dis.bFlags==SCAN_INT )
+                return( FALSE );
+
+            deb.fStep = TRUE;
+        }
+
+        deb.fTrace = TRUE;              // Do another trace step
+
+        return( TRUE );
+    }
+
+    // Multiple trace with the source on turns into the source trace, which needs the context
+    if( deb.nTraceCount && deb.eSrc!=SRC_ON )
+        return( MultiTrace() );
+
+    return( FALSE );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   void TraceReport(void)                                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Prints the number of trace steps per second after a long trace or step
+*   command had completed. Called when the debugger pops up.
+*
+******************************************************************************/
+void TraceReport(void)
+{
+    DWORD Tsc[2];                       // Current TSC value
+    DWORD dwLow, dwHigh;                // Elapsed TSC cycles
+    DWORD dwKhz;                        // CPU speed in KHz
+    DWORD ms;                           // Elapsed time in milliseconds
+
+    dwKhz = ice_get_cpu_khz();
+
+    if( deb.nTraceSteps >= TRACE_REPORT_STEPS && dwKhz )
+    {
+        GetRdtsc((BYTE *)Tsc);
+
+        dwLow  = Tsc[0] - deb.TraceTsc[0];
+        dwHigh = Tsc[1] - deb.TraceTsc[1] - (dwLow > Tsc[0]);
+
+        // Scale down the cycles and the CPU speed alike, so we can divide in 32 bits
+        while( dwHigh )
+        {
+            dwLow = (dwLow >> 1) | (dwHigh << 31);
+            dwHigh >>= 1;
+            dwKhz >>= 1;
+        }
+
+        ms = dwLow / (dwKhz? dwKhz : 1);
+
+        if( ms )
+            dprinth(1, "Traced %u steps in %u ms (%u steps/s)",
+                deb.nTraceSteps, ms, deb.nTraceSteps / ms * 1000 + deb.nTraceSteps % ms * 1000 / ms);
+    }
+
+    deb.nTraceSteps = 0;
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   BOOL cmdStep(char *args, int subClass)                                    *
@@ -494,6 +798,7 @@ BOOL cmdStep(char *args, int subClass)
         // SOURCE CODE ACTIVE - initiate repeated step cycles
 
         pSrcEipLine = deb.pSrcEipLine;  // Set the pointer cache of the current source line
+        CacheSrcLineRange();
         deb.fSrcStep = TRUE;            // We are doing source step
     }
 
@@ -97,6 +97,7 @@ pList->pList |
 #define PRINT_ALL_LINES     999         // Magic value to print all lines (not in a window)
 
 static char buf[MAX_STRING];            // Temp buffer to print the final string
+static char sValue[MAX_STRING];         // Temp buffer to evaluate a value
 
 
 /******************************************************************************
@@ -535,8 +536,12 @@ static void ListPrintRecurse(TLIST *pList, TLISTITEM *pItem, BOOL *fPrintNext, i
             (*pLineCount)--;
 
             // If we have the focus and the current item is the one selected, invert the line color
+            // Otherwise, highlight the values that changed
             if( pList->fInFocus && pList->pSelected==pItem )
                 col = COL_REVERSE;
+            else
+            if( pItem->fChanged )
+                col = COL_BOLD;
             else
                 col = COL_NORMAL;
 
@@ -641,18 +646,25 @@ void MakeSelectedVisible(TLIST *pList, int nLines)
 
 /******************************************************************************
 *
-*   Helper function to ListEvaluate() that evaluates all the nodes recursively.
+*   Helper function to ListEvaluate() that evaluates a node and its expanded
+*   elements recursively. The siblings of the node are not walked since they
+*   are evaluated at their own addresses. A value that differs from the one
+*   evaluated the last time is marked changed.
 *
 ******************************************************************************/
 static void ListEvaluateRecurse(TLISTITEM *pItem, BYTE *pVar )
 {
-    if( pItem )
-    {
-        PrintTypeValue(pItem->Value, &pItem->Item, pVar+pItem->delta/8, pItem->delta, pItem->width);
+    TLISTITEM *pElement;
 
-        ListEvaluateRecurse((TLISTITEM *) pItem->pElement, pVar+pItem->delta/8);
-        ListEvaluateRecurse((TLISTITEM *) pItem->pNext, pVar);
-    }
+    PrintTypeValue(sValue, &pItem->Item, pVar+pItem->delta/8, pItem->delta, pItem->width);
+
+    if( pItem->Value[0] && strcmp(pItem->Value, sValue) )
+        pItem->fChanged = TRUE;
+
+    strcpy(pItem->Value, sValue);
+
+    for(pElement = (TLISTITEM *) pItem->pElement; pElement; pElement = (TLISTITEM *) pElement->pNext)
+        ListEvaluateRecurse(pElement, pVar+pItem->delta/8);
 }
 
 /******************************************************************************
@@ -681,6 +693,94 @@ void ListEvaluate(TLIST *pList)
     }
 }
 
+/******************************************************************************
+*
+*   Helper function to ListClearChanged() that walks all the nodes recursively.
+*
+******************************************************************************/
+static void ListClearChangedRecurse(TLISTITEM *pItem)
+{
+    if( pItem )
+    {
+        pItem->fChanged = FALSE;
+
+        ListClearChangedRecurse((TLISTITEM *) pItem->pElement);
+        ListClearChangedRecurse((TLISTITEM *) pItem->pNext);
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void ListClearChanged(TLIST *pList)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Clears the changed marks of all the values in the given list. This is
+*   called when leaving the debugger, so the next time the values that had
+*   changed are highlighted.
+*
+*   Where:
+*       pList is the list to clear
+*
+******************************************************************************/
+void ListClearChanged(TLIST *pList)
+{
+    ListClearChangedRecurse(pList->pList);
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL ListSameContext(TLIST *pList)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks if the symbol context is the one that the root items of the list
+*   were last evaluated in, and records the current one.
+*
+*   Where:
+*       pList is the list to check
+*
+*   Returns:
+*       TRUE - the symbol table, function scope and frame did not change
+*       FALSE - context changed; the items need to be evaluated again
+*
+******************************************************************************/
+BOOL ListSameContext(TLIST *pList)
+{
+    BOOL fSame;
+
+    fSame = pList->pSymTab==deb.pSymTabCur && pList->pFnScope==deb.pFnScope
+         && pList->pRegs==deb.r && pList->dwFrame==deb.r->ebp;
+
+    pList->pSymTab  = deb.pSymTabCur;
+    pList->pFnScope = deb.pFnScope;
+    pList->pRegs    = deb.r;
+    pList->dwFrame  = deb.r->ebp;
+
+    return( fSame );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void ListResetContext(TLIST *pList)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Forgets the context that the list items were evaluated in, so they are
+*   all evaluated again. This is needed when a symbol table is removed.
+*
+*   Where:
+*       pList is the list to reset
+*
+******************************************************************************/
+void ListResetContext(TLIST *pList)
+{
+    pList->pSymTab  = NULL;
+    pList->pFnScope = NULL;
+    pList->pRegs    = NULL;
+    pList->dwFrame  = 0;
+}
+
 /******************************************************************************
 *                                                                             *
 *   void ListDraw(TLIST *pList, TFRAME *pFrame, BOOL fForce)                  *
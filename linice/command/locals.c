@@ -61,6 +61,7 @@
 #define MAX_LOCALS_QUEUE    32          // Max number of local variables to display
 
 static TSYMFNSCOPE1 *LocalsQueue[MAX_LOCALS_QUEUE];
+static TSYMFNSCOPE1 *LocalsListed[MAX_LOCALS_QUEUE];    // Queue that the list was built from
 
 static char *RegisterVariables[8] =
 {
@@ -136,6 +137,9 @@ static BOOL LocalBuildQueue(TSYMFNSCOPE *pFnScope, DWORD dwEIP)
     // following variables will not be visible, until the scope indent count comes back
     // to the base level
 
+    // Function addresses are stored relative to the code segment
+    dwEIP -= SymTabReloc(deb.pSymTabCur, 0);
+
     if( pFnScope && pFnScope->dwStartAddress<=dwEIP && pFnScope->dwEndAddress>=dwEIP )
     {
         // Scan forward for the matching code offset
@@ -267,6 +271,11 @@ static void LocalBuildList()
 *
 *   Rebuilds the list of local variables.
 *
+*   If the same variables are visible as when the list was last built, the
+*   list is kept together with the items that the user had expanded, and
+*   only the addresses of the variables are updated if the frame moved.
+*   Their values are read again when the list is drawn.
+*
 *   Where:
 *       List is the reference to a list to change
 *       pFnScope is the function scope to search
@@ -278,18 +287,43 @@ static void LocalBuildList()
 ******************************************************************************/
 BOOL FillLocalScope(TLIST *List, TSYMFNSCOPE *pFnScope, DWORD dwEIP)
 {
+    TLISTITEM *pItem = NULL;            // Root item of a variable
+    BOOL fSameScope;                    // The list was built for the same scope
+    int index;                          // Running index into queue
+
     memset(&LocalsQueue, 0, sizeof(LocalsQueue));
 
     // Build the scope only if the function scope is valid
-    if( pFnScope )
+    if( pFnScope && LocalBuildQueue(pFnScope, dwEIP) )
     {
-        if( LocalBuildQueue(pFnScope, dwEIP) )
+        // Keep the list if it shows the same variables of the same function
+        fSameScope = List->pList && List->pFnScope==pFnScope && !memcmp(LocalsQueue, LocalsListed, sizeof(LocalsQueue));
+
+        // Record the current context. If the frame moved, parse the addresses of
+        // the variables again, in the same order the list was built
+        if( !ListSameContext(List) && fSameScope )
+        {
+            index = MAX_LOCALS_QUEUE;
+
+            while( --index>=0 )
+            {
+                if( LocalsQueue[index] && (pItem = ListGetNext(List, pItem)) )
+                    ParseLocalSymbol(&pItem->Item, LocalsQueue[index]);
+            }
+        }
+
+        if( !fSameScope )
         {
             // Rebuild the list of locals based on the queue
+            ListDelAll(List);
 
             LocalBuildList();
+
+            memcpy(LocalsListed, LocalsQueue, sizeof(LocalsQueue));
         }
     }
+    else
+        ListDelAll(List);
 
     return( TRUE );
 }
@@ -0,0 +1,976 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     profile.c                                                     *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the statistical profiler and the PROFILE
+        command.
+
+        While profiling is on, every timer interrupt that arrives during the
+        debugee run stores the interrupted EIP into a ring buffer of the CPU
+        that took it, and the interrupt is passed on to the kernel without
+        popping up the debugger. The PROFILE command then folds the samples
+        into symbols and modules and lists them, most frequent first.
+
+        With PROFILE CALLS ON, every kernel sample also walks the EBP frames
+        of the interrupted code and adds the call stack to a call tree.
+        Tree nodes are hash-consed on (caller node, address), so a sample
+        is stored as the single node at the end of its path. The tree is
+        listed inverted (the sampled functions first, followed by their
+        callers), and linsym can fetch it as folded stacks for flame graphs.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include "module-header.h"              // Versatile module header file
+
+#include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
+#include "ice.h"                        // Include main debugger structures
+#include "ice-ioctl.h"                  // Include our own IOCTL numbers
+#include "errno.h"                      // Include kernel error numbers
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+// Samples taken on a single CPU
+
+typedef struct
+{
+    DWORD Eip[MAX_PROFILE_SAMPLES];     // Ring of interrupted addresses
+    UINT nHead;                         // Index of the next sample to write
+    DWORD dwSamples;                    // Total number of samples taken
+
+} TPROFCPU;
+
+static TPROFCPU Prof[MAX_CPU];          // Sample rings, one for each CPU
+static BOOL fProfile = FALSE;           // Profiling is on
+
+// Samples folded into symbols; special addresses collect samples
+// without a symbol
+
+#define PROF_USER           0           // Samples taken in the user mode
+#define PROF_UNKNOWN        1           // Kernel samples without a symbol
+
+typedef struct
+{
+    DWORD dwAddr;                       // Address of the symbol
+    DWORD dwSpan;                       // Largest sample offset from the symbol
+    UINT nHits;                         // Number of samples within the symbol
+
+} TPROFSYM;
+
+static TPROFSYM Sym[MAX_PROFILE_SYMS];
+static UINT nSyms;
+
+typedef struct
+{
+    char *pName;                        // Name of the module
+    UINT nHits;                         // Number of samples within the module
+
+} TPROFMOD;
+
+static TPROFMOD Mod[MAX_PROFILE_MODULES];
+static UINT nMods;
+
+// Call tree whose nodes are unique (parent, address) pairs; node 0 is the
+// root and the number of samples of a node counts the call stacks that
+// ended there
+
+#define CALL_HASH           512         // Number of hash chains (power of 2)
+#define CALL_CUTOFF         10          // Nodes below 1.0% are not listed
+
+typedef struct
+{
+    DWORD dwEip;                        // Address (code or return address)
+    WORD wParent;                       // Index of the caller node
+    WORD wNext;                         // Next node in the hash chain
+    DWORD dwHits;                       // Number of samples
+
+} TCALLNODE;
+
+typedef struct
+{
+    TCALLNODE Node[MAX_CALL_NODES];     // Nodes of the tree
+    WORD Hash[CALL_HASH];               // Heads of the hash chains
+    UINT nNodes;                        // Number of nodes used, not counting the root
+
+} TCALLTREE;
+
+static TCALLTREE Calls;                 // Sampled call stacks
+static TCALLTREE Inverted;              // Inverted tree, built for listing
+static BYTE fListed[MAX_CALL_NODES];    // Inverted tree nodes already listed
+static BOOL fCalls = FALSE;             // Call stack sampling is on
+static DWORD dwCallLock;                // Lock of the sampled tree
+static DWORD dwCallSamples;             // Number of call stacks in the tree
+static DWORD dwCallDropped;             // Samples that did not fit or were busy
+
+static char sFolded[MAX_CALL_DEPTH * (MAX_MODULE_NAME + MAX_SYMBOL_LEN + 2) + 16];
+
+/******************************************************************************
+*                                                                             *
+*   External Functions                                                        *
+*                                                                             *
+******************************************************************************/
+
+extern int GetOnOff(char *args);
+extern BOOL FindModule(TMODULE *pMod, char *pName, int nNameLen);
+extern UINT StackSample(DWORD dwEIP, DWORD dwESP, DWORD dwEBP, DWORD dwLow, DWORD dwHigh, DWORD *pList, UINT nMax);
+extern DWORD SpinlockTry(DWORD *pSpinlock);
+extern void  SpinlockReset(DWORD *pSpinlock);
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   static WORD CallNode(TCALLTREE *pTree, WORD wParent, DWORD dwEip)         *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the node of a call tree with the given parent and address,
+*   adding it if it does not exist yet.
+*
+*   Where:
+*       pTree is the call tree
+*       wParent is the index of the parent node
+*       dwEip is the address of the node
+*
+*   Returns:
+*       Index of the node
+*       0 if the tree is full
+*
+******************************************************************************/
+static WORD CallNode(TCALLTREE *pTree, WORD wParent, DWORD dwEip)
+{
+    TCALLNODE *pNode;
+    UINT hash;
+    WORD w;
+
+    hash = (dwEip ^ (dwEip >> 9) ^ (wParent * 31)) & (CALL_HASH - 1);
+
+    for(w=pTree->Hash[hash]; w; w=pTree->Node[w].wNext )
+    {
+        if( pTree->Node[w].dwEip==dwEip && pTree->Node[w].wParent==wParent )
+            return( w );
+    }
+
+    if( pTree->nNodes==MAX_CALL_NODES - 1 )
+        return( 0 );
+
+    // Fill in the node before linking it since the tree may be read meanwhile
+    w = pTree->nNodes + 1;
+    pNode = &pTree->Node[w];
+
+    pNode->dwEip   = dwEip;
+    pNode->wParent = wParent;
+    pNode->wNext   = pTree->Hash[hash];
+    pNode->dwHits  = 0;
+
+    pTree->Hash[hash] = w;
+    pTree->nNodes++;
+
+    return( w );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void CallSample(PTREGS pRegs)                                      *
+*                                                                             *
+*******************************************************************************
+*
+*   Adds the call stack of the interrupted code to the call tree. Only the
+*   frames of the kernel stack that the interrupt was taken on are walked.
+*   If another CPU is adding its sample at the same time, this one is
+*   dropped rather than waiting for it.
+*
+*   Where:
+*       pRegs is the interrupted register frame
+*
+******************************************************************************/
+static void CallSample(PTREGS pRegs)
+{
+    DWORD List[MAX_CALL_DEPTH];         // Sampled address followed by the return addresses
+    DWORD dwStack;                      // Start of the interrupted kernel stack
+    DWORD dwSize;                       // Size of a kernel stack
+    UINT n = 1;
+    WORD w = 0;
+
+    List[0] = pRegs->eip;
+
+    // The interrupt frame itself is on the interrupted kernel stack
+    if( !(pRegs->cs & 3) && !(pRegs->eflags & VM_MASK) )
+    {
+        // Kernel stacks are aligned to their size, which is 4K or 8K
+        dwSize = ice_thread_size();
+        dwStack = (DWORD) pRegs & ~(dwSize - 1);
+
+        n += StackSample(pRegs->eip, pRegs->esp, pRegs->ebp, (DWORD) pRegs, dwStack + dwSize, &List[1], MAX_CALL_DEPTH - 1);
+    }
+
+    if( SpinlockTry(&dwCallLock)==0 )
+    {
+        // The path goes from the outermost caller down to the sampled address
+        while( n-- )
+        {
+            if( !(w = CallNode(&Calls, w, List[n])) )
+                break;
+        }
+
+        if( w )
+        {
+            Calls.Node[w].dwHits++;
+            dwCallSamples++;
+        }
+        else
+            dwCallDropped++;
+
+        SpinlockReset(&dwCallLock);
+    }
+    else
+        dwCallDropped++;
+}
+
+/******************************************************************************
+*                                                                             *
+*   void ProfileSample(PTREGS pRegs)                                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Called on every timer interrupt during the debugee run. If profiling is
+*   on, records the interrupted address into the sample ring of this CPU.
+*   Each CPU only writes its own ring, so no locking is needed. If call
+*   stack sampling is on, adds the call stack to the call tree as well.
+*
+*   Where:
+*       pRegs is the interrupted register frame
+*
+******************************************************************************/
+void ProfileSample(PTREGS pRegs)
+{
+    TPROFCPU *pCpu;                     // Sample ring of this CPU
+    UINT cpu;
+
+    if( fProfile )
+    {
+        cpu = ice_smp_processor_id();
+
+        if( cpu < MAX_CPU )
+        {
+            pCpu = &Prof[cpu];
+
+            pCpu->Eip[pCpu->nHead] = pRegs->eip;
+            pCpu->nHead = (pCpu->nHead + 1) % MAX_PROFILE_SAMPLES;
+            pCpu->dwSamples++;
+        }
+    }
+
+    if( fCalls )
+        CallSample(pRegs);
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void FoldSample(DWORD dwEip)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Adds a sample to the symbol that contains it. A symbol that already has a
+*   sample at a larger offset also contains every address in between, so the
+*   symbol lookup is done only for samples that fall outside of known spans.
+*
+*   Where:
+*       dwEip is the sampled address
+*
+******************************************************************************/
+static void FoldSample(DWORD dwEip)
+{
+    DWORD dwAddr;                       // Address of the containing symbol
+    UINT range, i;
+
+    if( dwEip < ice_page_offset() )
+        dwAddr = PROF_USER, range = 0;
+    else
+    {
+        for(i=0; i<nSyms; i++)
+        {
+            if( Sym[i].dwAddr > PROF_UNKNOWN && dwEip - Sym[i].dwAddr <= Sym[i].dwSpan )
+            {
+                Sym[i].nHits++;
+                return;
+            }
+        }
+
+        if( SymAddress2Name(dwEip, &range) )
+            dwAddr = dwEip - range;
+        else
+            dwAddr = PROF_UNKNOWN, range = 0;
+    }
+
+    for(i=0; i<nSyms; i++)
+    {
+        if( Sym[i].dwAddr==dwAddr )
+            break;
+    }
+
+    // When the table is full, the rest is accounted as unknown
+    if( i==nSyms )
+    {
+        if( nSyms==MAX_PROFILE_SYMS )
+        {
+            for(i=0; i<nSyms && Sym[i].dwAddr!=PROF_UNKNOWN; i++ );
+
+            if( i==nSyms )
+                i = nSyms - 1;
+        }
+        else
+        {
+            Sym[i].dwAddr = dwAddr;
+            Sym[i].dwSpan = 0;
+            Sym[i].nHits  = 0;
+            nSyms++;
+        }
+    }
+
+    if( Sym[i].dwAddr==dwAddr && range > Sym[i].dwSpan )
+        Sym[i].dwSpan = range;
+
+    Sym[i].nHits++;
+}
+
+/******************************************************************************
+*                                                                             *
+*   static char *SymbolTableName(DWORD dwAddr)                                *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the name of the loaded symbol table that has a global function
+*   at the given address.
+*
+*   Where:
+*       dwAddr is the address of the function
+*
+*   Returns:
+*       Name of the symbol table
+*       NULL if no symbol table covers that address
+*
+******************************************************************************/
+static char *SymbolTableName(DWORD dwAddr)
+{
+    TSYMTAB *pSymTab;                   // Traverse list of symbol tables
+    TSYMGLOBAL *pGlobals;
+    DWORD dwStart;                      // Relocated symbol start address
+    int i;
+
+    for(pSymTab=deb.pSymTab; pSymTab; pSymTab=(TSYMTAB *)pSymTab->next )
+    {
+        pGlobals = (TSYMGLOBAL *)SymTabFindSection(pSymTab, HTYPE_GLOBALS);
+
+        for(i=0; pGlobals && i<pGlobals->nGlobals; i++ )
+        {
+            dwStart = pGlobals->list[i].dwStartAddress + SymTabReloc(pSymTab, pGlobals->list[i].bSegment);
+
+            if( dwAddr==dwStart )
+                return( pSymTab->sTableName );
+        }
+    }
+
+    return( NULL );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void FoldModule(char *pName, UINT nHits)                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Adds samples to the module with the given name.
+*
+*   Where:
+*       pName is the module name
+*       nHits is the number of samples to add
+*
+******************************************************************************/
+static void FoldModule(char *pName, UINT nHits)
+{
+    UINT i;
+
+    for(i=0; i<nMods; i++)
+    {
+        if( !strcmp(Mod[i].pName, pName) )
+            break;
+    }
+
+    if( i==nMods )
+    {
+        if( nMods==MAX_PROFILE_MODULES )
+            return;
+
+        Mod[i].pName = pName;
+        Mod[i].nHits = 0;
+        nMods++;
+    }
+
+    Mod[i].nHits += nHits;
+}
+
+/******************************************************************************
+*                                                                             *
+*   static char *ModuleName(DWORD dwAddr)                                     *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the name of the module that contains the symbol at the given
+*   address. Kernel exports are named "module!symbol"; functions from the
+*   loaded symbol tables are attributed to their table.
+*
+*   Where:
+*       dwAddr is the address of the symbol (or one of the PROF_* values)
+*
+*   Returns:
+*       Name of the module
+*
+******************************************************************************/
+static char *ModuleName(DWORD dwAddr)
+{
+    TMODULE Module;                     // Kernel module that exports the symbol
+    char *pName, *pDelim;
+
+    if( dwAddr==PROF_USER )
+        pName = "<user>";
+    else
+    if( dwAddr==PROF_UNKNOWN )
+        pName = "<unknown>";
+    else
+    if( !(pName = SymbolTableName(dwAddr)) )
+    {
+        // The kernel symbol lookup returns its name in a static buffer, so
+        // we can not keep a pointer into it; use the kernel's module name
+        if( (pName = SymAddress2Name(dwAddr, NULL)) && (pDelim = strchr(pName, '!')) )
+        {
+            if( FindModule(&Module, pName, pDelim - pName) )
+                pName = (char *) Module.name;
+            else
+                pName = "<module>";
+        }
+        else
+            pName = "kernel";
+    }
+
+    return( pName );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void SortSymbols(void)                                             *
+*                                                                             *
+*******************************************************************************
+*
+*   Sorts the folded symbols by the number of samples, most frequent first.
+*
+******************************************************************************/
+static void SortSymbols(void)
+{
+    TPROFSYM Temp;
+    UINT i, j;
+
+    for(i=1; i<nSyms; i++)
+    {
+        Temp = Sym[i];
+
+        for(j=i; j>0 && Sym[j-1].nHits < Temp.nHits; j--)
+            Sym[j] = Sym[j-1];
+
+        Sym[j] = Temp;
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void SortModules(void)                                             *
+*                                                                             *
+*******************************************************************************
+*
+*   Sorts the folded modules by the number of samples, most frequent first.
+*
+******************************************************************************/
+static void SortModules(void)
+{
+    TPROFMOD Temp;
+    UINT i, j;
+
+    for(i=1; i<nMods; i++)
+    {
+        Temp = Mod[i];
+
+        for(j=i; j>0 && Mod[j-1].nHits < Temp.nHits; j--)
+            Mod[j] = Mod[j-1];
+
+        Mod[j] = Temp;
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void ProfileList(UINT cpuFirst, UINT cpuLast)                      *
+*                                                                             *
+*******************************************************************************
+*
+*   Folds the samples of the given CPUs and lists the flat profile by
+*   symbols, followed by the breakdown by modules.
+*
+*   Where:
+*       cpuFirst is the first CPU whose samples to use
+*       cpuLast is the last CPU whose samples to use
+*
+******************************************************************************/
+static void ProfileList(UINT cpuFirst, UINT cpuLast)
+{
+    TPROFCPU *pCpu;                     // Sample ring of a CPU
+    UINT cpu, nCpus, i, n;
+    DWORD dwTotal, dwTaken;             // Number of samples listed and taken
+    DWORD dwPerMil;                     // Share of samples in 0.1%
+    char *pName;
+    int nLine = 1;
+
+    nSyms = nMods = 0;
+    dwTotal = dwTaken = 0;
+    nCpus = 0;
+
+    for(cpu=cpuFirst; cpu<=cpuLast; cpu++)
+    {
+        pCpu = &Prof[cpu];
+
+        // Until the ring wraps, the samples are stored from the start of it
+        n = pCpu->dwSamples < MAX_PROFILE_SAMPLES? pCpu->dwSamples : MAX_PROFILE_SAMPLES;
+
+        for(i=0; i<n; i++)
+            FoldSample(pCpu->Eip[i]);
+
+        if( n )
+            nCpus++;
+
+        dwTotal += n;
+        dwTaken += pCpu->dwSamples;
+    }
+
+    if( dwTotal==0 )
+    {
+        dprinth(1, "No profile samples, profiling is %s", fProfile? "on":"off");
+        return;
+    }
+
+    SortSymbols();
+
+    if( !dprinth(nLine++, "Profile of %d samples (%d taken) on %d CPU(s), profiling is %s",
+            dwTotal, dwTaken, nCpus, fProfile? "on":"off") )
+        return;
+
+    if( !dprinth(nLine++, "%c%c  Samples      %%  Symbol", DP_SETCOLINDEX, COL_BOLD) )
+        return;
+
+    for(i=0; i<nSyms; i++)
+    {
+        dwPerMil = Sym[i].nHits * 1000 / dwTotal;
+
+        if( Sym[i].dwAddr==PROF_USER )
+            pName = "<user mode>";
+        else
+        if( Sym[i].dwAddr==PROF_UNKNOWN || !(pName = SymAddress2Name(Sym[i].dwAddr, NULL)) )
+            pName = "<unknown>";
+
+        if( !dprinth(nLine++, "  %7d  %3d.%d  %s", Sym[i].nHits, dwPerMil / 10, dwPerMil % 10, pName) )
+            return;
+
+        FoldModule(ModuleName(Sym[i].dwAddr), Sym[i].nHits);
+    }
+
+    SortModules();
+
+    if( !dprinth(nLine++, "%c%c  Samples      %%  Module", DP_SETCOLINDEX, COL_BOLD) )
+        return;
+
+    for(i=0; i<nMods; i++)
+    {
+        dwPerMil = Mod[i].nHits * 1000 / dwTotal;
+
+        if( !dprinth(nLine++, "  %7d  %3d.%d  %s", Mod[i].nHits, dwPerMil / 10, dwPerMil % 10, Mod[i].pName) )
+            return;
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   static DWORD FunctionStart(DWORD dwEip)                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the address of the symbol that contains the given address.
+*
+*   Where:
+*       dwEip is the code address
+*
+*   Returns:
+*       Address of the containing symbol
+*       PROF_USER for the user mode addresses
+*       dwEip itself if there is no symbol
+*
+******************************************************************************/
+static DWORD FunctionStart(DWORD dwEip)
+{
+    UINT range;
+
+    if( dwEip < ice_page_offset() )
+        return( PROF_USER );
+
+    if( SymAddress2Name(dwEip, &range) )
+        return( dwEip - range );
+
+    return( dwEip );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static char *FunctionName(DWORD dwAddr)                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the name of the symbol at the address returned by FunctionStart().
+*   Addresses without a symbol are printed in hex.
+*
+*   Where:
+*       dwAddr is the address of the symbol
+*
+*   Returns:
+*       Name of the symbol, valid until the next call
+*
+******************************************************************************/
+static char *FunctionName(DWORD dwAddr)
+{
+    static char sAddr[12];
+    char *pName;
+
+    if( dwAddr==PROF_USER )
+        return( "<user mode>" );
+
+    if( (pName = SymAddress2Name(dwAddr, NULL)) )
+        return( pName );
+
+    sprintf(sAddr, "%08X", dwAddr);
+
+    return( sAddr );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void BuildInverted(void)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Builds the inverted call tree: every sampled call stack is added starting
+*   with the sampled function, followed by its callers. Addresses are folded
+*   into their functions, and each node counts all samples that passed
+*   through it. Return addresses are looked up one byte back so that a call
+*   at the very end of a function is attributed to it.
+*
+******************************************************************************/
+static void BuildInverted(void)
+{
+    TCALLNODE *pNode;                   // Node of a sampled call stack
+    DWORD dwAddr;                       // Function of a node
+    UINT w;
+    WORD inv;                           // Current node of the inverted tree
+
+    memset(Inverted.Hash, 0, sizeof(Inverted.Hash));
+    memset(fListed, 0, sizeof(fListed));
+    Inverted.nNodes = 0;
+
+    for(w=1; w<=Calls.nNodes; w++)
+    {
+        if( Calls.Node[w].dwHits )
+        {
+            inv = 0;
+
+            for(pNode=&Calls.Node[w]; pNode!=&Calls.Node[0]; pNode=&Calls.Node[pNode->wParent] )
+            {
+                if( inv==0 )
+                    dwAddr = FunctionStart(pNode->dwEip);
+                else
+                    dwAddr = FunctionStart(pNode->dwEip - 1);
+
+                if( !(inv = CallNode(&Inverted, inv, dwAddr)) )
+                    break;
+
+                Inverted.Node[inv].dwHits += Calls.Node[w].dwHits;
+            }
+        }
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void CallList(void)                                                *
+*                                                                             *
+*******************************************************************************
+*
+*   Lists the inverted call tree. Functions are listed by the number of
+*   samples, each followed by its callers (indented), most frequent first.
+*   Nodes with less than 1% of the samples are not listed.
+*
+******************************************************************************/
+static void CallList(void)
+{
+    static char sIndent[MAX_CALL_DEPTH * 2 + 1];
+    TCALLNODE *pNode;
+    DWORD dwPerMil;                     // Share of samples in 0.1%
+    UINT w, child, depth = 0;
+    int nLine = 1;
+
+    if( dwCallSamples==0 )
+    {
+        dprinth(1, "No call stack samples, call stack sampling is %s", fCalls? "on":"off");
+        return;
+    }
+
+    BuildInverted();
+
+    if( !dprinth(nLine++, "Call tree of %d samples (%d dropped, %d of %d nodes), call stack sampling is %s",
+            dwCallSamples, dwCallDropped, Calls.nNodes, MAX_CALL_NODES - 1, fCalls? "on":"off") )
+        return;
+
+    if( !dprinth(nLine++, "%c%c  Samples      %%  Function / callers", DP_SETCOLINDEX, COL_BOLD) )
+        return;
+
+    // Walk the tree depth first without recursion, marking the listed nodes
+    w = 0;
+
+    while( TRUE )
+    {
+        // Find the most frequent child that was not listed yet
+        child = 0;
+
+        for(pNode=&Inverted.Node[1]; pNode<=&Inverted.Node[Inverted.nNodes]; pNode++ )
+        {
+            if( pNode->wParent==w && !fListed[pNode - Inverted.Node] )
+            {
+                if( child==0 || pNode->dwHits > Inverted.Node[child].dwHits )
+                    child = pNode - Inverted.Node;
+            }
+        }
+
+        if( child && Inverted.Node[child].dwHits * 1000 / dwCallSamples >= CALL_CUTOFF )
+        {
+            dwPerMil = Inverted.Node[child].dwHits * 1000 / dwCallSamples;
+
+            memset(sIndent, ' ', depth * 2);
+            sIndent[depth * 2] = 0;
+
+            if( !dprinth(nLine++, "  %7d  %3d.%d  %s%s", Inverted.Node[child].dwHits,
+                    dwPerMil / 10, dwPerMil % 10, sIndent, FunctionName(Inverted.Node[child].dwEip)) )
+                return;
+
+            fListed[child] = TRUE;
+            w = child;
+            depth++;
+        }
+        else
+        {
+            if( w==0 )
+                break;
+
+            w = Inverted.Node[w].wParent;
+            depth--;
+        }
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   int ProfileReadFolded(void *pUser)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Copies the sampled call stacks into the user buffer as folded stacks:
+*   one line per distinct stack, with the functions from the outermost
+*   caller down to the sampled one separated by semicolons, followed by
+*   the number of samples. Copying starts at the given node and stops when
+*   the buffer is full, so the caller can continue from where it stopped.
+*
+*   The tree is read while it may still be sampled into; nodes are only
+*   ever added, so at worst a count is slightly behind.
+*
+*   Where:
+*       pUser is the address of the TPROFPACKET in the user space
+*
+*   Returns:
+*       0 on success
+*       -EFAULT on faulty memory access
+*
+******************************************************************************/
+int ProfileReadFolded(void *pUser)
+{
+    TPROFPACKET Packet;                 // Packet local copy
+    TCALLNODE *pNode;
+    DWORD List[MAX_CALL_DEPTH];         // Functions of a stack, sampled one first
+    DWORD w;
+    UINT n, len, used = 0;
+
+    if( ice_copy_from_user(&Packet, pUser, sizeof(TPROFPACKET))==0 )
+    {
+        for(w=MAX(Packet.dwNode, 1); w<=Calls.nNodes; w++)
+        {
+            if( Calls.Node[w].dwHits==0 )
+                continue;
+
+            // Return addresses are looked up one byte back, as in BuildInverted()
+            List[0] = FunctionStart(Calls.Node[w].dwEip);
+
+            for(n=1, pNode=&Calls.Node[Calls.Node[w].wParent]; n<MAX_CALL_DEPTH && pNode!=&Calls.Node[0]; pNode=&Calls.Node[pNode->wParent] )
+                List[n++] = FunctionStart(pNode->dwEip - 1);
+
+            for(len=0; n--; )
+                len += sprintf(sFolded + len, "%s%s", FunctionName(List[n]), n? ";":"");
+
+            len += sprintf(sFolded + len, " %d\n", Calls.Node[w].dwHits);
+
+            if( used + len > Packet.dwSize )
+                break;
+
+            if( ice_copy_to_user(Packet.pBuf + used, sFolded, len) )
+                return( -EFAULT );
+
+            used += len;
+        }
+
+        Packet.dwNode    = w;
+        Packet.dwNodes   = Calls.nNodes + 1;
+        Packet.dwSamples = dwCallSamples;
+        Packet.dwSize    = used;
+
+        if( ice_copy_to_user(pUser, &Packet, sizeof(TPROFPACKET))==0 )
+            return( 0 );
+    }
+
+    return( -EFAULT );
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL cmdProfile(char *args, int subClass)                                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Controls the statistical profiler and lists its samples:
+*
+*       PROFILE [ON | OFF | CLEAR | cpu]
+*       PROFILE CALLS [ON | OFF]
+*
+*   ON and OFF start and stop sampling, CLEAR discards the samples taken so
+*   far. Without arguments, the samples of all CPUs are listed; a CPU number
+*   lists only the samples taken on that CPU. PROFILE CALLS ON and OFF start
+*   and stop sampling the call stacks; without arguments, the inverted call
+*   tree is listed.
+*
+******************************************************************************/
+BOOL cmdProfile(char *args, int subClass)
+{
+    DWORD cpu;
+
+    if( !strnicmp(args, "calls", 5) && (args[5]==' ' || args[5]==0) )
+    {
+        switch( GetOnOff(args + 5) )
+        {
+            case 1:         // On
+                fCalls = TRUE;
+                break;
+
+            case 2:         // Off
+                fCalls = FALSE;
+                break;
+
+            case 3:         // List the call tree
+                CallList();
+                break;
+        }
+    }
+    else
+    if( !stricmp(args, "clear") )
+    {
+        memset(Prof, 0, sizeof(Prof));
+
+        memset(Calls.Hash, 0, sizeof(Calls.Hash));
+        Calls.nNodes = 0;
+        dwCallSamples = dwCallDropped = 0;
+    }
+    else
+    if( isdigit(*args) )
+    {
+        if( Expression(&cpu, args, &args) && !*args && cpu<MAX_CPU )
+            ProfileList(cpu, cpu);
+        else
+            PostError(ERR_SYNTAX, 0);
+    }
+    else
+    {
+        switch( GetOnOff(args) )
+        {
+            case 1:         // On
+                fProfile = TRUE;
+                break;
+
+            case 2:         // Off
+                fProfile = FALSE;
+                break;
+
+            case 3:         // List the samples
+                ProfileList(0, MAX_CPU - 1);
+                break;
+        }
+    }
+
+    return( TRUE );
+}
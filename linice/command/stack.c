@@ -43,6 +43,7 @@
 #include "module-header.h"              // Versatile module header file
 
 #include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
 #include "ice.h"                        // Include main debugger structures
 
 /******************************************************************************
@@ -65,6 +66,8 @@ static char buf[MAX_STRING];            // Buffer to store lines to be written o
 *                                                                             *
 ******************************************************************************/
 
+extern UINT UnwindFrame(PTUNWIND pFrame, BOOL fScan);
+
 /******************************************************************************
 *                                                                             *
 *   void StackDraw(BOOL fForce)                                               *
@@ -81,13 +84,15 @@ void StackDraw(BOOL fForce)
 
 /******************************************************************************
 *                                                                             *
-*   BOOL FillStackList(DWORD dwEBP, DWORD dwEIP, BOOL fLocals)                *
+*   BOOL FillStackList(DWORD dwESP, DWORD dwEBP, DWORD dwEIP, BOOL fLocals)   *
 *                                                                             *
 *******************************************************************************
 *
 *   Rebuilds the stack list based on the given stack frame and code context.
+*   Frames that were found by scanning the stack are marked with '?'.
 *
 *   Where:
+*       dwESP is the stack pointer of the code context, 0 if not known
 *       dwEBP is the pointer to the stack frame
 *       dwEIP is the code context
 *       fLocals if TRUE, will list local symbols as well (NOT IMPLEMENTED YET)
@@ -95,67 +100,95 @@ void StackDraw(BOOL fForce)
 *       TRUE Stack list has been rebuilt
 *
 ******************************************************************************/
-BOOL FillStackList(DWORD dwEBP, DWORD dwEIP, BOOL fLocals)
+BOOL FillStackList(DWORD dwESP, DWORD dwEBP, DWORD dwEIP, BOOL fLocals)
 {
     TLISTITEM *pItem;                   // List item that we are adding
-    TADDRDESC Addr;                     // Address descriptor to use when fetching values
+    TUNWIND Frame;                      // Frame that we are unwinding
     UINT level = 0;                     // Stack frame level count
-    int range;                          // Symbol offset range variable
+    UINT method;                        // Method that unwound a frame
+    UINT range;                         // Symbol offset range variable
     char *pBuf, *pName;                 // Temp pointer to the write out buffer and the name
 
-    Addr.sel = deb.r->ss;
-    Addr.offset = dwEBP;
-
-    // Start at the current frame and dump all frames walking back (up the stack).
-    //   | return address |  EBP + 4
-    //   | saved EBP      |  EBP
+    Frame.eip     = dwEIP;
+    Frame.esp     = dwESP;
+    Frame.ebp     = dwEBP;
+    Frame.dwLow   = 0;
+    Frame.dwHigh  = 0;
+    Frame.fCaller = FALSE;
 
-    // We walk the number of levels until we hit an invalid pointer
+    // Start at the current frame and dump all frames walking back (up the stack)
+    // until we can not find the return address of a frame
     while( level++ < MAX_STACK_LEVELS )
     {
-        // Get the original value of the EBP on the stack and the return address
-        if( !VerifyRange(&Addr, 2 * sizeof(DWORD)) )
+        if( (method = UnwindFrame(&Frame, TRUE))==UNWIND_END )
             break;
 
         // Print the current stack frame address of the RET pointer and where it points to
         pBuf = buf;                     // Reset the write pointer
 
-        // Get the previous EBP from the current stack frame
-        dwEBP = AddrGetDword(&Addr);
-
-        // Get the return value from the current stack frame
-        Addr.offset += 4;
-        dwEIP = AddrGetDword(&Addr);
-        Addr.offset -= 4;
-
-        // If the EIP is not valid, stop the traversal because the stack frame
-        // if probably not valid any more
-        if( GlobalReadBYTE((BYTE *)&range, dwEIP)==FALSE )
-            break;
-
         // Print the TOS context: return address and the function it points to
-        pBuf += sprintf(pBuf, "%08X %08X", Addr.offset, dwEIP);
+        pBuf += sprintf(pBuf, "%08X %08X%c", Frame.dwFrame, Frame.eip, method==UNWIND_BY_SCAN? '?':' ');
 
         // Find the closest symbol to the EIP that we found on the stack
-        pName = SymAddress2Name(dwEIP, &range);
+        pName = SymAddress2Name(Frame.eip, &range);
 
         // Print it if we found any
         if( pName )
-            pBuf += sprintf(pBuf, "   %s+%X", pName, range);
+            pBuf += sprintf(pBuf, "  %s+%X", pName, range);
 
         // Finally, add the string to the stack list
         if((pItem = ListAdd(&deb.Stack))==NULL)
             break;
 
         sprintf(pItem->String, "%s", buf);
-
-        // Set the frame pointer to the next frame in the chain
-        Addr.offset = dwEBP;
     }
 
     return( TRUE );
 }
 
+/******************************************************************************
+*                                                                             *
+*   UINT StackSample(DWORD dwEIP, DWORD dwESP, DWORD dwEBP, DWORD dwLow,      *
+*                    DWORD dwHigh, DWORD *pList, UINT nMax)                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Walks the stack frames the same way as FillStackList(), but only stores
+*   the return addresses. It is called from the timer interrupt, so it does
+*   not use the guarded memory access; instead, every frame has to be within
+*   the given stack range and above the previous one, and every return
+*   address has to be in the kernel. The stack is not scanned.
+*
+*   Where:
+*       dwEIP is the interrupted code address
+*       dwESP is the interrupted stack pointer
+*       dwEBP is the interrupted frame pointer
+*       dwLow is the lowest valid stack address
+*       dwHigh is the end of the valid stack (exclusive)
+*       pList is the array to receive the return addresses
+*       nMax is the maximum number of addresses to store
+*   Returns:
+*       Number of return addresses stored
+*
+******************************************************************************/
+UINT StackSample(DWORD dwEIP, DWORD dwESP, DWORD dwEBP, DWORD dwLow, DWORD dwHigh, DWORD *pList, UINT nMax)
+{
+    TUNWIND Frame;                      // Frame that we are unwinding
+    UINT level = 0;                     // Stack frame level count
+
+    Frame.eip     = dwEIP;
+    Frame.esp     = dwESP;
+    Frame.ebp     = dwEBP;
+    Frame.dwLow   = dwLow;
+    Frame.dwHigh  = dwHigh;
+    Frame.fCaller = FALSE;
+
+    while( level < nMax && UnwindFrame(&Frame, FALSE)!=UNWIND_END )
+        pList[level++] = Frame.eip;
+
+    return( level );
+}
+
 /******************************************************************************
 *                                                                             *
 *   BOOL cmdStack(char *args, int subClass)                                   *
@@ -168,9 +201,10 @@ BOOL FillStackList(DWORD dwEBP, DWORD dwEIP, BOOL fLocals)
 ******************************************************************************/
 BOOL cmdStack(char *args, int subClass)
 {
-    DWORD dwEBP, dwEIP;                 // Values that we read from a stack frame
+    DWORD dwESP, dwEBP, dwEIP;          // Values that we read from a stack frame
     BOOL fLocals = FALSE;               // By default, dont display locals
 
+    dwESP = deb.r->esp;                 // Default ESP is the current one
     dwEBP = deb.r->ebp;                 // Default EBP is the current one
     dwEIP = deb.r->eip;                 // And the EIP the same
 
@@ -193,8 +227,8 @@ BOOL cmdStack(char *args, int subClass)
             {
                 // We have a new starting EBP frame pointer, but since it has changed,
                 // there is no way to know what EIP context we are in to be able to
-                // find the information about locals.
-                ;
+                // find the information about locals. The ESP is not known either.
+                dwESP = 0;
             }
             else
             {
@@ -208,7 +242,7 @@ BOOL cmdStack(char *args, int subClass)
 
     ListDelAll(&deb.Stack);
 
-    FillStackList(dwEBP, dwEIP, fLocals);
+    FillStackList(dwESP, dwEBP, dwEIP, fLocals);
 
     StackDraw(TRUE);
 
@@ -173,6 +173,7 @@ extern void ObjectStart(void);
 extern void HookPrintk(void);
 extern void UnhookPrintk(void);
 extern void EdDumpHistory(void);
+extern BOOL smpSwitchCpu(UINT cpu);
 
 
 /******************************************************************************
@@ -376,6 +377,56 @@ BOOL cmdIdt(char *args, int subClass)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   static char *CpuLatency(char *pBuf, DWORD dwCycles)                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Formats a TSC cycle count in microseconds, if the CPU speed is known.
+*
+******************************************************************************/
+static char *CpuLatency(char *pBuf, DWORD dwCycles)
+{
+    DWORD dwMhz = ice_get_cpu_khz() / 1000;
+
+    if( dwMhz )
+        sprintf(pBuf, "%u us", dwCycles / dwMhz);
+    else
+        sprintf(pBuf, "%u cycles", dwCycles);
+
+    return( pBuf );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static char *CpuStopInfo(char *pBuf, UINT cpu)                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Formats how a given CPU was stopped and how long it took.
+*
+******************************************************************************/
+static char *CpuStopInfo(char *pBuf, UINT cpu)
+{
+    static char *sStop[] = { "break", "IPI", "NMI" };
+    char sLatency[32];
+    PTCPU pCpu = &deb.Cpu[cpu];
+
+    if( !pCpu->fValid )
+        strcpy(pBuf, "did not stop");
+    else
+    if( pCpu->eStop==STOP_BREAK )
+        strcpy(pBuf, sStop[STOP_BREAK]);
+    else
+    if( pCpu->dwLatency==0 )
+        sprintf(pBuf, "%s, late", sStop[pCpu->eStop]);
+    else
+        sprintf(pBuf, "%s in %s", sStop[pCpu->eStop], CpuLatency(sLatency, pCpu->dwLatency));
+
+    return( pBuf );
+}
+
 /******************************************************************************
 *                                                                             *
 *   BOOL cmdCpu(char *args, int subClass)                                     *
@@ -387,6 +438,8 @@ BOOL cmdIdt(char *args, int subClass)
 *   Additional options:
 *       CPU s       - stores CPU registers into a virtual register slot
 *       CPU r       - restores CPU registers
+*       CPU *       - lists the state of all CPUs
+*       CPU cpu#    - switches the debugger context to the given CPU
 *
 *   TODO: Implement argument -i, display the IO APIC registers
 *
@@ -394,6 +447,10 @@ BOOL cmdIdt(char *args, int subClass)
 BOOL cmdCpu(char *args, int subClass)
 {
     static TREGS CPU;                   // CPU register store
+    TSysreg *pSys;                      // System registers of the current CPU
+    UINT cpu, nCpus;                    // CPU number and count
+    char sStop[32];                     // CPU stop info
+    char sFreeze[24];                   // Entry to freeze latency
     int nLine = 1;                      // Line counter
 
     // New options to Linice: Save and Restore CPU registers
@@ -419,28 +476,79 @@ BOOL cmdCpu(char *args, int subClass)
 
         return( TRUE );
     }
+    else
+    if( *args=='*' )
+    {
+        // List all CPUs and what they were doing when we stopped them
+        nCpus = ice_smp_num_cpus();
+        if( nCpus > MAX_CPU )
+            nCpus = MAX_CPU;
+
+        for(cpu=0; cpu<nCpus; cpu++)
+        {
+            if( deb.Cpu[cpu].fValid )
+            {
+                if( dprinth(nLine++, "%c%cCPU #%-2d  CS:EIP=%04X:%08X  SS:ESP=%04X:%08X  Task=%08X  (%s)",
+                    DP_SETCOLINDEX, cpu==deb.cpuCur? COL_BOLD:COL_NORMAL,
+                    cpu, deb.Cpu[cpu].pRegs->cs, deb.Cpu[cpu].pRegs->eip,
+                    deb.Cpu[cpu].pRegs->ss, deb.Cpu[cpu].pRegs->esp,
+                    (DWORD) deb.Cpu[cpu].pTask, CpuStopInfo(sStop, cpu))==FALSE )
+                    return( TRUE );
+            }
+            else
+            {
+                if( dprinth(nLine++, "CPU #%-2d  (%s)", cpu, CpuStopInfo(sStop, cpu))==FALSE )
+                    return( TRUE );
+            }
+        }
+
+        dprinth(nLine++, "Entry to freeze: %s", CpuLatency(sFreeze, deb.dwFreezeLatency));
+
+        return( TRUE );
+    }
+    else
+    if( *args )
+    {
+        // Switch the context to a given CPU
+        if( GetDecB(&cpu, &args) && !*args )
+        {
+            if( smpSwitchCpu(cpu)==FALSE )
+                dprinth(1, "CPU #%d did not report its state", cpu);
+        }
+        else
+            deb.errorCode = ERR_SYNTAX;
+
+        return( TRUE );
+    }
+
+    // Display the system registers of the CPU we are looking at
+    if( deb.cpuCur==deb.cpu )
+        pSys = &deb.sysReg;
+    else
+        pSys = &deb.Cpu[deb.cpuCur].sysReg;
 
-    if(dprinth(nLine++, "CPU #%d", deb.cpu)
+    if(dprinth(nLine++, "CPU #%d   Stopped by %s   Entry to freeze: %s", deb.cpuCur,
+            CpuStopInfo(sStop, deb.cpuCur), CpuLatency(sFreeze, deb.dwFreezeLatency))
     && dprinth(nLine++, "CS:EIP=%04X:%08X   SS:ESP=%04X:%08X", deb.r->cs, deb.r->eip, deb.r->ss, deb.r->esp)
     && dprinth(nLine++, "EAX=%08X   EBX=%08X   ECX=%08X   EDX=%08X", deb.r->eax, deb.r->ebx, deb.r->ecx, deb.r->edx)
     && dprinth(nLine++, "ESI=%08X   EDI=%08X   EBP=%08X   EFL=%08X", deb.r->esi, deb.r->edi, deb.r->ebp, deb.r->eflags)
     && dprinth(nLine++, "DS=%04X   ES=%04X   FS=%04X   GS=%04X", deb.r->ds, deb.r->es, deb.r->fs, deb.r->gs)
 
-    && MkBits(bits, deb.sysReg.cr0, bitsCR0)
-    && dprinth(nLine++, "CR0=%08X   %s", deb.sysReg.cr0, bits)
-    && dprinth(nLine++, "CR2=%08X", deb.sysReg.cr2)
-
-    && MkBits(bits, deb.sysReg.cr3, bitsCR3)
-    && dprinth(nLine++, "CR3=%08X   %s", deb.sysReg.cr3, bits)
-    && MkBits(bits, deb.sysReg.cr4, bitsCR4)
-    && dprinth(nLine++, "CR4=%08X   %s", deb.sysReg.cr4, bits)
-
-    && dprinth(nLine++, "DR0=%08X", deb.sysReg.dr[0])
-    && dprinth(nLine++, "DR1=%08X", deb.sysReg.dr[1])
-    && dprinth(nLine++, "DR2=%08X", deb.sysReg.dr[2])
-    && dprinth(nLine++, "DR3=%08X", deb.sysReg.dr[3])
-    && dprinth(nLine++, "DR6=%08X", deb.sysReg.dr6)
-    && dprinth(nLine++, "DR7=%08X", deb.sysReg.dr7)
+    && MkBits(bits, pSys->cr0, bitsCR0)
+    && dprinth(nLine++, "CR0=%08X   %s", pSys->cr0, bits)
+    && dprinth(nLine++, "CR2=%08X", pSys->cr2)
+
+    && MkBits(bits, pSys->cr3, bitsCR3)
+    && dprinth(nLine++, "CR3=%08X   %s", pSys->cr3, bits)
+    && MkBits(bits, pSys->cr4, bitsCR4)
+    && dprinth(nLine++, "CR4=%08X   %s", pSys->cr4, bits)
+
+    && dprinth(nLine++, "DR0=%08X", pSys->dr[0])
+    && dprinth(nLine++, "DR1=%08X", pSys->dr[1])
+    && dprinth(nLine++, "DR2=%08X", pSys->dr[2])
+    && dprinth(nLine++, "DR3=%08X", pSys->dr[3])
+    && dprinth(nLine++, "DR6=%08X", pSys->dr6)
+    && dprinth(nLine++, "DR7=%08X", pSys->dr7)
 
     && MkBits(bits, deb.r->eflags, bitsEFL)
     && dprinth(nLine++, "EFL=%08X   %s IOPL=%d", deb.r->eflags, bits, (deb.r->eflags >> IOPL_BIT0 & 3)) );
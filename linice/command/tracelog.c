@@ -0,0 +1,571 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     tracelog.c                                                    *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the execution history recorder and the SHOW
+        command that lists it.
+
+        Every trace step, and every debugger entry that continues without
+        popping up (breakpoints that evaluated to FALSE, step-over
+        breakpoints), appends a record to a fixed ring buffer. A trace step
+        record also keeps the memory operand of the instruction with its
+        value before and after the instruction executed.
+
+        On CPUs with last branch recording MSRs, the branches that the
+        CPU recorded before each debugger entry can be added to the ring
+        as well (SHOW LBR ON).
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include "module-header.h"              // Versatile module header file
+
+#include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
+#include "ice.h"                        // Include main debugger structures
+
+#include "disassembler.h"               // Include disassembler
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+#define MAX_TRACE_RECORDS   1024        // Number of records in the ring buffer
+
+// Record types
+
+#define REC_TRACE           1           // Instruction that was single stepped
+#define REC_STOP            2           // Debugger entry that continued execution
+#define REC_BRANCH          3           // Branch recorded by the CPU (LBR)
+
+// Memory operand flags
+
+#define MEM_EA              0x01        // Instruction has a memory operand
+#define MEM_OLD             0x02        // Value before the instruction is valid
+#define MEM_NEW             0x04        // Value after the instruction is valid
+
+typedef struct
+{
+    BYTE bType;                         // Record type
+    BYTE bMem;                          // Memory operand flags
+    WORD cs;                            // Code selector
+    DWORD eip;                          // Instruction address (branch source)
+    DWORD eax, ebx, ecx, edx;           // Selected registers before the instruction
+    DWORD esi, edi, ebp, esp;
+    DWORD dwEA;                         // Effective address (branch target)
+    DWORD dwOld;                        // Value at the EA before the instruction
+    DWORD dwNew;                        // Value at the EA after the instruction
+
+} TTRACEREC;
+
+static TTRACEREC Ring[MAX_TRACE_RECORDS];   // Ring buffer of the records
+static UINT nHead = 0;                  // Index of the next record to write
+static UINT nRecords = 0;               // Number of valid records in the ring
+static TTRACEREC *pPending = NULL;      // Trace record waiting for its memory operand value
+
+// Last branch recording MSRs
+
+#define MSR_DEBUGCTL        0x1D9       // Debug control MSR
+#define DEBUGCTL_LBR        0x01        // Last branch recording enable bit
+
+typedef struct
+{
+    BYTE family;                        // CPU family
+    BYTE modelFirst, modelLast;         // Range of CPU models
+    BYTE nEntries;                      // Number of entries in the LBR stack
+    WORD tos;                           // Top of stack MSR (0 if no stack)
+    WORD from;                          // First branch source MSR
+    WORD to;                            // First branch target MSR (0 if stored in the high dword of the source)
+
+} TLBRDESC;
+
+static const TLBRDESC LbrDesc[] = {
+    {  6,  1,  8,  1,     0, 0x1DB, 0x1DC },    // P6 family: one branch
+    {  6, 10, 11,  1,     0, 0x1DB, 0x1DC },
+    {  6,  9,  9,  8, 0x1C9, 0x040,     0 },    // Pentium M
+    {  6, 13, 14,  8, 0x1C9, 0x040,     0 },    // Pentium M, Core Solo and Duo
+    {  6, 15, 15,  4, 0x1C9, 0x040, 0x060 },    // Core 2
+    {  6, 23, 23,  4, 0x1C9, 0x040, 0x060 },
+    {  6, 29, 29,  4, 0x1C9, 0x040, 0x060 },
+    {  6, 28, 28,  8, 0x1C9, 0x040, 0x060 },    // Atom
+    {  6, 26, 26, 16, 0x1C9, 0x680, 0x6C0 },    // Nehalem
+    {  6, 30, 31, 16, 0x1C9, 0x680, 0x6C0 },
+    {  6, 46, 46, 16, 0x1C9, 0x680, 0x6C0 },
+    { 15,  0,  2,  4, 0x1DA, 0x1DB,     0 },    // Pentium 4
+    { 15,  3,  6, 16, 0x1DA, 0x680, 0x6C0 },
+    {  0, }
+};
+
+static const TLBRDESC *pLbr = NULL;     // LBR layout of this CPU, if it is being used
+
+static char buf[MAX_STRING];            // Disassembly buffer
+static char sLine[MAX_STRING];          // Line buffer to print
+
+/******************************************************************************
+*                                                                             *
+*   External Functions                                                        *
+*                                                                             *
+******************************************************************************/
+
+extern BOOL GlobalReadDword(DWORD *ppDword, DWORD dwAddress);
+extern DWORD fnEAddr(DWORD arg);
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   static TTRACEREC *NewRecord(BYTE bType)                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Allocates the next record in the ring buffer, overwriting the oldest one.
+*
+*   Where:
+*       bType is the record type
+*   Returns:
+*       Pointer to the record
+*
+******************************************************************************/
+static TTRACEREC *NewRecord(BYTE bType)
+{
+    TTRACEREC *pRec = &Ring[nHead];
+
+    nHead = (nHead + 1) % MAX_TRACE_RECORDS;
+
+    if( nRecords < MAX_TRACE_RECORDS )
+        nRecords++;
+
+    // The pending trace record may just have been overwritten
+    if( pRec==pPending )
+        pPending = NULL;
+
+    pRec->bType = bType;
+    pRec->bMem  = 0;
+
+    return( pRec );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL IsOwnCode(DWORD dwAddress)                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns TRUE if the address is within the debugger's own code.
+*
+******************************************************************************/
+static BOOL IsOwnCode(DWORD dwAddress)
+{
+    return( dwAddress>=(DWORD)ObjectStart && dwAddress<(DWORD)ObjectEnd );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void ReadLbr(void)                                                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Appends the branches recorded by the CPU, oldest first, to the ring.
+*   Branches into and out of the debugger itself are skipped.
+*
+******************************************************************************/
+static void ReadLbr(void)
+{
+    TTRACEREC *pRec;                    // New record
+    DWORD lo, hi;                       // MSR value
+    DWORD dwFrom, dwTo;                 // Branch addresses
+    UINT tos = 0;                       // Top of the LBR stack (the newest entry)
+    UINT i, n;
+
+    // Stop recording so our own branches do not push out the debugee's
+    RDMSR(MSR_DEBUGCTL, lo, hi);
+    WRMSR(MSR_DEBUGCTL, lo & ~DEBUGCTL_LBR, hi);
+
+    if( pLbr->tos )
+    {
+        RDMSR(pLbr->tos, lo, hi);
+        tos = lo % pLbr->nEntries;
+    }
+
+    for(n=1; n<=pLbr->nEntries; n++ )
+    {
+        i = (tos + n) % pLbr->nEntries;
+
+        RDMSR(pLbr->from + i, dwFrom, dwTo);
+
+        if( pLbr->to )
+            RDMSR(pLbr->to + i, dwTo, hi);
+
+        if( (dwFrom || dwTo) && !IsOwnCode(dwFrom) && !IsOwnCode(dwTo) )
+        {
+            pRec = NewRecord(REC_BRANCH);
+
+            pRec->cs   = 0;
+            pRec->eip  = dwFrom;
+            pRec->dwEA = dwTo;
+        }
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void TraceLogEnter(void)                                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Called on every debugger entry. Completes the record of the instruction
+*   that was just single stepped with the new value of its memory operand,
+*   and collects the last branch records.
+*
+******************************************************************************/
+void TraceLogEnter(void)
+{
+    if( pPending )
+    {
+        if( GlobalReadDword(&pPending->dwNew, pPending->dwEA) )
+            pPending->bMem |= MEM_NEW;
+
+        pPending = NULL;
+    }
+
+    if( pLbr )
+        ReadLbr();
+}
+
+/******************************************************************************
+*                                                                             *
+*   void TraceLogLeave(BOOL fRecord)                                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Called when the debugger continues the execution of the debugee. Records
+*   the state at the current cs:eip. If the next instruction is single
+*   stepped, also its memory operand is recorded.
+*
+*   Where:
+*       fRecord - add a record of the current state
+*
+******************************************************************************/
+void TraceLogLeave(BOOL fRecord)
+{
+    TTRACEREC *pRec;                    // New record
+    DWORD lo, hi;                       // MSR value
+
+    if( fRecord )
+    {
+        pRec = NewRecord(deb.fTrace? REC_TRACE : REC_STOP);
+
+        pRec->cs  = deb.r->cs;
+        pRec->eip = deb.r->eip;
+        pRec->eax = deb.r->eax;
+        pRec->ebx = deb.r->ebx;
+        pRec->ecx = deb.r->ecx;
+        pRec->edx = deb.r->edx;
+        pRec->esi = deb.r->esi;
+        pRec->edi = deb.r->edi;
+        pRec->ebp = deb.r->ebp;
+        pRec->esp = deb.r->esp;
+
+        // The value of the memory operand after the instruction is known only
+        // if we single step it
+        if( deb.fTrace && IsEffectiveAddress() )
+        {
+            pRec->dwEA  = fnEAddr(0);
+            pRec->bMem |= MEM_EA;
+
+            if( GlobalReadDword(&pRec->dwOld, pRec->dwEA) )
+                pRec->bMem |= MEM_OLD;
+
+            pPending = pRec;
+        }
+    }
+
+    // Resume the last branch recording
+    if( pLbr )
+    {
+        RDMSR(MSR_DEBUGCTL, lo, hi);
+        WRMSR(MSR_DEBUGCTL, lo | DEBUGCTL_LBR, hi);
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL CmdLbr(char *args)                                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Enables or disables the last branch recording: SHOW LBR [ON | OFF]
+*
+******************************************************************************/
+static BOOL CmdLbr(char *args)
+{
+    const TLBRDESC *pDesc;              // LBR layout descriptor
+    UINT cpu;                           // CPU family and model
+    DWORD lo, hi;                       // MSR value
+
+    switch( GetOnOff(args) )
+    {
+        case 1:         // On
+            cpu = ice_get_cpu_model();
+
+            for(pDesc=LbrDesc; pDesc->family; pDesc++ )
+            {
+                if( (cpu >> 8)==pDesc->family && (cpu & 0xFF)>=pDesc->modelFirst && (cpu & 0xFF)<=pDesc->modelLast )
+                    break;
+            }
+
+            if( pDesc->family )
+                pLbr = pDesc;
+            else
+                dprinth(1, "Last branch recording is not supported on this CPU");
+            break;
+
+        case 2:         // Off
+            if( pLbr )
+            {
+                RDMSR(MSR_DEBUGCTL, lo, hi);
+                WRMSR(MSR_DEBUGCTL, lo & ~DEBUGCTL_LBR, hi);
+
+                pLbr = NULL;
+            }
+            break;
+
+        case 3:         // Display the state
+            if( pLbr )
+                dprinth(1, "LBR is on (%d branches)", pLbr->nEntries);
+            else
+                dprinth(1, "LBR is off");
+            break;
+    }
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL PrintRecord(int nLine, int index, TTRACEREC *pRec, TTRACEREC *pPrev)
+*                                                                             *
+*******************************************************************************
+*
+*   Prints one record: its symbolized address, the instruction, registers that
+*   changed since the previous record and the memory operand.
+*
+*   Where:
+*       nLine is the line count for dprinth()
+*       index is the record number, counting back from the newest one
+*       pRec is the record to print
+*       pPrev is the previous record, or NULL
+*   Returns:
+*       Result of dprinth()
+*
+******************************************************************************/
+static BOOL PrintRecord(int nLine, int index, TTRACEREC *pRec, TTRACEREC *pPrev)
+{
+    static const char *sRegs[8] = { "EAX", "EBX", "ECX", "EDX", "ESI", "EDI", "EBP", "ESP" };
+    TDISASM Dis;                        // Disassembler interface structure
+    DWORD *pReg, *pPrevReg;             // Register arrays of the records
+    char *pName;                        // Symbol name
+    UINT range;                         // Offset from the symbol
+    int pos, i;
+
+    pos = sprintf(sLine, "%4d ", index);
+
+    if( pRec->bType==REC_BRANCH )
+    {
+        pos += sprintf(sLine+pos, "branch %08X", pRec->eip);
+
+        if( (pName = SymAddress2Name(pRec->eip, &range)) )
+            pos += sprintf(sLine+pos, " %.40s+%X", pName, range);
+
+        pos += sprintf(sLine+pos, " -> %08X", pRec->dwEA);
+
+        if( (pName = SymAddress2Name(pRec->dwEA, &range)) )
+            pos += sprintf(sLine+pos, " %.40s+%X", pName, range);
+
+        return( dprinth(nLine, "%s", sLine) );
+    }
+
+    pos += sprintf(sLine+pos, "%04X:%08X ", pRec->cs, pRec->eip);
+
+    if( (pName = SymAddress2Name(pRec->eip, &range)) )
+        pos += sprintf(sLine+pos, "%.40s+%X ", pName, range);
+
+    // Disassemble the instruction as it is now in memory
+    Dis.bState   = DIS_DATA32 | DIS_ADDRESS32;
+    Dis.wSel     = pRec->cs;
+    Dis.dwOffset = pRec->eip;
+    Dis.szDisasm = (BYTE *)buf;
+    Disassembler(&Dis);
+
+    pos += sprintf(sLine+pos, "%.64s%c", buf, pRec->bType==REC_STOP? '*' : ' ');
+
+    // Registers that the previous instruction changed
+    if( pPrev && pPrev->bType!=REC_BRANCH )
+    {
+        pReg     = &pRec->eax;
+        pPrevReg = &pPrev->eax;
+
+        for(i=0; i<8 && pos<MAX_STRING-32; i++ )
+        {
+            if( pReg[i]!=pPrevReg[i] )
+                pos += sprintf(sLine+pos, " %s=%08X", sRegs[i], pReg[i]);
+        }
+    }
+
+    // Memory operand and its value, showing the new value if it changed
+    if( (pRec->bMem & MEM_EA) && pos<MAX_STRING-32 )
+    {
+        pos += sprintf(sLine+pos, " [%08X]", pRec->dwEA);
+
+        if( pRec->bMem & MEM_OLD )
+            pos += sprintf(sLine+pos, "=%08X", pRec->dwOld);
+
+        if( (pRec->bMem & MEM_NEW) && (!(pRec->bMem & MEM_OLD) || pRec->dwNew!=pRec->dwOld) )
+            pos += sprintf(sLine+pos, "->%08X", pRec->dwNew);
+    }
+
+    return( dprinth(nLine, "%s", sLine) );
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL cmdShow(char *args, int subClass)                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Lists the execution history, oldest record first:
+*
+*       SHOW [B | start] [L length]
+*       SHOW LBR [ON | OFF]
+*
+*   Records are numbered counting back from the newest one (1). B starts with
+*   the oldest record; start selects the record to start with. Without
+*   arguments, the last page of records is listed. Records marked with '*'
+*   were not single stepped (a breakpoint evaluated to FALSE or a step over).
+*
+******************************************************************************/
+BOOL cmdShow(char *args, int subClass)
+{
+    TTRACEREC *pRec, *pPrev;            // Current and previous record
+    DWORD start, len;                   // Record to start with and number of records
+    UINT index;                         // Index of the record in the ring
+    int nLine = 1;
+
+    if( !strnicmp(args, "lbr", 3) )
+        return( CmdLbr(args+3) );
+
+    start = pWin->c.nLines > 2? pWin->c.nLines - 2 : 1;
+    len   = nRecords;
+
+    if( *args )
+    {
+        if( *args=='B' || *args=='b' )
+        {
+            start = nRecords;
+            args++;
+            while( *args==' ' ) args++;
+        }
+        else
+        if( *args!='L' && *args!='l' )
+        {
+            if( !Expression(&start, args, &args) || start==0 )
+            {
+                PostError(ERR_SYNTAX, 0);
+                return( TRUE );
+            }
+        }
+
+        if( *args=='L' || *args=='l' )
+        {
+            args++;
+            if( !Expression(&len, args, &args) )
+            {
+                PostError(ERR_SYNTAX, 0);
+                return( TRUE );
+            }
+        }
+
+        if( *args )
+        {
+            PostError(ERR_SYNTAX, 0);
+            return( TRUE );
+        }
+    }
+
+    if( nRecords==0 )
+    {
+        dprinth(1, "Execution history is empty");
+        return( TRUE );
+    }
+
+    if( start > nRecords )
+        start = nRecords;
+
+    if( len > start )
+        len = start;
+
+    pPrev = NULL;
+
+    while( len-- )
+    {
+        index = (nHead + MAX_TRACE_RECORDS - start) % MAX_TRACE_RECORDS;
+        pRec  = &Ring[index];
+
+        // Find the previous record to show which registers changed
+        if( pPrev==NULL && start < nRecords )
+            pPrev = &Ring[(index + MAX_TRACE_RECORDS - 1) % MAX_TRACE_RECORDS];
+
+        if( PrintRecord(nLine++, start, pRec, pPrev)==FALSE )
+            break;
+
+        pPrev = pRec;
+        start--;
+    }
+
+    return( TRUE );
+}
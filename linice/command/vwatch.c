@@ -0,0 +1,635 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     vwatch.c                                                      *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the virtual watchpoint engine. Memory
+        breakpoints (BPM) that did not get one of the four debug registers
+        are watched by protecting the page that they are in: the present
+        bit of its page table entry is cleared (or only the write bit,
+        for the write breakpoints), and the page fault handler is hooked.
+
+        A page fault on a watched page lifts the protection and single
+        steps the faulting instruction with interrupts disabled. The
+        single step trap puts the protection back. If the access hit a
+        watched range, the debugger is entered from that trap, just as a
+        debug register breakpoint would trap after the access; otherwise
+        the execution simply continues.
+
+        Only kernel pages that are mapped by 4K page tables can be watched
+        (module data and vmalloc memory), since the large pages that map
+        the kernel low memory also hold the code that handles the faults.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include "module-header.h"              // Versatile module header file
+
+#include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
+#include "intel.h"                      // Include processor specific stuff
+#include "ice.h"                        // Include main debugger structures
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+extern TIDT_Gate LinuxIdt[256];         // Original Linux IDT
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+#define PTE_PRESENT         0x001       // Page table entry: page is present
+#define PTE_WRITE           0x002       // Page table entry: page is writable
+#define PDE_PS              0x080       // Page directory entry: 4Mb page
+
+#define PF_WRITE            0x002       // Page fault error code: write access
+#define PF_USER             0x004       // Page fault error code: user mode access
+
+// Define a watched page
+
+typedef struct
+{
+    DWORD dwPage;                       // Linear address of the page
+    DWORD *pPte;                        // Address of its page table entry
+    DWORD dwPte;                        // Original value of the page table entry
+    DWORD dwClear;                      // Page table entry bits cleared to protect it
+
+} TWPAGE;
+
+// Define a watched range; there is one for every armed virtual watchpoint
+
+typedef struct
+{
+    int index;                          // Breakpoint index
+    UINT nPage;                         // Index of the watched page
+    DWORD dwFirst;                      // First watched byte
+    DWORD dwLast;                       // Last watched byte
+    BOOL fWrite;                        // Only writes are watched
+
+} TWRANGE;
+
+// Define the single step state of a CPU that is stepping over a watched page access
+
+typedef struct
+{
+    BOOL fStep;                         // Stepping over a watched page access
+    DWORD dwPages;                      // Pages unprotected for the step (bitmask)
+    DWORD eflags;                       // Original eflags (we change TF and IF)
+    int index;                          // Breakpoint whose range was accessed, or -1
+    DWORD dwTsc;                        // Time stamp of the fault
+
+} TWSTEP;
+
+static TWPAGE Page[MAX_WATCH_PAGES];    // Watched pages
+static UINT nPages = 0;                 // Number of watched pages
+static TWRANGE Range[MAX_BREAKPOINTS];  // Watched ranges
+static UINT nRanges = 0;                // Number of watched ranges
+static TWSTEP Step[MAX_CPU];            // Single step state of each CPU
+static int nHit = -1;                   // Breakpoint that stopped, or -1
+
+static TWATCHSTAT Stat[MAX_BREAKPOINTS];// Overhead statistics of each breakpoint
+
+/******************************************************************************
+*                                                                             *
+*   External Functions                                                        *
+*                                                                             *
+******************************************************************************/
+
+extern DWORD GetRdtsc(BYTE *buffer8);
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   static DWORD *GetPte(DWORD dwPage)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the address of the page table entry of a kernel page, using the
+*   current page directory. Kernel page tables are in the low memory and they
+*   are shared by all processes.
+*
+*   Where:
+*       dwPage is the linear address of the page
+*
+*   Returns:
+*       Address of the page table entry
+*       NULL if the page is not present or it is a part of a 4Mb page
+*
+******************************************************************************/
+static DWORD *GetPte(DWORD dwPage)
+{
+    DWORD *pPD, *pPT;                   // Page directory and page table
+    DWORD pde;                          // Page directory entry
+
+    pPD = (DWORD *) (ice_page_offset() + (deb.sysReg.cr3 & ~0xFFF));
+    pde = pPD[dwPage >> 22];
+
+    if( !(pde & PTE_PRESENT) || (pde & PDE_PS) )
+        return( NULL );
+
+    pPT = (DWORD *) (ice_page_offset() + (pde & ~0xFFF));
+
+    if( !(pPT[(dwPage >> 12) & 1023] & PTE_PRESENT) )
+        return( NULL );
+
+    return( &pPT[(dwPage >> 12) & 1023] );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL IsLinicePage(DWORD dwPage)                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns TRUE if the page holds Linice code or data that the fault handling
+*   path needs, so it must never be protected.
+*
+******************************************************************************/
+static BOOL IsLinicePage(DWORD dwPage)
+{
+    static const struct { DWORD start, end; } Used[] = {
+        { (DWORD) ObjectStart, (DWORD) ObjectEnd },
+        { (DWORD) &deb, (DWORD) &deb + sizeof(deb) },
+        { (DWORD) LinuxIdt, (DWORD) LinuxIdt + sizeof(TIDT_Gate) * 256 },
+        { (DWORD) Page, (DWORD) Page + sizeof(Page) },
+        { (DWORD) Range, (DWORD) Range + sizeof(Range) },
+        { (DWORD) Step, (DWORD) Step + sizeof(Step) },
+        { (DWORD) Stat, (DWORD) Stat + sizeof(Stat) },
+        { 0, 0 }
+    };
+    int i;
+
+    for(i=0; Used[i].end; i++ )
+    {
+        if( dwPage < Used[i].end && dwPage + 4096 > Used[i].start )
+            return( TRUE );
+    }
+
+    return( FALSE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL WatchVerify(DWORD dwAddress, UINT nLen)                              *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks if a memory range can be watched by page protection. This is used
+*   when a memory breakpoint is defined and there is no debug register left.
+*
+*   Where:
+*       dwAddress is the first byte to watch
+*       nLen is the number of bytes to watch
+*
+*   Returns:
+*       TRUE - The range can be watched
+*       FALSE - The range can not be watched
+*
+******************************************************************************/
+BOOL WatchVerify(DWORD dwAddress, UINT nLen)
+{
+    DWORD dwPage = dwAddress & ~0xFFF;
+
+    // The range has to be within a single kernel page
+    if( dwAddress < ice_page_offset() || ((dwAddress + nLen - 1) & ~0xFFF)!=dwPage )
+        return( FALSE );
+
+    if( IsLinicePage(dwPage) )
+        return( FALSE );
+
+    return( GetPte(dwPage)!=NULL );
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL WatchArm(int index, DWORD dwAddress, UINT nLen, BOOL fWrite)         *
+*                                                                             *
+*******************************************************************************
+*
+*   Adds a range to watch by page protection. Called while arming the
+*   breakpoints; the pages are protected by WatchProtect() once all ranges
+*   are added.
+*
+*   Where:
+*       index is the breakpoint index
+*       dwAddress is the first byte to watch
+*       nLen is the number of bytes to watch
+*       fWrite is TRUE to watch only the writes
+*
+*   Returns:
+*       TRUE - The range is armed
+*       FALSE - The range can not be watched (the page is not mapped any more)
+*
+******************************************************************************/
+BOOL WatchArm(int index, DWORD dwAddress, UINT nLen, BOOL fWrite)
+{
+    DWORD dwPage = dwAddress & ~0xFFF;
+    DWORD *pPte;
+    UINT n;
+
+    if( nRanges>=MAX_BREAKPOINTS || !WatchVerify(dwAddress, nLen) )
+        return( FALSE );
+
+    // Find the page or add a new one
+    for(n=0; n<nPages; n++ )
+    {
+        if( Page[n].dwPage==dwPage )
+            break;
+    }
+
+    if( n==nPages )
+    {
+        if( nPages>=MAX_WATCH_PAGES || (pPte = GetPte(dwPage))==NULL )
+            return( FALSE );
+
+        Page[n].dwPage  = dwPage;
+        Page[n].pPte    = pPte;
+        Page[n].dwPte   = *pPte;
+        Page[n].dwClear = 0;
+        nPages++;
+    }
+
+    // Reads can only be caught on a page that is not present
+    Page[n].dwClear |= fWrite? PTE_WRITE : PTE_PRESENT;
+
+    Range[nRanges].index   = index;
+    Range[nRanges].nPage   = n;
+    Range[nRanges].dwFirst = dwAddress;
+    Range[nRanges].dwLast  = dwAddress + nLen - 1;
+    Range[nRanges].fWrite  = fWrite;
+    nRanges++;
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void WatchProtect(void)                                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Protects all the pages of the armed ranges. Called at the end of arming
+*   the breakpoints.
+*
+******************************************************************************/
+void WatchProtect(void)
+{
+    UINT n;
+
+    for(n=0; n<nPages; n++ )
+    {
+        *Page[n].pPte = Page[n].dwPte & ~Page[n].dwClear;
+
+        INVLPG(Page[n].dwPage);
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   int WatchDisarm(void)                                                     *
+*                                                                             *
+*******************************************************************************
+*
+*   Removes the protection from all watched pages and forgets the ranges.
+*   A page table entry that was changed in the meantime (the memory was freed)
+*   is left alone.
+*
+*   Returns:
+*       Index of the breakpoint whose range was accessed, or -1
+*
+******************************************************************************/
+int WatchDisarm(void)
+{
+    int index = nHit;
+    UINT n;
+
+    for(n=0; n<nPages; n++ )
+    {
+        if( *Page[n].pPte==(Page[n].dwPte & ~Page[n].dwClear) )
+            *Page[n].pPte = Page[n].dwPte;
+
+        INVLPG(Page[n].dwPage);
+    }
+
+    // A CPU that is still stepping will find no pages to protect again
+    for(n=0; n<MAX_CPU; n++ )
+        Step[n].dwPages = 0;
+
+    nPages = 0;
+    nRanges = 0;
+    nHit = -1;
+
+    return( index );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void WatchRelease(DWORD dwStart, UINT size)                               *
+*                                                                             *
+*******************************************************************************
+*
+*   Removes the protection from the watched pages within a memory range that
+*   is being freed, so the kernel finds the original page table entries.
+*   Called from the module unload, while the debugee is running.
+*
+*   Where:
+*       dwStart is the starting kernel address of the range
+*       size is the size of the address range
+*
+******************************************************************************/
+void WatchRelease(DWORD dwStart, UINT size)
+{
+    UINT n, i;
+
+    for(n=0; n<nPages; n++ )
+    {
+        if( Page[n].dwClear && Page[n].dwPage + 4096 > dwStart && Page[n].dwPage < dwStart + size )
+        {
+            *Page[n].pPte = Page[n].dwPte;
+            INVLPG(Page[n].dwPage);
+
+            // The page stays in the table but it is not protected any more
+            Page[n].dwClear = 0;
+
+            for(i=0; i<nRanges; i++ )
+            {
+                if( Range[i].nPage==n )
+                    Range[i].dwLast = Range[i].dwFirst - 1;
+            }
+        }
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void WatchFlush(void)                                                     *
+*                                                                             *
+*******************************************************************************
+*
+*   Flushes the TLB entries of the watched pages on the current CPU. Called
+*   by the other CPUs when the debugger lets them go.
+*
+******************************************************************************/
+void WatchFlush(void)
+{
+    UINT n;
+
+    for(n=0; n<nPages; n++ )
+        INVLPG(Page[n].dwPage);
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL WatchArmed(void)                                                     *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns TRUE if there are pages being watched, so the page fault
+*   handler needs to be hooked.
+*
+******************************************************************************/
+BOOL WatchArmed(void)
+{
+    return( nPages > 0 );
+}
+
+/******************************************************************************
+*                                                                             *
+*   int WatchHit(void)                                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the index of the breakpoint whose range was accessed, or -1.
+*
+******************************************************************************/
+int WatchHit(void)
+{
+    return( nHit );
+}
+
+/******************************************************************************
+*                                                                             *
+*   UINT WatchTrap(DWORD nInt, PTREGS pRegs)                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Called from the interrupt handler on a page fault and a single step trap
+*   of the debugee, before the debugger entry.
+*
+*   Where:
+*       nInt is the interrupt number: 0x0E or 0x01
+*       pRegs is the register frame of the debugee
+*
+*   Returns:
+*       WATCH_RESUME - The trap was handled, continue the debugee
+*       WATCH_CHAIN - Page fault is not ours, chain it to the kernel handler
+*       WATCH_ENTER - Enter the debugger
+*
+******************************************************************************/
+UINT WatchTrap(DWORD nInt, PTREGS pRegs)
+{
+    TWSTEP *pStep;                      // Step state of the current CPU
+    TWPAGE *pPage;                      // Watched page that faulted
+    DWORD cr2, dr6, dwCycles;
+    BYTE Tsc[8];
+    UINT n, i;
+    int cpu;
+
+    cpu = ice_smp_processor_id();
+    if( cpu >= MAX_CPU )
+        return( nInt==0x0E? WATCH_CHAIN : WATCH_ENTER );
+
+    pStep = &Step[cpu];
+
+    if( nInt==0x0E )
+    {
+        GET_CR2(cr2);
+
+        // Only the kernel accesses to the pages that we protect are ours
+        if( pRegs->ErrorCode & PF_USER )
+            return( WATCH_CHAIN );
+
+        for(n=0; n<nPages; n++ )
+        {
+            if( Page[n].dwPage==(cr2 & ~0xFFF) && Page[n].dwClear )
+                break;
+        }
+
+        if( n==nPages )
+            return( WATCH_CHAIN );
+
+        pPage = &Page[n];
+
+        // Another CPU stepping over this page has the protection lifted; the
+        // fault came from a stale TLB entry, so simply retry the access
+        if( *pPage->pPte==pPage->dwPte )
+        {
+            INVLPG(pPage->dwPage);
+
+            return( WATCH_RESUME );
+        }
+
+        if( !pStep->fStep )
+        {
+            pStep->fStep   = TRUE;
+            pStep->eflags  = pRegs->eflags;
+            pStep->index   = -1;
+            pStep->dwTsc   = GetRdtsc(Tsc);
+        }
+
+        pStep->dwPages |= 1 << n;
+
+        // Find the range that was accessed and count the fault against every
+        // watchpoint in this page since they all cause it
+        for(i=0; i<nRanges; i++ )
+        {
+            if( Range[i].nPage==n )
+            {
+                Stat[Range[i].index].Faults++;
+
+                if( cr2 + 3 >= Range[i].dwFirst && cr2 <= Range[i].dwLast
+                 && (!Range[i].fWrite || (pRegs->ErrorCode & PF_WRITE))
+                 && pStep->index < 0 )
+                {
+                    pStep->index = Range[i].index;
+                }
+            }
+        }
+
+        // Lift the protection and single step the access with interrupts off
+        *pPage->pPte = pPage->dwPte;
+        INVLPG(pPage->dwPage);
+
+        pRegs->eflags |= TF_MASK;
+        pRegs->eflags &= ~IF_MASK;
+
+        return( WATCH_RESUME );
+    }
+
+    // Single step trap: is it the one that we have set up?
+    if( !pStep->fStep )
+        return( WATCH_ENTER );
+
+    pStep->fStep = FALSE;
+
+    // Account the time from the fault to here to the watchpoints that caused it
+    dwCycles = GetRdtsc(Tsc) - pStep->dwTsc;
+
+    for(i=0; i<nRanges; i++ )
+    {
+        if( pStep->dwPages & (1 << Range[i].nPage) )
+        {
+            ADD_CYCLES(Stat[Range[i].index].Cycles, dwCycles, 0);
+
+            if( pStep->index==Range[i].index )
+                Stat[Range[i].index].Matches++;
+        }
+    }
+
+    // Put the protection back, unless the page has been changed meanwhile
+    for(n=0; n<nPages; n++ )
+    {
+        if( pStep->dwPages & (1 << n) )
+        {
+            if( *Page[n].pPte==Page[n].dwPte && Page[n].dwClear )
+                *Page[n].pPte = Page[n].dwPte & ~Page[n].dwClear;
+
+            INVLPG(Page[n].dwPage);
+        }
+    }
+
+    pStep->dwPages = 0;
+
+    // Restore the original trap and interrupt flags
+    pRegs->eflags &= ~(TF_MASK | IF_MASK);
+    pRegs->eflags |= pStep->eflags & (TF_MASK | IF_MASK);
+
+    if( pStep->index >= 0 )
+    {
+        nHit = pStep->index;
+
+        return( WATCH_ENTER );
+    }
+
+    // The debugger was tracing this instruction anyway
+    if( pStep->eflags & TF_MASK )
+        return( WATCH_ENTER );
+
+    // The CPU does not clear the single step status
+    GET_DR6(dr6);
+    dr6 &= ~BITMASK(DR6_BS_BIT);
+    SET_DR6(dr6);
+
+    return( WATCH_RESUME );
+}
+
+/******************************************************************************
+*                                                                             *
+*   TWATCHSTAT *WatchGetStat(int index)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the overhead statistics of a breakpoint.
+*
+******************************************************************************/
+TWATCHSTAT *WatchGetStat(int index)
+{
+    return( &Stat[index] );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void WatchClearStat(int index)                                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Clears the overhead statistics of a breakpoint slot that is being reused.
+*
+******************************************************************************/
+void WatchClearStat(int index)
+{
+    memset(&Stat[index], 0, sizeof(TWATCHSTAT));
+}
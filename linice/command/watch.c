@@ -134,6 +134,44 @@ void WatchDraw(BOOL fForce)
     ListDraw(&deb.Watch, &pWin->w, fForce);
 }
 
+/******************************************************************************
+*                                                                             *
+*   static BOOL WatchIsPath(TLISTITEM *pItem)                                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks if a watch expression only names a variable, a register, or a
+*   member of a structure variable. In the same symbol context, such an
+*   expression always evaluates to the same address, so it does not have to
+*   be evaluated again. Any other expression may read memory (pointers,
+*   arrays) or compute its value when evaluated.
+*
+*   Where:
+*       pItem is the watch item
+*
+*   Returns:
+*       TRUE - the watch item addresses the same data in the same context
+*       FALSE - the watch expression has to be evaluated again
+*
+******************************************************************************/
+static BOOL WatchIsPath(TLISTITEM *pItem)
+{
+    char *pExpr = pItem->Name;
+
+    if( pItem->Item.bType!=EXTYPE_SYMBOL && pItem->Item.bType!=EXTYPE_REGISTER )
+        return( FALSE );
+
+    while( *pExpr )
+    {
+        if( !isalnum(*pExpr) && *pExpr!='_' && *pExpr!='.' )
+            return( FALSE );
+
+        pExpr++;
+    }
+
+    return( TRUE );
+}
+
 /******************************************************************************
 *                                                                             *
 *   void RecalculateWatch()                                                   *
@@ -148,15 +186,26 @@ void WatchDraw(BOOL fForce)
 *   Watch needs to be redrawn after this change - here we only update internal
 *   lists and buffers.
 *
+*   Expressions that name a variable are not evaluated again while the symbol
+*   context stays the same. Their values are read again when the list is
+*   drawn.
+*
 ******************************************************************************/
 void RecalculateWatch()
 {
     TLISTITEM *pItem = NULL;            // Current item
     TExItem ExItem;                     // Expression item to be evaluated
+    BOOL fSameContext;                  // Symbol context did not change
+
+    fSameContext = ListSameContext(&deb.Watch);
 
     // Walk the list of root items and check that the expression is still valid
     while( (pItem = ListGetNext(&deb.Watch, pItem)) )
     {
+        // The same variable in the same context is still at the same address
+        if( fSameContext && WatchIsPath(pItem) )
+            continue;
+
         // Check the expression
         if( Evaluate(&ExItem, pItem->Name, NULL, TRUE) )
         {
@@ -164,8 +213,11 @@ void RecalculateWatch()
             // so compare the ExItem data structures
             if( ExItemCompare(&ExItem, &pItem->Item) )
             {
-                // Values are identical, no need to do anything here
-                ;
+                // Same type, so keep the expanded elements and only take the new address
+                memcpy(&pItem->Item, &ExItem, sizeof(TExItem));
+
+                if( ExItem.pData==(BYTE *)&ExItem.Data )
+                    pItem->Item.pData = (BYTE *)&pItem->Item.Data;
             }
             else
             {
@@ -53,7 +53,7 @@
 *                                                                             *
 ******************************************************************************/
 
-extern BOOL FillStackList(DWORD dwEBP, DWORD dwEIP, BOOL fLocals);
+extern BOOL FillStackList(DWORD dwESP, DWORD dwEBP, DWORD dwEIP, BOOL fLocals);
 extern BOOL FillLocalScope(TLIST *List, TSYMFNSCOPE *pFnScope, DWORD dwEIP);
 extern void RecalculateWatch(void);
 extern void DataEvaluateDex(void);
@@ -94,6 +94,9 @@ TSYMFNLIN *SymAddress2FnLin(WORD wSel, DWORD dwOffset)
 
     if( deb.pSymTabCur )
     {
+        // Function addresses are stored relative to the code segment
+        dwOffset -= SymTabReloc(deb.pSymTabCur, 0);
+
         pHead = deb.pSymTabCur->header;
 
         while( pHead->hType != HTYPE__END )
@@ -148,6 +151,8 @@ char *SymFnLin2LineExact(WORD *pLineNumber, TSYMFNLIN *pFnLin, DWORD dwAddress)
 
     if( pFnLin )
     {
+        dwAddress -= SymTabReloc(deb.pSymTabCur, 0);
+
         // More checks that the address is right
         if( dwAddress>=pFnLin->dwStartAddress && dwAddress<=pFnLin->dwEndAddress )
         {
@@ -214,6 +219,8 @@ TSYMFNLIN1 *SymFnLin2LineRecord(TSYMFNLIN *pFnLin, DWORD dwAddress)
 
     if( pFnLin )
     {
+        dwAddress -= SymTabReloc(deb.pSymTabCur, 0);
+
         // More checks that the address is right
         if( dwAddress>=pFnLin->dwStartAddress && dwAddress<=pFnLin->dwEndAddress )
         {
@@ -249,6 +256,59 @@ TSYMFNLIN1 *SymFnLin2LineRecord(TSYMFNLIN *pFnLin, DWORD dwAddress)
     return( NULL );
 }
 
+/******************************************************************************
+*                                                                             *
+*   BOOL SymFnLin2LineRange(TSYMFNLIN *pFnLin, DWORD dwAddress,               *
+*                           DWORD *pStart, DWORD *pEnd)                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the address range of the code block that contains the given
+*   address and belongs to a single line record. Any address within that
+*   range maps to the same source line.
+*
+*   Where:
+*       pFnLin is the function line descriptor
+*       dwAddress is the address to look up
+*       pStart is the address to store the start of the block
+*       pEnd is the address to store the end of the block (exclusive)
+*   Returns:
+*       TRUE - the range is stored
+*       FALSE - no line found at that location
+*
+******************************************************************************/
+BOOL SymFnLin2LineRange(TSYMFNLIN *pFnLin, DWORD dwAddress, DWORD *pStart, DWORD *pEnd)
+{
+    TSYMFNLIN1 *pFnLin1;
+    TSYMFNLIN1 *pNext;
+    DWORD dwBase;                       // Relocated function start address
+
+    pFnLin1 = SymFnLin2LineRecord(pFnLin, dwAddress);
+
+    if( pFnLin1 )
+    {
+        dwBase = pFnLin->dwStartAddress + SymTabReloc(deb.pSymTabCur, 0);
+
+        *pStart = dwBase + pFnLin1->offset;
+        *pEnd   = dwBase + (pFnLin->dwEndAddress - pFnLin->dwStartAddress) + 1;
+
+        // The block ends where the next record with a larger offset starts
+        for(pNext=pFnLin1+1; pNext<&pFnLin->list[pFnLin->nLines]; pNext++ )
+        {
+            if( pNext->offset > pFnLin1->offset )
+            {
+                *pEnd = dwBase + pNext->offset;
+                break;
+            }
+        }
+
+        // The address may still precede the first line record of the function
+        return( dwAddress>=*pStart && dwAddress<*pEnd );
+    }
+
+    return( FALSE );
+}
+
 /******************************************************************************
 *                                                                             *
 *   char *SymFnLin2Line(WORD *pLineNumber, TSYMFNLIN *pFnLin, DWORD dwAddress)*
@@ -405,16 +465,19 @@ TSYMFNSCOPE *SymAddress2FnScope(WORD wSel, DWORD dwOffset)
     // Find the function scope descriptor that contains the given address
     if( deb.pSymTabCur )
     {
+        // Function addresses are stored relative to the code segment
+        dwOffset -= SymTabReloc(deb.pSymTabCur, 0);
+
         pHead = deb.pSymTabCur->header;
 
         while( pHead->hType != HTYPE__END )
         {
-            if( pHead->hType == HTYPE_FUNCTION_SCOPE )
+            if( SECTYPE(pHead) == HTYPE_FUNCTION_SCOPE )
             {
                 // Check if the address is inclusive
                 pFnScope = (TSYMFNSCOPE *)pHead;
                 if( pFnScope->dwStartAddress<=dwOffset && pFnScope->dwEndAddress>=dwOffset )
-                    return( pFnScope );
+                    return( (TSYMFNSCOPE *)SymTabMakePointers(deb.pSymTabCur, pHead) );
             }
 
             pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
@@ -451,7 +514,7 @@ void SetSymbolContext(WORD wSel, DWORD dwOffset)
     deb.codeFileXoffset = 0;
 
     // Delete all the lists that we need to rebuild at every context change
-    ListDelAll(&deb.Local);
+    // (locals are kept while they show the same variables)
     ListDelAll(&deb.Stack);
 
     // Adjust the code window's machine code top address:
@@ -483,7 +546,7 @@ void SetSymbolContext(WORD wSel, DWORD dwOffset)
         Address2SymbolTable(wSel, dwOffset);
 
     // Fill the stack list
-    FillStackList(deb.r->ebp, dwOffset, TRUE);
+    FillStackList(deb.r->esp, deb.r->ebp, dwOffset, TRUE);
 
     if( deb.pSymTabCur )
     {
@@ -495,9 +558,6 @@ void SetSymbolContext(WORD wSel, DWORD dwOffset)
             // Set the current function line descriptor based on the current CS:EIP
             deb.pFnLin = SymAddress2FnLin(wSel, dwOffset);
 
-            // Set the array of local scope variables (only if the function scope is valid)
-            FillLocalScope(&deb.Local, deb.pFnScope, deb.r->eip);
-
             // If we have function scope information for that address...
             if( deb.pFnLin )
             {
@@ -532,6 +592,9 @@ void SetSymbolContext(WORD wSel, DWORD dwOffset)
         }
     }
 
+    // Set the array of local scope variables (only if the function scope is valid)
+    FillLocalScope(&deb.Local, deb.pFnScope, deb.r->eip);
+
     // Adjust data windows that depend on DEX expressions since they may depend on the context symbols
     DataEvaluateDex();
 
@@ -92,7 +92,6 @@ static int major_device_number;
 *                                                                             *
 ******************************************************************************/
 
-extern DWORD Checksum1(DWORD start, DWORD len);
 extern int InitProcFs();
 extern int CloseProcFs();
 
@@ -109,6 +108,10 @@ extern int InitPacket(PTINITPACKET pInit);
 extern int XInitPacket(TXINITPACKET *pXInit);
 extern int UserAddSymbolTable(void *pSymtab);
 extern int UserRemoveSymbolTable(void *pSymtab);
+extern int UserStageSymbolTable(void *pPacket);
+extern int UserCommitSymbolTable(void);
+extern void *SymTabStageMap(DWORD dwSize, int delta);
+extern void *HistoryMap(DWORD dwSize);
 
 extern void UnHookSwitch(void);
 extern BOOL KeyboardHook(DWORD handle_kbd_event, DWORD handle_scancode);
@@ -121,6 +124,9 @@ extern int QueryExtModule();
 
 extern int HistoryReadReset();
 extern char *HistoryReadNext(void);
+extern int HistoryReadBulk(void *pUser);
+extern int ProfileReadFolded(void *pUser);
+extern int HeadlessReadScreen(void *pUser);
 
 extern WORD GetKernelDS();
 extern WORD GetKernelCS();
@@ -208,8 +214,8 @@ int IceInitModule(void)
                     // Register /proc/linice virtual file
                     if( InitProcFs()==0 )
                     {
-                        // Calculate the checksum of the Linice code
-                        deb.LiniceChecksum = Checksum1((DWORD)ObjectStart, (DWORD)ObjectEnd - (DWORD)ObjectStart);
+                        // Calculate the block checksums of the Linice code
+                        ImageChecksumInit();
 
                         INFO(("Linice successfully loaded.\n"));
 
@@ -334,6 +340,11 @@ void IceCleanupModule(void)
 *   int DriverClose(struct inode *inode, struct file *file)
 *   int DriverIOCTL(struct inode *inode, struct file *file, unsigned int ioctl, unsigned long param)
 *
+*   Memory mapping is handled by the kernel interface, which calls:
+*
+*   void *DriverMmap(unsigned long offset, unsigned long size, int *pfReadOnly)
+*   void DriverMunmap(void *pBase)
+*
 ******************************************************************************/
 int DriverOpen(void)
 {
@@ -443,6 +454,20 @@ int DriverIOCTL(void *p1, void *p2, unsigned int ioctl, unsigned long param)
             retval = UserRemoveSymbolTable((void *)param);
             break;
 
+        //==========================================================================================
+        case ICE_IOCTL_SYM_STAGE:       // Reserve a staging area for a symbol table to be mapped
+            INFO("ICE_IOCTL_SYM_STAGE\n");
+
+            retval = UserStageSymbolTable((void *)param);
+            break;
+
+        //==========================================================================================
+        case ICE_IOCTL_SYM_COMMIT:      // Add a symbol table that was read into the staging area
+            INFO("ICE_IOCTL_SYM_COMMIT\n");
+
+            retval = UserCommitSymbolTable();
+            break;
+
         //==========================================================================================
         case ICE_IOCTL_HISBUF_RESET:    // Fetch a seria of history lines - reset the internal reader
             INFO("ICE_IOCTL_HISBUF_RESET\n");
@@ -463,7 +488,55 @@ int DriverIOCTL(void *p1, void *p2, unsigned int ioctl, unsigned long param)
                 retval = -EFAULT;       // Faulty memory access OR end of history stream
 
             break;
+
+        //==========================================================================================
+        case ICE_IOCTL_HISBUF_BULK:     // Fetch a range of history lines in one call
+            INFO("ICE_IOCTL_HISBUF_BULK\n");
+
+            retval = HistoryReadBulk((void *)param);
+            break;
+
+        //==========================================================================================
+        case ICE_IOCTL_PROFILE_FOLDED:  // Fetch the sampled call stacks
+            INFO("ICE_IOCTL_PROFILE_FOLDED\n");
+
+            retval = ProfileReadFolded((void *)param);
+            break;
+
+        //==========================================================================================
+        case ICE_IOCTL_SCREEN:          // Fetch the headless output screen
+            INFO("ICE_IOCTL_SCREEN\n");
+
+            retval = HeadlessReadScreen((void *)param);
+            break;
     }
 
     return( retval );
 }
+
+void *DriverMmap(unsigned long offset, unsigned long size, int *pfReadOnly)
+{
+    INFO("IceMmap offset %X size %X\n", (int)offset, (int)size);
+
+    switch(offset)
+    {
+        case ICE_MMAP_SYMBOLS:          // Symbol table staging area
+            *pfReadOnly = FALSE;
+            return( SymTabStageMap(size, 1) );
+
+        case ICE_MMAP_HISTORY:          // History buffer
+            *pfReadOnly = TRUE;
+            return( HistoryMap(size) );
+    }
+
+    return( NULL );
+}
+
+void DriverMunmap(void *pBase)
+{
+    INFO("IceMunmap %X\n", (int)pBase);
+
+    // History mapping is not reference counted
+    if( pBase != deb.hHistoryBufferHeap )
+        SymTabStageMap(0, -1);
+}
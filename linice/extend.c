@@ -47,6 +47,7 @@
 #include "ice.h"                        // Include main debugger structures
 #include "stdarg.h"                     // Include variable argument header
 #include "disassembler.h"               // Include disassembler
+#include "eval.h"                       // Include expression evaluator
 
 #include "LiniceExt.h"                  // Include extension include file
 
@@ -64,6 +65,21 @@
 
 static TLINICEEXT *pRootExt = NULL;     // Pointer to the list of extensions
 
+/******************************************************************************
+*                                                                             *
+*   External Functions                                                        *
+*                                                                             *
+******************************************************************************/
+
+extern BOOL FindSymbol(TExItem *item, char *pName, int *pNameLen);
+extern BOOL Evaluate(TExItem *pItem, char *pExpr, char **ppNext, BOOL fSymbolsValueOf);
+extern UINT GetTypeSize(TSYMTYPEDEF1 *pType1);
+extern void PrettyPrintVariableName(char *pString, char *pName, TSYMTYPEDEF1 *pType1);
+extern int BreakpointSetCallback(TLINICEEXT *pOwner, int type, TADDRDESC Addr, int access, PEXT_BREAKPOINT Callback, void *pContext);
+extern BOOL BreakpointClearCallback(TLINICEEXT *pOwner, int index);
+extern BOOL BreakpointAttachCallback(TLINICEEXT *pOwner, int index, PEXT_BREAKPOINT Callback, void *pContext);
+extern void BreakpointReleaseOwner(TLINICEEXT *pOwner);
+
 /******************************************************************************
 *                                                                             *
 *   Functions                                                                 *
@@ -186,6 +202,215 @@ static int ExtMemVerify(int sel, int offset, int size)
     return( VerifyRange(&Addr, size) );
 }
 
+/******************************************************************************
+*   int ExtMemRead(void *pDest, int sel, int offset, int size)
+*******************************************************************************
+*
+*   Reads a block of memory; the bytes past a fault are set to 0xFF
+*
+******************************************************************************/
+static int ExtMemRead(void *pDest, int sel, int offset, int size)
+{
+    TADDRDESC Addr;                     // Address descriptor
+
+    Addr.sel    = sel? sel : GetKernelDS();
+    Addr.offset = offset;
+
+    return( size>0? AddrReadBlock(&Addr, (BYTE *) pDest, size) : 0 );
+}
+
+/******************************************************************************
+*   int ExtMemWrite(int sel, int offset, void *pSrc, int size)
+*******************************************************************************
+*
+*   Writes a block of memory the same way the memory is edited
+*
+******************************************************************************/
+static int ExtMemWrite(int sel, int offset, void *pSrc, int size)
+{
+    TADDRDESC Addr;                     // Address descriptor
+
+    Addr.sel    = sel? sel : GetKernelDS();
+    Addr.offset = offset;
+
+    return( size>0? AddrWriteBlock(&Addr, (BYTE *) pSrc, size, TRUE) : 0 );
+}
+
+/******************************************************************************
+*   char *ExtSymName(unsigned int address, unsigned int *pOffset)
+*******************************************************************************
+*
+*   Returns the symbol name at an address. If pOffset is given, the closest
+*   symbol below the address is returned with the offset from it.
+*
+******************************************************************************/
+static char *ExtSymName(unsigned int address, unsigned int *pOffset)
+{
+    return( SymAddress2Name(address, pOffset) );
+}
+
+/******************************************************************************
+*   int ExtSymAddress(unsigned int *pAddress, char *pName)
+*******************************************************************************
+*
+*   Looks up the address of a symbol: a local, static or global variable or
+*   function, or a kernel export in the "module!symbol" format
+*
+******************************************************************************/
+static int ExtSymAddress(unsigned int *pAddress, char *pName)
+{
+    TExItem Item;                       // Symbol item
+    int nLen = strlen(pName);
+
+    memset(&Item, 0, sizeof(TExItem));
+
+    if( FindSymbol(&Item, pName, &nLen) )
+    {
+        // Exports are stored as a literal address
+        if( Item.bType==EXTYPE_SYMBOL && Item.pData!=(BYTE *) &Item.Data )
+            *pAddress = (DWORD) Item.pData;
+        else
+        if( Item.bType==EXTYPE_SYMBOL || Item.bType==EXTYPE_LITERAL )
+            *pAddress = Item.Data;
+        else
+            return( FALSE );
+
+        return( TRUE );
+    }
+
+    return( FALSE );
+}
+
+/******************************************************************************
+*   int ExtDisasmBlock(TLINICEDISASM *pList, int count, int sel, int offset)
+*******************************************************************************
+*
+*   Disassembles a number of consecutive instructions into a caller buffer
+*
+******************************************************************************/
+static int ExtDisasmBlock(TLINICEDISASM *pList, int count, int sel, int offset)
+{
+    static char buf[MAX_STRING];        // Disassembly of one instruction
+    TDISASM dis;                        // Disassembler interface structure
+    int n;
+
+    dis.bState   = DIS_DATA32 | DIS_ADDRESS32;
+    dis.wSel     = sel? sel : GetKernelCS();
+    dis.dwOffset = offset;
+    dis.szDisasm = (BYTE *) buf;
+
+    for(n=0; n<count; n++, pList++)
+    {
+        pList->offset = dis.dwOffset;
+
+        Disassembler( &dis );
+
+        pList->len = dis.bInstrLen;
+        strncpy(pList->text, buf, LINICEEXT_DISASM_LEN-1);
+        pList->text[LINICEEXT_DISASM_LEN-1] = 0;
+
+        if( dis.bInstrLen==0 )
+            break;
+
+        dis.dwOffset += dis.bInstrLen;
+    }
+
+    return( n );
+}
+
+/******************************************************************************
+*   int ExtReadVar(TLINICEVAR *pVar, char *pExpr, void *pBuf, int size)
+*******************************************************************************
+*
+*   Evaluates a variable expression and reads its value and type. Variables
+*   in registers are read from the debugee register state.
+*
+******************************************************************************/
+static int ExtReadVar(TLINICEVAR *pVar, char *pExpr, void *pBuf, int size)
+{
+    static char buf[MAX_STRING];        // Type name
+    TExItem Item;                       // Variable item
+    TADDRDESC Addr;                     // Address of the variable
+    int nVar;                           // Size of the variable
+
+    if( Evaluate(&Item, pExpr, NULL, TRUE) )
+    {
+        nVar = GetTypeSize(&Item.Type);
+
+        PrettyPrintVariableName(buf, "", &Item.Type);
+        strncpy(pVar->type, buf, LINICEEXT_TYPE_LEN-1);
+        pVar->type[LINICEEXT_TYPE_LEN-1] = 0;
+        pVar->size = nVar;
+        pVar->address = 0;
+
+        size = MIN(size, nVar);
+
+        if( Item.bType==EXTYPE_SYMBOL && Item.pData!=(BYTE *) &Item.Data )
+        {
+            pVar->address = (DWORD) Item.pData;
+
+            Addr.sel    = Item.wSel? Item.wSel : GetKernelDS();
+            Addr.offset = (DWORD) Item.pData;
+
+            if( size>0 )
+                AddrReadBlock(&Addr, (BYTE *) pBuf, size);
+        }
+        else
+        {
+            // Registers and literals are in our own memory
+            if( size>0 )
+                memcpy(pBuf, Item.pData, size);
+        }
+
+        return( nVar );
+    }
+
+    return( -1 );
+}
+
+/******************************************************************************
+*   int ExtBpSet(TLINICEEXT *pExt, int type, int sel, int offset, int access, PEXT_BREAKPOINT Callback, void *pContext)
+*******************************************************************************
+*
+*   Sets a breakpoint whose hits call the extension
+*
+******************************************************************************/
+static int ExtBpSet(TLINICEEXT *pExt, int type, int sel, int offset, int access, PEXT_BREAKPOINT Callback, void *pContext)
+{
+    TADDRDESC Addr;                     // Breakpoint address
+
+    Addr.sel    = sel? sel : (type==LINICEBP_BPX? GetKernelCS() : GetKernelDS());
+    Addr.offset = offset;
+
+    if( type==LINICEBP_BPX )
+        access = LINICEBP_RW;           // Not used
+
+    return( BreakpointSetCallback(pExt, type, Addr, access, Callback, pContext) );
+}
+
+/******************************************************************************
+*   int ExtBpClear(TLINICEEXT *pExt, int index)
+*******************************************************************************
+*
+*   Clears a breakpoint that the extension has set
+*
+******************************************************************************/
+static int ExtBpClear(TLINICEEXT *pExt, int index)
+{
+    return( BreakpointClearCallback(pExt, index) );
+}
+
+/******************************************************************************
+*   int ExtBpAttach(TLINICEEXT *pExt, int index, PEXT_BREAKPOINT Callback, void *pContext)
+*******************************************************************************
+*
+*   Attaches the extension callback to a breakpoint, or detaches it
+*
+******************************************************************************/
+static int ExtBpAttach(TLINICEEXT *pExt, int index, PEXT_BREAKPOINT Callback, void *pContext)
+{
+    return( BreakpointAttachCallback(pExt, index, Callback, pContext) );
+}
 
 /******************************************************************************
 *   void ExtZapCallbacks(TLINICEEXT *pExt)
@@ -207,6 +432,19 @@ static void ExtZapCallbacks(TLINICEEXT *pExt)
     pExt->Execute   = (PLINICEEXT_EXEC)      (&pExt->pNext);
     pExt->Getch     = (PLINICEEXT_GETCH)     (&pExt->pNext);
     pExt->MemVerify = (PLINICEEXT_MEMVERIFY) (&pExt->pNext);
+
+    if( pExt->version!=LINICEEXTVERSION1 )
+    {
+        pExt->MemRead     = (PLINICEEXT_MEMREAD)     (&pExt->pNext);
+        pExt->MemWrite    = (PLINICEEXT_MEMWRITE)    (&pExt->pNext);
+        pExt->SymName     = (PLINICEEXT_SYMNAME)     (&pExt->pNext);
+        pExt->SymAddress  = (PLINICEEXT_SYMADDRESS)  (&pExt->pNext);
+        pExt->DisasmBlock = (PLINICEEXT_DISASMBLOCK) (&pExt->pNext);
+        pExt->ReadVar     = (PLINICEEXT_READVAR)     (&pExt->pNext);
+        pExt->BpSet       = (PLINICEEXT_BPSET)       (&pExt->pNext);
+        pExt->BpClear     = (PLINICEEXT_BPCLEAR)     (&pExt->pNext);
+        pExt->BpAttach    = (PLINICEEXT_BPATTACH)    (&pExt->pNext);
+    }
 }
 
 /******************************************************************************
@@ -232,9 +470,10 @@ int LiniceRegisterExtension(TLINICEEXT *pExt)
     // Check the validity of the interface header
     if( pExt )
     {
-        if( pExt->version==LINICEEXTVERSION )
+        if( pExt->version==LINICEEXTVERSION || pExt->version==LINICEEXTVERSION1 )
         {
-            if( pExt->size==sizeof(TLINICEEXT) && pExt->pDotName!=NULL )
+            // Version 1 structures end before the version 2 services
+            if( pExt->size==(pExt->version==LINICEEXTVERSION? LINICEEXTSIZE : LINICEEXTSIZE1) && pExt->pDotName!=NULL )
             {
                 // Add extension to the list of extensions (to the head of the list)
                 // But first we need to make sure that block has not been already
@@ -272,6 +511,19 @@ int LiniceRegisterExtension(TLINICEEXT *pExt)
                 pExt->Getch     = (PLINICEEXT_GETCH)     ExtGetch;
                 pExt->MemVerify = (PLINICEEXT_MEMVERIFY) ExtMemVerify;
 
+                if( pExt->version==LINICEEXTVERSION )
+                {
+                    pExt->MemRead     = (PLINICEEXT_MEMREAD)     ExtMemRead;
+                    pExt->MemWrite    = (PLINICEEXT_MEMWRITE)    ExtMemWrite;
+                    pExt->SymName     = (PLINICEEXT_SYMNAME)     ExtSymName;
+                    pExt->SymAddress  = (PLINICEEXT_SYMADDRESS)  ExtSymAddress;
+                    pExt->DisasmBlock = (PLINICEEXT_DISASMBLOCK) ExtDisasmBlock;
+                    pExt->ReadVar     = (PLINICEEXT_READVAR)     ExtReadVar;
+                    pExt->BpSet       = (PLINICEEXT_BPSET)       ExtBpSet;
+                    pExt->BpClear     = (PLINICEEXT_BPCLEAR)     ExtBpClear;
+                    pExt->BpAttach    = (PLINICEEXT_BPATTACH)    ExtBpAttach;
+                }
+
                 dprinth(1, "EXT Register: %8s", pExt->pDotName);
             }
             else
@@ -323,6 +575,9 @@ void LiniceUnregisterExtension(TLINICEEXT *pExt)
                 pPrev->pNext = pExt->pNext;
             }
 
+            // Its breakpoints must not call it any more
+            BreakpointReleaseOwner(pExt);
+
             // Set the callback functions to its dummy RET, so if they are
             // called by mistake, nothing will happen.
             ExtZapCallbacks(pExt);
@@ -43,7 +43,10 @@
 #include "module-header.h"              // Versatile module header file
 
 #include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
 #include "ice.h"                        // Include main debugger structures
+#include "ice-ioctl.h"                  // Include our own IOCTL numbers
+#include "errno.h"                      // Include kernel error numbers
 #include "debug.h"                      // Include our dprintk()
 
 /******************************************************************************
@@ -55,6 +58,11 @@
 #define HISTORY_BUFFER      (deb.hHistoryBufferHeap)
 #define MAX_HISTORY_BUF     (deb.nHistorySize)
 
+// Line records start after the header that user space reads through mmap
+
+#define HISTORY_LINES       (HISTORY_BUFFER + sizeof(THISHEADER))
+#define MAX_HISTORY_LINES   (MAX_HISTORY_BUF - sizeof(THISHEADER))
+
 /******************************************************************************
 *                                                                             *
 *   Local Defines, Variables and Macros                                       *
@@ -74,6 +82,12 @@ static TLine *pHead;                    // Pointer to the head line
 static TLine *pTail;                    // Pointer to the tail line
 static DWORD avail;                     // Number of bytes available in the buffer
 static TLine *pRead = NULL;             // Read history ioctl pointer
+static DWORD nLines;                    // Number of lines currently in the buffer
+
+#define pHeader     ((volatile THISHEADER *) HISTORY_BUFFER)
+
+// Keep the compiler from moving buffer stores across the generation updates
+#define HISTORY_BARRIER()   __asm__ __volatile__("" : : : "memory")
 
 /******************************************************************************
 *                                                                             *
@@ -143,6 +157,141 @@ char *HistoryReadNext(void)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   int HistoryReadBulk(void *pUser)                                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Copies a range of history lines into the user buffer in one call. The
+*   lines are numbered by the order they were added in, so the caller can
+*   continue from where it stopped. Lines that were already released from
+*   the buffer are skipped.
+*
+*   The history may change while we copy to the user (which may sleep), in
+*   which case we drop the line that we were copying and return what we
+*   have so far.
+*
+*   Where:
+*       pUser is the address of the THISBUFPACKET in the user space
+*
+*   Returns:
+*       0 on success
+*       -EFAULT on faulty memory access
+*
+******************************************************************************/
+int HistoryReadBulk(void *pUser)
+{
+    THISBUFPACKET Packet;               // Packet local copy
+    TLine *p;                           // Line that we are copying
+    DWORD dwGen;                        // Generation when we started
+    DWORD dwLine;                       // Number of the current line
+    UINT len, used = 0;
+
+    if( ice_copy_from_user(&Packet, pUser, sizeof(THISBUFPACKET))==0 )
+    {
+        dwGen  = pHeader->dwGen & ~1;
+        dwLine = pHeader->dwLines - nLines;
+        p = pTail;
+
+        // Skip to the first requested line
+        while( dwLine < Packet.dwLine && p != pHead )
+        {
+            p = p->next;
+            dwLine++;
+        }
+
+        Packet.dwFirst = dwLine;
+        Packet.nLines = 0;
+
+        while( p && p != pHead && pHeader->dwGen==dwGen )
+        {
+            len = MIN(MAX_STRING, strlen(p->line)+1);
+
+            if( used + len > Packet.dwSize )
+                break;
+
+            if( ice_copy_to_user(Packet.pBuf + used, p->line, len) )
+                return( -EFAULT );
+
+            // If the line changed while we were copying it, drop it
+            if( pHeader->dwGen!=dwGen )
+                break;
+
+            used += len;
+            dwLine++;
+            Packet.nLines++;
+            p = p->next;
+        }
+
+        Packet.dwLine = dwLine;
+        Packet.dwLines = pHeader->dwLines;
+        Packet.dwSize = used;
+        Packet.dwHistorySize = MAX_HISTORY_BUF;
+
+        if( ice_copy_to_user(pUser, &Packet, sizeof(THISBUFPACKET))==0 )
+            return( 0 );
+    }
+
+    return( -EFAULT );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void *HistoryMap(DWORD dwSize)                                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the address of the history buffer to be mapped read-only into
+*   the user space.
+*
+*   Where:
+*       dwSize is the size of the mapping
+*
+*   Returns:
+*       Address of the history buffer
+*       NULL if the mapping would be larger than the buffer
+*
+******************************************************************************/
+void *HistoryMap(DWORD dwSize)
+{
+    if( HISTORY_BUFFER && dwSize <= ((MAX_HISTORY_BUF + 4095) & ~4095) )
+        return( HISTORY_BUFFER );
+
+    return( NULL );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void HistoryPublish(void)                                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Updates the header offsets after the history buffer changed.
+*
+******************************************************************************/
+static void HistoryPublish(void)
+{
+    pHeader->dwHead = (BYTE *)pHead - HISTORY_BUFFER;
+    pHeader->dwTail = (BYTE *)pTail - HISTORY_BUFFER;
+}
+
+/******************************************************************************
+*                                                                             *
+*   void HistoryInit(void)                                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Initializes a newly allocated history buffer. Called once from init.c
+*
+******************************************************************************/
+void HistoryInit(void)
+{
+    memset(HISTORY_BUFFER, 0, sizeof(THISHEADER));
+
+    ClearHistory();
+}
+
 /******************************************************************************
 *                                                                             *
 *   void ClearHistory(void)                                                   *
@@ -154,10 +303,21 @@ char *HistoryReadNext(void)
 ******************************************************************************/
 void ClearHistory(void)
 {
-    pHead = pTail = (TLine *) HISTORY_BUFFER;
+    pHeader->dwGen++;
+    HISTORY_BARRIER();
+
+    pHead = pTail = (TLine *) HISTORY_LINES;
     memset(pHead, 0, sizeof(TLine));
-    avail = MAX_HISTORY_BUF;
+    avail = MAX_HISTORY_LINES;
     pHead->next = pHead->prev = NULL;
+    nLines = 0;
+
+    pHeader->dwBase = (DWORD) HISTORY_BUFFER;
+    pHeader->dwSize = MAX_HISTORY_BUF;
+    HistoryPublish();
+
+    HISTORY_BARRIER();
+    pHeader->dwGen++;
 }
 
 /******************************************************************************
@@ -182,6 +342,9 @@ void HistoryAdd(char *sLine)
     len = strlen(sLine);
     size = len + 1 + sizeof(TLine) - 1;
 
+    pHeader->dwGen++;
+    HISTORY_BARRIER();
+
     // Give it some hefty margin since lines at the end of the buffer
     // can not be split
 
@@ -192,6 +355,7 @@ void HistoryAdd(char *sLine)
         avail += pTail->bSize;
         pTail = pTail->next;
         pTail->prev = NULL;
+        nLines--;
     }
 
     // If the new line record can not fit at the end of the buffer, wrap
@@ -202,7 +366,7 @@ void HistoryAdd(char *sLine)
         TLine * prev_save;
 
         prev_save = pHead->prev;
-        pHead = (TLine *) HISTORY_BUFFER;
+        pHead = (TLine *) HISTORY_LINES;
         prev_save->next = pHead;
         pHead->prev = prev_save;
         pHead->next = NULL;
@@ -224,6 +388,13 @@ void HistoryAdd(char *sLine)
     pHead->next->prev = pHead;
     pHead = pHead->next;
     pHead->next = NULL;
+    nLines++;
+
+    pHeader->dwLines++;
+    HistoryPublish();
+
+    HISTORY_BARRIER();
+    pHeader->dwGen++;
 }
 
 
@@ -56,6 +56,10 @@ global  GetDWORD
 global  SetDWORD
 global  SetByte
 global  MemAccess_FAULT
+global  MemBlock_START
+global  GetBlock
+global  SetBlock
+global  MemBlock_FAULT
 global  MemAccess_END
 
 global  strtolower
@@ -77,6 +81,8 @@ global  SpinlockTest
 global  SpinUntilReset
 global  SpinlockSet
 global  SpinlockReset
+global  SpinlockTry
+global  AtomicIncrement
 
 global  GetKernelDS
 global  GetKernelCS
@@ -322,8 +328,8 @@ skip_set_stack:
         add     esp, 8                          ; Restore esp to what was before the call
 
         cmp     esp, ebp                        ; Did we gave it any extra buffer?
-        setz    [fStackLevel]                   ; Reset the semaphore if we did (first level)
-        jz      skip_reset_stack
+        jz      skip_reset_stack                ; Nested (or other CPU) entries leave the semaphore alone
+        mov     byte [fStackLevel], 0           ; Reset the semaphore since we did (first level)
         add     esp, dword [StackExtraBuffer]   ; Move esp to skip the buffer and position to the pRegs
         mov     ebp, esp                        ; Make ebp and esp the same at this point
 skip_reset_stack:
@@ -877,6 +883,153 @@ MemAccess_FAULT:
         pop     ebp
         ret
 
+;==============================================================================
+;
+;   DWORD GetBlock( WORD sel, DWORD offset, BYTE *pDest, DWORD len )
+;
+;   Copies a block of memory from sel:offset into the kernel buffer.
+;   The selector and the limit of the whole block are checked once and
+;   the copy is done with a single string move, so the caller should make
+;   sure the pages are present; a fault still returns the error code.
+;
+;   Where:
+;       [ebp + 8 ]      selector
+;       [ebp + 12 ]     offset
+;       [ebp + 16 ]     destination buffer
+;       [ebp + 20 ]     length in bytes
+;
+;   Returns:
+;       0 if the block was copied, or MEMACCESS_* code
+;
+;==============================================================================
+;
+;   Block functions use a larger frame than the functions above, so their
+;   faults are returned through MemBlock_FAULT
+;
+
+MemBlock_START:
+
+GetBlock:
+        push    ebp
+        mov     ebp, esp
+        push    ebx
+        push    gs
+        push    es
+        push    esi
+        push    edi
+
+        xor     eax, eax                ; Nothing to copy is a success
+        mov     ecx, [ebp + 20]         ; Get the length
+        jecxz   @bad_selector_rk        ; Exit if there is nothing to copy
+
+        ; Perform a sanity check of the selector value
+        mov     eax, MEMACCESS_GPF      ; Assume failure with the access right
+        lar     bx, [ebp + 8]           ; Load access rights of a selector
+        jnz     @bad_selector_rk        ; Exit if the selector is invisible or invalid
+
+        mov     eax, MEMACCESS_LIM      ; Assume failure with the segment limit
+        dec     ecx                     ; Offset of the last byte of the block
+        add     ecx, [ebp + 12]
+        jc      @bad_selector_rk        ; Exit if the block wraps around
+        lsl     ebx, [ebp + 8]          ; Load segment limit into ebx register
+        cmp     ebx, ecx                ; Compare to the last byte requested
+        jb      @bad_selector_rk        ; Exit if the limit is exceeded
+
+        mov     ax, [ebp + 8]           ; Get the selector
+        mov     gs, ax                  ; Store it in the GS
+        mov     esi, [ebp + 12]         ; Source is the offset off that selector
+        mov     edi, [ebp + 16]         ; Destination is our buffer
+        mov     ecx, [ebp + 20]
+        mov     ebx, ecx                ; Keep the byte count
+        shr     ecx, 2                  ; Copy dwords first
+        cld
+
+        ; Access the memory using the GS selector, possibly causing PF or GPF
+        ; since we installed handlers, they will return the correct error code
+
+        gs rep movsd
+        mov     ecx, ebx
+        and     ecx, 3                  ; And then the remaining bytes
+        gs rep movsb
+        xor     eax, eax
+@bad_selector_rk:
+        pop     edi
+        pop     esi
+        pop     es
+        pop     gs
+        pop     ebx
+        pop     ebp
+        ret
+
+;==============================================================================
+;
+;   DWORD SetBlock( WORD sel, DWORD offset, BYTE *pSrc, DWORD len )
+;
+;   Copies a block of memory from the kernel buffer to sel:offset
+;
+;   Where:
+;       [ebp + 8 ]      selector
+;       [ebp + 12 ]     offset
+;       [ebp + 16 ]     source buffer
+;       [ebp + 20 ]     length in bytes
+;
+;   Returns:
+;       0 if the block was copied, or MEMACCESS_* code
+;
+;==============================================================================
+SetBlock:
+        push    ebp
+        mov     ebp, esp
+        push    ebx
+        push    gs
+        push    es
+        push    esi
+        push    edi
+
+        xor     eax, eax                ; Nothing to copy is a success
+        mov     ecx, [ebp + 20]         ; Get the length
+        jecxz   @bad_selector_wk        ; Exit if there is nothing to copy
+
+        ; Perform a sanity check of the selector value
+        mov     eax, MEMACCESS_GPF      ; Assume failure with the access right
+        lar     bx, [ebp + 8]           ; Load access rights of a selector
+        jnz     @bad_selector_wk        ; Exit if the selector is invisible or invalid
+
+        mov     eax, MEMACCESS_LIM      ; Assume failure with the segment limit
+        dec     ecx                     ; Offset of the last byte of the block
+        add     ecx, [ebp + 12]
+        jc      @bad_selector_wk        ; Exit if the block wraps around
+        lsl     ebx, [ebp + 8]          ; Load segment limit into ebx register
+        cmp     ebx, ecx                ; Compare to the last byte requested
+        jb      @bad_selector_wk        ; Exit if the limit is exceeded
+
+        mov     ax, [ebp + 8]           ; Get the selector
+        mov     es, ax                  ; Store it in the ES, the string target
+        mov     esi, [ebp + 16]         ; Source is our buffer
+        mov     edi, [ebp + 12]         ; Destination is the offset off that selector
+        mov     ecx, [ebp + 20]
+        mov     ebx, ecx                ; Keep the byte count
+        shr     ecx, 2                  ; Copy dwords first
+        cld
+
+        ; Access the memory using the ES selector, possibly causing PF or GPF
+        ; since we installed handlers, they will return the correct error code
+
+        rep movsd
+        mov     ecx, ebx
+        and     ecx, 3                  ; And then the remaining bytes
+        rep movsb
+        xor     eax, eax
+@bad_selector_wk:
+MemBlock_FAULT:
+        pop     edi
+        pop     esi
+        pop     es
+        pop     gs
+        pop     ebx
+        pop     ebp
+        ret
+
 MemAccess_END:
         nop
 
@@ -1221,6 +1374,15 @@ GetKernelCS:
 ;   DWORD SpinUntilReset(DWORD *pSpinlock);
 ;   void  SpinlockSet(DWORD *pSpinlock);
 ;   void  SpinlockReset(DWORD *pSpinlock);
+;   DWORD SpinlockTry(DWORD *pSpinlock);
+;
+;   DWORD AtomicIncrement(DWORD *pValue);
+;
+;   SpinlockTry atomically sets the spinlock and returns its previous value,
+;   so it returns 0 if the caller has acquired it.
+;
+;   AtomicIncrement increments a value shared by the CPUs with a locked
+;   instruction and returns its previous value.
 ;
 ;==============================================================================
 
@@ -1265,6 +1427,28 @@ SpinlockTest:
         pop     ebp
         ret
 
+SpinlockTry:
+        push    ebp
+        mov     ebp, esp
+        push    edx
+        mov     edx, [ebp+8]
+        mov     eax, 1
+        xchg    eax, [edx]
+        pop     edx
+        pop     ebp
+        ret
+
+AtomicIncrement:
+        push    ebp
+        mov     ebp, esp
+        push    edx
+        mov     edx, [ebp+8]
+        mov     eax, 1
+        lock xadd [edx], eax
+        pop     edx
+        pop     ebp
+        ret
+
 ;==============================================================================
 ;
 ;   DWORD Checksum2( DWORD start, DWORD end )
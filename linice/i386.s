@@ -58,6 +58,10 @@
 .global SetDWORD
 .global SetByte
 .global MemAccess_FAULT
+.global MemBlock_START
+.global GetBlock
+.global SetBlock
+.global MemBlock_FAULT
 .global MemAccess_END
 
 .global strtolower
@@ -79,6 +83,7 @@
 .global SpinUntilReset
 .global SpinlockSet
 .global SpinlockReset
+.global SpinlockTry
 
 .global GetKernelDS
 .global GetKernelCS
@@ -349,8 +354,8 @@ skip_set_stack:
         addl    $8,%esp                         # Restore esp to what was before the call
 
         cmpl    %ebp,%esp                       # Did we gave it any extra buffer?
-        setzb   fStackLevel                     # Reset the semaphore if we did (first level)
-        jz      skip_reset_stack
+        jz      skip_reset_stack                # Nested (or other CPU) entries leave the semaphore alone
+        movb    $0,fStackLevel                  # Reset the semaphore since we did (first level)
         addl    StackExtraBuffer,%esp           # Move esp to skip the buffer and position to the pRegs
         movl    %esp,%ebp                       # Make ebp and esp the same at this point
 skip_reset_stack:
@@ -904,6 +909,153 @@ MemAccess_FAULT:
         popl    %ebp
         ret
 
+#==============================================================================
+#
+#   DWORD GetBlock( WORD sel, DWORD offset, BYTE *pDest, DWORD len )
+#
+#   Copies a block of memory from sel:offset into the kernel buffer.
+#   The selector and the limit of the whole block are checked once and
+#   the copy is done with a single string move, so the caller should make
+#   sure the pages are present; a fault still returns the error code.
+#
+#   Where:
+#       [ebp + 8 ]      selector
+#       [ebp + 12 ]     offset
+#       [ebp + 16 ]     destination buffer
+#       [ebp + 20 ]     length in bytes
+#
+#   Returns:
+#       0 if the block was copied, or MEMACCESS_* code
+#
+#==============================================================================
+#
+#   Block functions use a larger frame than the functions above, so their
+#   faults are returned through MemBlock_FAULT
+#
+
+MemBlock_START:
+
+GetBlock:
+        pushl   %ebp
+        movl    %esp,%ebp
+        pushl   %ebx
+        pushl   %gs
+        pushl   %es
+        pushl   %esi
+        pushl   %edi
+
+        xorl    %eax,%eax               # Nothing to copy is a success
+        movl    20(%ebp),%ecx           # Get the length
+        jecxz   _bad_selector_rk        # Exit if there is nothing to copy
+
+        # Perform a sanity check of the selector value
+        movl    $MEMACCESS_GPF, %eax    # Assume failure with the access right
+        larw    8(%ebp),%bx             # Load access rights of a selector
+        jnz     _bad_selector_rk        # Exit if the selector is invisible or invalid
+
+        movl    $MEMACCESS_LIM, %eax    # Assume failure with the segment limit
+        decl    %ecx                    # Offset of the last byte of the block
+        addl    12(%ebp),%ecx
+        jc      _bad_selector_rk        # Exit if the block wraps around
+        lsll    8(%ebp),%ebx            # Load segment limit into ebx register
+        cmpl    %ecx,%ebx               # Compare to the last byte requested
+        jb      _bad_selector_rk        # Exit if the limit is exceeded
+
+        movw    8(%ebp),%ax             # Get the selector
+        movw    %ax,%gs                 # Store it in the GS
+        movl    12(%ebp),%esi           # Source is the offset off that selector
+        movl    16(%ebp),%edi           # Destination is our buffer
+        movl    20(%ebp),%ecx
+        movl    %ecx,%ebx               # Keep the byte count
+        shrl    $2,%ecx                 # Copy dwords first
+        cld
+
+        # Access the memory using the GS selector, possibly causing PF or GPF
+        # since we installed handlers, they will return the correct error code
+
+        rep movsl %gs:(%esi),%es:(%edi)
+        movl    %ebx,%ecx
+        andl    $3,%ecx                 # And then the remaining bytes
+        rep movsb %gs:(%esi),%es:(%edi)
+        xorl    %eax,%eax
+_bad_selector_rk:
+        popl    %edi
+        popl    %esi
+        popl    %es
+        popl    %gs
+        popl    %ebx
+        popl    %ebp
+        ret
+
+#==============================================================================
+#
+#   DWORD SetBlock( WORD sel, DWORD offset, BYTE *pSrc, DWORD len )
+#
+#   Copies a block of memory from the kernel buffer to sel:offset
+#
+#   Where:
+#       [ebp + 8 ]      selector
+#       [ebp + 12 ]     offset
+#       [ebp + 16 ]     source buffer
+#       [ebp + 20 ]     length in bytes
+#
+#   Returns:
+#       0 if the block was copied, or MEMACCESS_* code
+#
+#==============================================================================
+SetBlock:
+        pushl   %ebp
+        movl    %esp,%ebp
+        pushl   %ebx
+        pushl   %gs
+        pushl   %es
+        pushl   %esi
+        pushl   %edi
+
+        xorl    %eax,%eax               # Nothing to copy is a success
+        movl    20(%ebp),%ecx           # Get the length
+        jecxz   _bad_selector_wk        # Exit if there is nothing to copy
+
+        # Perform a sanity check of the selector value
+        movl    $MEMACCESS_GPF, %eax    # Assume failure with the access right
+        larw    8(%ebp),%bx             # Load access rights of a selector
+        jnz     _bad_selector_wk        # Exit if the selector is invisible or invalid
+
+        movl    $MEMACCESS_LIM, %eax    # Assume failure with the segment limit
+        decl    %ecx                    # Offset of the last byte of the block
+        addl    12(%ebp),%ecx
+        jc      _bad_selector_wk        # Exit if the block wraps around
+        lsll    8(%ebp),%ebx            # Load segment limit into ebx register
+        cmpl    %ecx,%ebx               # Compare to the last byte requested
+        jb      _bad_selector_wk        # Exit if the limit is exceeded
+
+        movw    8(%ebp),%ax             # Get the selector
+        movw    %ax,%es                 # Store it in the ES, the string target
+        movl    16(%ebp),%esi           # Source is our buffer
+        movl    12(%ebp),%edi           # Destination is the offset off that selector
+        movl    20(%ebp),%ecx
+        movl    %ecx,%ebx               # Keep the byte count
+        shrl    $2,%ecx                 # Copy dwords first
+        cld
+
+        # Access the memory using the ES selector, possibly causing PF or GPF
+        # since we installed handlers, they will return the correct error code
+
+        rep movsl
+        movl    %ebx,%ecx
+        andl    $3,%ecx                 # And then the remaining bytes
+        rep movsb
+        xorl    %eax,%eax
+_bad_selector_wk:
+MemBlock_FAULT:
+        popl    %edi
+        popl    %esi
+        popl    %es
+        popl    %gs
+        popl    %ebx
+        popl    %ebp
+        ret
+
 MemAccess_END:
         nop
 
@@ -1250,6 +1402,10 @@ GetKernelCS:
 #   DWORD SpinUntilReset(DWORD *pSpinlock);
 #   void  SpinlockSet(DWORD *pSpinlock);
 #   void  SpinlockReset(DWORD *pSpinlock);
+#   DWORD SpinlockTry(DWORD *pSpinlock);
+#
+#   SpinlockTry atomically sets the spinlock and returns its previous value,
+#   so it returns 0 if the caller has acquired it.
 #
 #==============================================================================
 
@@ -1294,6 +1450,17 @@ SpinlockTest:
         popl    %ebp
         ret
 
+SpinlockTry:
+        pushl   %ebp
+        movl    %esp,%ebp
+        pushl   %edx
+        movl    8(%ebp),%edx
+        movl    $1,%eax
+        xchgl   %eax,(%edx)
+        popl    %edx
+        popl    %ebp
+        ret
+
 #==============================================================================
 #
 #   DWORD Checksum2( DWORD start, DWORD end )
@@ -66,6 +66,58 @@
 *                                                                             *
 ******************************************************************************/
 
+/////////////////////////////////////////////////////////////////
+// PER-CPU STATE
+/////////////////////////////////////////////////////////////////
+// When the debugger is entered, every other CPU publishes its state here
+// before it starts spinning
+
+typedef struct
+{
+    BOOL fValid;                        // The state has been published for this break
+    PTREGS pRegs;                       // Registers to use (live frame on the debugger CPU)
+    TREGS r;                            // Register snapshot of a spinning CPU
+    TSysreg sysReg;                     // System registers of that CPU
+    void *pTask;                        // Task that was running on that CPU
+    BOOL fNmiPending;                   // We sent this CPU a freeze NMI that it did not take yet
+    ENUM eStop;                         // How did this CPU stop:
+#   define STOP_BREAK       0           // It broke into the debugger
+#   define STOP_IPI         1           // Call-function IPI
+#   define STOP_NMI         2           // NMI IPI
+    DWORD dwLatency;                    // TSC cycles from the debugger entry to stop (0 if late)
+
+} TCPU, *PTCPU;
+
+/////////////////////////////////////////////////////////////////
+// PER-CPU STATISTICS
+/////////////////////////////////////////////////////////////////
+// Counters exported through /proc/linice. Each CPU only updates its own
+// slot; the counters bumped from within the debugger use the debugger CPU
+
+typedef struct
+{
+    UINT nIntsPass[0x40];               // Number of interrupts received
+    UINT nIntsIce[0x40];                // While debugger run
+    UINT nEntries;                      // Number of debugger entries
+    DWORD Cycles[2];                    // TSC cycles spent inside the debugger (64 bit)
+    UINT nBpHits;                       // Breakpoint hits
+    UINT nBpMisses;                     // Breakpoint hits that continued the debugee
+    UINT nBpLogged;                     // Breakpoint hits that were only logged
+    UINT nSymLookups;                   // Address to symbol name lookups
+    UINT nSymFinds;                     // Symbol name to address lookups
+    UINT nSerialSent;                   // Bytes sent over the serial port
+    UINT nSerialReceived;               // Bytes received over the serial port
+    UINT nSerialErrors;                 // Serial line errors (overrun, parity, framing, break)
+
+} TSTAT, *PTSTAT;
+
+// 64 bit cycle counts are kept as two dwords, the low one first. Adds a 64 bit
+// value given as its low and high dword; the low one is evaluated twice
+
+#define ADD_CYCLES(sum, lo, hi)     ((sum)[0] += (lo), (sum)[1] += (hi) + ((sum)[0] < (lo)))
+
+extern DWORD AvgCycles(DWORD *pSum, DWORD n);
+
 /////////////////////////////////////////////////////////////////
 // THE MAIN DEBUGGER STRUCTURE
 /////////////////////////////////////////////////////////////////
@@ -122,6 +174,7 @@ typedef struct
 
     BOOL fRedraw;                       // Request to redraw the screen after the current command
     BOOL fPfProtect;                    // Safety optional switch to ignore PF from the Linice
+    BOOL fNmiFreeze;                    // Use NMI IPI to stop other CPUs on the debugger entry
 
     // Define the Linice high-level data structures and pointers
 
@@ -170,6 +223,8 @@ typedef struct
     BOOL fStep;                         // Step command in progress
     BOOL fStepRet;                      // Single step until RET instruction (P RET)
     BOOL fSrcStep;                      // Source is on and we issued a step command (P)
+    UINT nTraceSteps;                   // Trace steps taken since the debugger was left
+    DWORD TraceTsc[2];                  // TSC at the time the debugger was left
 
     // Define the current context evaluated at the time of break
 
@@ -180,6 +235,11 @@ typedef struct
     TSysreg sysReg;                     // System registers
 
     UINT cpu;                           // CPU number that the debugger uses
+    UINT cpuCur;                        // CPU whose state is currently displayed
+    TCPU Cpu[MAX_CPU];                  // State of all CPUs at the time of break
+    BOOL fNmiFreezing;                  // Other CPUs are being stopped by NMI
+    DWORD dwEntryTsc;                   // TSC (low) at the debugger entry
+    DWORD dwFreezeLatency;              // TSC cycles from the debugger entry until all CPUs stopped
     UINT nInterrupt;                    // Interrupt that occurred
     int bpIndex;                        // Index of the breakpoint that hit (default -1)
 
@@ -195,15 +255,13 @@ typedef struct
 
     // Statistics and timing variables
 
-    UINT nIntsPass[0x40];               // Number of interrupts received
-    UINT nIntsIce[0x40];                // While debugger run
+    TSTAT Stat[MAX_CPU];                // Per-CPU statistics
 
     // Timers - decremented by the timer interrupt down to zero
     //  0 - serial polling
     //  1 - cursor carret blink
-    UINT timer[2];
-
-    DWORD LiniceChecksum;               // Checksum of the Linice code (or SUM)
+    //  2 - background image integrity check
+    UINT timer[3];
 
 } TDEB, *PTDEB;
 
@@ -261,6 +319,48 @@ typedef struct
 extern TCommand Cmd[];                  // Command structure array
 extern char *sHelp[];                   // Help lines
 
+/////////////////////////////////////////////////////////////////
+// VIRTUAL WATCHPOINT STATISTICS
+/////////////////////////////////////////////////////////////////
+// Overhead of a memory breakpoint watched by page protection
+
+typedef struct
+{
+    DWORD Faults;                       // Page faults taken on its page
+    DWORD Matches;                      // Faults that accessed its range
+    DWORD Cycles[2];                    // Cycles spent handling the faults (64 bit)
+
+} TWATCHSTAT;
+
+// Return values of WatchTrap()
+
+#define WATCH_RESUME        0           // Trap handled, continue the debugee
+#define WATCH_CHAIN         1           // Not ours, chain to the kernel handler
+#define WATCH_ENTER         2           // Enter the debugger
+
+/////////////////////////////////////////////////////////////////
+// STACK UNWIND STATE
+/////////////////////////////////////////////////////////////////
+// Registers of a stack frame being unwound by UnwindFrame()
+
+typedef struct
+{
+    DWORD eip;                          // Code address of the frame
+    DWORD esp;                          // Stack pointer of the frame, 0 if not known
+    DWORD ebp;                          // Frame pointer register
+    DWORD dwFrame;                      // Address of the return address slot minus 4
+    DWORD dwLow, dwHigh;                // Stack range to read directly, or 0 to use ss
+    BOOL fCaller;                       // The eip is a return address
+
+} TUNWIND, *PTUNWIND;
+
+// Return values of UnwindFrame()
+
+#define UNWIND_END          0           // No more frames
+#define UNWIND_BY_CFI       1           // Unwound by the call frame information
+#define UNWIND_BY_EBP       2           // Unwound by the frame pointer chain
+#define UNWIND_BY_SCAN      3           // Return address found by scanning the stack
+
 /////////////////////////////////////////////////////////////////
 // INTERNAL MOUSE PACKET STRUCTURE
 /////////////////////////////////////////////////////////////////
@@ -289,6 +389,7 @@ typedef struct
     void (*mouse)(int, int);            // Function that displays mouse cursor
     void (*carret)(BOOL fOn);           // Cursor (carret) callback
     BOOL (*resize)(int, int, int);      // Resize window command
+    void (*flush)(void);                // Show what was drawn so far (optional)
 
 } TOUT, *PTOUT;
 
@@ -330,6 +431,7 @@ extern int dprint( char *format, ... );
 extern BOOL dprinth( int nLineCount, char *format, ... );
 extern int PrintLine(char *format,...);
 extern void dputc(UCHAR c);
+extern void dflush(void);
 
 extern void RegDraw(BOOL fForce);
 extern void LocalsDraw(BOOL fForce);
@@ -347,6 +449,7 @@ extern DWORD HistoryDisplay(DWORD hView, int nDir);
 extern DWORD HistoryGetTop(void);
 extern void HistoryAdd(char *sLine);
 extern void ClearHistory(void);
+extern void HistoryInit(void);
 
 //----------------------------------------------------------------------------
 // Memory and IO access functions
@@ -374,9 +477,13 @@ extern BYTE AddrGetByte(PTADDRDESC pAddr);
 extern DWORD AddrGetDword(PTADDRDESC pAddr);
 extern void  AddrSetDword(PTADDRDESC pAddr, DWORD value);
 extern DWORD AddrSetByte(PTADDRDESC pAddr, BYTE value, BOOL fForce);
+extern UINT AddrReadBlock(PTADDRDESC pAddr, BYTE *pBuf, UINT nLen);
+extern UINT AddrWriteBlock(PTADDRDESC pAddr, BYTE *pBuf, UINT nLen, BOOL fForce);
 extern BOOL VerifyRange(PTADDRDESC pAddr, DWORD dwSize);
 extern BOOL VerifySelector(WORD Sel);
 extern BOOL GlobalReadBYTE(BYTE *pByte, DWORD dwAddress);
+extern void ImageChecksumInit(void);
+extern BOOL ImageVerify(UINT nBlocks);
 
 //----------------------------------------------------------------------------
 // Command parser helper functions
@@ -397,12 +504,24 @@ extern void *SymTabFindSection(TSYMTAB *pSymTab, BYTE hType);
 extern void *SymTabFindSectionNext(TSYMTAB *pSymTab, void *pCur, BYTE hType);
 extern TSYMSOURCE *SymTabFindSource(TSYMTAB *pSymTab, WORD fileID);
 extern TSYMTYPEDEF *SymTabFindTypedef(TSYMTAB *pSymTab, WORD fileID);
+extern TSYMHEADER *SymTabMakePointers(TSYMTAB *pSymTab, TSYMHEADER *pHead);
+extern int SymTabReloc(TSYMTAB *pSymTab, BYTE bSegment);
+extern TSYMUNWIND *SymTabUnwind(TSYMTAB *pSymTab, int *pDelta);
+extern BOOL SymTabTryLock(void);
+extern void SymTabUnlock(void);
+
+// Sections whose string offsets have not yet been converted into pointers are
+// marked with a private bit in their type; compare section types using SECTYPE()
+#define HTYPE_RAW               0x80    // Section still contains string offsets
+#define SECTYPE(pHead)          (((TSYMHEADER *)(pHead))->hType & ~HTYPE_RAW)
+
 extern char *SymAddress2Name(DWORD dwOffset, UINT *pRange);
 
 extern DWORD SymLinNum2Address(DWORD line);
 extern TSYMFNLIN *SymAddress2FnLin(WORD wSel, DWORD dwOffset);
 extern char *SymFnLin2Line(WORD *pLineNumber, TSYMFNLIN *pFnLin, DWORD dwAddress);
 extern char *SymFnLin2LineExact(WORD *pLineNumber, TSYMFNLIN *pFnLin, DWORD dwAddress);
+extern BOOL SymFnLin2LineRange(TSYMFNLIN *pFnLin, DWORD dwAddress, DWORD *pStart, DWORD *pEnd);
 extern TSYMFNSCOPE *SymAddress2FnScope(WORD wSel, DWORD dwOffset);
 
 extern void SetSymbolContext(WORD wSel, DWORD dwOffset);
@@ -417,6 +536,10 @@ extern void ListDelAll(TLIST *pList);
 extern TLISTITEM *ListGetNewItem(void);
 extern BOOL ListFindItem(TLIST *pList, TExItem *pExItem);
 extern TLISTITEM *ListGetNext(TLIST *pList, TLISTITEM *pItem);
+extern void ListEvaluate(TLIST *pList);
+extern void ListClearChanged(TLIST *pList);
+extern BOOL ListSameContext(TLIST *pList);
+extern void ListResetContext(TLIST *pList);
 
 //----------------------------------------------------------------------------
 // Miscellaneous
@@ -498,6 +498,11 @@ typedef struct
 #define GET_DR7(_reg)    __asm__("movl %%dr7,%0":"=r" (_reg));
 #define SET_DR7(_reg)    __asm__("movl %0,%%dr7"::"r" (_reg) );
 
+#define RDMSR(_msr,_lo,_hi) __asm__ __volatile__("rdmsr":"=a" (_lo), "=d" (_hi):"c" (_msr));
+#define WRMSR(_msr,_lo,_hi) __asm__ __volatile__("wrmsr"::"c" (_msr), "a" (_lo), "d" (_hi));
+
+#define INVLPG(_addr)    __asm__ __volatile__("invlpg (%0)"::"r" (_addr) : "memory");
+
 #define INT1()           __asm__("int $1" ::);
 #define INT3()           __asm__("int $3" ::);
 
@@ -528,6 +533,14 @@ extern void GetIDT(TDescriptor *p);
 
 #define INT(x)
 
+#define RDMSR(_msr,_lo,_hi) { (_lo) = (_hi) = 0; }
+#define WRMSR(_msr,_lo,_hi)
+
+#define INVLPG(_addr)
+#define GET_CR2(_reg)    { (_reg) = 0; }
+#define GET_DR6(_reg)    { (_reg) = 0; }
+#define SET_DR6(_reg)
+
 #endif // SIM
 
 // Restore packing value
@@ -56,6 +56,7 @@ typedef struct
     struct TLISTITEM *pNext;            // Pointer to the next variable item
     struct TLISTITEM *pElement;         // Pointer to the (expanded) element
     BOOL fCanDelete;                    // This list item can be deleted by the user
+    BOOL fChanged;                      // Value changed since the debugger was entered
     UINT nLevel;                        // Level of expansion for right shift
     //-----------------------------------------------------------------------
     // Element information
@@ -85,6 +86,12 @@ typedef struct
     DWORD nXOffset;                     // Printing offset to the right
     BOOL fInFocus;                      // Highlight the pSelected line
 
+    // Symbol context that the root items were evaluated in
+    TSYMTAB *pSymTab;                   // Current symbol table
+    TSYMFNSCOPE *pFnScope;              // Function scope
+    PTREGS pRegs;                       // Register frame
+    DWORD dwFrame;                      // Frame pointer
+
 } TLIST;
 
 #define LIST_ID_WATCH       0x00        // Watch list
@@ -76,6 +76,7 @@ extern TOUT outVga;
 
 extern void CommandBuildHelpIndex();
 extern void VgaInit();
+extern int FbInit(void);
 extern void VgaSprint(char *s);
 extern void InterruptInit();
 extern void HookDebuger();
@@ -143,7 +144,7 @@ int InitPacket(PTINITPACKET pInit)
                 // Initialize history buffer so we can start using it
 
                 deb.nHistorySize = pInit->nHistorySize;
-                ClearHistory();
+                HistoryInit();
 
                 // Link the VGA to be the initial output device
 
@@ -207,6 +208,12 @@ int InitPacket(PTINITPACKET pInit)
 
                 deb.nXDrawSize = pInit->nDrawSize;
 
+                // Set up the kernel framebuffer, if there is one, while we
+                // can still allocate and map memory. The output stays on the
+                // VGA until the user switches to it with the XWIN command.
+
+                FbInit();
+
                 // Initialize interrupt handling subsystem
 
                 InterruptInit();
@@ -105,6 +105,10 @@ WCHAR GetKey( BOOL fBlock )
     BOOL fCarret;                       // Cursor carret on/off state
     WCHAR c;
 
+    // Whatever was printed has to be visible before we look for a key
+    if( pOut )
+        dflush();
+
     // There are two distinct ways to handle input depending on polling or not
 
     if( fBlock )
@@ -129,6 +133,14 @@ WCHAR GetKey( BOOL fBlock )
                 if( pOut && pOut->carret )
                     (pOut->carret)(fCarret = !fCarret);
             }
+
+            // While idle, keep verifying the Linice code image a few blocks at a time
+            if( deb.timer[2]==0 )
+            {
+                deb.timer[2] = TIMER_IMAGE;
+
+                ImageVerify(IMAGE_VERIFY_BLOCKS);
+            }
         }
 
         // Turn the cursor (carret) off
@@ -103,12 +103,16 @@ extern DWORD switchto;                  // Address of the kernel's __switch_to()
 extern void MemAccess_START();
 extern void MemAccess_END();
 extern void MemAccess_FAULT();
+extern void MemBlock_START();
+extern void MemBlock_FAULT();
 
 extern DWORD IceIntHandlers[0x30];
 extern DWORD IceIntHandler80;
 
 extern void DebuggerEnterBreak(void);
 extern void DebuggerEnterDelayedArm(void);
+extern void BreakpointProfile(void);
+extern void ProfileSample(PTREGS pRegs);
 
 // From apic.c
 
@@ -118,6 +122,14 @@ extern int ReverseMapIrq(int nInt);
 extern void IoApicClamp(int cpu);
 extern void IoApicUnclamp();
 extern void smpSpinOtherCpus(void);
+extern BOOL smpNmiFreeze(PTREGS pRegs);
+
+extern DWORD GetRdtsc(BYTE *buffer8);
+
+// From vwatch.c
+
+extern BOOL WatchArmed(void);
+extern UINT WatchTrap(DWORD nInt, PTREGS pRegs);
 
 /******************************************************************************
 *                                                                             *
@@ -230,6 +242,12 @@ void HookDebuger(void)
 //    HookIdt(pIdt, 0x0E, 0xE);          // Page fault
     HookIdt(pIdt, 0x20, 0x20);         // PIT
 
+    // Page fault is hooked only while some pages are watched by protection.
+    // Those faults are handled without entering the debugger; all others are
+    // simply chained to the kernel handler
+    if( WatchArmed() )
+        HookIdt(pIdt, 0x0E, 0xE);      // Page fault
+
 //    HookIdt(pIdt, 0x21, 0x21);         // Keyboard
 //    HookIdt(pIdt, 0x23, 0x23);         // COM2
 //    HookIdt(pIdt, 0x24, 0x24);         // COM1
@@ -238,6 +256,26 @@ void HookDebuger(void)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   void HookNmi(void)                                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Hooks the NMI entry of the Linux IDT so we can stop other CPUs with an
+*   NMI IPI. NMIs that are not ours are chained to the kernel handler. The
+*   entry is restored along with the rest of the IDT on the next debugger
+*   entry, so a late freeze NMI is still caught by us and dropped.
+*
+******************************************************************************/
+void HookNmi(void)
+{
+    PTIDT_Gate pIdt = (PTIDT_Gate) deb.idt.base;
+
+    HookIdt(pIdt, 0x02, 0x2);          // NMI
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   void UnHookDebuger(void)                                                  *
@@ -316,6 +354,9 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
     //------------------------------------------------------------------------
     DWORD chain;
     BYTE savePIC1 = 0;
+    BYTE Tsc[8], TscExit[8];
+    DWORD lo, hi;
+    UINT cpu;
 
     // If it is an embedded INT3 (0xCC) at the address of the hooked task switcher,
     // Simply call our function followed by the return to our buffer where we kept
@@ -329,6 +370,29 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
         return( 0 );
     }
 
+    // NMI is hooked only to stop other CPUs on the debugger entry
+    if( nInt==0x02 )
+    {
+        if( smpNmiFreeze(pRegs) )
+            return( 0 );
+
+        return( GET_IDT_BASE( &LinuxIdt[0x02] ) );
+    }
+
+    // Page faults on the pages watched by protection and the single steps over
+    // those accesses are handled here unless a watched range was accessed
+    if( (nInt==0x0E || nInt==0x01) && !SpinlockTest(&deb.fRunningIce) )
+    {
+        switch( WatchTrap(nInt, pRegs) )
+        {
+            case WATCH_RESUME:
+                return( 0 );
+
+            case WATCH_CHAIN:
+                return( GET_IDT_BASE( &LinuxIdt[0x0E] ) );
+        }
+    }
+
     // Depending on the execution context, branch
 
     if( SpinlockTest(&deb.fRunningIce) )
@@ -338,7 +402,7 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
         //---------------------------------------------
         chain = 0;                      // By default, do not chain from this handler
 
-        deb.nIntsIce[nInt & 0x3F]++;
+        deb.Stat[deb.cpu].nIntsIce[nInt & 0x3F]++;
 
         // Handle some limited number of interrupts, puke on the rest
 
@@ -350,6 +414,7 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
                 // Put all required timers here
                 if( deb.timer[0] )   deb.timer[0]--;        // Serial polling
                 if( deb.timer[1] )   deb.timer[1]--;        // Cursor carret blink
+                if( deb.timer[2] )   deb.timer[2]--;        // Image integrity check
                 break;
 
             case 0x21:      // Keyboard interrupt
@@ -372,14 +437,14 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
 
             case 0x0E:      // PAGE FAULT - we handle internal page faults
                             // from the very specific functions differently:
-                            //  GetByte() and GetDWORD()
+                            //  GetByte(), GetDWORD() and the block copies
                 if( (pRegs->eip > (DWORD)MemAccess_START) && (pRegs->eip < (DWORD)MemAccess_END) )
                 {
                     // Set the default value for invalid data / page fault into eax and
                     // position EIP to the function epilogue
 
                     pRegs->eax = MEMACCESS_PF;          // Page not present error code
-                    pRegs->eip = (DWORD)MemAccess_FAULT;
+                    pRegs->eip = (pRegs->eip > (DWORD)MemBlock_START)? (DWORD)MemBlock_FAULT : (DWORD)MemAccess_FAULT;
 
                     break;
                 }
@@ -400,14 +465,14 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
 
             case 0x0D:      // GP FAULT - we handle internal GP faults
                             // from the very specific functions differently:
-                            //  GetByte() and GetDWORD()
+                            //  GetByte(), GetDWORD() and the block copies
                 if( (pRegs->eip > (DWORD)MemAccess_START) && (pRegs->eip < (DWORD)MemAccess_END) )
                 {
                     // Set the default value for invalid data into eax and
                     // position EIP to the function epilogue
 
                     pRegs->eax = MEMACCESS_GPF;         // Invalid selector error code
-                    pRegs->eip = (DWORD)MemAccess_FAULT;
+                    pRegs->eip = (pRegs->eip > (DWORD)MemBlock_START)? (DWORD)MemBlock_FAULT : (DWORD)MemAccess_FAULT;
 
                     break;
                 }
@@ -435,10 +500,16 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
         //---------------------------------------------
         //  Exception occurred during the debugee run
         //---------------------------------------------
-        deb.nIntsPass[nInt & 0x3F]++;
+        cpu = ice_smp_processor_id();
+        if( cpu < MAX_CPU )
+            deb.Stat[cpu].nIntsPass[nInt & 0x3F]++;
 
         chain = GET_IDT_BASE( &LinuxIdt[ReverseMapIrq(nInt)] );
 
+        // Timer interrupts feed the profiler, if it is on
+        if( nInt==0x20 )
+            ProfileSample(pRegs);
+
         // We break into the debugger for all interrupts except the
         // timer, in which case we need to check for the keyboard activation flag
 
@@ -447,6 +518,9 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
             // Store the CPU number that we happen to be using
             deb.cpu = ice_smp_processor_id();
 
+            // Timestamp the entry so we can measure how long it takes to stop other CPUs
+            deb.dwEntryTsc = GetRdtsc(Tsc);
+
             // Limit all IRQ's to the current CPU
             IoApicClamp( deb.cpu );
 
@@ -532,10 +606,24 @@ DWORD InterruptHandler( DWORD nInt, PTREGS pRegs )
 
                 // Restore system registers
                 SetSysreg(&deb.sysReg);
+
+                // Account the trap path of a breakpoint that did not pop up
+                BreakpointProfile();
+
+                // Add the time spent in the debugger to its 64 bit total
+                GetRdtsc(TscExit);
+                lo = *(DWORD *)&TscExit[0] - *(DWORD *)&Tsc[0];
+                hi = *(DWORD *)&TscExit[4] - *(DWORD *)&Tsc[4] - (lo > *(DWORD *)&TscExit[0]);
+
+                deb.Stat[deb.cpu].nEntries++;
+                ADD_CYCLES(deb.Stat[deb.cpu].Cycles, lo, hi);
             }
 
             chain = 0;          // Continue into the debugee, do not chain
 
+            // Any freeze NMI that did not make it in time will now be dropped
+            deb.fNmiFreezing = FALSE;
+
             SpinlockReset(&deb.fRunningIce);
 
             IoApicUnclamp();
@@ -81,6 +81,16 @@ typedef struct                          // Free node structure
 
 #define HEADER_SIZE     sizeof(Tmalloc) // Define header size constant
 
+typedef struct                          // Heap header
+{
+    Tmalloc head;                       // Sentinel of the free list
+    DWORD used;                         // Bytes currently allocated
+    DWORD maxUsed;                      // High-water mark of the allocated bytes
+
+} THeap;
+
+#define TH              (THeap *)
+
 
 /******************************************************************************
 *                                                                             *
@@ -147,16 +157,20 @@ static BYTE * _Init_Alloc( BYTE *pRamStart, DWORD dwRamSize )
         return( NULL );
 
     // Set the dummy free structure at the beginning of the free block to
-    // easily traverse the linked list (a sentinel)
+    // easily traverse the linked list (a sentinel). It is a part of the
+    // heap header that also keeps the usage statistics
 
     pMalloc = TM(pRamStart);            // Get the buffer start
     pFree = (char*)pMalloc;             // Set the free list beginning
 
     pMalloc->size = 0;                  // No one can request that much!
-    pMalloc->next = STM(pMalloc + 1);   // Next structure immediately follows
+    pMalloc->next = STM(TH(pRamStart) + 1); // Next structure follows the header
+
+    (TH(pRamStart))->used = 0;
+    (TH(pRamStart))->maxUsed = 0;
 
     pMalloc = TM(pMalloc->next);        // Next free block header
-    pMalloc->size = dwRamSize - HEADER_SIZE; // That's how much is really free
+    pMalloc->size = dwRamSize - sizeof(THeap); // That's how much is really free
     pMalloc->next = NULL;               // Last block in the list
 
     // Return the address of a heap that is now initialized
@@ -214,6 +228,64 @@ void memFreeHeap(BYTE *hHeap)
     ice_vfree((char *) hHeap);
 }
 
+/******************************************************************************
+*                                                                             *
+*   static void HeapAccount(THeap *pHeader, DWORD size)                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Adds a newly allocated block to the heap usage and updates its high-water
+*   mark.
+*
+******************************************************************************/
+static void HeapAccount(THeap *pHeader, DWORD size)
+{
+    pHeader->used += size;
+
+    if( pHeader->used > pHeader->maxUsed )
+        pHeader->maxUsed = pHeader->used;
+}
+
+/******************************************************************************
+*                                                                             *
+*   void HeapStat(BYTE *pHeap, DWORD *pUsed, DWORD *pMaxUsed)                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the usage of a heap, including the block headers.
+*
+*   Where:
+*       pHeap is the requested heap (can be NULL)
+*       pUsed is the address to store the number of bytes currently allocated
+*       pMaxUsed is the address to store the high-water mark
+*
+******************************************************************************/
+void HeapStat(BYTE *pHeap, DWORD *pUsed, DWORD *pMaxUsed)
+{
+    *pUsed = *pMaxUsed = 0;
+
+    if( pHeap )
+    {
+        *pUsed = (TH(pHeap))->used;
+        *pMaxUsed = (TH(pHeap))->maxUsed;
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void HeapStatReset(BYTE *pHeap)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Restarts the high-water mark of a heap from its current usage.
+*
+******************************************************************************/
+void HeapStatReset(BYTE *pHeap)
+{
+    if( pHeap )
+        (TH(pHeap))->maxUsed = (TH(pHeap))->used;
+}
+
 /******************************************************************************
 *                                                                             *
 *   char *mallocHeap(BYTE *pHeap, UINT size)                                  *
@@ -296,6 +368,8 @@ char *mallocHeap(BYTE *pHeap, UINT size)
          pNew->size = size;                     // Set the allocated block size
          pNew->next = STM(MALLOC_COOKIE);       // And the debug cookie
 
+         HeapAccount(TH(pHeap), size);
+
          return (void*)((int)pNew + HEADER_SIZE);
     }
     else
@@ -309,6 +383,8 @@ char *mallocHeap(BYTE *pHeap, UINT size)
 
          pNew->next = STM(MALLOC_COOKIE);       // Set the debug cookie
 
+         HeapAccount(TH(pHeap), pNew->size);
+
          return (void*)((int)pNew + HEADER_SIZE);
     }
 }
@@ -356,6 +432,8 @@ void freeHeap(BYTE *pHeap, void *mPtr )
         return;
     }
 
+    (TH(pHeap))->used -= pMalloc->size;
+
     // Now we have to return the block to the list of free blocks, so find the
     // place in the list to insert it.  The free list is ordered by the address
     // of the blocks that it holds
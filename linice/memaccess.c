@@ -43,6 +43,7 @@
 #include "module-header.h"              // Versatile module header file
 
 #include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
 #include "ice.h"                        // Include main debugger structures
 
 /******************************************************************************
@@ -73,9 +74,23 @@ typedef struct
 
 static TSTAMP Stamp;
 
+// Linice code image is checksummed in blocks so it can be verified a few
+// blocks at a time; writes that we do ourselves are folded into the sums
+
+static DWORD ImageSum[MAX_IMAGE_BLOCKS];// Checksum of each block of the image
+static DWORD dwImageStart;              // Start address of the image
+static DWORD dwImageSize;               // Size of the image in bytes
+static UINT nImageBlockShift;           // Block size as a power of 2
+static UINT nImageBlocks;               // Number of blocks in use
+static UINT nImageNext;                 // Next block to verify in rotation
+static BOOL fImageCorrupt;              // A block was found not to match
+
 #define CHECK_NOSELF(p)             (p)
 #define CHECK_OEM(p)                (p)
 
+#define PTE_PRESENT         0x001       // Page table entry: page is present
+#define PDE_PS              0x080       // Page directory entry: 4Mb page
+
 /******************************************************************************
 *                                                                             *
 *   Functions                                                                 *
@@ -83,6 +98,7 @@ static TSTAMP Stamp;
 ******************************************************************************/
 
 BYTE ComputeChecksum(BYTE *pMem, UINT size);
+static void ImageTrackWrite(DWORD dwAddress, UINT nSize, BOOL fWritten);
 BOOL GlobalReadBYTE(BYTE *pByte, DWORD dwAddress);
 
 // These functions should be called only from this module; all memory access
@@ -92,6 +108,8 @@ extern DWORD SetByte(WORD sel, DWORD offset, BYTE value);
 extern DWORD GetByte(WORD sel, DWORD offset);
 extern void  SetDWORD(WORD sel, DWORD offset, DWORD value);
 extern DWORD GetDWORD(WORD sel, DWORD offset);
+extern DWORD GetBlock(WORD sel, DWORD offset, BYTE *pDest, DWORD len);
+extern DWORD SetBlock(WORD sel, DWORD offset, BYTE *pSrc, DWORD len);
 
 //------------------------------- Protection ---------------------------------
 // These function should be placed in this order:
@@ -152,7 +170,11 @@ DWORD AddrGetDword(PTADDRDESC pAddr)
 ******************************************************************************/
 void AddrSetDword(PTADDRDESC pAddr, DWORD dwValue)
 {
+    ImageTrackWrite(pAddr->offset, sizeof(DWORD), FALSE);
+
     SetDWORD(pAddr->sel, CHECK_OEM(CHECK_NOSELF(pAddr->offset)), dwValue);
+
+    ImageTrackWrite(pAddr->offset, sizeof(DWORD), TRUE);
 }
 
 /******************************************************************************
@@ -217,18 +239,12 @@ BOOL GlobalReadBYTE(BYTE *pByte, DWORD dwAddress)
 ******************************************************************************/
 BOOL GlobalReadMem(BYTE *pBuf, DWORD dwAddress, UINT nLen)
 {
-    memset(pBuf, 0xFF, nLen);
-
-    while( nLen-- )
-    {
-        if( !GlobalReadBYTE(pBuf, dwAddress) )
-            return( FALSE );
+    TADDRDESC Addr;                     // Address access descriptor
 
-        pBuf++;
-        dwAddress++;
-    }
+    Addr.sel = GetKernelDS();
+    Addr.offset = dwAddress;
 
-    return( TRUE );
+    return( AddrReadBlock(&Addr, pBuf, nLen)==nLen );
 }
 
 /******************************************************************************
@@ -240,6 +256,10 @@ DWORD AddrSetByte(PTADDRDESC pAddr, BYTE value, BOOL fForce)
     DWORD Access;
     TGDT_Gate *pGdt;
 
+    // Writing into our own code (like placing a breakpoint) needs to keep the
+    // image checksums current. Kernel segments are flat, so offset is linear
+    ImageTrackWrite(pAddr->offset, sizeof(BYTE), FALSE);
+
     deb.memaccess = SetByte(pAddr->sel, CHECK_NOSELF(pAddr->offset), value);
 
     // If the set memory failed, and we really wanted to override
@@ -260,9 +280,186 @@ DWORD AddrSetByte(PTADDRDESC pAddr, BYTE value, BOOL fForce)
         }
     }
 
+    ImageTrackWrite(pAddr->offset, sizeof(BYTE), TRUE);
+
     return( deb.memaccess );
 }
 
+/******************************************************************************
+*                                                                             *
+*   static BOOL BlockPagePresent(WORD sel, DWORD dwOffset)                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks if the page holding an address is present. For the GDT selectors
+*   the page tables are looked up, so the page itself is not touched; the
+*   page table entries are read through the guarded access and if that
+*   does not work (PAE, page tables in high memory), we probe the address.
+*
+*   Where:
+*       sel is the selector
+*       dwOffset is the offset of any byte within the page
+*
+*   Returns:
+*       TRUE - page is present
+*       FALSE - page is not present
+*
+******************************************************************************/
+static BOOL BlockPagePresent(WORD sel, DWORD dwOffset)
+{
+    TADDRDESC Addr;
+    TGDT_Gate *pGdt;
+    DWORD dwLinear;                     // Linear address of the page
+    DWORD pde, pte;                     // Page directory and page table entries
+
+    if( !(sel & 4) && !(deb.sysReg.cr4 & BITMASK(PAE_BIT)) )
+    {
+        pGdt = (TGDT_Gate *) (deb.gdt.base + (sel & ~7));
+        dwLinear = GET_GDT_BASE(pGdt) + dwOffset;
+
+        if( GlobalReadDword(&pde, ice_page_offset() + (deb.sysReg.cr3 & ~0xFFF) + (dwLinear >> 22) * sizeof(DWORD)) )
+        {
+            if( !(pde & PTE_PRESENT) )
+                return( FALSE );
+
+            if( pde & PDE_PS )
+                return( TRUE );
+
+            if( GlobalReadDword(&pte, ice_page_offset() + (pde & ~0xFFF) + ((dwLinear >> 12) & 1023) * sizeof(DWORD)) )
+                return( (pte & PTE_PRESENT)? TRUE : FALSE );
+        }
+    }
+
+    Addr.sel = sel;
+    Addr.offset = dwOffset;
+
+    return( AddrIsPresent(&Addr) );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static UINT BlockSpan(PTADDRDESC pAddr, UINT nLen)                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the number of bytes at the start of a block that are on the
+*   present pages. Every page is checked only once.
+*
+******************************************************************************/
+static UINT BlockSpan(PTADDRDESC pAddr, UINT nLen)
+{
+    UINT nSpan = 0;                     // Bytes on the present pages so far
+
+    if( SelLAR(pAddr->sel)==0 )
+    {
+        deb.memaccess = MEMACCESS_GPF;
+
+        return( 0 );
+    }
+
+    while( nSpan < nLen && BlockPagePresent(pAddr->sel, pAddr->offset + nSpan) )
+        nSpan += MIN(4096 - ((pAddr->offset + nSpan) & 0xFFF), nLen - nSpan);
+
+    deb.memaccess = nSpan < nLen? MEMACCESS_PF : 0;
+
+    return( nSpan );
+}
+
+/******************************************************************************
+*                                                                             *
+*   UINT AddrReadBlock(PTADDRDESC pAddr, BYTE *pBuf, UINT nLen)               *
+*                                                                             *
+*******************************************************************************
+*
+*   Reads a block of memory. The read stops at the first page that is not
+*   present; the bytes that could not be read are set to 0xFF. The result
+*   of the access is left in deb.memaccess.
+*
+*   Where:
+*       pAddr is the address to read from
+*       pBuf is the buffer to receive the data
+*       nLen is the number of bytes to read
+*
+*   Returns:
+*       Number of bytes read
+*
+******************************************************************************/
+UINT AddrReadBlock(PTADDRDESC pAddr, BYTE *pBuf, UINT nLen)
+{
+    DWORD Access;                       // Result of the access
+    UINT nSpan;                         // Number of bytes that we can read
+
+    nSpan = BlockSpan(pAddr, nLen);
+    Access = deb.memaccess;
+
+    if( nSpan && GetBlock(pAddr->sel, pAddr->offset, pBuf, nSpan) )
+    {
+        Access = MEMACCESS_PF;
+        nSpan = 0;
+    }
+
+    memset(pBuf + nSpan, 0xFF, nLen - nSpan);
+
+    deb.memaccess = Access;
+
+    return( nSpan );
+}
+
+/******************************************************************************
+*                                                                             *
+*   UINT AddrWriteBlock(PTADDRDESC pAddr, BYTE *pBuf, UINT nLen, BOOL fForce) *
+*                                                                             *
+*******************************************************************************
+*
+*   Writes a block of memory. The write stops at the first page that is not
+*   present. The result of the access is left in deb.memaccess.
+*
+*   Where:
+*       pAddr is the address to write to
+*       pBuf is the data to write
+*       nLen is the number of bytes to write
+*       fForce is TRUE to write through the kernel DS if the selector is
+*           not writable
+*
+*   Returns:
+*       Number of bytes written
+*
+******************************************************************************/
+UINT AddrWriteBlock(PTADDRDESC pAddr, BYTE *pBuf, UINT nLen, BOOL fForce)
+{
+    DWORD Access;                       // Result of the access
+    UINT nSpan;                         // Number of bytes that we can write
+    UINT nWritten = 0;                  // Number of bytes written
+    TGDT_Gate *pGdt;
+
+    nSpan = BlockSpan(pAddr, nLen);
+    Access = deb.memaccess;
+
+    if( nSpan )
+    {
+        ImageTrackWrite(pAddr->offset, nSpan, FALSE);
+
+        if( SetBlock(pAddr->sel, CHECK_NOSELF(pAddr->offset), pBuf, nSpan)==0 )
+            nWritten = nSpan;
+        else
+        {
+            // Same as with AddrSetByte(), retry through the kernel DS
+            pGdt = (TGDT_Gate *) (deb.gdt.base + (pAddr->sel & ~7));
+
+            if( fForce && SetBlock(GetKernelDS(), CHECK_NOSELF(GET_GDT_BASE(pGdt) + pAddr->offset), pBuf, nSpan)==0 )
+                nWritten = nSpan;
+            else
+                Access = MEMACCESS_GPF;
+        }
+
+        ImageTrackWrite(pAddr->offset, nSpan, TRUE);
+    }
+
+    deb.memaccess = Access;
+
+    return( nWritten );
+}
+
 
 /******************************************************************************
 *                                                                             *
@@ -478,6 +675,143 @@ BOOL VerifyMemoryStamp(void)
     return( FALSE );
 }
 
+/******************************************************************************
+*                                                                             *
+*   static DWORD ImageBlockSum(UINT nBlock)                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Computes the checksum of a single block of the Linice code image. Every
+*   byte is weighted by its position within the block, so the sum also catches
+*   moved code and can still be adjusted for a single byte that changed.
+*
+*   Where:
+*       nBlock is the block number
+*
+*   Returns:
+*       Checksum of the block
+*
+******************************************************************************/
+static DWORD ImageBlockSum(UINT nBlock)
+{
+    BYTE *pMem;
+    DWORD dwSum = 0;
+    UINT i, nSize;
+
+    pMem  = (BYTE *) dwImageStart + (nBlock << nImageBlockShift);
+    nSize = MIN(1 << nImageBlockShift, dwImageStart + dwImageSize - (DWORD) pMem);
+
+    for(i=0; i<nSize; i++ )
+        dwSum += (i + 1) * pMem[i];
+
+    return( dwSum );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void ImageTrackWrite(DWORD dwAddress, UINT nSize, BOOL fWritten)   *
+*                                                                             *
+*******************************************************************************
+*
+*   Called twice around every memory write that we do: before the write to
+*   take the old bytes out of the image checksums, and after the write to add
+*   the new bytes in. Bytes outside the Linice code image are ignored.
+*
+*   Where:
+*       dwAddress is the linear address being written
+*       nSize is the number of bytes being written
+*       fWritten is FALSE before the write, TRUE after it
+*
+******************************************************************************/
+static void ImageTrackWrite(DWORD dwAddress, UINT nSize, BOOL fWritten)
+{
+    DWORD dwOffset;
+    UINT nBlock;
+    DWORD dwWeight;
+
+    for(; nSize; nSize--, dwAddress++ )
+    {
+        dwOffset = dwAddress - dwImageStart;
+
+        // Image bytes are always present, so we can read them directly
+        if( dwOffset < dwImageSize )
+        {
+            nBlock = dwOffset >> nImageBlockShift;
+            dwWeight = (dwOffset & ((1 << nImageBlockShift) - 1)) + 1;
+
+            if( fWritten )
+                ImageSum[nBlock] += dwWeight * *(BYTE *) dwAddress;
+            else
+                ImageSum[nBlock] -= dwWeight * *(BYTE *) dwAddress;
+        }
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void ImageChecksumInit(void)                                              *
+*                                                                             *
+*******************************************************************************
+*
+*   Computes the block checksums of the Linice code image. Called once at
+*   init time. Blocks are 4K in size, unless the image is too large for
+*   MAX_IMAGE_BLOCKS of them.
+*
+******************************************************************************/
+void ImageChecksumInit(void)
+{
+    UINT nBlock;
+
+    dwImageStart = (DWORD) ObjectStart;
+    dwImageSize  = (DWORD) ObjectEnd - (DWORD) ObjectStart;
+
+    nImageBlockShift = 12;
+    while( (dwImageSize >> nImageBlockShift) >= MAX_IMAGE_BLOCKS )
+        nImageBlockShift++;
+
+    nImageBlocks = (dwImageSize + (1 << nImageBlockShift) - 1) >> nImageBlockShift;
+    nImageNext = 0;
+    fImageCorrupt = FALSE;
+
+    for(nBlock=0; nBlock<nImageBlocks; nBlock++ )
+        ImageSum[nBlock] = ImageBlockSum(nBlock);
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL ImageVerify(UINT nBlocks)                                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Verifies the checksums of the next few blocks of the Linice code image,
+*   continuing where the last call left off, or of the complete image.
+*   Once a block did not match, the image stays marked as corrupted.
+*
+*   Where:
+*       nBlocks is the number of blocks to verify, 0 for all of them
+*
+*   Returns:
+*       TRUE - Linice code image is intact as far as we know
+*       FALSE - Linice code image has been corrupted
+*
+******************************************************************************/
+BOOL ImageVerify(UINT nBlocks)
+{
+    if( nBlocks==0 || nBlocks > nImageBlocks )
+        nBlocks = nImageBlocks;
+
+    while( nBlocks-- )
+    {
+        if( ImageSum[nImageNext] != ImageBlockSum(nImageNext) )
+            fImageCorrupt = TRUE;
+
+        if( ++nImageNext >= nImageBlocks )
+            nImageNext = 0;
+    }
+
+    return( !fImageCorrupt );
+}
+
 /******************************************************************************
 *                                                                             *
 *   void CalcMemAccessChecksum2()                                             *
@@ -857,18 +857,39 @@ static const TFONT8x16 font8x16[256] = {
 };
 
 
+#ifdef FONT_EXTRA
+// Font converted from a PSF or BDF file by tools/Font/fontgen
+#include "font-extra.h"
+#endif
+
+
 TFont Font[MAX_FONTS] = {
 {
     (BYTE *)&font8x8,                   // 8x8 font
-    8                                   // 8 pixels high
+    8,                                  // 8 pixels high
+    8,                                  // 8 pixels wide
+    1                                   // 1 byte per row
 },
 {
     (BYTE *)&font8x14,                  // 8x14 font
-    14                                  // 14 pixels high
+    14,                                 // 14 pixels high
+    8,                                  // 8 pixels wide
+    1                                   // 1 byte per row
 },
 {
     (BYTE *)&font8x16,                  // 8x16 font
-    16                                  // 16 pixels high
+    16,                                 // 16 pixels high
+    8,                                  // 8 pixels wide
+    1                                   // 1 byte per row
+}
+#ifdef FONT_EXTRA
+,
+{
+    (BYTE *)&fontExtra,                 // Converted font
+    FONT_EXTRA_Y,
+    FONT_EXTRA_X,
+    (FONT_EXTRA_X + 7) / 8
 }
+#endif
 };
 
@@ -0,0 +1,468 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     headless.c                                                    *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        Headless output module. It renders into a memory grid of character
+        and attribute cells laid out the same way as the VGA text buffer, and
+        does not touch any hardware.
+
+        It counts the bytes sent to the driver and the cells written into
+        the grid. A frame ends when the debugger turns on the cursor to wait
+        for input, so the counts of the last frame are the cost of drawing
+        the screen in response to a key or a command.
+
+        The grid is not cleared when switching to another display, so it
+        can be read through ICE_IOCTL_SCREEN after the fact.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include "module-header.h"              // Versatile module header file
+
+#include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
+#include "ice.h"                        // Include main debugger structures
+#include "ice-ioctl.h"                  // Include our own IOCTL numbers
+#include "errno.h"                      // Include kernel error numbers
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+TOUT outHeadless = {0};
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+//---------------------------------------------------
+// Helper variables for display output
+//---------------------------------------------------
+
+typedef struct
+{
+    int col;                            // Current line's color index
+    BYTE savedX, savedY;                // Last recently saved cursor coordinates
+    BYTE scrollTop, scrollBottom;       // Scroll region top and bottom coordinates
+
+    DWORD dwFrames;                     // Number of frames drawn
+    DWORD dwFrameBytes;                 // Bytes sent in the last complete frame
+    DWORD dwFrameCells;                 // Cells written in the last complete frame
+    DWORD dwBytes;                      // Bytes sent since the driver init
+    DWORD dwCells;                      // Cells written since the driver init
+    DWORD dwMarkBytes;                  // Byte count at the start of the current frame
+    DWORD dwMarkCells;                  // Cell count at the start of the current frame
+
+} THeadless;
+
+static THeadless hl;
+
+// Screen grid: character + attribute << 8, as in the VGA text buffer
+
+static WORD Grid[MAX_OUTPUT_SIZEY][MAX_OUTPUT_SIZEX];
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+static void HeadlessSprint(char *s);
+static void HeadlessCarret(BOOL fOn);
+static void HeadlessMouse(int x, int y);
+static BOOL HeadlessResize(int x, int y, int nFont);
+
+/******************************************************************************
+*                                                                             *
+*   void HeadlessInit(void)                                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Initializes headless output driver. It is called every time we switch to
+*   it, and keeps the screen size that was last set.
+*
+******************************************************************************/
+void HeadlessInit(void)
+{
+    if( outHeadless.sizeX==0 )
+    {
+        outHeadless.sizeX = 80;
+        outHeadless.sizeY = 25;
+    }
+
+    outHeadless.x = 0;
+    outHeadless.y = 0;
+    outHeadless.sprint = HeadlessSprint;
+    outHeadless.carret = HeadlessCarret;
+    outHeadless.mouse = HeadlessMouse;
+    outHeadless.resize = HeadlessResize;
+
+    memset(&hl, 0, sizeof(hl));
+
+    hl.scrollTop = 0;
+    hl.scrollBottom = outHeadless.sizeY - 1;
+    hl.col = COL_NORMAL;
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void Fill(int x, int y, int len, int col)                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Clears a run of cells on a line to spaces of a given color
+*
+******************************************************************************/
+static void Fill(int x, int y, int len, int col)
+{
+    if( len > 0 )
+    {
+        memset_w(&Grid[y][x], deb.col[col] * 256 + ' ', len);
+
+        hl.dwCells += len;
+    }
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void HeadlessCarret(BOOL fOn)                                      *
+*                                                                             *
+*******************************************************************************
+*
+*   There is no cursor to show; turning it on closes the current frame if
+*   anything was drawn since the last one.
+*
+******************************************************************************/
+static void HeadlessCarret(BOOL fOn)
+{
+    if( fOn && hl.dwBytes != hl.dwMarkBytes )
+    {
+        hl.dwFrameBytes = hl.dwBytes - hl.dwMarkBytes;
+        hl.dwFrameCells = hl.dwCells - hl.dwMarkCells;
+        hl.dwMarkBytes  = hl.dwBytes;
+        hl.dwMarkCells  = hl.dwCells;
+        hl.dwFrames++;
+    }
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void HeadlessMouse(int x, int y)                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Mouse display function
+*
+******************************************************************************/
+static void HeadlessMouse(int x, int y)
+{
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL HeadlessResize(int x, int y, int nFont)                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Resize headless display; any size that the grid can hold is accepted.
+*
+******************************************************************************/
+static BOOL HeadlessResize(int x, int y, int nFont)
+{
+    outHeadless.sizeX = x;
+    outHeadless.sizeY = y;
+
+    outHeadless.x = 0;
+    outHeadless.y = 0;
+
+    return( TRUE );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void ScrollUp()                                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Scrolls up a region
+*
+******************************************************************************/
+static void ScrollUp()
+{
+    int y;
+
+    if( (hl.scrollTop < hl.scrollBottom) && (hl.scrollBottom < outHeadless.sizeY) )
+    {
+        // Scroll up all requested lines
+        for(y=hl.scrollTop; y<hl.scrollBottom; y++)
+            memcpy(&Grid[y][0], &Grid[y+1][0], outHeadless.sizeX * sizeof(WORD));
+
+        hl.dwCells += outHeadless.sizeX * (hl.scrollBottom - hl.scrollTop);
+
+        // Clear the last line
+        Fill(0, hl.scrollBottom, outHeadless.sizeX, COL_NORMAL);
+    }
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void ScrollDown()                                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Scrolls down a region
+*
+******************************************************************************/
+static void ScrollDown()
+{
+    int y;
+
+    if( (hl.scrollTop < hl.scrollBottom) && (hl.scrollBottom < outHeadless.sizeY) )
+    {
+        // Scroll down all requested lines
+        for(y=hl.scrollBottom; y>hl.scrollTop; y--)
+            memcpy(&Grid[y][0], &Grid[y-1][0], outHeadless.sizeX * sizeof(WORD));
+
+        hl.dwCells += outHeadless.sizeX * (hl.scrollBottom - hl.scrollTop);
+
+        // Clear the first line
+        Fill(0, hl.scrollTop, outHeadless.sizeX, COL_NORMAL);
+    }
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void HeadlessSprint(char *s)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   String output to the headless screen grid.
+*
+******************************************************************************/
+static void HeadlessSprint(char *s)
+{
+    char *pStart = s;
+    BYTE c;
+    UINT nTabs;
+
+    while( (c = *s++) != 0 )
+    {
+        switch( c )
+        {
+            case DP_ENABLE_OUTPUT:
+            case DP_DISABLE_OUTPUT:
+                    // Enable and disable output are ignored on headless device
+                break;
+
+            case DP_SAVEBACKGROUND:
+            case DP_RESTOREBACKGROUND:
+                    // Save and restore background are ignored on headless device
+                break;
+
+            case DP_CLS:
+                    // Clear the screen and reset the cursor coordinates
+                    for(outHeadless.y=0; outHeadless.y<outHeadless.sizeY; outHeadless.y++)
+                        Fill(0, outHeadless.y, outHeadless.sizeX, COL_NORMAL);
+                    outHeadless.x = 0;
+                    outHeadless.y = 0;
+                break;
+
+            case DP_SETCURSORXY:
+                    outHeadless.x = (*s++)-1;
+                    outHeadless.y = (*s++)-1;
+                break;
+
+            case DP_SETCURSORSHAPE:
+                    deb.fOvertype = (*s++)-1;
+                break;
+
+            case DP_SAVEXY:
+                    hl.savedX = outHeadless.x;
+                    hl.savedY = outHeadless.y;
+                break;
+
+            case DP_RESTOREXY:
+                    outHeadless.x = hl.savedX;
+                    outHeadless.y = hl.savedY;
+                break;
+
+            case DP_SETSCROLLREGIONYY:
+                    hl.scrollTop = (*s++)-1;
+                    hl.scrollBottom = (*s++)-1;
+                break;
+
+            case DP_SCROLLUP:
+                    // Scroll a portion of the screen up and clear the bottom line
+                    ScrollUp();
+                break;
+
+            case DP_SCROLLDOWN:
+                    // Scroll a portion of the screen down and clear the top line
+                    ScrollDown();
+                break;
+
+            case DP_SETCOLINDEX:
+                    hl.col = *s++;
+                break;
+
+            case '\r':
+                    // Erase all characters to the right of the cursor pos and move cursor back
+                    if( outHeadless.y < outHeadless.sizeY && outHeadless.x < outHeadless.sizeX )
+                        Fill(outHeadless.x, outHeadless.y, outHeadless.sizeX - outHeadless.x, hl.col);
+                    outHeadless.x = 0;
+                    hl.col = COL_NORMAL;
+                break;
+
+            case '\n':
+                    // Go to a new line, possible autoscroll
+                    outHeadless.x = 0;
+                    hl.col = COL_NORMAL;
+
+                    // Check if we are on the last line of autoscroll
+                    if( hl.scrollBottom==outHeadless.y )
+                        ScrollUp();
+                    else
+                        outHeadless.y++;
+                break;
+
+            case DP_RIGHTALIGN:
+                    // Right align the rest of the text
+                    outHeadless.x = outHeadless.sizeX - strlen(s);
+                break;
+
+            case DP_TAB:
+                    // Tabs are expanded into spaces
+                    for(nTabs=deb.nTabs; nTabs; nTabs--)
+                    {
+                        if( outHeadless.x < outHeadless.sizeX && outHeadless.y < outHeadless.sizeY )
+                        {
+                            Grid[outHeadless.y][outHeadless.x++] = ' ' + deb.col[hl.col] * 256;
+                            hl.dwCells++;
+                        }
+                    }
+                break;
+
+            case DP_ESCAPE:
+                    // Escape character prints the next code as raw ascii
+                    c = *s++;
+
+                    // This case continues into the default...!
+
+            default:
+                    // All printable characters
+                    if( outHeadless.x < outHeadless.sizeX && outHeadless.y < outHeadless.sizeY )
+                    {
+                        Grid[outHeadless.y][outHeadless.x] = (WORD) c + deb.col[hl.col] * 256;
+                        hl.dwCells++;
+
+                        // Advance the print position
+                        outHeadless.x++;
+                    }
+                break;
+        }
+    }
+
+    hl.dwBytes += s - pStart - 1;
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   int HeadlessReadScreen(void *pUser)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Copies the headless screen grid into the user buffer, row by row, and
+*   returns the drawing statistics. Only as many cells as fit into the
+*   buffer are copied; a NULL buffer only fetches the statistics.
+*
+*   Where:
+*       pUser is the address of the TSCREENPACKET in the user space
+*
+*   Returns:
+*       0 on success
+*       -EFAULT on faulty memory access
+*
+******************************************************************************/
+int HeadlessReadScreen(void *pUser)
+{
+    TSCREENPACKET Packet;               // Packet local copy
+    DWORD dwRow;                        // Size of one screen row in bytes
+    UINT y, used = 0;
+
+    if( ice_copy_from_user(&Packet, pUser, sizeof(TSCREENPACKET))==0 )
+    {
+        dwRow = outHeadless.sizeX * sizeof(WORD);
+
+        if( Packet.pBuf )
+        {
+            for(y=0; y<outHeadless.sizeY && used + dwRow <= Packet.dwSize; y++)
+            {
+                if( ice_copy_to_user((BYTE *)Packet.pBuf + used, &Grid[y][0], dwRow) )
+                    return( -EFAULT );
+
+                used += dwRow;
+            }
+        }
+
+        Packet.dwSizeX      = outHeadless.sizeX;
+        Packet.dwSizeY      = outHeadless.sizeY;
+        Packet.dwX          = outHeadless.x;
+        Packet.dwY          = outHeadless.y;
+        Packet.dwFrames     = hl.dwFrames;
+        Packet.dwFrameBytes = hl.dwFrameBytes;
+        Packet.dwFrameCells = hl.dwFrameCells;
+        Packet.dwBytes      = hl.dwBytes;
+        Packet.dwCells      = hl.dwCells;
+        Packet.dwSize       = used;
+
+        if( ice_copy_to_user(pUser, &Packet, sizeof(TSCREENPACKET))==0 )
+            return( 0 );
+    }
+
+    return( -EFAULT );
+}
@@ -29,6 +29,12 @@
         This module implements output functionality for linear frame buffer
 		mapped bitmapped graphics modes (SVGA, X)
 
+        The frame buffer is either sent by the xice helper from a running
+        X server, or taken from the kernel framebuffer (fbdev) driver. With
+        the kernel framebuffer, if the display can be panned, the debugger
+        draws into an off-screen page and flips to it instead of saving and
+        restoring the background.
+
 *******************************************************************************
 *                                                                             *
 *   Changes:                                                                  *
@@ -114,17 +120,36 @@ typedef struct
     BYTE fEnabled;                      // Output is enabled
 
     DWORD dwFrameOffset;                // Offset to our effective frame
+    DWORD dwPage;                       // Offset of the page that we draw into
     TFont *pFont;                       // Pointer to a current font structure
+    int scale;                          // Font is scaled up by this factor
+    DWORD cellX, cellY;                 // Size of a character on the screen in pixels
+    BOOL fDirect;                       // Font rows can be drawn directly into the frame buffer
     DWORD stride;                       // Screen stride
     DWORD xres, yres;                   // X, Y resolution in pixels
     DWORD bpp;                          // BYTES per pixel :-)
     void (*PrintChar)(DWORD, BYTE, int);// Raw print char function
     void (*Cls)(void);                  // Raw cls function
 
+    BOOL fSaved;                        // Background is saved (our window is shown)
+    BOOL fFb;                           // Using the kernel framebuffer
+    BOOL fPan;                          // Kernel framebuffer can be panned
+    BOOL fFlip;                         // We flipped to our own page
+    BOOL fClear;                        // Our page needs to be cleared before it is shown
+    DWORD yresVirtual;                  // Mapped lines of the kernel framebuffer
+    DWORD yoffset;                      // Kernel displayed line before we flipped
+
 } TDGA;
 
 static TDGA dga;
 
+// Pixel masks for each combination of 4 font bits, each bit expanded to
+// as many pixels as the font is scaled. A font row is drawn with no test
+// per pixel, and a scaled row is built only once and then copied.
+
+static DWORD NibbleMask[16][4 * MAX_FONT_SCALE];
+static DWORD LineBuf[MAX_FONT_X * MAX_FONT_SCALE];
+
 extern BYTE cacheText[MAX_OUTPUT_SIZEY][MAX_OUTPUT_SIZEX];
 
 /******************************************************************************
@@ -142,6 +167,11 @@ static void DgaCls16();
 static void DgaCarret(BOOL fOn);
 static void DgaMouse(int x, int y);
 static BOOL DgaResize(int x, int y, int nFont);
+static void DgaFrameOffset(void);
+static BOOL DgaFlip(BOOL fSave);
+static void DgaSetPage(DWORD page);
+static int DgaPickFont(int nFont, int x, int y, DWORD xres, DWORD yres, int *pScale);
+static void DgaSetFont(int nFont, int scale);
 
 extern void CacheTextScrollUp(DWORD top, DWORD bottom);
 extern void CacheTextCls();
@@ -150,28 +180,29 @@ extern DWORD UserVirtToPhys(DWORD address);
 
 /******************************************************************************
 *                                                                             *
-*   int XInitPacket(TXINITPACKET *pXInit)                                     *
+*   static int LfbInit(char *pName, TXINITPACKET *pXInit, DWORD physicalAddress, DWORD dwMappingSize)
 *                                                                             *
 *******************************************************************************
 *
-*   Initializes X framebuffer. This call is made by the xice loader when
-*   switching/starting on the X.
+*   Allocates the backing store buffer, maps the frame buffer and sets up the
+*   output driver for the given display format.
+*
+*   Where:
+*       pName is the name of the source used in messages
+*       pXInit is the display format
+*       physicalAddress is the physical address of the frame buffer
+*       dwMappingSize is how much of the frame buffer to map
 *
 *   Returns:
 *       0 on success
 *       -1 on failure
 *
 ******************************************************************************/
-int XInitPacket(TXINITPACKET *pXInit)
+static int LfbInit(char *pName, TXINITPACKET *pXInit, DWORD physicalAddress, DWORD dwMappingSize)
 {
     int i;
-    DWORD physicalAddress;
-    DWORD dwMappingSize;                // How much of frame buffer to map
     DWORD dwSize;                       // Initial backing store buffer size
-
-    // Do all the messages on a VGA output device. That will also be a nice
-    // fallback device should something go wrong
-    pOut = &outVga;
+    int nFont, scale;                   // Font to use at this resolution and its scale
 
     // If the buffer size is specified, use it. Otherwise, use what came with main init packet
     if( pXInit->dwDrawSize )
@@ -184,14 +215,16 @@ int XInitPacket(TXINITPACKET *pXInit)
     }
 
     // Make sure the size is enough for the starting buffer 80x25 and the selected font
-    dwSize = (80+2) * 8 * pXInit->bpp * (25+2) * Font[deb.nFont].ysize;
+    nFont = DgaPickFont(deb.nFont, 80, 25, pXInit->xres, pXInit->yres, &scale);
+
+    dwSize = (80+2) * Font[nFont].xsize * scale * pXInit->bpp * (25+2) * Font[nFont].ysize * scale;
 
     if( deb.nXDrawSize < dwSize )
     {
         deb.nXDrawSize = dwSize;
     }
 
-    dprinth(1, "XWIN: Received XInitPacket.. Using buffer size of %d (%d Kb)", deb.nXDrawSize, deb.nXDrawSize/1024);
+    dprinth(1, "%s: Using buffer size of %d (%d Kb)", pName, deb.nXDrawSize, deb.nXDrawSize/1024);
 
     // If we already allocated buffers etc., need to release before reallocating
     if( deb.pXDrawBuffer != NULL )
@@ -209,13 +242,7 @@ int XInitPacket(TXINITPACKET *pXInit)
     // over the area of drawing
     if( (deb.pXDrawBuffer = ice_vmalloc(deb.nXDrawSize)) != NULL)
     {
-        INFO("XWIN: Allocated %d for backing store buffer\n", (int)deb.nXDrawSize);
-
-        // Find the physical address of the frame buffer in user address space
-        physicalAddress = UserVirtToPhys(pXInit->pFrameBuf);
-
-        // Find the size of the frame buffer that we need to map
-        dwMappingSize = pXInit->stride * pXInit->yres;
+        INFO("%s: Allocated %d for backing store buffer\n", pName, (int)deb.nXDrawSize);
 
         // Map the graphics card physical memory into the kernel address space
         deb.pXFrameBuffer = ice_ioremap(physicalAddress, dwMappingSize);
@@ -239,9 +266,10 @@ int XInitPacket(TXINITPACKET *pXInit)
             dga.scrollTop = 0;
             dga.scrollBottom = outDga.sizeY - 1;
             dga.col = COL_NORMAL;
-            dga.pFont = &Font[deb.nFont];
             dga.fEnabled = FALSE;
 
+            DgaSetFont(nFont, scale);
+
             dga.stride = pXInit->stride;
             dga.xres   = pXInit->xres;
             dga.yres   = pXInit->yres;
@@ -251,7 +279,7 @@ int XInitPacket(TXINITPACKET *pXInit)
             deb.FrameY = 0;
 
             // Calculate frame offset based on the existing origin variables
-            dga.dwFrameOffset = deb.FrameY * dga.stride + deb.FrameX * dga.bpp;
+            DgaFrameOffset();
 
             // We need to calculate colors for the given pixel mode
             for(i=0; i<16; i++ )
@@ -280,38 +308,27 @@ int XInitPacket(TXINITPACKET *pXInit)
 
             // Print stats
 
-            dprinth(1, "XWIN: User virtual address = %08X", pXInit->pFrameBuf);
-            dprinth(1, "XWIN: Physical address     = %08X", physicalAddress);
-            dprinth(1, "XWIN: Kernel address       = %08X (%08X)", deb.pXFrameBuffer, dwMappingSize);
-            dprinth(1, "XWIN: Desktop %d x %d, stride=%d  bpp=%d", dga.xres, dga.yres, dga.stride, dga.bpp * 8);
-
-            // Switch output to this driver and schedule a clean break into debugger
-
-            pOut = &outDga;
-
-            deb.nScheduleKbdBreakTimeout = 2;
+            dprinth(1, "%s: Physical address     = %08X", pName, physicalAddress);
+            dprinth(1, "%s: Kernel address       = %08X (%08X)", pName, deb.pXFrameBuffer, dwMappingSize);
+            dprinth(1, "%s: Desktop %d x %d, stride=%d  bpp=%d", pName, dga.xres, dga.yres, dga.stride, dga.bpp * 8);
+            dprinth(1, "%s: Font %d x %d, scale %d", pName, dga.pFont->xsize, dga.pFont->ysize, dga.scale);
 
             return( 0 );                // Return success
         }
         else
         {
-            // We could not map the frame buffer.. Clean up and switch back to vga driver
+            // We could not map the frame buffer.. Clean up
 
-            pOut = &outVga;
-
-            dprinth(1, "XWIN: Unable to map frame buffer (size=%d)!", dwMappingSize);
+            dprinth(1, "%s: Unable to map frame buffer (size=%d)!", pName, dwMappingSize);
 
             ice_vfree(deb.pXDrawBuffer);
         }
     }
     else
     {
-        // We could not allocate memory.. Clean up and switch back to a vga driver
-
-        pOut = &outVga;
-
-        dprinth(1, "XWIN: Unable to allocate %d for backing store buffer!", deb.nXDrawSize);
+        // We could not allocate memory.. Clean up
 
+        dprinth(1, "%s: Unable to allocate %d for backing store buffer!", pName, deb.nXDrawSize);
     }
 
     deb.pXDrawBuffer = NULL;
@@ -321,6 +338,227 @@ int XInitPacket(TXINITPACKET *pXInit)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   int XInitPacket(TXINITPACKET *pXInit)                                     *
+*                                                                             *
+*******************************************************************************
+*
+*   Initializes X framebuffer. This call is made by the xice loader when
+*   switching/starting on the X.
+*
+*   Returns:
+*       0 on success
+*       -1 on failure
+*
+******************************************************************************/
+int XInitPacket(TXINITPACKET *pXInit)
+{
+    DWORD physicalAddress;
+
+    // Do all the messages on a VGA output device. That will also be a nice
+    // fallback device should something go wrong
+    pOut = &outVga;
+
+    dprinth(1, "XWIN: Received XInitPacket..");
+
+    // Find the physical address of the frame buffer in user address space
+    physicalAddress = UserVirtToPhys(pXInit->pFrameBuf);
+
+    dprinth(1, "XWIN: User virtual address = %08X", pXInit->pFrameBuf);
+
+    if( LfbInit("XWIN", pXInit, physicalAddress, pXInit->stride * pXInit->yres)==0 )
+    {
+        // Switch output to this driver and schedule a clean break into debugger
+
+        pOut = &outDga;
+
+        deb.nScheduleKbdBreakTimeout = 2;
+
+        return( 0 );                    // Return success
+    }
+
+    return( -1 );                       // Return error!
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   int FbInit(void)                                                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Initializes the output to the kernel framebuffer, if one is registered.
+*   The geometry and the physical address are taken from the framebuffer
+*   driver. The whole framebuffer memory is mapped so we can draw into the
+*   pages that are not displayed.
+*
+*   Returns:
+*       0 on success; the caller can switch the output to outDga
+*       -1 if there is no usable kernel framebuffer
+*
+******************************************************************************/
+int FbInit(void)
+{
+    TFBINFO Fb;
+    TXINITPACKET XInit;
+    DWORD dwMappingSize;
+
+    if( ice_get_fb_info(&Fb) )
+        return( -1 );
+
+    if( Fb.bits_per_pixel!=16 && Fb.bits_per_pixel!=32 )
+    {
+        dprinth(1, "FB: %d bpp framebuffer is not supported", Fb.bits_per_pixel);
+        return( -1 );
+    }
+
+    // Translate the framebuffer format into the one that xice sends
+
+    memset(&XInit, 0, sizeof(XInit));
+
+    XInit.xres        = Fb.xres;
+    XInit.yres        = Fb.yres;
+    XInit.bpp         = Fb.bits_per_pixel / 8;
+    XInit.stride      = Fb.line_length;
+    XInit.redShift    = Fb.red_offset;
+    XInit.greenShift  = Fb.green_offset;
+    XInit.blueShift   = Fb.blue_offset;
+    XInit.redMask     = ((1 << Fb.red_length) - 1) << Fb.red_offset;
+    XInit.greenMask   = ((1 << Fb.green_length) - 1) << Fb.green_offset;
+    XInit.blueMask    = ((1 << Fb.blue_length) - 1) << Fb.blue_offset;
+    XInit.redColAdj   = 8 - Fb.red_length;
+    XInit.greenColAdj = 8 - Fb.green_length;
+    XInit.blueColAdj  = 8 - Fb.blue_length;
+
+    // Map all the pages, but not more than the framebuffer memory
+    dwMappingSize = Fb.line_length * Fb.yres_virtual;
+    if( Fb.smem_len && dwMappingSize > Fb.smem_len )
+        dwMappingSize = Fb.smem_len;
+
+    if( dwMappingSize < Fb.line_length * Fb.yres )
+        return( -1 );
+
+    if( LfbInit("FB", &XInit, Fb.smem_start, dwMappingSize)==0 )
+    {
+        dga.fFb = TRUE;
+        dga.fPan = Fb.fPan;
+        dga.yresVirtual = dwMappingSize / dga.stride;
+
+        dprinth(1, "FB: %d lines mapped, page flipping is %s", dga.yresVirtual,
+            (dga.fPan && dga.yresVirtual >= 2 * dga.yres)? "available":"not available");
+
+        return( 0 );
+    }
+
+    return( -1 );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void DgaFrameOffset(void)                                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Calculates the offset of our window within the frame buffer from the
+*   page that we draw into and the window origin.
+*
+******************************************************************************/
+static void DgaFrameOffset(void)
+{
+    dga.dwFrameOffset = dga.dwPage + deb.FrameY * dga.stride + deb.FrameX * dga.bpp;
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static int DgaPickFont(int nFont, int x, int y, DWORD xres, DWORD yres, int *pScale)
+*                                                                             *
+*******************************************************************************
+*
+*   Picks the font and its scale for the display resolution. The selected
+*   font is scaled up on high resolution displays as long as the window of
+*   the given size fits on the screen. If there is a font of the scaled size,
+*   it is used instead.
+*
+*   Where:
+*       nFont is the selected font index
+*       x, y is the size of the window in characters
+*       xres, yres is the display resolution
+*       pScale is where to store the scale of the font
+*
+*   Returns:
+*       index of the font to use
+*
+******************************************************************************/
+static int DgaPickFont(int nFont, int x, int y, DWORD xres, DWORD yres, int *pScale)
+{
+    int scale, i;
+
+    scale = yres / FONT_SCALE_YRES;
+
+    if( scale > MAX_FONT_SCALE )
+        scale = MAX_FONT_SCALE;
+
+    while( scale > 1 )
+    {
+        if( (x+2) * Font[nFont].xsize * scale <= xres && (y+2) * Font[nFont].ysize * scale <= yres )
+            break;
+        scale--;
+    }
+
+    if( scale > 1 )
+    {
+        for(i=0; i<MAX_FONTS; i++)
+        {
+            if( Font[i].xsize==Font[nFont].xsize * scale && Font[i].ysize==Font[nFont].ysize * scale )
+            {
+                *pScale = 1;
+                return( i );
+            }
+        }
+    }
+    else
+        scale = 1;
+
+    *pScale = scale;
+
+    return( nFont );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void DgaSetFont(int nFont, int scale)                              *
+*                                                                             *
+*******************************************************************************
+*
+*   Selects the font and the scale to draw with and builds the pixel masks.
+*
+******************************************************************************/
+static void DgaSetFont(int nFont, int scale)
+{
+    int n, i;
+
+    dga.pFont = &Font[nFont];
+    dga.scale = scale;
+    dga.cellX = dga.pFont->xsize * scale;
+    dga.cellY = dga.pFont->ysize * scale;
+
+    // Rows of the unscaled fonts of the whole bytes width have no padding
+    dga.fDirect = scale==1 && (dga.pFont->xsize & 7)==0;
+
+    for(n=0; n<16; n++)
+    {
+        for(i=0; i<4 * scale; i++)
+        {
+            NibbleMask[n][i] = (n & (8 >> (i / scale)))? 0xFFFFFFFF : 0;
+        }
+    }
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   void DgaPrintCharacter32(DWORD ptr, BYTE c, int col)                      *
@@ -332,11 +570,11 @@ int XInitPacket(TXINITPACKET *pXInit)
 ******************************************************************************/
 static void DgaPrintCharacter32(DWORD ptr, BYTE c, int col)
 {
-    DWORD *pPixel;
-    int x, y;
+    DWORD *pPixel, *pMask;
+    int x, y, i, n;
     BYTE *pChar;
     BYTE line;
-    DWORD pixelFore, pixelBack;
+    DWORD pixelXor, pixelBack;
     BOOL fCarret = FALSE;               // Special carret character
 
     // If we are printing a cursor carret, set up the state
@@ -347,36 +585,50 @@ static void DgaPrintCharacter32(DWORD ptr, BYTE c, int col)
     }
 
     // Cache the current colors for foreground and background
-    pixelFore = dga.pixelFore[deb.col[col] & 0xF];
     pixelBack = dga.pixelBack[(deb.col[col] >> 4) & 0x7];
+    pixelXor  = dga.pixelFore[deb.col[col] & 0xF] ^ pixelBack;
 
     // Get the address of the start of a character
-    pChar = (BYTE *)(dga.pFont->Bitmap + c * dga.pFont->ysize);
+    pChar = (BYTE *)(dga.pFont->Bitmap + c * dga.pFont->ysize * dga.pFont->bpl);
+
+    n = 4 * dga.scale;                  // Number of pixels for 4 bits of a font row
 
     for(y=0; y<dga.pFont->ysize; y++)
     {
-        // Get one scanline of a character font
-        line = *pChar++;
-        pPixel = (DWORD *) ptr;
+        // Build the scanline in the line buffer unless it can go directly to the screen
+        pPixel = dga.fDirect? (DWORD *) ptr : LineBuf;
 
-        // If we are printing a cursor carret, set last 2 lines
-        if( fCarret && y>=dga.pFont->ysize-2 )
+        for(x=0; x<dga.pFont->bpl; x++)
         {
-            line = 0xFF;                // OR the full foreground line
-        }
+            // Get one byte of a scanline of a character font
+            line = *pChar++;
 
-        for(x=0; x<8; x++)
-        {
-            if( line & 0x80 )
-                *pPixel = pixelFore;
-            else
-                *pPixel = pixelBack;
+            // If we are printing a cursor carret, set last 2 lines
+            if( fCarret && y>=dga.pFont->ysize-2 )
+            {
+                line = 0xFF;            // OR the full foreground line
+            }
+
+            pMask = NibbleMask[line >> 4];
+            for(i=0; i<n; i++)
+                *pPixel++ = pixelBack ^ (pixelXor & *pMask++);
 
-            pPixel++;
-            line <<= 1;
+            pMask = NibbleMask[line & 0xF];
+            for(i=0; i<n; i++)
+                *pPixel++ = pixelBack ^ (pixelXor & *pMask++);
         }
 
-        ptr += dga.stride;
+        if( dga.fDirect )
+            ptr += dga.stride;
+        else
+        {
+            // Copy the scanline as many times as the font is scaled
+            for(i=0; i<dga.scale; i++)
+            {
+                memcpy((void *) ptr, LineBuf, dga.cellX * 4);
+                ptr += dga.stride;
+            }
+        }
     }
 }
 
@@ -392,10 +644,11 @@ static void DgaPrintCharacter32(DWORD ptr, BYTE c, int col)
 static void DgaPrintCharacter16(DWORD ptr, BYTE c, int col)
 {
     WORD *pPixel;
-    int x, y;
+    DWORD *pMask;
+    int x, y, i, n;
     BYTE *pChar;
     BYTE line;
-    WORD pixelFore, pixelBack;
+    WORD pixelXor, pixelBack;
     BOOL fCarret = FALSE;               // Special carret character
 
     // If we are printing a cursor carret, set up the state
@@ -406,36 +659,50 @@ static void DgaPrintCharacter16(DWORD ptr, BYTE c, int col)
     }
 
     // Cache the current colors for foreground and background
-    pixelFore = (WORD)(dga.pixelFore[deb.col[col] & 0xF] & 0xFFFF);
     pixelBack = (WORD)(dga.pixelBack[(deb.col[col] >> 4) & 0x7] & 0xFFFF);
+    pixelXor  = (WORD)(dga.pixelFore[deb.col[col] & 0xF] & 0xFFFF) ^ pixelBack;
 
     // Get the address of the start of a character
-    pChar = (BYTE *)(dga.pFont->Bitmap + c * dga.pFont->ysize);
+    pChar = (BYTE *)(dga.pFont->Bitmap + c * dga.pFont->ysize * dga.pFont->bpl);
+
+    n = 4 * dga.scale;                  // Number of pixels for 4 bits of a font row
 
     for(y=0; y<dga.pFont->ysize; y++)
     {
-        // Get one scanline of a character font
-        line = *pChar++;
-        pPixel = (WORD *) ptr;
+        // Build the scanline in the line buffer unless it can go directly to the screen
+        pPixel = dga.fDirect? (WORD *) ptr : (WORD *) LineBuf;
 
-        // If we are printing a cursor carret, set last 2 lines
-        if( fCarret && y>=dga.pFont->ysize-2 )
+        for(x=0; x<dga.pFont->bpl; x++)
         {
-            line = 0xFF;                // OR the full foreground line
-        }
+            // Get one byte of a scanline of a character font
+            line = *pChar++;
 
-        for(x=0; x<8; x++)
-        {
-            if( line & 0x80 )
-                *pPixel = pixelFore;
-            else
-                *pPixel = pixelBack;
+            // If we are printing a cursor carret, set last 2 lines
+            if( fCarret && y>=dga.pFont->ysize-2 )
+            {
+                line = 0xFF;            // OR the full foreground line
+            }
 
-            pPixel++;
-            line <<= 1;
+            pMask = NibbleMask[line >> 4];
+            for(i=0; i<n; i++)
+                *pPixel++ = pixelBack ^ (pixelXor & (WORD) *pMask++);
+
+            pMask = NibbleMask[line & 0xF];
+            for(i=0; i<n; i++)
+                *pPixel++ = pixelBack ^ (pixelXor & (WORD) *pMask++);
         }
 
-        ptr += dga.stride;
+        if( dga.fDirect )
+            ptr += dga.stride;
+        else
+        {
+            // Copy the scanline as many times as the font is scaled
+            for(i=0; i<dga.scale; i++)
+            {
+                memcpy((void *) ptr, LineBuf, dga.cellX * 2);
+                ptr += dga.stride;
+            }
+        }
     }
 }
 
@@ -457,14 +724,14 @@ static void DgaPrintCharacter(DWORD x, DWORD y, BYTE c, int col)
     DWORD address;
 
     // Only print characters that completely fit within the screen bounds
-    if( x <= (dga.xres - 8) / 8 )
+    if( x <= (dga.xres - dga.cellX) / dga.cellX )
     {
-        if( y <= (dga.yres - dga.pFont->ysize) / dga.pFont->ysize )
+        if( y <= (dga.yres - dga.cellY) / dga.cellY )
         {
             // Calculate the address in the frame buffer to print a character
             address = (DWORD) deb.pXFrameBuffer + dga.dwFrameOffset +
-                y * dga.stride * dga.pFont->ysize +
-                x * dga.bpp * 8;
+                y * dga.stride * dga.cellY +
+                x * dga.bpp * dga.cellX;
 
             if( dga.PrintChar )
                 (dga.PrintChar)(address, c, col);
@@ -491,11 +758,11 @@ static void DgaCls16()
     pixelBack = (WORD)(dga.pixelBack[(deb.col[dga.col] >> 4) & 0x7] & 0xFFFF);
     address = deb.pXFrameBuffer + dga.dwFrameOffset;
 
-    for(y=0; y<pOut->sizeY * dga.pFont->ysize; y++)
+    for(y=0; y<pOut->sizeY * dga.cellY; y++)
     {
         // Set memory - word sizes
         // We are adding for borders
-        memset_w(address, pixelBack, (pOut->sizeX+2) * 8);
+        memset_w(address, pixelBack, (pOut->sizeX+2) * dga.cellX);
         address = (void *)((DWORD) address + dga.stride);
     }
 }
@@ -518,16 +785,121 @@ static void DgaCls32()
     pixelBack = dga.pixelBack[(deb.col[dga.col] >> 4) & 0x7];
     address = deb.pXFrameBuffer + dga.dwFrameOffset;
 
-    for(y=0; y<pOut->sizeY * dga.pFont->ysize; y++)
+    for(y=0; y<pOut->sizeY * dga.cellY; y++)
     {
         // Set memory - double word sizes
         // We are adding for borders
-        memset_d(address, pixelBack, (pOut->sizeX+2) * 8);
+        memset_d(address, pixelBack, (pOut->sizeX+2) * dga.cellX);
         address = (void *)((DWORD) address + dga.stride);
     }
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   static BOOL DgaFlip(BOOL fSave)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Shows our window by flipping the kernel framebuffer to a page that is
+*   not displayed, or flips back to the kernel page. Our page has to be
+*   cleared only when the window moves or changes its size, since the
+*   window area itself is redrawn on every entry.
+*
+*   If there is no such page or the display could not be panned, we draw
+*   on the displayed page and the background is moved as usual.
+*
+*   Where: fSave - TRUE to show our page
+*                  FALSE to show the kernel page
+*
+*   Returns:
+*       TRUE if the pages were flipped
+*       FALSE if the caller needs to move the background
+*
+******************************************************************************/
+static BOOL DgaFlip(BOOL fSave)
+{
+    TFBINFO Fb;
+    DWORD page;
+
+    if( fSave )
+    {
+        ice_get_fb_info(&Fb);
+        dga.yoffset = Fb.yoffset;
+
+        // Pick a page that does not overlap the displayed one
+        page = Fb.yoffset;
+
+        if( dga.fPan )
+        {
+            if( Fb.yoffset >= dga.yres )
+                page = 0;
+            else
+            if( Fb.yoffset + 2 * dga.yres <= dga.yresVirtual )
+                page = dga.yresVirtual - dga.yres;
+        }
+
+        // Try to flip to our page
+        if( page != Fb.yoffset )
+        {
+            DgaSetPage(page);
+
+            if( dga.fClear )
+            {
+                memset(deb.pXFrameBuffer + dga.dwPage, 0, dga.stride * dga.yres);
+                dga.fClear = FALSE;
+            }
+
+            if( ice_fb_pan(page)==0 )
+            {
+                dga.fFlip = TRUE;
+
+                return( TRUE );
+            }
+        }
+
+        // Draw on the displayed page
+        DgaSetPage(Fb.yoffset);
+
+        dga.fFlip = FALSE;
+    }
+    else
+    {
+        if( dga.fFlip )
+        {
+            ice_fb_pan(dga.yoffset);
+
+            dga.fFlip = FALSE;
+
+            return( TRUE );
+        }
+    }
+
+    return( FALSE );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void DgaSetPage(DWORD page)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Selects the page that we draw into, by its first line.
+*
+******************************************************************************/
+static void DgaSetPage(DWORD page)
+{
+    if( dga.dwPage != page * dga.stride )
+    {
+        dga.dwPage = page * dga.stride;
+        dga.fClear = TRUE;
+
+        DgaFrameOffset();
+    }
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   void MoveBackground(BOOL fSave)                                           *
@@ -545,27 +917,38 @@ static void MoveBackground(BOOL fSave)
     DWORD size, y, address;
     BYTE *pBuf;
 
+    // Ignore the requests that do not change the state, so we never restore
+    // a background that was not saved
+    if( fSave==dga.fSaved )
+        return;
+
+    dga.fSaved = fSave;
+
+    // The kernel framebuffer may flip pages instead of moving the window area
+    if( dga.fFb && DgaFlip(fSave) )
+        return;
+
     // Make sure we have draw buffer allocated and that it is the right size
     if( deb.pXDrawBuffer )
     {
         // Calculate required size in bytes of the window area
         // We are adding border (2 characters)
-        size = (outDga.sizeX+2) * 8 * dga.bpp * // X size of the font is always 8 pixels
-               (outDga.sizeY+2) * dga.pFont->ysize;
+        size = (outDga.sizeX+2) * dga.cellX * dga.bpp *
+               (outDga.sizeY+2) * dga.cellY;
         if( size <= deb.nXDrawSize )
         {
             pBuf = deb.pXDrawBuffer;
             address = (DWORD) deb.pXFrameBuffer + dga.dwFrameOffset;
 
             // Move the window area, line by line, in the required direction
-            for(y=0; y<(outDga.sizeY+2) * dga.pFont->ysize; y++)
+            for(y=0; y<(outDga.sizeY+2) * dga.cellY; y++)
             {
                 if( fSave )
-                    memcpy((void *)pBuf, (void *)address, (outDga.sizeX+2) * 8 * dga.bpp);
+                    memcpy((void *)pBuf, (void *)address, (outDga.sizeX+2) * dga.cellX * dga.bpp);
                 else
-                    memcpy((void *)address, (void *)pBuf, (outDga.sizeX+2) * 8 * dga.bpp);
+                    memcpy((void *)address, (void *)pBuf, (outDga.sizeX+2) * dga.cellX * dga.bpp);
 
-                pBuf += (outDga.sizeX+2) * 8 * dga.bpp;
+                pBuf += (outDga.sizeX+2) * dga.cellX * dga.bpp;
                 address += dga.stride;
             }
         }
@@ -610,30 +993,34 @@ static void DgaMouse(int x, int y)
 static BOOL DgaResize(int x, int y, int nFont)
 {
     DWORD dwSize;                       // Backing store buffer requirement
-    int fontY;                          // Current or new font Y size
+    DWORD cellX, cellY;                 // Character size with the new font
+    int iFont, scale;                   // Font to use at this resolution and its scale
+
+    // Pick the font for the new window size. If the command was not to set
+    // different font, we expect the caller to pass us the current font number.
+    iFont = DgaPickFont(nFont, x, y, dga.xres, dga.yres, &scale);
 
-    // Load the font Y size. If the command was not to set different font, we
-    // expect the caller to pass us the current font number.
-    fontY = Font[nFont].ysize;
+    cellX = Font[iFont].xsize * scale;
+    cellY = Font[iFont].ysize * scale;
 
     // Check that the number of lines or width do not exceed current display size
 
-    if( x > (dga.xres/8)-2 )
+    if( x > (dga.xres/cellX)-2 )
     {
-        dprinth(1, "Maximum WIDTH at this screen resolution is %d", (dga.xres/8)-2 );
+        dprinth(1, "Maximum WIDTH at this screen resolution is %d", (dga.xres/cellX)-2 );
         return( FALSE );
     }
 
-    if( y > (dga.yres/fontY)-2 )
+    if( y > (dga.yres/cellY)-2 )
     {
-        dprinth(1, "Maximum LINES at this resolution and font is %d", (dga.yres/fontY)-2);
+        dprinth(1, "Maximum LINES at this resolution and font is %d", (dga.yres/cellY)-2);
         return( FALSE );
     }
 
     // Depending on the amount of backing store buffer memory allocated,
     // we may want to decrease this request to what would fit
 
-    dwSize = (x+2) * 8 * dga.bpp * (y+2) * fontY;
+    dwSize = (x+2) * cellX * dga.bpp * (y+2) * cellY;
 
     if( dwSize > deb.nXDrawSize )
     {
@@ -646,10 +1033,10 @@ static BOOL DgaResize(int x, int y, int nFont)
         if( x != outDga.sizeX )
         {
             // Changing X size (command WIDTH)
-            x = deb.nXDrawSize / (8 * dga.bpp * (outDga.sizeY+2) * fontY);
+            x = deb.nXDrawSize / (cellX * dga.bpp * (outDga.sizeY+2) * cellY);
             x -= 2;                     // Account for 2 border edges
 
-            dwSize = (x+2) * 8 * dga.bpp * (y+2) * fontY;
+            dwSize = (x+2) * cellX * dga.bpp * (y+2) * cellY;
 
             dprinth(1, "Using WIDTH of %d instead.", x);
         }
@@ -657,10 +1044,10 @@ static BOOL DgaResize(int x, int y, int nFont)
         if( y != outDga.sizeY )
         {
             // Changing Y size (command LINES)
-            y = deb.nXDrawSize / ((outDga.sizeX+2) * 8 * dga.bpp * fontY);
+            y = deb.nXDrawSize / ((outDga.sizeX+2) * cellX * dga.bpp * cellY);
             y -= 2;                     // Account for 2 border edges
 
-            dwSize = (x+2) * 8 * dga.bpp * (y+2) * fontY;
+            dwSize = (x+2) * cellX * dga.bpp * (y+2) * cellY;
 
             dprinth(1, "Using LINES of %d instead.", y);
         }
@@ -675,19 +1062,20 @@ static BOOL DgaResize(int x, int y, int nFont)
     dputc(DP_RESTOREBACKGROUND);
 
     // After resizing, we may want to readjust the starting frame X and Y coordinates
-    if( deb.FrameX + (x+2) * 8 >= dga.xres )
-        deb.FrameX = dga.xres - (x+2) * 8;
+    if( deb.FrameX + (x+2) * cellX >= dga.xres )
+        deb.FrameX = dga.xres - (x+2) * cellX;
 
-    if( deb.FrameY + (y+2) * fontY >= dga.yres )
-        deb.FrameY = dga.yres - (y+2) * fontY;
+    if( deb.FrameY + (y+2) * cellY >= dga.yres )
+        deb.FrameY = dga.yres - (y+2) * cellY;
 
-    dga.dwFrameOffset = deb.FrameY * dga.stride + deb.FrameX * dga.bpp;
+    DgaFrameOffset();
+    dga.fClear = TRUE;
 
     // Size is now ok, it will fit. Readjust the variables and exit.
     outDga.sizeX = x;
     outDga.sizeY = y;
     deb.nFont = nFont;                  // Set unchanged or new font index
-    dga.pFont = &Font[nFont];           // And the pointer to a new font
+    DgaSetFont(iFont, scale);           // And the font that is drawn with
 
     dputc(DP_SAVEBACKGROUND);
 
@@ -962,8 +1350,8 @@ void XWinControl(WCHAR Key)
             case CHAR_CTRL + CHAR_ALT + 'c':
             case CHAR_CTRL + CHAR_ALT + 'C':
                 // Center the window on the screen
-                deb.FrameX = dga.xres/2 - ((outDga.sizeX+2) * dga.bpp)/2;
-                deb.FrameY = dga.yres/2 - ((outDga.sizeY+2) * dga.pFont->ysize)/2;
+                deb.FrameX = dga.xres/2 - ((outDga.sizeX+2) * dga.cellX)/2;
+                deb.FrameY = dga.yres/2 - ((outDga.sizeY+2) * dga.cellY)/2;
                 break;
 
             case CHAR_CTRL + CHAR_ALT + LEFT:
@@ -997,14 +1385,15 @@ void XWinControl(WCHAR Key)
 
         // Moving window to the right, down or centering may have pushed it
         // over the right or bottom edge, and that could be fatal. Readjust if necessary.
-        if( deb.FrameX + (outDga.sizeX+2) * 8 >= dga.xres )
-            deb.FrameX = dga.xres - (outDga.sizeX+2) * 8;
+        if( deb.FrameX + (outDga.sizeX+2) * dga.cellX >= dga.xres )
+            deb.FrameX = dga.xres - (outDga.sizeX+2) * dga.cellX;
 
-        if( deb.FrameY + (outDga.sizeY+2) * dga.pFont->ysize >= dga.yres )
-            deb.FrameY = dga.yres - (outDga.sizeY+2) * dga.pFont->ysize;
+        if( deb.FrameY + (outDga.sizeY+2) * dga.cellY >= dga.yres )
+            deb.FrameY = dga.yres - (outDga.sizeY+2) * dga.cellY;
 
         // Recalculate new address of our window frame
-        dga.dwFrameOffset = deb.FrameY * dga.stride + deb.FrameX * dga.bpp;
+        DgaFrameOffset();
+        dga.fClear = TRUE;
 
         // Repaint the window completely
         dputc(DP_SAVEBACKGROUND);
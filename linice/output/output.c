@@ -111,6 +111,24 @@ void dputc(UCHAR c)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   void dflush(void)                                                         *
+*                                                                             *
+*******************************************************************************
+*
+*   Makes an output device show everything that was printed so far. Devices
+*   that draw into a private buffer copy it to the screen; the rest do not
+*   need to do anything.
+*
+******************************************************************************/
+void dflush(void)
+{
+    if( pOut->flush )
+        (pOut->flush)();
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   int PrintLine(char *format,...)                                           *
@@ -28,6 +28,13 @@
 
         VGA text buffer output driver
 
+        Text is drawn into a shadow buffer in the system memory. The rows
+        that were drawn into are copied to the video memory when the output
+        is flushed: before waiting for a key, and when the debugee continues
+        with the debugger screen left displayed. Only the rows that differ
+        from what was last copied are written, and the video memory is never
+        read except to save the background.
+
 *******************************************************************************
 *                                                                             *
 *   Changes:                                                                  *
@@ -75,6 +82,7 @@ typedef struct
 {
     BYTE CRTC[0x19];                    // CRTC Registers (3D4/3D5)
     BYTE SR[5];                         // Sequencer Registers (3C4/3C5)
+    int nLines;                         // Number of saved text lines
     WORD textbuf[ MAX_VGA_SIZEX * MAX_VGA_SIZEY ];
 
 } TVgaState;
@@ -100,11 +108,20 @@ typedef struct
     BYTE savedX, savedY;                // Last recently saved cursor coordinates
     BYTE scrollTop, scrollBottom;       // Scroll region top and bottom coordinates
     BYTE fEnabled;                      // Output is enabled
+    BYTE fForce;                        // Video memory content is unknown, write all dirty rows
+    BYTE Dirty[MAX_VGA_SIZEY];          // Rows drawn into since the last flush
 
 } TVga;
 
 static TVga vga;
 
+static WORD Shadow[MAX_VGA_SIZEX * MAX_VGA_SIZEY];  // Text that we draw into
+static WORD Shown[MAX_VGA_SIZEX * MAX_VGA_SIZEY];   // Text last copied to the video memory
+
+// Address of a character in the shadow buffer
+
+#define SHADOW(x, y)    ((BYTE *) &Shadow[(x) + (y) * outVga.sizeX])
+
 
 /******************************************************************************
 *                                                                             *
@@ -116,6 +133,8 @@ void VgaSprint(char *s);
 static void VgaCarret(BOOL fOn);
 static void VgaMouse(int x, int y);
 static BOOL VgaResize(int x, int y, int nFont);
+static void VgaFlush(void);
+static void VgaInvalidate(void);
 
 /******************************************************************************
 *                                                                             *
@@ -141,6 +160,7 @@ void VgaInit(void)
     outVga.carret = VgaCarret;
     outVga.mouse = VgaMouse;
     outVga.resize = VgaResize;
+    outVga.flush = VgaFlush;
 
     vga.scrollTop = 0;
     vga.scrollBottom = MAX_VGA_SIZEY - 1;
@@ -150,6 +170,65 @@ void VgaInit(void)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   static void VgaInvalidate(void)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Called when the video memory no longer shows the shadow buffer. All rows
+*   are copied on the next flush.
+*
+******************************************************************************/
+static void VgaInvalidate(void)
+{
+    memset(vga.Dirty, TRUE, sizeof(vga.Dirty));
+    vga.fForce = TRUE;
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void VgaFlush(void)                                                *
+*                                                                             *
+*******************************************************************************
+*
+*   Copies the rows that changed from the shadow buffer to the video memory
+*   using 32 bit stores.
+*
+******************************************************************************/
+static void VgaFlush(void)
+{
+    DWORD *pSrc, *pDest;
+    int x, y;
+
+    if( vga.fEnabled )
+    {
+        for(y=0; y<outVga.sizeY; y++)
+        {
+            if( vga.Dirty[y] )
+            {
+                vga.Dirty[y] = FALSE;
+
+                pSrc = (DWORD *) &Shadow[y * MAX_VGA_SIZEX];
+
+                if( vga.fForce || memcmp(pSrc, &Shown[y * MAX_VGA_SIZEX], MAX_VGA_SIZEX * 2) )
+                {
+                    memcpy(&Shown[y * MAX_VGA_SIZEX], pSrc, MAX_VGA_SIZEX * 2);
+
+                    pDest = (DWORD *) (vga.pText + y * MAX_VGA_SIZEX * 2);
+
+                    for(x=0; x<MAX_VGA_SIZEX/2; x++)
+                        *pDest++ = *pSrc++;
+                }
+            }
+        }
+
+        vga.fForce = FALSE;
+    }
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   static void SaveBackground(void)                                          *
@@ -191,9 +270,15 @@ static void SaveBackground(void)
 
     vga.pText = (BYTE *) LINUX_VGA_TEXT + ((vgaState.CRTC[0x0C] << 8) + vgaState.CRTC[0x0D]) * 2;
 
-    // Store away what was in the text buffer on the screen
+    // Store away what was in the text buffer on the screen. Only the lines
+    // that we will draw over are saved
+
+    vgaState.nLines = outVga.sizeY;
 
-    memcpy(vgaState.textbuf, vga.pText, sizeof(vgaState.textbuf));
+    memcpy(vgaState.textbuf, vga.pText, vgaState.nLines * MAX_VGA_SIZEX * 2);
+
+    // The screen does not show what we drew the last time
+    VgaInvalidate();
 }
 
 
@@ -226,7 +311,9 @@ static void RestoreBackground(void)
 
     // Restore the frame buffer content that was there before we stepped in
 
-    memcpy(vga.pText, vgaState.textbuf, sizeof(vgaState.textbuf));
+    memcpy(vga.pText, vgaState.textbuf, vgaState.nLines * MAX_VGA_SIZEX * 2);
+
+    VgaInvalidate();
 }
 
 
@@ -334,14 +421,16 @@ static void ScrollUp()
     if( (vga.scrollTop < vga.scrollBottom) && (vga.scrollBottom < outVga.sizeY) )
     {
         // Scroll up all requested lines
-        memmove(vga.pText + (vga.scrollTop * outVga.sizeX) * 2,
-                vga.pText + ((vga.scrollTop + 1) * outVga.sizeX) * 2,
+        memmove(SHADOW(0, vga.scrollTop),
+                SHADOW(0, vga.scrollTop + 1),
                 outVga.sizeX * 2 * (vga.scrollBottom - vga.scrollTop));
 
         // Clear the last line
-        memset_w(vga.pText + (vga.scrollBottom * outVga.sizeX) * 2,
+        memset_w(SHADOW(0, vga.scrollBottom),
                deb.col[COL_NORMAL] * 256 + ' ',
                outVga.sizeX );
+
+        memset(&vga.Dirty[vga.scrollTop], TRUE, vga.scrollBottom - vga.scrollTop + 1);
     }
 }
 
@@ -389,9 +478,13 @@ void VgaSprint(char *s)
 
                 case DP_CLS:
                         // Clear the screen and reset the cursor coordinates
-                        memset_w(vga.pText,
+                        memset_w(SHADOW(0, 0),
                             deb.col[COL_NORMAL] * 256 + ' ',
                             outVga.sizeY * outVga.sizeX);
+
+                        // Whole screen is redrawn; also rewrite what the
+                        // debugee may have printed while it was running
+                        VgaInvalidate();
                         outVga.x = 0;
                         outVga.y = 0;
                     break;
@@ -430,14 +523,16 @@ void VgaSprint(char *s)
                         if( (vga.scrollTop < vga.scrollBottom) && (vga.scrollBottom < outVga.sizeY) )
                         {
                             // Scroll down all requested lines
-                            memmove(vga.pText + ((vga.scrollTop + 1) * outVga.sizeX) * 2,
-                                    vga.pText + (vga.scrollTop * outVga.sizeX) * 2,
+                            memmove(SHADOW(0, vga.scrollTop + 1),
+                                    SHADOW(0, vga.scrollTop),
                                     outVga.sizeX * 2 * (vga.scrollBottom - vga.scrollTop));
 
                             // Clear the first line
-                            memset_w(vga.pText + (vga.scrollTop * outVga.sizeX) * 2,
+                            memset_w(SHADOW(0, vga.scrollTop),
                                    deb.col[COL_NORMAL] * 256 + ' ',
                                    outVga.sizeX);
+
+                            memset(&vga.Dirty[vga.scrollTop], TRUE, vga.scrollBottom - vga.scrollTop + 1);
                         }
                     break;
 
@@ -447,9 +542,10 @@ void VgaSprint(char *s)
 
                 case '\r':
                         // Erase all characters to the right of the cursor pos and move cursor back
-                        memset_w(vga.pText + (outVga.x +  outVga.y * outVga.sizeX) * 2,
+                        memset_w(SHADOW(outVga.x, outVga.y),
                                 deb.col[vga.col] * 256 + ' ',
                                 outVga.sizeX - outVga.x);
+                        vga.Dirty[outVga.y] = TRUE;
                         outVga.x = 0;
                         vga.col = COL_NORMAL;
                     break;
@@ -481,8 +577,8 @@ void VgaSprint(char *s)
                         // All printable characters
                         if( outVga.x < outVga.sizeX )
                         {
-                            *(WORD *)(vga.pText + (outVga.x +  outVga.y * outVga.sizeX) * 2)
-                                = (WORD) c + deb.col[vga.col] * 256;
+                            *(WORD *) SHADOW(outVga.x, outVga.y) = (WORD) c + deb.col[vga.col] * 256;
+                            vga.Dirty[outVga.y] = TRUE;
 
                             // Advance the print position
                             outVga.x++;
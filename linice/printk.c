@@ -29,6 +29,13 @@
         This module contains the printk hook and supports the functionality
         of capturing the kernel printk() into Linice command buffer.
 
+        A captured message is not formatted when it is printed. Its format
+        pointer and raw arguments go into the capture ring of the CPU that
+        printed it, and the messages are formatted into the command window
+        when the debugger is entered. A message that does not fit into a
+        full ring is dropped and counted. Only the strings that %s arguments
+        point to are copied, since they may be gone by then.
+
 *******************************************************************************
 *                                                                             *
 *   Major changes:                                                            *
@@ -63,12 +70,173 @@
 static BYTE PrintkKernelCodeLine[5];    // Buffer to store original code bytes
 static BYTE *PrintkAddress = NULL;      // Address of the printk() function
 
+#define PRINTK_DEFAULT_LEVEL    4       // Level of messages without the <n> prefix
+#define PRINTK_MAX_WIDTH        80      // Widest field that is formatted
+
+// Captured message; string arguments hold the offset of their copy that
+// follows the arguments. A record with the format of 0 pads the ring.
+
+typedef struct
+{
+    DWORD dwFormat;                     // Address of the format string
+    DWORD dwCaller;                     // Return address into the caller of printk()
+    DWORD dwSeq;                        // Sequence number to merge the rings of all CPUs
+    WORD wSize;                         // Size of the record, DWORD aligned
+    BYTE nArgs;                         // Number of argument DWORDs
+    BYTE bLevel;                        // Log level of the message
+    DWORD Arg[1];                       // Argument DWORDs, followed by the strings
+
+} TPRINTKREC;
+
+#define PRINTK_REC_HEADER   (sizeof(TPRINTKREC) - sizeof(DWORD))
+
+// Messages captured on a single CPU; ring positions are free running
+
+typedef struct
+{
+    BYTE Ring[MAX_PRINTK_RING];         // Records of the captured messages
+    DWORD dwHead;                       // Ring position of the next record to write
+    DWORD dwTail;                       // Ring position of the oldest record
+    DWORD dwLock;                       // Taken while a record is written
+    DWORD dwCaptured;                   // Number of messages captured
+    DWORD dwDropped;                    // Number of messages that did not fit
+    DWORD dwFiltered;                   // Number of messages filtered out
+
+} TPRINTKCPU;
+
+static TPRINTKCPU Printk[MAX_CPU];      // Capture rings, one for each CPU
+static DWORD dwPrintkSeq = 0;           // Next sequence number, shared by all CPUs
+static UINT nPrintkLevel = 7;           // Highest log level that is captured
+static char sPrintkModule[MAX_MODULE_NAME] = "";    // Only print messages from this module
+
+// Conversion specification of a format string
+
+typedef struct
+{
+    BOOL fLeft, fSign, fSpace, fZero;   // Flags that we can format
+    int width;                          // Field width, -1 if given as an argument
+    int precision;                      // Precision, -1 if none, -2 if given as an argument
+    int nLong;                          // Number of long modifiers
+    BOOL fShort;                        // Short modifier
+    char conv;                          // Conversion character, 0 if not supported
+
+} TSPEC;
+
+/******************************************************************************
+*                                                                             *
+*   External Functions                                                        *
+*                                                                             *
+******************************************************************************/
+
+extern TSYMTAB *SymTabFind(char *name, BYTE SymTableType);
+extern DWORD SpinlockTry(DWORD *pSpinlock);
+extern DWORD AtomicIncrement(DWORD *pValue);
+extern void  SpinlockReset(DWORD *pSpinlock);
+
 /******************************************************************************
 *                                                                             *
 *   Functions                                                                 *
 *                                                                             *
 ******************************************************************************/
 
+/******************************************************************************
+*                                                                             *
+*   static char *PrintkSpec(char *pFmt, TSPEC *pSpec)                         *
+*                                                                             *
+*******************************************************************************
+*
+*   Parses a conversion specification of the kernel printk() format. It is
+*   used both when capturing and when formatting, so the arguments are
+*   always consumed the same way.
+*
+*   Where:
+*       pFmt is the format string following the '%' character
+*       pSpec is the specification to fill in
+*
+*   Returns:
+*       Format string following the specification
+*
+******************************************************************************/
+static char *PrintkSpec(char *pFmt, TSPEC *pSpec)
+{
+    memset(pSpec, 0, sizeof(TSPEC));
+    pSpec->precision = -1;
+
+    for(;; pFmt++)
+    {
+        if( *pFmt=='-' ) pSpec->fLeft = TRUE;
+        else
+        if( *pFmt=='+' ) pSpec->fSign = TRUE;
+        else
+        if( *pFmt==' ' ) pSpec->fSpace = TRUE;
+        else
+        if( *pFmt=='0' ) pSpec->fZero = TRUE;
+        else
+        if( *pFmt!='#' )
+            break;
+    }
+
+    if( *pFmt=='*' )
+        pSpec->width = -1, pFmt++;
+    else
+        while( isdigit(*pFmt) )
+            pSpec->width = pSpec->width * 10 + *pFmt++ - '0';
+
+    if( *pFmt=='.' )
+    {
+        pFmt++;
+
+        if( *pFmt=='*' )
+            pSpec->precision = -2, pFmt++;
+        else
+            for(pSpec->precision=0; isdigit(*pFmt); )
+                pSpec->precision = pSpec->precision * 10 + *pFmt++ - '0';
+    }
+
+    // Size_t, ptrdiff_t and intmax_t are all 32 bits
+    for(;; pFmt++)
+    {
+        if( *pFmt=='h' ) pSpec->fShort = TRUE;
+        else
+        if( *pFmt=='l' ) pSpec->nLong++;
+        else
+        if( *pFmt=='L' || *pFmt=='q' ) pSpec->nLong += 2;
+        else
+        if( *pFmt!='z' && *pFmt!='Z' && *pFmt!='t' && *pFmt!='j' )
+            break;
+    }
+
+    if( *pFmt && strchr("diuoxXcspn%", *pFmt) )
+        pSpec->conv = *pFmt++;
+
+    return( pFmt );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static UINT PrintkArgs(TSPEC *pSpec)                                      *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the number of argument DWORDs that a specification consumes.
+*   The last one is the value itself.
+*
+******************************************************************************/
+static UINT PrintkArgs(TSPEC *pSpec)
+{
+    UINT n = 0;
+
+    if( pSpec->conv && pSpec->conv!='%' )
+    {
+        n = (pSpec->width==-1) + (pSpec->precision==-2) + 1;
+
+        if( pSpec->nLong >= 2 && strchr("diuoxX", pSpec->conv) )
+            n++;
+    }
+
+    return( n );
+}
+
 /******************************************************************************
 *                                                                             *
 *   asmlinkage void PrintkHandler(char *format, ...)                          *
@@ -77,30 +245,445 @@ static BYTE *PrintkAddress = NULL;      // Address of the printk() function
 *
 *   This function gets called instead of kernel printk() after we are hooked.
 *
+*   The message is stored into the capture ring of this CPU; the record is
+*   written under a try-lock so a printk() from an interrupt that arrives
+*   while a record is being written is dropped instead of corrupting it.
+*
 ******************************************************************************/
 asmlinkage void PrintkHandler(char *format, ...)
 {
-    static char printBuf[1024];
-    char *p;
+    WORD Len[MAX_PRINTK_ARGS];          // Size of the copy of each string argument
+    TPRINTKCPU *pCpu;                   // Capture ring of this CPU
+    TPRINTKREC *pRec;
+    TSPEC Spec;
+    DWORD Arg[MAX_PRINTK_ARGS];         // Arguments of printk() as DWORDs
+    DWORD dwCaller;                     // Return address into the caller
+    DWORD pos, pad, size;
+    UINT cpu, nArgs, nSpec, nStrings, limit, i;
+    BYTE bLevel;
+    char *p, *pStr;
     va_list arg;
 
-    // TODO: It is possible to overflow the buffer by printk()-ing a large string. Fix it.
+    cpu = ice_smp_processor_id();
+    if( cpu >= MAX_CPU )
+        return;
+
+    pCpu = &Printk[cpu];
+
+    bLevel = PRINTK_DEFAULT_LEVEL;
+    if( format[0]=='<' && format[1]>='0' && format[1]<='7' && format[2]=='>' )
+        bLevel = format[1] - '0';
+
+    if( bLevel > nPrintkLevel )
+    {
+        pCpu->dwFiltered++;
+        return;
+    }
+
+    dwCaller = (DWORD) __builtin_return_address(0);
+
+    // Fetch the arguments and count the space for the copies of the strings
+    va_start(arg, format);
+
+    for(p=format, nArgs=0, nStrings=0; *p; )
+    {
+        if( *p++ != '%' )
+            continue;
+
+        p = PrintkSpec(p, &Spec);
+        nSpec = PrintkArgs(&Spec);
+
+        if( Spec.conv==0 || nArgs + nSpec > MAX_PRINTK_ARGS )
+            break;
+
+        for(i=0; i<nSpec; i++)
+        {
+            Arg[nArgs + i] = va_arg(arg, DWORD);
+            Len[nArgs + i] = 0;
+        }
+
+        if( Spec.conv=='s' )
+        {
+            limit = MAX_PRINTK_STRING - 1;
+
+            if( Spec.precision==-2 && Arg[nArgs + (Spec.width==-1)] < limit )
+                limit = Arg[nArgs + (Spec.width==-1)];
+            else
+            if( Spec.precision >= 0 && Spec.precision < limit )
+                limit = Spec.precision;
+
+            pStr = Arg[nArgs + nSpec - 1]? (char *) Arg[nArgs + nSpec - 1] : "(null)";
+
+            for(i=0; i<limit && pStr[i]; i++);
+
+            Len[nArgs + nSpec - 1] = i + 1;
+            nStrings += i + 1;
+        }
+
+        nArgs += nSpec;
+    }
 
-    // Print the line into our local buffer so we can clean it up and print
-    va_start( arg, format );
-    ivsprintf(printBuf, format, arg);
     va_end(arg);
 
-    // Since we are using our own print driver which has support for more
-    // output options, we need to clean the incoming string from all
-    // non-ASCII characters to avoid the string messing up the output.
-    for(p=printBuf; *p ; p++ )
+    size = (PRINTK_REC_HEADER + nArgs * sizeof(DWORD) + nStrings + 3) & ~3;
+
+    if( SpinlockTry(&pCpu->dwLock)==0 )
+    {
+        // Records do not wrap around; pad the end of the ring if needed
+        pos = pCpu->dwHead;
+        pad = MAX_PRINTK_RING - (pos & (MAX_PRINTK_RING - 1));
+        if( pad >= size )
+            pad = 0;
+
+        if( pos + pad + size - pCpu->dwTail <= MAX_PRINTK_RING )
+        {
+            // Too short a pad is recognized by the reader without a header
+            if( pad >= PRINTK_REC_HEADER )
+            {
+                pRec = (TPRINTKREC *) &pCpu->Ring[pos & (MAX_PRINTK_RING - 1)];
+                pRec->dwFormat = 0;
+                pRec->wSize = pad;
+            }
+
+            pos += pad;
+            pRec = (TPRINTKREC *) &pCpu->Ring[pos & (MAX_PRINTK_RING - 1)];
+
+            pRec->dwFormat = (DWORD) format;
+            pRec->dwCaller = dwCaller;
+            pRec->dwSeq    = AtomicIncrement(&dwPrintkSeq);
+            pRec->wSize    = size;
+            pRec->nArgs    = nArgs;
+            pRec->bLevel   = bLevel;
+
+            for(i=0, size=PRINTK_REC_HEADER + nArgs * sizeof(DWORD); i<nArgs; i++)
+            {
+                if( Len[i] )
+                {
+                    pStr = Arg[i]? (char *) Arg[i] : "(null)";
+
+                    memcpy((BYTE *) pRec + size, pStr, Len[i] - 1);
+                    *((BYTE *) pRec + size + Len[i] - 1) = 0;
+
+                    pRec->Arg[i] = size;
+                    size += Len[i];
+                }
+                else
+                    pRec->Arg[i] = Arg[i];
+            }
+
+            pCpu->dwHead = pos + pRec->wSize;
+            pCpu->dwCaptured++;
+        }
+        else
+            pCpu->dwDropped++;
+
+        SpinlockReset(&pCpu->dwLock);
+    }
+    else
+        pCpu->dwDropped++;
+}
+
+/******************************************************************************
+*                                                                             *
+*   static TPRINTKREC *PrintkNext(TPRINTKCPU *pCpu)                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the oldest message of a capture ring, skipping the pads.
+*
+*   Returns:
+*       Address of the message record
+*       NULL if the ring is empty
+*
+******************************************************************************/
+static TPRINTKREC *PrintkNext(TPRINTKCPU *pCpu)
+{
+    TPRINTKREC *pRec;
+    DWORD dwLeft;                       // Bytes to the end of the ring
+
+    while( pCpu->dwTail != pCpu->dwHead )
     {
-        if( !isprint(*p) )
-            *p = ' ';
+        dwLeft = MAX_PRINTK_RING - (pCpu->dwTail & (MAX_PRINTK_RING - 1));
+
+        if( dwLeft < PRINTK_REC_HEADER )
+        {
+            pCpu->dwTail += dwLeft;
+            continue;
+        }
+
+        pRec = (TPRINTKREC *) &pCpu->Ring[pCpu->dwTail & (MAX_PRINTK_RING - 1)];
+
+        if( pRec->dwFormat )
+            return( pRec );
+
+        pCpu->dwTail += pRec->wSize;
     }
 
-    dprinth(1, "%s", printBuf);
+    return( NULL );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL PrintkModuleMatch(DWORD dwCaller)                             *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks whether a message was printed by the selected module. A module
+*   with a loaded symbol table is matched by its functions, any other by its
+*   exported symbols.
+*
+*   Where:
+*       dwCaller is the return address into the caller of printk()
+*
+******************************************************************************/
+static BOOL PrintkModuleMatch(DWORD dwCaller)
+{
+    TSYMTAB *pSymTab;
+    TSYMGLOBAL *pGlobals;
+    DWORD dwStart;                      // Relocated function start address
+    UINT range, len;
+    char *pName;
+    int i;
+
+    if( !*sPrintkModule )
+        return( TRUE );
+
+    if( (pSymTab = SymTabFind(sPrintkModule, SYMTABLETYPE_UNDEF)) )
+    {
+        pGlobals = (TSYMGLOBAL *)SymTabFindSection(pSymTab, HTYPE_GLOBALS);
+
+        for(i=0; pGlobals && i<pGlobals->nGlobals; i++ )
+        {
+            dwStart = pGlobals->list[i].dwStartAddress + SymTabReloc(pSymTab, pGlobals->list[i].bSegment);
+
+            if( dwCaller > dwStart && dwCaller - dwStart <= pGlobals->list[i].dwEndAddress - pGlobals->list[i].dwStartAddress )
+                return( TRUE );
+        }
+
+        return( FALSE );
+    }
+
+    len = strlen(sPrintkModule);
+
+    // The return address is looked up one byte back, inside of the call
+    pName = SymAddress2Name(dwCaller - 1, &range);
+
+    return( pName && pName[len]=='!' && !strnicmp(pName, sPrintkModule, len) );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void PrintkPrint(TPRINTKREC *pRec)                                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Formats a captured message into the command window, one line for each
+*   line of the message. The format string is read through the guarded
+*   memory access since its module may have been unloaded since.
+*
+******************************************************************************/
+static void PrintkPrint(TPRINTKREC *pRec)
+{
+    static char sFormat[MAX_PRINTK_LINE];
+    static char sLine[MAX_PRINTK_LINE + MAX_PRINTK_STRING + PRINTK_MAX_WIDTH];
+    char sSpec[24];                     // Specification passed to sprintf()
+    TSPEC Spec;
+    DWORD dwValue, dwHigh;
+    UINT n, i, len;
+    int width;
+    char *p;
+    BYTE c;
+
+    for(i=0; i<sizeof(sFormat)-1 && GlobalReadBYTE(&c, pRec->dwFormat + i) && c; i++)
+        sFormat[i] = c;
+
+    sFormat[i] = 0;
+
+    if( i==0 )
+    {
+        dprinth(1, "printk() format at %08X is not present", pRec->dwFormat);
+        return;
+    }
+
+    p = sFormat;
+    if( p[0]=='<' && p[1] && p[2]=='>' )
+        p += 3;
+
+    for(n=0, len=0; *p && len < MAX_PRINTK_LINE; )
+    {
+        if( *p!='%' )
+        {
+            c = *p++;
+
+            if( c=='\n' )
+            {
+                sLine[len] = 0;
+                if( len )
+                    dprinth(1, "%s", sLine);
+                len = 0;
+            }
+            else
+                sLine[len++] = isprint(c)? c : ' ';
+
+            continue;
+        }
+
+        p = PrintkSpec(p + 1, &Spec);
+
+        if( Spec.conv=='%' )
+        {
+            sLine[len++] = '%';
+            continue;
+        }
+
+        if( Spec.conv==0 || n + PrintkArgs(&Spec) > pRec->nArgs )
+            break;
+
+        width = Spec.width;
+        if( width==-1 )
+        {
+            width = pRec->Arg[n++];
+            if( width < 0 )
+                width = -width, Spec.fLeft = TRUE;
+        }
+
+        if( Spec.precision==-2 )
+            n++;
+
+        // Our sprintf() knows a subset of the flags and no precision
+        sprintf(sSpec, "%%%s%s%s%s%d%s",
+            Spec.fLeft? "-":"", Spec.fSign? "+":"", Spec.fSpace? " ":"", Spec.fZero? "0":"",
+            MIN(width, PRINTK_MAX_WIDTH), Spec.fShort? "h":"");
+
+        dwValue = pRec->Arg[n++];
+
+        switch( Spec.conv )
+        {
+            case 'n':
+                break;
+
+            case 's':
+                strcat(sSpec, "s");
+                len += sprintf(sLine + len, sSpec, (char *) pRec + dwValue);
+                break;
+
+            case 'p':
+                len += sprintf(sLine + len, "%08X", dwValue);
+                break;
+
+            case 'c':
+                strcat(sSpec, "c");
+                len += sprintf(sLine + len, sSpec, isprint((BYTE) dwValue)? (BYTE) dwValue : ' ');
+                break;
+
+            default:
+                // Long long values are printed in hex unless they fit into 32 bits
+                if( Spec.nLong >= 2 )
+                {
+                    dwHigh = pRec->Arg[n++];
+
+                    if( dwHigh && !(dwHigh==0xFFFFFFFF && (int)dwValue < 0 && strchr("di", Spec.conv)) )
+                    {
+                        len += sprintf(sLine + len, "%s%X%08X", strchr("xX", Spec.conv)? "":"0x", dwHigh, dwValue);
+                        break;
+                    }
+                }
+
+                i = strlen(sSpec);
+                sSpec[i] = Spec.conv=='o'? 'x' : Spec.conv;
+                sSpec[i + 1] = 0;
+                len += sprintf(sLine + len, sSpec, dwValue);
+                break;
+        }
+    }
+
+    sLine[len] = 0;
+    if( len )
+        dprinth(1, "%s", sLine);
+}
+
+/******************************************************************************
+*                                                                             *
+*   void PrintkDrain(void)                                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Prints all captured messages of all CPUs in the order they were printed
+*   and empties the capture rings. Called on the debugger entry, while the
+*   other CPUs are stopped.
+*
+******************************************************************************/
+void PrintkDrain(void)
+{
+    TPRINTKREC *pRec, *pOldest;
+    TPRINTKCPU *pCpu;
+    UINT cpu, cpuOldest;
+
+    for(;;)
+    {
+        pOldest = NULL;
+        cpuOldest = 0;
+
+        for(cpu=0; cpu<MAX_CPU; cpu++)
+        {
+            pRec = PrintkNext(&Printk[cpu]);
+
+            if( pRec && (pOldest==NULL || (int)(pRec->dwSeq - pOldest->dwSeq) < 0) )
+            {
+                pOldest = pRec;
+                cpuOldest = cpu;
+            }
+        }
+
+        if( pOldest==NULL )
+            break;
+
+        pCpu = &Printk[cpuOldest];
+
+        if( PrintkModuleMatch(pOldest->dwCaller) )
+            PrintkPrint(pOldest);
+        else
+            pCpu->dwFiltered++;
+
+        pCpu->dwTail += pOldest->wSize;
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void PrintkStat(UINT cpu, DWORD *pCaptured, DWORD *pDropped, DWORD *pFiltered)
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the capture counts of a CPU.
+*
+******************************************************************************/
+void PrintkStat(UINT cpu, DWORD *pCaptured, DWORD *pDropped, DWORD *pFiltered)
+{
+    *pCaptured = Printk[cpu].dwCaptured;
+    *pDropped  = Printk[cpu].dwDropped;
+    *pFiltered = Printk[cpu].dwFiltered;
+}
+
+/******************************************************************************
+*                                                                             *
+*   void PrintkStatReset(void)                                                *
+*                                                                             *
+*******************************************************************************
+*
+*   Clears the capture counts of all CPUs. The captured messages are kept.
+*
+******************************************************************************/
+void PrintkStatReset(void)
+{
+    UINT cpu;
+
+    for(cpu=0; cpu<MAX_CPU; cpu++)
+    {
+        Printk[cpu].dwCaptured = 0;
+        Printk[cpu].dwDropped  = 0;
+        Printk[cpu].dwFiltered = 0;
+    }
 }
 
 /******************************************************************************
@@ -162,3 +745,94 @@ void UnhookPrintk(void)
     }
 }
 
+/******************************************************************************
+*                                                                             *
+*   BOOL cmdPrintk(char *args, int subClass)                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Controls the capture of the kernel printk() messages:
+*
+*       PRINTK [ON | OFF | CLEAR]
+*       PRINTK LEVEL n
+*       PRINTK MODULE [name | *]
+*
+*   ON and OFF hook and unhook the kernel printk(), CLEAR discards the
+*   captured messages that were not printed yet. LEVEL sets the highest log
+*   level that is captured, MODULE prints only the messages of a module.
+*   Without arguments, the capture counts of each CPU are listed.
+*
+******************************************************************************/
+BOOL cmdPrintk(char *args, int subClass)
+{
+    TPRINTKCPU *pCpu;
+    UINT level, cpu;
+
+    if( !strnicmp(args, "level", 5) && (args[5]==' ' || args[5]==0) )
+    {
+        args += 5;
+        while( *args==' ' ) args++;
+
+        if( GetDecB(&level, &args) && !*args && level<=7 )
+            nPrintkLevel = level;
+        else
+            PostError(ERR_SYNTAX, 0);
+    }
+    else
+    if( !strnicmp(args, "module", 6) && (args[6]==' ' || args[6]==0) )
+    {
+        args += 6;
+        while( *args==' ' ) args++;
+
+        if( !*args || !strcmp(args, "*") )
+            *sPrintkModule = 0;
+        else
+        {
+            strncpy(sPrintkModule, args, MAX_MODULE_NAME - 1);
+            sPrintkModule[MAX_MODULE_NAME - 1] = 0;
+        }
+    }
+    else
+    if( !stricmp(args, "clear") )
+    {
+        for(cpu=0; cpu<MAX_CPU; cpu++)
+            Printk[cpu].dwTail = Printk[cpu].dwHead;
+    }
+    else
+    {
+        switch( GetOnOff(args) )
+        {
+            case 1:         // On
+                HookPrintk();
+                break;
+
+            case 2:         // Off
+                UnhookPrintk();
+                break;
+
+            case 3:         // List the capture counts
+                dprinth(1, "printk() is %s, level %d, module %s",
+                    PrintkAddress? "hooked":"not hooked", nPrintkLevel, *sPrintkModule? sPrintkModule : "*");
+
+                if( dprinth(1, "CPU  Captured  Dropped   Filtered  Bytes") )
+                {
+                    for(cpu=0; cpu<MAX_CPU; cpu++)
+                    {
+                        pCpu = &Printk[cpu];
+
+                        if( pCpu->dwCaptured || pCpu->dwDropped || pCpu->dwFiltered )
+                        {
+                            if( !dprinth(1, "%3d  %8d  %8d  %8d  %7d", cpu,
+                                pCpu->dwCaptured, pCpu->dwDropped, pCpu->dwFiltered,
+                                pCpu->dwHead - pCpu->dwTail) )
+                                break;
+                        }
+                    }
+                }
+                break;
+        }
+    }
+
+    return( TRUE );
+}
+
@@ -26,7 +26,8 @@
 
     Module Description:
 
-        Simple read-only /proc virtual file implementation
+        /proc virtual file implementation. Reading it returns the debugger
+        statistics, writing it resets them.
 
 *******************************************************************************
 *                                                                             *
@@ -60,9 +61,17 @@
 *                                                                             *
 ******************************************************************************/
 
-static int ProcRead(char *buf, char **start, off_t offset, int len, int *unused, int *data);
+static int ProcRead(char *buf, char **start, off_t offset, int len, int *eof, int *data);
 static int ProcWrite(void *file, char *buf, unsigned long count, void *data);
 
+static char ProcPage[MAX_PROC_STAT];    // Snapshot of the statistics page
+static int nProcPage = 0;               // Length of the snapshot
+
+extern void PrintkStat(UINT cpu, DWORD *pCaptured, DWORD *pDropped, DWORD *pFiltered);
+extern void PrintkStatReset(void);
+extern void HeapStat(BYTE *pHeap, DWORD *pUsed, DWORD *pMaxUsed);
+extern void HeapStatReset(BYTE *pHeap);
+
 /******************************************************************************
 *                                                                             *
 *   Functions                                                                 *
@@ -83,36 +92,164 @@ int CloseProcFs()
 
 /******************************************************************************
 *                                                                             *
-*   int ProcRead(char *buf, char **start, off_t offset, int len, int *unused) *
+*   static void ProcLine(char *pKey, DWORD *pValue, UINT nValues)             *
 *                                                                             *
 *******************************************************************************
 *
-*   Called when /proc/linice is read.
+*   Appends one line of the statistics page: a key followed by its values.
+*
+******************************************************************************/
+static void ProcLine(char *pKey, DWORD *pValue, UINT nValues)
+{
+    UINT i;
+
+    // Every line fits into 256 bytes, drop the lines that would not fit
+    if( nProcPage < MAX_PROC_STAT - 256 )
+    {
+        nProcPage += sprintf(ProcPage + nProcPage, "%s", pKey);
+
+        for(i=0; i<nValues; i++)
+            nProcPage += sprintf(ProcPage + nProcPage, " %u", pValue[i]);
+
+        ProcPage[nProcPage++] = '\n';
+        ProcPage[nProcPage] = 0;
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void ProcSnapshot(void)                                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Formats the statistics page. Every line starts with a key followed by
+*   one value per CPU, except for the heap lines that list the bytes in use,
+*   the high-water mark and the size of a heap. The interrupt lines are only
+*   listed for the vectors that were counted.
+*
+******************************************************************************/
+static void ProcSnapshot(void)
+{
+    DWORD Value[MAX_CPU], Dummy[2];
+    char sKey[16];
+    UINT nCpus, cpu, nInt;
+    BOOL fCounted;
+
+    nCpus = ice_smp_num_cpus();
+    if( nCpus==0 || nCpus > MAX_CPU )
+        nCpus = MAX_CPU;
+
+    nProcPage = 0;
+
+    Value[0] = nCpus;
+    ProcLine("cpus", Value, 1);
+
+#define PROC_STAT(key, field)                           \
+    for(cpu=0; cpu<nCpus; cpu++)                        \
+        Value[cpu] = deb.Stat[cpu].field;               \
+    ProcLine(key, Value, nCpus)
+
+    PROC_STAT("entries", nEntries);
+    PROC_STAT("cycles.lo", Cycles[0]);
+    PROC_STAT("cycles.hi", Cycles[1]);
+    PROC_STAT("bp.hits", nBpHits);
+    PROC_STAT("bp.misses", nBpMisses);
+    PROC_STAT("bp.logged", nBpLogged);
+    PROC_STAT("sym.lookups", nSymLookups);
+    PROC_STAT("sym.finds", nSymFinds);
+    PROC_STAT("serial.sent", nSerialSent);
+    PROC_STAT("serial.received", nSerialReceived);
+    PROC_STAT("serial.errors", nSerialErrors);
+
+    for(cpu=0; cpu<nCpus; cpu++)
+        PrintkStat(cpu, &Value[cpu], Dummy, Dummy);
+    ProcLine("printk.captured", Value, nCpus);
+
+    for(cpu=0; cpu<nCpus; cpu++)
+        PrintkStat(cpu, Dummy, &Value[cpu], Dummy);
+    ProcLine("printk.dropped", Value, nCpus);
+
+    for(cpu=0; cpu<nCpus; cpu++)
+        PrintkStat(cpu, Dummy, Dummy, &Value[cpu]);
+    ProcLine("printk.filtered", Value, nCpus);
+
+    // Interrupts received while the debugee runs and while Linice runs
+
+#undef PROC_STAT
+
+    for(nInt=0; nInt<0x40; nInt++)
+    {
+        for(cpu=0, fCounted=FALSE; cpu<nCpus; cpu++)
+            if( (Value[cpu] = deb.Stat[cpu].nIntsPass[nInt]) )
+                fCounted = TRUE;
+
+        if( fCounted )
+        {
+            sprintf(sKey, "pass.%02X", nInt);
+            ProcLine(sKey, Value, nCpus);
+        }
+    }
+
+    for(nInt=0; nInt<0x40; nInt++)
+    {
+        for(cpu=0, fCounted=FALSE; cpu<nCpus; cpu++)
+            if( (Value[cpu] = deb.Stat[cpu].nIntsIce[nInt]) )
+                fCounted = TRUE;
+
+        if( fCounted )
+        {
+            sprintf(sKey, "ice.%02X", nInt);
+            ProcLine(sKey, Value, nCpus);
+        }
+    }
+
+    // Heaps
+
+    HeapStat(deb.hHeap, &Value[0], &Value[1]);
+    Value[2] = MAX_HEAP;
+    ProcLine("heap", Value, 3);
+
+    HeapStat(deb.hSymbolBufferHeap, &Value[0], &Value[1]);
+    Value[2] = deb.nSymbolBufferSize;
+    ProcLine("heap.symbols", Value, 3);
+}
+
+/******************************************************************************
+*                                                                             *
+*   int ProcRead(char *buf, char **start, off_t offset, int len, int *eof, int *data)
+*                                                                             *
+*******************************************************************************
+*
+*   Called when /proc/linice is read. The statistics page is formatted at the
+*   start of a read and then returned in as many pieces as the reader asks.
 *
 *   Where:
 *       Standard procfs parameters :)
 *
 *   Returns:
-*       Right now we simply return some collected statistics.
+*       Number of bytes stored into buf
 *
 ******************************************************************************/
-static int ProcRead(char *buf, char **start, off_t offset, int len, int *unused, int *data)
+static int ProcRead(char *buf, char **start, off_t offset, int len, int *eof, int *data)
 {
-    len = 0;
-
     ice_mod_inc_use_count();
 
-    // Print the number of interrupts that we trapped
+    if( offset==0 )
+        ProcSnapshot();
 
-    len += sprintf(buf+len, "Host ints:      Linice ints:\n");
-    len += sprintf(buf+len, " int1:  %5d     %5d\n", deb.nIntsPass[0x01], deb.nIntsIce[0x01]);
-    len += sprintf(buf+len, " int3:  %5d     %5d\n", deb.nIntsPass[0x03], deb.nIntsIce[0x03]);
-    len += sprintf(buf+len, " timer: %5d     %5d\n", deb.nIntsPass[0x20], deb.nIntsIce[0x20]);
-    len += sprintf(buf+len, " kbd:   %5d     %5d\n", deb.nIntsPass[0x21], deb.nIntsIce[0x21]);
-    len += sprintf(buf+len, " com2:  %5d     %5d\n", deb.nIntsPass[0x23], deb.nIntsIce[0x23]);
-    len += sprintf(buf+len, " com1:  %5d     %5d\n", deb.nIntsPass[0x24], deb.nIntsIce[0x24]);
-    len += sprintf(buf+len, " ps/2:  %5d     %5d\n", deb.nIntsPass[0x2C], deb.nIntsIce[0x2C]);
-    len += sprintf(buf+len, " PF:    %5d     %5d\n", deb.nIntsPass[0x0E], deb.nIntsIce[0x0E]);
+    // The page is larger than a buffer, so we return it from the start of
+    // the buffer and let the caller advance the offset
+
+    if( offset >= nProcPage )
+        len = 0;
+    else
+    if( offset + len > nProcPage )
+        len = nProcPage - offset;
+
+    memcpy(buf, ProcPage + offset, len);
+
+    *start = buf;
+    *eof = offset + len >= nProcPage;
 
     ice_mod_dec_use_count();
 
@@ -126,18 +263,24 @@ static int ProcRead(char *buf, char **start, off_t offset, int len, int *unused,
 *                                                                             *
 *******************************************************************************
 *
-*   Called when /proc/linice is written.
+*   Called when /proc/linice is written. Any write resets the statistics,
+*   for example "echo reset > /proc/linice".
 *
 *   Where:
 *       Standard procfs parameters :)
 *
 *   Returns:
-*       We eat all writes for now.
+*       We eat all writes.
 *
 ******************************************************************************/
 static int ProcWrite(void *file, char *buf, unsigned long count, void *data)
 {
+    memset(deb.Stat, 0, sizeof(deb.Stat));
+
+    PrintkStatReset();
+    HeapStatReset(deb.hHeap);
+    HeapStatReset(deb.hSymbolBufferHeap);
+
     // Return the count of data.
     return( count );
 }
-
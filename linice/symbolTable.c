@@ -47,6 +47,7 @@
 #include "clib.h"                       // Include C library header file
 #include "iceface.h"                    // Include iceface module stub protos
 #include "ice.h"                        // Include main debugger structures
+#include "ice-ioctl.h"                  // Include our own IOCTL numbers
 #include "errno.h"                      // Include kernel error numbers
 #include "debug.h"                      // Include our dprintk()
 
@@ -62,6 +63,32 @@
 *                                                                             *
 ******************************************************************************/
 
+#define SYM_PAGE_SIZE       4096        // Symbol tables are page aligned so they can be mapped
+
+// Every symbol table allocation is preceded by this private descriptor which
+// stores the address of the underlying heap block, the reserved size,
+// the table's relocation section which holds the per-segment base offsets
+// and its unwind section
+
+typedef struct
+{
+    TSYMRELOC *pReloc;                  // Relocation section or NULL
+    TSYMUNWIND *pUnwind;                // Unwind section or NULL
+    BYTE *pBlock;                       // Address of the heap block
+    DWORD dwSize;                       // Size accounted from the symbol pool
+
+} TSYMALLOC;
+
+static TSYMTAB *pSymStage = NULL;       // Symbol table staging area
+static DWORD dwStageSize = 0;           // Symbol table file size being staged
+static DWORD dwStageMapSize = 0;        // Size of the staging area (page multiple)
+static int nStageMapped = 0;            // Number of user mappings of the staging area
+
+// The unwinder walks the list of symbol tables from the timer interrupt; it
+// only tries this lock, and a table is unlinked and freed only while holding it
+
+static DWORD dwSymTabLock = 0;
+
 /******************************************************************************
 *                                                                             *
 *   Functions                                                                 *
@@ -69,12 +96,14 @@
 ******************************************************************************/
 
 extern BOOL FindModule(TMODULE *pMod, char *pName, int nNameLen);
+extern DWORD SpinlockTry(DWORD *pSpinlock);
+extern void SpinlockReset(DWORD *pSpinlock);
 
 
 BOOL SymbolTableRemove(char *pTableName, TSYMTAB *pRemove);
 BOOL SymTabSetupRelocOffset(TSYMTAB *pSymTab, DWORD dwInitModule, DWORD dwInitModuleSample);
 void SymTabRelocate(TSYMTAB *pSymTab, int factor);
-static void SymTabMakePointers(TSYMTAB *pSymTab, DWORD dStrings);
+static void SymTabDeferPointers(TSYMTAB *pSymTab);
 
 
 /******************************************************************************
@@ -96,6 +125,174 @@ int CheckSymtab(TSYMTAB *pSymtab)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   static TSYMTAB *SymTabAlloc(DWORD dwSize)                                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Allocates a page aligned block for a symbol table from the dedicated
+*   symbol table pool and accounts for it.
+*
+*   Where:
+*       dwSize is the number of bytes to allocate
+*
+*   Returns:
+*       Address of the symbol table buffer
+*       NULL if there is not enough memory
+*
+******************************************************************************/
+static TSYMTAB *SymTabAlloc(DWORD dwSize)
+{
+    BYTE *pBlock;                       // Heap block that we allocate
+    TSYMALLOC *pAlloc;                  // Private allocation descriptor
+    TSYMTAB *pSymTab;                   // Aligned symbol table address
+
+    if( deb.nSymbolBufferAvail >= dwSize )
+    {
+        pBlock = (BYTE *) mallocHeap(deb.hSymbolBufferHeap, dwSize + SYM_PAGE_SIZE + sizeof(TSYMALLOC));
+        if( pBlock )
+        {
+            pSymTab = (TSYMTAB *)(((DWORD)pBlock + sizeof(TSYMALLOC) + SYM_PAGE_SIZE - 1) & ~(SYM_PAGE_SIZE - 1));
+
+            pAlloc = (TSYMALLOC *)pSymTab - 1;
+            pAlloc->pReloc = NULL;
+            pAlloc->pUnwind = NULL;
+            pAlloc->pBlock = pBlock;
+            pAlloc->dwSize = dwSize;
+
+            deb.nSymbolBufferAvail -= dwSize;
+
+            return( pSymTab );
+        }
+    }
+
+    return( NULL );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void SymTabFree(TSYMTAB *pSymTab)                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Releases a symbol table block allocated by SymTabAlloc().
+*
+******************************************************************************/
+static void SymTabFree(TSYMTAB *pSymTab)
+{
+    TSYMALLOC *pAlloc;                  // Private allocation descriptor
+
+    pAlloc = (TSYMALLOC *)pSymTab - 1;
+
+    deb.nSymbolBufferAvail += pAlloc->dwSize;
+
+    freeHeap(deb.hSymbolBufferHeap, pAlloc->pBlock);
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static int SymTabCheckHeader(TSYMTAB *pSymHeader)                         *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks the signature and the version of the symbol table header.
+*
+*   Returns:
+*       0 header ok
+*       -EINVAL Bad symbol table
+*
+******************************************************************************/
+static int SymTabCheckHeader(TSYMTAB *pSymHeader)
+{
+    // Make sure we are really loading a symbol table
+    if( !strcmp(pSymHeader->sSig, SYMSIG) )
+    {
+        // TODO: Here we also want to check the CRC or something like that for a table being loaded
+        //       Just to make sure it is not corrupted.
+
+        // Compare the symbol table version - major number has to match
+        if( (pSymHeader->Version>>8)==(SYMVER>>8) )
+            return( 0 );
+
+        dprinth(1, "Error: Symbol table has incompatible version number!");
+    }
+    else
+    {
+        dprinth(1, "Invalid symbol table signature!");
+    }
+
+    return( -EINVAL );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void SymTabLink(TSYMTAB *pSymTab)                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Links a complete, loaded symbol table into the list of symbol tables,
+*   makes it current and, if it describes a kernel module that is already
+*   loaded, relocates it.
+*
+******************************************************************************/
+static void SymTabLink(TSYMTAB *pSymTab)
+{
+    TMODULE Mod;                        // Module information structure
+    TSYMRELOC *pReloc;                  // Symbol table relocation header
+    int i;
+
+    dprinth(1, "Loaded symbols for module `%s' size %d (ver %d.%d)",
+        pSymTab->sTableName, pSymTab->dwSize, pSymTab->Version>>8, pSymTab->Version&0xFF);
+
+    // Strings within the table are stored as offsets. Instead of relocating them
+    // all here, mark the sections and convert each one on its first use
+    SymTabDeferPointers(pSymTab);
+
+    // Cache the relocation section; all segments start unrelocated
+    pReloc = (TSYMRELOC *) SymTabFindSection(pSymTab, HTYPE_RELOC);
+    if( pReloc )
+    {
+        for(i=0; i<pReloc->nReloc; i++)
+            pReloc->list[i].reloc = 0;
+    }
+
+    ((TSYMALLOC *)pSymTab - 1)->pReloc = pReloc;
+
+    // Cache the unwind section as well, the unwinder runs from the timer interrupt
+    ((TSYMALLOC *)pSymTab - 1)->pUnwind = (TSYMUNWIND *) SymTabFindSection(pSymTab, HTYPE_UNWIND);
+
+    // Link this symbol table in the linked list and also make it current. It
+    // is complete before it is linked, so the unwinder can walk it at any time
+    pSymTab->next = (struct TSYMTAB *) deb.pSymTab;
+
+    deb.pSymTab = pSymTab;
+    deb.pSymTabCur = deb.pSymTab;
+
+    // If the symbol table being loaded describes a kernel module, we need to
+    // see if that module is already loaded, and if so, relocate its symbols
+
+    // If a module with that symbol name has already been loaded prepare the new table
+    if( FindModule(&Mod, pSymTab->sTableName, strlen(pSymTab->sTableName)) )
+    {
+        // Module is already loaded - we need to relocate symbol table based on it
+
+        // Setup relocation offsets
+        if( SymTabSetupRelocOffset(pSymTab, (DWORD) Mod.init, (DWORD) Mod.init) )
+        {
+            // Relocate symbol table
+            SymTabRelocate(pSymTab, 1);
+
+            // Make that symbol table the current one
+            deb.pSymTabCur = pSymTab;
+        }
+    }
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   int UserAddSymbolTable(void *pSymUser)                                    *
@@ -119,113 +316,59 @@ int UserAddSymbolTable(void *pSymUser)
     int retval = -EINVAL;
     TSYMTAB SymHeader;
     TSYMTAB *pSymTab;                   // Symbol table in debugger buffer
-    DWORD dStrings;                     // Offset to strings (to adjust)
-    TMODULE Mod;                        // Module information structure
 
     // Copy only the header of the symbol table into a local structure to examine it
     if( ice_copy_from_user(&SymHeader, pSymUser, sizeof(TSYMTAB))==0 )
     {
-        // Make sure we are really loading a symbol table
-        if( !strcmp(SymHeader.sSig, SYMSIG) )
+        if( (retval = SymTabCheckHeader(&SymHeader))==0 )
         {
-            // TODO: Here we also want to check the CRC or something like that for a table being loaded
-            //       Just to make sure it is not corrupted.
-
-            // Compare the symbol table version - major number has to match
-            if( (SymHeader.Version>>8)==(SYMVER>>8) )
-            {
-                // If we are reloading an existing symbol table, remove it from Linice
+            // If we are reloading an existing symbol table, remove it from Linice
 
-                // TODO: Remove all associated breakpoints in this function?
+            // TODO: Remove all associated breakpoints in this function?
 
-                SymbolTableRemove(SymHeader.sTableName, NULL);
+            SymbolTableRemove(SymHeader.sTableName, NULL);
 
-                // Check that we have enough memory to allocate from the dedicated memory pool
-                if( deb.nSymbolBufferAvail >= SymHeader.dwSize )
+            // Check that we have enough memory to allocate from the dedicated memory pool
+            if( deb.nSymbolBufferAvail >= SymHeader.dwSize )
+            {
+                // Allocate memory for complete symbol table from the dedicated symbol table pool
+                pSymTab = SymTabAlloc(SymHeader.dwSize);
+                if( pSymTab )
                 {
-                    // Allocate memory for complete symbol table from the dedicated symbol table pool
-                    pSymTab = (TSYMTAB *) mallocHeap(deb.hSymbolBufferHeap, SymHeader.dwSize);
-                    if( pSymTab )
-                    {
-                        INFO("Allocated %d bytes at %X for symbol table\n", (int) SymHeader.dwSize, (int) pSymTab);
+                    INFO("Allocated %d bytes at %X for symbol table\n", (int) SymHeader.dwSize, (int) pSymTab);
 
-                        // Copy the complete symbol table from the use space
-                        if( ice_copy_from_user(pSymTab, pSymUser, SymHeader.dwSize)==0 )
-                        {
-                            dprinth(1, "Loaded symbols for module `%s' size %d (ver %d.%d)",
-                                pSymTab->sTableName, pSymTab->dwSize, pSymTab->Version>>8, pSymTab->Version&0xFF);
-
-                            deb.nSymbolBufferAvail -= SymHeader.dwSize;
-
-                            // Link this symbol table in the linked list and also make it current
-                            pSymTab->next = (struct TSYMTAB *) deb.pSymTab;
-
-                            deb.pSymTab = pSymTab;
-                            deb.pSymTabCur = deb.pSymTab;
-
-                            // Initialize elements of the private symbol table structure
-
-                            dStrings = (DWORD) pSymTab + pSymTab->dStrings;
-
-                            // Relocate all strings within this symbol table to pointers (from offsets)
-
-                            SymTabMakePointers(deb.pSymTabCur, dStrings);
-
-                            // If the symbol table being loaded describes a kernel module, we need to
-                            // see if that module is already loaded, and if so, relocate its symbols
-
-                            // If a module with that symbol name has already been loaded prepare the new table
-                            if( FindModule(&Mod, pSymTab->sTableName, strlen(pSymTab->sTableName)) )
-                            {
-                                // Module is already loaded - we need to relocate symbol table based on it
-
-                                // Setup relocation offsets
-                                if( SymTabSetupRelocOffset(pSymTab, (DWORD) Mod.init, (DWORD) Mod.init) )
-                                {
-                                    // Relocate symbol table
-                                    SymTabRelocate(pSymTab, 1);
-
-                                    // Make that symbol table the current one
-                                    deb.pSymTabCur = pSymTab;
-                                }
-                            }
-
-                            // Return OK
-                            return( 0 );
-                        }
-                        else
-                        {
-                            ERROR("Error copying symbol table");
-                            retval = -EFAULT;
-                        }
+                    // Copy the complete symbol table from the use space
+                    if( ice_copy_from_user(pSymTab, pSymUser, SymHeader.dwSize)==0 )
+                    {
+                        SymTabLink(pSymTab);
 
-                        // Deallocate memory for symbol table
-                        freeHeap(deb.hSymbolBufferHeap, (void *) pSymTab);
+                        // Return OK
+                        return( 0 );
                     }
                     else
                     {
-                        // This should not happen since we keep the size in check. It _may_ happen
-                        // if the symbol table memory gets fragmented after repeated use... I doubt
-                        // that would ever happen in the realm of this application.
-                        ERROR("Unable to allocate %d for symbol table!\n", (int) SymHeader.dwSize);
-                        retval = -ENOMEM;
+                        ERROR("Error copying symbol table");
+                        retval = -EFAULT;
                     }
+
+                    // Deallocate memory for symbol table
+                    SymTabFree(pSymTab);
                 }
                 else
                 {
-                    dprinth(1, "Symbol table memory pool too small to load this table!");
+                    // This should not happen since we keep the size in check. It _may_ happen
+                    // if the symbol table memory gets fragmented after repeated use... I doubt
+                    // that would ever happen in the realm of this application.
+                    ERROR("Unable to allocate %d for symbol table!\n", (int) SymHeader.dwSize);
                     retval = -ENOMEM;
                 }
             }
             else
             {
-                dprinth(1, "Error: Symbol table has incompatible version number!");
+                dprinth(1, "Symbol table memory pool too small to load this table!");
+                retval = -ENOMEM;
             }
         }
-        else
-        {
-            dprinth(1, "Invalid symbol table signature!");
-        }
     }
     else
     {
@@ -237,6 +380,176 @@ int UserAddSymbolTable(void *pSymUser)
 }
 
 
+/******************************************************************************
+*                                                                             *
+*   int UserStageSymbolTable(void *pPacket)                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Reserves a page aligned staging area for a symbol table of a given size.
+*   The loader maps that area into its address space (SymTabStageMap) and reads
+*   the symbol file directly into it, so the table is never copied.
+*   Any previously staged, uncommitted area is released; size of 0 only does
+*   that.
+*
+*   Where:
+*       pPacket is the address of the TSYMMAPPACKET in the user space
+*
+*   Returns:
+*       0 staging area reserved
+*       -EINVAL Bad size
+*       -EBUSY previous staging area is still mapped
+*       -EFAULT general failure
+*       -ENOMEM not enough memory
+*
+******************************************************************************/
+int UserStageSymbolTable(void *pPacket)
+{
+    TSYMMAPPACKET Packet;
+
+    if( ice_copy_from_user(&Packet, pPacket, sizeof(TSYMMAPPACKET))==0 )
+    {
+        if( nStageMapped )
+            return( -EBUSY );
+
+        // Release any previously staged table that was never committed
+        if( pSymStage )
+        {
+            SymTabFree(pSymStage);
+            pSymStage = NULL;
+        }
+
+        // Size of zero only releases the staging area
+        if( Packet.dwSize==0 )
+            return( 0 );
+
+        if( Packet.dwSize < sizeof(TSYMTAB) )
+            return( -EINVAL );
+
+        // Round the staging area up to a page size so it can be mapped
+        dwStageSize = Packet.dwSize;
+        dwStageMapSize = (Packet.dwSize + SYM_PAGE_SIZE - 1) & ~(SYM_PAGE_SIZE - 1);
+
+        pSymStage = SymTabAlloc(dwStageMapSize);
+        if( pSymStage )
+        {
+            // Dont give out the stale content of the pool
+            memset(pSymStage, 0, dwStageMapSize);
+
+            Packet.dwMapSize = dwStageMapSize;
+
+            if( ice_copy_to_user(pPacket, &Packet, sizeof(TSYMMAPPACKET))==0 )
+                return( 0 );
+
+            SymTabFree(pSymStage);
+            pSymStage = NULL;
+
+            return( -EFAULT );
+        }
+
+        dprinth(1, "Symbol table memory pool too small to load this table!");
+
+        return( -ENOMEM );
+    }
+
+    ERROR("Invalid IOCTL packet address\n");
+
+    return( -EFAULT );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   int UserCommitSymbolTable(void)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Validates the symbol table that was read into the staging area and links
+*   it into the list of symbol tables, replacing the table of the same name.
+*
+*   Returns:
+*       0 table added
+*       -EINVAL Bad symbol table or nothing staged
+*       -EBUSY staging area is still mapped
+*
+******************************************************************************/
+int UserCommitSymbolTable(void)
+{
+    TSYMTAB *pSymTab = pSymStage;       // Staged symbol table
+    int retval;
+
+    if( pSymTab==NULL )
+        return( -EINVAL );
+
+    // The loader has to unmap the table before we make it live
+    if( nStageMapped )
+        return( -EBUSY );
+
+    pSymStage = NULL;
+
+    if( (retval = SymTabCheckHeader(pSymTab))==0 )
+    {
+        if( pSymTab->dwSize==dwStageSize )
+        {
+            // Make sure the table name is terminated since we use it to remove the old table
+            pSymTab->sTableName[sizeof(pSymTab->sTableName)-1] = 0;
+
+            SymbolTableRemove(pSymTab->sTableName, NULL);
+
+            SymTabLink(pSymTab);
+
+            return( 0 );
+        }
+
+        dprinth(1, "Symbol table size mismatch!");
+        retval = -EINVAL;
+    }
+
+    SymTabFree(pSymTab);
+
+    return( retval );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   void *SymTabStageMap(DWORD dwSize, int delta)                             *
+*                                                                             *
+*******************************************************************************
+*
+*   Called by the mmap() handler to get the staging area to map, and when
+*   a mapping of the staging area is duplicated or released.
+*
+*   Where:
+*       dwSize is the size of the mapping request
+*       delta is 1 for a new mapping, -1 for a mapping that is being released
+*
+*   Returns:
+*       Kernel address of the staging area
+*       NULL if there is no staging area or the size does not fit
+*
+******************************************************************************/
+void *SymTabStageMap(DWORD dwSize, int delta)
+{
+    if( delta < 0 )
+    {
+        if( nStageMapped > 0 )
+            nStageMapped--;
+
+        return( NULL );
+    }
+
+    if( pSymStage && dwSize <= dwStageMapSize )
+    {
+        nStageMapped++;
+
+        return( pSymStage );
+    }
+
+    return( NULL );
+}
+
+
 /******************************************************************************
 *                                                                             *
 *   int UserRemoveSymbolTable(void *pSymtab)                                  *
@@ -318,6 +631,19 @@ BOOL SymbolTableRemove(char *pTableName, TSYMTAB *pRemove)
 
         if( fMatch )
         {
+            // Wait for the unwinder to leave the tables. Within the debugger
+            // the other CPUs are stopped and may be holding the lock, so the
+            // table is then kept
+            while( SpinlockTry(&dwSymTabLock) )
+            {
+                if( deb.fRunningIce )
+                {
+                    dprinth(1, "Symbol table `%s' is in use by the profiler, try again later", pSym->sTableName);
+
+                    return(FALSE);
+                }
+            }
+
             dprinth(1, "Removing symbol table `%s'", pSym->sTableName);
 
             // Found it - unlink, free and return success
@@ -326,15 +652,19 @@ BOOL SymbolTableRemove(char *pTableName, TSYMTAB *pRemove)
             else
                 pPrev->next = pSym->next;                       // Not the first in the linked list
 
-            // Add the memory block to the free pool
-            deb.nSymbolBufferAvail += pSym->dwSize;
+            // Release the symbol table itself and add the memory back to the pool
+            SymTabFree(pSym);
 
-            // Release the symbol table itself
-            freeHeap(deb.hSymbolBufferHeap, (BYTE *)pSym);
+            SpinlockReset(&dwSymTabLock);
 
             // Leave no dangling pointers...
             deb.pSymTabCur = deb.pSymTab;
 
+            // Locals and watch expressions are kept across the context changes
+            // as long as the context is the same; this one is not
+            ListDelAll(&deb.Local);
+            ListResetContext(&deb.Watch);
+
             //------------------------------------------------------------------
             // Symbol table dependency:
             // Find all the pointers that were addressing elements within this
@@ -425,7 +755,8 @@ BOOL cmdTable(char *args, int subClass)
 
                     while( deb.pSymTab )
                     {
-                        SymbolTableRemove(NULL, deb.pSymTab);
+                        if( !SymbolTableRemove(NULL, deb.pSymTab) )
+                            break;
                     }
                 }
                 else
@@ -526,7 +857,8 @@ TSYMTAB *SymTabFind(char *name, BYTE SymTableType)
 *                                                                             *
 *******************************************************************************
 *
-*   Searches for the named section within the given symbol table.
+*   Searches for the named section within the given symbol table. String
+*   pointers of the returned section are valid.
 *
 *   Where:
 *       pSymTab is the address of the symbol table to search
@@ -547,8 +879,8 @@ void *SymTabFindSection(TSYMTAB *pSymTab, BYTE hType)
 
         while( pHead->hType != HTYPE__END )
         {
-            if( pHead->hType == hType )
-                return( (void *)pHead );
+            if( SECTYPE(pHead) == hType )
+                return( (void *)SymTabMakePointers(pSymTab, pHead) );
 
             pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
         }
@@ -589,8 +921,8 @@ void *SymTabFindSectionNext(TSYMTAB *pSymTab, void *pCur, BYTE hType)
         // Advance to the next record
         pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
 
-        if( pHead->hType == hType )
-            return( (void *)pHead );
+        if( SECTYPE(pHead) == hType )
+            return( (void *)SymTabMakePointers(pSymTab, pHead) );
 
     }while( pHead->hType != HTYPE__END );
 
@@ -626,12 +958,12 @@ TSYMSOURCE *SymTabFindSource(TSYMTAB *pSymTab, WORD fileID)
 
         while( pHead->hType != HTYPE__END )
         {
-            if( (pHead->hType == HTYPE_SOURCE) )
+            if( SECTYPE(pHead) == HTYPE_SOURCE )
             {
                 pSource = (TSYMSOURCE *)pHead;
 
                 if( pSource->file_id==fileID )
-                    return( pSource );
+                    return( (TSYMSOURCE *)SymTabMakePointers(pSymTab, pHead) );
             }
 
             pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
@@ -671,12 +1003,12 @@ TSYMTYPEDEF *SymTabFindTypedef(TSYMTAB *pSymTab, WORD fileID)
 
         while( pHead->hType != HTYPE__END )
         {
-            if( (pHead->hType == HTYPE_TYPEDEF) )
+            if( SECTYPE(pHead) == HTYPE_TYPEDEF )
             {
                 pTypedef = (TSYMTYPEDEF *)pHead;
 
                 if( pTypedef->file_id==fileID )
-                    return( pTypedef );
+                    return( (TSYMTYPEDEF *)SymTabMakePointers(pSymTab, pHead) );
             }
 
             pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
@@ -755,12 +1087,16 @@ BOOL SymTabSetupRelocOffset(TSYMTAB *pSymTab, DWORD dwInitModule, DWORD dwInitMo
 
 /******************************************************************************
 *                                                                             *
-*   void SymTabRelocate(TSYMTAB *pSymTab, int factor                          *
+*   void SymTabRelocate(TSYMTAB *pSymTab, int factor)                         *
 *                                                                             *
 *******************************************************************************
 *
-*   Relocates all address references within a symbol table by a set of
-*   code/data offsets.
+*   Applies or reverts the relocation of a symbol table.
+*
+*   Symbol addresses are never rewritten; they are kept as stored in the
+*   symbol file and adjusted at lookup time by their segment offset (see
+*   SymTabReloc()). Applying the relocation therefore only needs the offsets
+*   set up by SymTabSetupRelocOffset(), and reverting it clears them.
 *
 *   Where:
 *       pSymTab is the pointer to a symbol table to relocate
@@ -770,135 +1106,192 @@ BOOL SymTabSetupRelocOffset(TSYMTAB *pSymTab, DWORD dwInitModule, DWORD dwInitMo
 void SymTabRelocate(TSYMTAB *pSymTab, int factor)
 {
     TSYMRELOC  *pReloc;                 // Symbol table relocation header
-    TSYMHEADER *pHead;                  // Generic section header
-
-    TSYMGLOBAL  *pGlobals;              // Globals section pointer
-    TSYMGLOBAL1 *pGlobal;               // Single global item
-    TSYMFNLIN   *pFnLin;                // Function lines section pointer
-    TSYMFNSCOPE *pFnScope;              // Function scope section pointer
-    TSYMSTATIC  *pStatic;               // Static symbols section pointer
-    TSYMSTATIC1 *pStatic1;              // Single static item
-    DWORD count;
-    int nSegment;                       // Segment number that the variable is in
+    int i;
 
     if( pSymTab )
     {
-        pReloc = (TSYMRELOC *) SymTabFindSection(pSymTab, HTYPE_RELOC);
+        pReloc = ((TSYMALLOC *)pSymTab - 1)->pReloc;
 
         if( pReloc )
         {
             if( factor>0 )
                 dprinth(1, "SYSCALL: Relocating symbols for `%s' .text=%08X", pSymTab->sTableName, pReloc->list[0].reloc);
             else
-                dprinth(1, "SYSCALL: Reverting symbol relocation for `%s'", pSymTab->sTableName);
-
-            pHead = pSymTab->header;
-
-            // Loop over the complete symbol table and relocate each appropriate section
-            while( pHead->hType != HTYPE__END )
             {
-                switch( pHead->hType )
-                {
-                    case HTYPE_GLOBALS:
+                dprinth(1, "SYSCALL: Reverting symbol relocation for `%s'", pSymTab->sTableName);
 
-                        pGlobals = (TSYMGLOBAL *) pHead;
-                        pGlobal  = &pGlobals->list[0];
+                for(i=0; i<pReloc->nReloc; i++)
+                    pReloc->list[i].reloc = 0;
+            }
+        }
+    }
+}
 
-                        for(count=0; count<pGlobals->nGlobals; count++, pGlobal++ )
-                        {
-                            // pGlobal->bSegment contains the symbol segment that is index
-                            // into the relocation array for that segment type
 
-                            nSegment = pGlobal->bSegment;
+/******************************************************************************
+*                                                                             *
+*   int SymTabReloc(TSYMTAB *pSymTab, BYTE bSegment)                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the current relocation offset of a segment within a symbol table.
+*   Every address read from a symbol table needs to be adjusted by it.
+*
+*   Where:
+*       pSymTab is the symbol table
+*       bSegment is the segment index (0 for code)
+*
+*   Returns:
+*       Value to add to a stored address to get the run-time address
+*
+******************************************************************************/
+int SymTabReloc(TSYMTAB *pSymTab, BYTE bSegment)
+{
+    TSYMRELOC  *pReloc;                 // Symbol table relocation header
 
-                            pGlobal->dwStartAddress += pReloc->list[nSegment].reloc * factor;
-                            pGlobal->dwEndAddress   += pReloc->list[nSegment].reloc * factor;
-                        }
-                        break;
+    if( pSymTab )
+    {
+        pReloc = ((TSYMALLOC *)pSymTab - 1)->pReloc;
 
-                    case HTYPE_SOURCE:
-                        // This section does not need relocation
-                        break;
+        if( pReloc && bSegment < pReloc->nReloc )
+            return( pReloc->list[bSegment].reloc );
+    }
 
-                    case HTYPE_FUNCTION_LINES:
+    return( 0 );
+}
 
-                        pFnLin = (TSYMFNLIN *) pHead;
-                        pFnLin->dwStartAddress += pReloc->list[0].reloc * factor;
-                        pFnLin->dwEndAddress   += pReloc->list[0].reloc * factor;
-                        break;
 
-                    case HTYPE_FUNCTION_SCOPE:
+/******************************************************************************
+*                                                                             *
+*   BOOL SymTabTryLock(void)                                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Tries to take the lock that keeps the symbol tables from being removed.
+*   This is used by the unwinder when it runs from the timer interrupt; it
+*   must not wait, since the lock may be held by the CPU it interrupted.
+*
+*   Returns:
+*       TRUE if the lock is taken; the caller has to release it with SymTabUnlock()
+*       FALSE if a table is being removed
+*
+******************************************************************************/
+BOOL SymTabTryLock(void)
+{
+    return( SpinlockTry(&dwSymTabLock)==0 );
+}
 
-                        pFnScope = (TSYMFNSCOPE *) pHead;
-                        pFnScope->dwStartAddress += pReloc->list[0].reloc * factor;
-                        pFnScope->dwEndAddress   += pReloc->list[0].reloc * factor;
 
-                        // Loop for all function scope tokens and relocate TOKTYPE_LCSYM as it is
-                        // the only one containing the address of the symbol (uninitialized local static)
+/******************************************************************************
+*                                                                             *
+*   void SymTabUnlock(void)                                                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Releases the lock taken by SymTabTryLock().
+*
+******************************************************************************/
+void SymTabUnlock(void)
+{
+    SpinlockReset(&dwSymTabLock);
+}
 
-                        for(count=0; count<pFnScope->nTokens; count++ )
-                        {
-                            if( pFnScope->list[count].TokType==TOKTYPE_LCSYM )
-                            {
-                                nSegment = pFnScope->list[count].bSegment;
 
-                                pFnScope->list[count].param += pReloc->list[nSegment].reloc * factor;
-                            }
-                        }
-                        break;
+/******************************************************************************
+*                                                                             *
+*   TSYMUNWIND *SymTabUnwind(TSYMTAB *pSymTab, int *pDelta)                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Returns the unwind section of a symbol table. Tables of kernel modules
+*   that are not loaded have no code to unwind and return no section.
+*
+*   Where:
+*       pSymTab is the symbol table
+*       pDelta receives the value to add to the addresses of the unwind rows
+*
+*   Returns:
+*       Unwind section
+*       NULL if the table has no unwind section or its code is not loaded
+*
+******************************************************************************/
+TSYMUNWIND *SymTabUnwind(TSYMTAB *pSymTab, int *pDelta)
+{
+    TSYMRELOC  *pReloc;                 // Symbol table relocation header
 
-                    case HTYPE_STATIC:
+    pReloc = ((TSYMALLOC *)pSymTab - 1)->pReloc;
 
-                        pStatic  = (TSYMSTATIC *) pHead;
-                        pStatic1 = &pStatic->list[0];
+    *pDelta = SymTabReloc(pSymTab, 0);
 
-                        for(count=0; count<pStatic->nStatics; count++, pStatic1++ )
-                        {
-                            nSegment = pStatic1->bSegment;
+    if( pReloc && *pDelta==0 )
+        return( NULL );
 
-                            pStatic1->dwAddress += pReloc->list[nSegment].reloc * factor;
-                        }
-                        break;
+    return( ((TSYMALLOC *)pSymTab - 1)->pUnwind );
+}
 
-                    case HTYPE_TYPEDEF:
-                        // This section does not need relocation
-                        break;
 
-                    case HTYPE_IGNORE:
-                        // This section does not need relocation
-                        break;
+/******************************************************************************
+*                                                                             *
+*   static void SymTabDeferPointers(TSYMTAB *pSymTab)                         *
+*                                                                             *
+*******************************************************************************
+*
+*   This function is called only once upon symbol table load. It marks all
+*   sections that contain string offsets with HTYPE_RAW so their pointers
+*   get adjusted by SymTabMakePointers() the first time they are used. This
+*   keeps the load time independent of the size of the table.
+*
+*   Where:
+*       pSymTab is the pointer to a symbol table to mark
+*
+******************************************************************************/
+static void SymTabDeferPointers(TSYMTAB *pSymTab)
+{
+    TSYMHEADER *pHead;                  // Generic section header
 
-                    default:
-                        // We could catch a corrupted symbols error here if we want to...
-                        break;
-                }
+    pHead = pSymTab->header;
 
-                // Next section
-                pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
-            }
+    while( pHead->hType != HTYPE__END )
+    {
+        switch( pHead->hType )
+        {
+            case HTYPE_FUNCTION_SCOPE:
+            case HTYPE_GLOBALS:
+            case HTYPE_STATIC:
+            case HTYPE_SOURCE:
+            case HTYPE_TYPEDEF:
+                pHead->hType |= HTYPE_RAW;
+                break;
         }
+
+        // Next section
+        pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
     }
 }
 
 
 /******************************************************************************
 *                                                                             *
-*   void SymTabMakePointers(TSYMTAB *pSymTab, DWORD dStrings)                 *
+*   TSYMHEADER *SymTabMakePointers(TSYMTAB *pSymTab, TSYMHEADER *pHead)       *
 *                                                                             *
 *******************************************************************************
 *
-*   This function is called only once upon symbol table load. It traverses
-*   over all elements of a given table and adjusts pointers to strings since
-*   they are only relative offsets in the raw symbol table file.
+*   Adjusts pointers to strings of a single section since they are only
+*   relative offsets in the raw symbol table file. Does nothing if the section
+*   has already been adjusted. Every piece of code that looks up a section
+*   needs to pass it through this function before using its strings.
 *
 *   Where:
-*       pSymTab is the pointer to a symbol table to adjust
-*       dStrings is the offset adjustment
+*       pSymTab is the pointer to a symbol table containing the section
+*       pHead is the section to adjust
+*
+*   Returns:
+*       pHead
 *
 ******************************************************************************/
-static void SymTabMakePointers(TSYMTAB *pSymTab, DWORD dStrings)
+TSYMHEADER *SymTabMakePointers(TSYMTAB *pSymTab, TSYMHEADER *pHead)
 {
-    TSYMHEADER *pHead;                  // Generic section header
+    DWORD dStrings;                     // Offset adjustment
     UINT count;                         // Generic counter
 
     TSYMFNSCOPE  *pFnScope;             // Function scope section pointer
@@ -908,99 +1301,88 @@ static void SymTabMakePointers(TSYMTAB *pSymTab, DWORD dStrings)
     TSYMSTATIC   *pStatic;              // Static symbols section pointer
     TSYMSTATIC1  *pStatic1;             // Single static item
     TSYMSOURCE   *pSource;              // Source section header
-//  TSYMFNLIN    *pFnLin;               // Function lines section pointer
-//  TSYMFNLIN1   *pFnLin1;              // Single function line item
     TSYMTYPEDEF  *pType;                // Type section pointer
     TSYMTYPEDEF1 *pType1;               // Single type item
 
-    if( pSymTab )
+    if( pHead->hType & HTYPE_RAW )
     {
-        pHead = pSymTab->header;
-
-        // Loop over the complete symbol table and adjust all pointers as appropriate
-        while( pHead->hType != HTYPE__END )
-        {
-            switch( pHead->hType )
-            {
-                case HTYPE_FUNCTION_SCOPE:
+        pHead->hType &= ~HTYPE_RAW;
 
-                    pFnScope  = (TSYMFNSCOPE *) pHead;
-                    pFnScope1 = &pFnScope->list[0];
+        dStrings = (DWORD) pSymTab + pSymTab->dStrings;
 
-                    pFnScope->pName += dStrings;
-
-                    for(count=0; count<pFnScope->nTokens; count++, pFnScope1++)
-                    {
-                        pFnScope1->pName += dStrings;
-                    }
+        switch( pHead->hType )
+        {
+            case HTYPE_FUNCTION_SCOPE:
 
-                    break;
+                pFnScope  = (TSYMFNSCOPE *) pHead;
+                pFnScope1 = &pFnScope->list[0];
 
-                case HTYPE_GLOBALS:
+                pFnScope->pName += dStrings;
 
-                    pGlobals = (TSYMGLOBAL *) pHead;
-                    pGlobal  = &pGlobals->list[0];
+                for(count=0; count<pFnScope->nTokens; count++, pFnScope1++)
+                {
+                    pFnScope1->pName += dStrings;
+                }
 
-                    for(count=0; count<pGlobals->nGlobals; count++, pGlobal++ )
-                    {
-                        pGlobal->pName += dStrings;
-                        pGlobal->pDef  += dStrings;
-                    }
-                    break;
+                break;
 
-                case HTYPE_STATIC:
+            case HTYPE_GLOBALS:
 
-                    pStatic  = (TSYMSTATIC *) pHead;
-                    pStatic1 = &pStatic->list[0];
+                pGlobals = (TSYMGLOBAL *) pHead;
+                pGlobal  = &pGlobals->list[0];
 
-                    for(count=0; count<pStatic->nStatics; count++, pStatic1++ )
-                    {
-                        pStatic1->pName += dStrings;
-                        pStatic1->pDef  += dStrings;
-                    }
-                    break;
+                for(count=0; count<pGlobals->nGlobals; count++, pGlobal++ )
+                {
+                    pGlobal->pName += dStrings;
+                    pGlobal->pDef  += dStrings;
+                }
+                break;
 
-                case HTYPE_SOURCE:
+            case HTYPE_STATIC:
 
-                    pSource = (TSYMSOURCE *) pHead;
+                pStatic  = (TSYMSTATIC *) pHead;
+                pStatic1 = &pStatic->list[0];
 
-                    pSource->pSourcePath += dStrings;
-                    pSource->pSourceName += dStrings;
+                for(count=0; count<pStatic->nStatics; count++, pStatic1++ )
+                {
+                    pStatic1->pName += dStrings;
+                    pStatic1->pDef  += dStrings;
+                }
+                break;
 
-                    for(count=0; count<pSource->nLines; count++)
-                    {
-                        pSource->pLineArray[count] += dStrings;
-                    }
+            case HTYPE_SOURCE:
 
-                    break;
+                pSource = (TSYMSOURCE *) pHead;
 
-                case HTYPE_FUNCTION_LINES:
-                    break;
+                pSource->pSourcePath += dStrings;
+                pSource->pSourceName += dStrings;
 
-                case HTYPE_TYPEDEF:
+                for(count=0; count<pSource->nLines; count++)
+                {
+                    pSource->pLineArray[count] += dStrings;
+                }
 
-                    pType  = (TSYMTYPEDEF *) pHead;
-                    pType1 = &pType->list[0];
-                    pType->pRel = (TSYMADJUST *)((DWORD)pType->pRel + dStrings);
+                break;
 
-                    for(count=0; count<pType->nTypedefs; count++, pType1++)
-                    {
-                        pType1->pName += dStrings;
-                        pType1->pDef  += dStrings;
-                    }
+            case HTYPE_TYPEDEF:
 
-                    break;
+                pType  = (TSYMTYPEDEF *) pHead;
+                pType1 = &pType->list[0];
+                pType->pRel = (TSYMADJUST *)((DWORD)pType->pRel + dStrings);
 
-                case HTYPE_IGNORE:
-                    break;
+                for(count=0; count<pType->nTypedefs; count++, pType1++)
+                {
+                    pType1->pName += dStrings;
+                    pType1->pDef  += dStrings;
+                }
 
-                default:
-                    // We could catch a corrupted symbols error here if we want to...
-                    break;
-            }
+                break;
 
-            // Next section
-            pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
+            default:
+                // We could catch a corrupted symbols error here if we want to...
+                break;
         }
     }
+
+    return( pHead );
 }
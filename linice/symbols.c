@@ -103,7 +103,11 @@ void ParseLocalSymbol(TExItem *item, TSYMFNSCOPE1 *pLocal)
     switch( pLocal->TokType )
     {
         case TOKTYPE_LCSYM:
-            // Local static symbol has absolute address
+            // Local static symbol has absolute address within its segment
+            item->bType = EXTYPE_SYMBOL;
+            item->pData = (BYTE *) (pLocal->param + SymTabReloc(deb.pSymTabCur, pLocal->bSegment));
+            break;
+
         case TOKTYPE_LSYM:
             // Local symbol is also on the stack addresses by SS:EBP
         case TOKTYPE_PARAM:
@@ -189,7 +193,7 @@ BOOL FindLocalSymbol(TExItem *item, char *pName, int nNameLen)
     {
         pFnScope = deb.pFnScope;
 
-        dwOffset = deb.r->eip - pFnScope->dwStartAddress;
+        dwOffset = deb.r->eip - SymTabReloc(deb.pSymTabCur, 0) - pFnScope->dwStartAddress;
 
         // Traverse function scope array from back to front until we find we passed our offset
         for(i = pFnScope->nTokens-1; i>=0; i-- )
@@ -278,7 +282,7 @@ BOOL FindStaticSymbol(TExItem *item, char *pName, int nNameLen)
                         // Fill in the item structure
 
                         item->bType = EXTYPE_SYMBOL;
-                        item->pData = (BYTE*) pStatic->list[i].dwAddress;
+                        item->pData = (BYTE*) (pStatic->list[i].dwAddress + SymTabReloc(deb.pSymTabCur, pStatic->list[i].bSegment));
 
                         // Get the type of the symbol
                         pType1 = Type2Typedef(pStatic->list[i].pDef, 0, pStatic->file_id);
@@ -351,11 +355,11 @@ BOOL FindGlobalSymbol(TExItem *item, char *pName, int nNameLen)
                     // so dont dereference it, but return the value of the symbol
                     if(pGlobal->list[i].bSegment == 0)
                     {
-                        item->Data = pGlobal->list[i].dwStartAddress;
+                        item->Data = pGlobal->list[i].dwStartAddress + SymTabReloc(deb.pSymTabCur, 0);
                         item->pData = (BYTE *)&item->Data;
                     }
                     else
-                        item->pData = (BYTE*) pGlobal->list[i].dwStartAddress;
+                        item->pData = (BYTE*) (pGlobal->list[i].dwStartAddress + SymTabReloc(deb.pSymTabCur, pGlobal->list[i].bSegment));
 
                     // Get the type of the symbol. The file ID is stored with the global symbol
                     pType1 = Type2Typedef(pGlobal->list[i].pDef, 0, pGlobal->list[i].file_id);
@@ -537,10 +541,15 @@ BOOL FindSymbol(TExItem *item, char *pName, int *pNameLen)
 {
     static char buf[MAX_STRING];        // Temp buffer for the symbol name
     int nNameLen;                       // Symbol name length
+    UINT cpu;
 
     // Basic parameter validation
     if( item && pNameLen )
     {
+        cpu = ice_smp_processor_id();
+        if( cpu < MAX_CPU )
+            deb.Stat[cpu].nSymFinds++;
+
         nNameLen = *pNameLen;           // Get the symbol name length
 
         // Look for the module!symbol format
@@ -746,7 +755,7 @@ BOOL cmdSymbol(char *args, int subClass)
                 }
                 // Finally, print all the symbols that did not mis-match
                 if(dprinth(nLine++, " %08X %02d %s %s",
-                    pGlobals->list[i].dwStartAddress,
+                    pGlobals->list[i].dwStartAddress + SymTabReloc(deb.pSymTabCur, pGlobals->list[i].bSegment),
                     pGlobals->list[i].bSegment,
                     pGlobals->list[i].bSegment==0x00? ".text  ":
                     pGlobals->list[i].bSegment==0x01? ".data  ":
@@ -790,20 +799,17 @@ BOOL cmdFile(char *args, int subClass)
             {
                 // Print the current source file name
 
-                pHead = deb.pSymTabCur->header;
+                pHead = SymTabFindSection(deb.pSymTabCur, HTYPE_SOURCE);
 
-                while( pHead->hType != HTYPE__END )
+                while( pHead )
                 {
-                    if( pHead->hType == HTYPE_SOURCE )
-                    {
-                        pSrc = (TSYMSOURCE *)pHead;
+                    pSrc = (TSYMSOURCE *)pHead;
 
-                        // Print the source file path/name
-                        if( (dprinth(nLine++, "%s", pSrc->pSourcePath))==FALSE )
-                            break;
-                    }
+                    // Print the source file path/name
+                    if( (dprinth(nLine++, "%s", pSrc->pSourcePath))==FALSE )
+                        break;
 
-                    pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
+                    pHead = SymTabFindSectionNext(deb.pSymTabCur, pHead, HTYPE_SOURCE);
                 }
             }
             else
@@ -811,27 +817,24 @@ BOOL cmdFile(char *args, int subClass)
                 // Switch to a different source file
 
                 // Loop over all the source files and compare to what we typed
-                pHead = deb.pSymTabCur->header;
+                pHead = SymTabFindSection(deb.pSymTabCur, HTYPE_SOURCE);
 
-                while( pHead->hType != HTYPE__END )
+                while( pHead )
                 {
-                    if( pHead->hType == HTYPE_SOURCE )
-                    {
-                        pSrc = (TSYMSOURCE *)pHead;
+                    pSrc = (TSYMSOURCE *)pHead;
 
-                        if( !strcmp(args, pSrc->pSourceName) )
-                        {
-                            deb.pSource = pSrc;             // New source descriptor
-                            deb.codeFileTopLine = 1;        // Display at the first source line
-                            deb.codeFileXoffset = 0;        // Reset the X offset
+                    if( !strcmp(args, pSrc->pSourceName) )
+                    {
+                        deb.pSource = pSrc;             // New source descriptor
+                        deb.codeFileTopLine = 1;        // Display at the first source line
+                        deb.codeFileXoffset = 0;        // Reset the X offset
 
-                            deb.fRedraw = TRUE;
+                        deb.fRedraw = TRUE;
 
-                            return( TRUE );
-                        }
+                        return( TRUE );
                     }
 
-                    pHead = (TSYMHEADER*)((DWORD)pHead + pHead->dwSize);
+                    pHead = SymTabFindSectionNext(deb.pSymTabCur, pHead, HTYPE_SOURCE);
                 }
 
                 dprinth(nLine++, "Source file '%s' not found", args);
@@ -876,6 +879,7 @@ static char *SymAddress2Global(DWORD dwOffset, UINT *pRange)
 {
     TSYMGLOBAL *pGlobals;
     TSYMTAB *pSymTab;                   // Traverse list of symbol tables
+    DWORD dwStart;                      // Relocated symbol start address
     int i;
 
     pSymTab = deb.pSymTab;
@@ -888,18 +892,20 @@ static char *SymAddress2Global(DWORD dwOffset, UINT *pRange)
 
         for(i=0; i<pGlobals->nGlobals; i++ )
         {
+            dwStart = pGlobals->list[i].dwStartAddress + SymTabReloc(pSymTab, pGlobals->list[i].bSegment);
+
             // If we can search the range, return the match within a global function
             if( pRange )
             {
-                if( dwOffset >= pGlobals->list[i].dwStartAddress && dwOffset <= pGlobals->list[i].dwEndAddress )
+                if( dwOffset >= dwStart && dwOffset - dwStart <= pGlobals->list[i].dwEndAddress - pGlobals->list[i].dwStartAddress )
                 {
-                    *pRange = dwOffset - pGlobals->list[i].dwStartAddress;
+                    *pRange = dwOffset - dwStart;
                     return( pGlobals->list[i].pName );
                 }
             }
             else    // Strict match
             {
-                if( dwOffset == pGlobals->list[i].dwStartAddress )
+                if( dwOffset == dwStart )
                     return( pGlobals->list[i].pName );
             }
         }
@@ -937,6 +943,9 @@ static char *SymAddress2Function(DWORD dwOffset, UINT *pRange)
     // Loop for all loaded symbol tables
     if( pSymTab )
     {
+        // Function addresses are stored relative to the code segment
+        dwOffset -= SymTabReloc(pSymTab, 0);
+
         // Search static records
         pFnScope = (TSYMFNSCOPE *)SymTabFindSection(pSymTab, HTYPE_FUNCTION_SCOPE);
 
@@ -1004,7 +1013,7 @@ static char *SymAddress2Static(DWORD dwOffset, UINT *pRange)
             for(i=0; i<pStatic->nStatics; i++ )
             {
                 // With static symbols, we dont have a range value
-                if( dwOffset == pStatic->list[i].dwAddress )
+                if( dwOffset == pStatic->list[i].dwAddress + SymTabReloc(pSymTab, pStatic->list[i].bSegment) )
                 {
                     if( pRange )        // Only strict match because we dont know the size
                         *pRange = 0;    // of the static object
@@ -1139,6 +1148,12 @@ static char *SymAddress2Kernel(DWORD dwOffset, UINT *pRange)
 char *SymAddress2Name(DWORD dwOffset, UINT *pRange)
 {
     char *pName;
+    UINT cpu;
+
+    // This is also called outside the debugger (profile reads), on any CPU
+    cpu = ice_smp_processor_id();
+    if( cpu < MAX_CPU )
+        deb.Stat[cpu].nSymLookups++;
 
     if( (pName = SymAddress2Global(dwOffset, pRange)) )
         return( pName );
@@ -1194,7 +1209,7 @@ DWORD SymLinNum2Address(DWORD line)
                 {
                     if( pFnLin->list[n].line==line && pFnLin->list[n].file_id==file_id )
                     {
-                        return( pFnLin->dwStartAddress + pFnLin->list[n].offset );
+                        return( pFnLin->dwStartAddress + SymTabReloc(deb.pSymTabCur, 0) + pFnLin->list[n].offset );
                     }
                 }
             }
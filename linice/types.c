@@ -631,13 +631,21 @@ static int PrintEnumTypeValue(char *buf, char *pEnum, BYTE *pVar)
 static int PrintExpandCharPtr(char *buf, BYTE *pPointee)
 {
     static char String[MAX_CHAR_PTR_SAMPLE+1];  // String to store sample
-    int i;                                      // String counter
+    TADDRDESC Addr;                             // Address of the pointee
+    UINT nRead;                                 // Number of bytes read
+    UINT i;                                     // String counter
     int written = 0;                    // Number of characters written
 
-    // Try to read several values from the pointee and print them if they make up a string
+    // Read a sample from the pointee in one go
+    Addr.sel = GetKernelDS();
+    Addr.offset = (DWORD) pPointee;
+
+    nRead = AddrReadBlock(&Addr, (BYTE *) String, MAX_CHAR_PTR_SAMPLE);
+
+    // Print the values if they make up a string
     for(i=0; i<MAX_CHAR_PTR_SAMPLE; i++)
     {
-        if( GlobalReadBYTE(&String[i], (DWORD) pPointee) )
+        if( i < nRead )
         {
             // If this is end-of-string, break
             if( String[i]==0 )
@@ -646,8 +654,6 @@ static int PrintExpandCharPtr(char *buf, BYTE *pPointee)
             // If the character is not printable, this is not a string
             if( !isprint(String[i]) )
                 return( written );
-
-            pPointee++;
         }
         else
             return( written );
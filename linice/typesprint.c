@@ -767,9 +767,9 @@ BOOL cmdTypes(char *args, int subClass)
 
                 while( pHead->hType != HTYPE__END )
                 {
-                    if( pHead->hType == HTYPE_TYPEDEF )
+                    if( SECTYPE(pHead) == HTYPE_TYPEDEF )
                     {
-                        pType = (TSYMTYPEDEF*)pHead;
+                        pType = (TSYMTYPEDEF*)SymTabMakePointers(deb.pSymTabCur, pHead);
 
                         // Got a type header, list all types defined there
 
@@ -0,0 +1,363 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     unwind.c                                                      *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the stack unwinder.
+
+        A frame is unwound using the first method that works:
+
+        1) The unwind rows that linsym made from the call frame information
+           of a symbol table. They work for code built without frame
+           pointers.
+        2) The frame pointer chain: saved EBP at [EBP], return address at
+           [EBP+4].
+        3) Scanning the stack for a value that points just past a call
+           instruction within a known symbol. This one may find stale
+           return addresses, so its frames are only a guess.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include "module-header.h"              // Versatile module header file
+
+#include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
+#include "ice.h"                        // Include main debugger structures
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL UnwindRead(PTUNWIND pFrame, DWORD dwAddress, DWORD *pValue)   *
+*                                                                             *
+*******************************************************************************
+*
+*   Reads a dword from the stack. Within the debugger, the access is checked
+*   through the stack selector. Otherwise, the stack is read directly and
+*   the address has to be within the given stack range.
+*
+*   Where:
+*       pFrame is the frame being unwound
+*       dwAddress is the stack address to read
+*       pValue receives the value
+*
+*   Returns:
+*       TRUE - value read
+*       FALSE - address is not valid
+*
+******************************************************************************/
+static BOOL UnwindRead(PTUNWIND pFrame, DWORD dwAddress, DWORD *pValue)
+{
+    TADDRDESC Addr;                     // Address descriptor to use when fetching values
+
+    if( pFrame->dwHigh )
+    {
+        if( dwAddress < pFrame->dwLow || dwAddress + sizeof(DWORD) > pFrame->dwHigh || (dwAddress & 3) )
+            return( FALSE );
+
+        *pValue = *(DWORD *) dwAddress;
+    }
+    else
+    {
+        Addr.sel = deb.r->ss;
+        Addr.offset = dwAddress;
+
+        if( !VerifyRange(&Addr, sizeof(DWORD)) )
+            return( FALSE );
+
+        *pValue = AddrGetDword(&Addr);
+    }
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL UnwindIsCode(PTUNWIND pFrame, DWORD dwAddress)                *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks that a return address may point to code. Outside the debugger we
+*   can not touch the memory, so we only check that it is in the kernel.
+*
+******************************************************************************/
+static BOOL UnwindIsCode(PTUNWIND pFrame, DWORD dwAddress)
+{
+    BYTE bCode;
+
+    if( pFrame->dwHigh )
+        return( dwAddress >= ice_page_offset() );
+
+    return( GlobalReadBYTE(&bCode, dwAddress) );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL UnwindIsCall(DWORD dwAddress)                                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks that the instruction ending just before the address is a call:
+*   E8 rel32, or FF /2 with any of the register, memory, disp8 or disp32
+*   (with or without SIB) operand forms.
+*
+*   Where:
+*       dwAddress is the possible return address
+*
+*   Returns:
+*       TRUE - address follows a call instruction
+*       FALSE - address does not follow a call instruction
+*
+******************************************************************************/
+static BOOL UnwindIsCall(DWORD dwAddress)
+{
+    BYTE b[7];                          // Code bytes preceding the address
+    int i;
+
+    for(i=0; i<7; i++)
+    {
+        if( !GlobalReadBYTE(&b[i], dwAddress - 7 + i) )
+            return( FALSE );
+    }
+
+    // b[6] is the byte just before the address
+    if( b[2]==0xE8 )
+        return( TRUE );
+
+    if( (b[5]==0xFF && (b[6] & 0x38)==0x10)
+     || (b[4]==0xFF && (b[5] & 0x38)==0x10)
+     || (b[3]==0xFF && (b[4] & 0x38)==0x10)
+     || (b[1]==0xFF && (b[2] & 0x38)==0x10)
+     || (b[0]==0xFF && (b[1] & 0x38)==0x10) )
+        return( TRUE );
+
+    return( FALSE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL UnwindFindRow(DWORD dwAddress, TSYMUNWIND1 *pRow)             *
+*                                                                             *
+*******************************************************************************
+*
+*   Finds the unwind row that applies to a code address in all loaded
+*   symbol tables. The row is copied out, so it can be used after the
+*   symbol tables are released.
+*
+*   Where:
+*       dwAddress is the code address
+*       pRow is the address to store the unwind row
+*
+*   Returns:
+*       TRUE if the row is found
+*       FALSE if no symbol table describes the address
+*
+******************************************************************************/
+static BOOL UnwindFindRow(DWORD dwAddress, TSYMUNWIND1 *pRow)
+{
+    TSYMTAB *pSymTab;                   // Symbol table being searched
+    TSYMUNWIND *pUnwind;                // Its unwind section
+    DWORD dwOffset;                     // Address as stored in the unwind rows
+    int reloc;                          // Relocation of the unwind rows
+    UINT low, high, mid;
+
+    for(pSymTab = deb.pSymTab; pSymTab; pSymTab = (TSYMTAB *) pSymTab->next)
+    {
+        pUnwind = SymTabUnwind(pSymTab, &reloc);
+
+        if( pUnwind && pUnwind->nRows )
+        {
+            dwOffset = dwAddress - reloc;
+
+            // The last row always ends a function
+            if( dwOffset >= pUnwind->list[0].dwAddress && dwOffset < pUnwind->list[pUnwind->nRows-1].dwAddress )
+            {
+                low = 0;
+                high = pUnwind->nRows - 1;
+
+                // Find the last row at or below the address
+                while( high - low > 1 )
+                {
+                    mid = (low + high) / 2;
+
+                    if( pUnwind->list[mid].dwAddress <= dwOffset )
+                        low = mid;
+                    else
+                        high = mid;
+                }
+
+                *pRow = pUnwind->list[low];
+
+                return( TRUE );
+            }
+        }
+    }
+
+    return( FALSE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static UINT UnwindNext(PTUNWIND pFrame, DWORD dwSlot, DWORD dwRet,        *
+*                          DWORD dwEbp, UINT method)                          *
+*                                                                             *
+*******************************************************************************
+*
+*   Moves the frame to the caller. The return address has to be above the
+*   current stack pointer so that the unwinding always makes progress.
+*
+*   Where:
+*       pFrame is the frame being unwound
+*       dwSlot is the stack address of the return address
+*       dwRet is the return address
+*       dwEbp is the caller's EBP
+*       method is the method that found the frame
+*
+*   Returns:
+*       method
+*       UNWIND_END if the frame does not make progress
+*
+******************************************************************************/
+static UINT UnwindNext(PTUNWIND pFrame, DWORD dwSlot, DWORD dwRet, DWORD dwEbp, UINT method)
+{
+    if( pFrame->esp && dwSlot < pFrame->esp )
+        return( UNWIND_END );
+
+    pFrame->dwFrame = dwSlot - 4;
+    pFrame->eip     = dwRet;
+    pFrame->esp     = dwSlot + 4;
+    pFrame->ebp     = dwEbp;
+    pFrame->fCaller = TRUE;
+
+    return( method );
+}
+
+/******************************************************************************
+*                                                                             *
+*   UINT UnwindFrame(PTUNWIND pFrame, BOOL fScan)                             *
+*                                                                             *
+*******************************************************************************
+*
+*   Unwinds a stack frame: finds the return address of the frame and the
+*   registers of the caller.
+*
+*   If the stack range in the frame is set, the stack is read directly and
+*   the return addresses are only checked to be in the kernel; this is used
+*   when sampling from an interrupt. Otherwise the stack is read through the
+*   debugee SS and the return addresses are checked to be readable.
+*
+*   When sampling from an interrupt, the symbol tables are walked for the
+*   call frame information only if no table is being removed at the time;
+*   otherwise that frame is followed by the frame pointer chain.
+*
+*   Where:
+*       pFrame is the frame to unwind, updated to its caller
+*       fScan is TRUE to scan the stack if the other methods fail (debugger only)
+*
+*   Returns:
+*       UNWIND_BY_* method that unwound the frame
+*       UNWIND_END if no more frames could be found
+*
+******************************************************************************/
+UINT UnwindFrame(PTUNWIND pFrame, BOOL fScan)
+{
+    TSYMUNWIND1 Row;                    // Unwind row of the frame
+    BOOL fRow = FALSE;                  // The unwind row is found
+    DWORD dwCfa;                        // Canonical frame address (ESP before the call)
+    DWORD dwRet, dwEbp, dwSlot;
+    UINT range, i;
+
+    // Return addresses may be just past the end of a function, so look up the call itself
+    if( pFrame->dwHigh==0 )
+        fRow = UnwindFindRow(pFrame->fCaller? pFrame->eip - 1 : pFrame->eip, &Row);
+    else
+    if( SymTabTryLock() )
+    {
+        fRow = UnwindFindRow(pFrame->fCaller? pFrame->eip - 1 : pFrame->eip, &Row);
+
+        SymTabUnlock();
+    }
+
+    if( fRow && (Row.bCfaReg==UNWIND_CFA_EBP || (Row.bCfaReg==UNWIND_CFA_ESP && pFrame->esp)) )
+    {
+        dwCfa = (Row.bCfaReg==UNWIND_CFA_EBP? pFrame->ebp : pFrame->esp) + Row.wCfaOffset;
+        dwEbp = pFrame->ebp;
+
+        if( UnwindRead(pFrame, dwCfa - 4, &dwRet)
+         && (Row.bEbpOffset==0 || UnwindRead(pFrame, dwCfa - Row.bEbpOffset, &dwEbp))
+         && UnwindIsCode(pFrame, dwRet) )
+            return( UnwindNext(pFrame, dwCfa - 4, dwRet, dwEbp, UNWIND_BY_CFI) );
+    }
+
+    //   | return address |  EBP + 4
+    //   | saved EBP      |  EBP
+    if( (pFrame->esp==0 || pFrame->ebp >= pFrame->esp)
+     && UnwindRead(pFrame, pFrame->ebp, &dwEbp)
+     && UnwindRead(pFrame, pFrame->ebp + 4, &dwRet)
+     && UnwindIsCode(pFrame, dwRet) )
+        return( UnwindNext(pFrame, pFrame->ebp + 4, dwRet, dwEbp, UNWIND_BY_EBP) );
+
+    // Look for the nearest value on the stack that could be a return address
+    if( fScan && pFrame->esp && !pFrame->dwHigh )
+    {
+        for(i=0, dwSlot=pFrame->esp; i<MAX_UNWIND_SCAN; i++, dwSlot += 4)
+        {
+            if( !UnwindRead(pFrame, dwSlot, &dwRet) )
+                break;
+
+            if( UnwindIsCall(dwRet) && SymAddress2Name(dwRet, &range) )
+                return( UnwindNext(pFrame, dwSlot, dwRet, pFrame->ebp, UNWIND_BY_SCAN) );
+        }
+    }
+
+    return( UNWIND_END );
+}
@@ -325,6 +325,35 @@ static BOOL ChkReloc(TSYMHEADER *pHead, DWORD pStr)
     return( TRUE );
 }
 
+static BOOL ChkUnwind(TSYMHEADER *pHead, DWORD pStr)
+{
+    TSYMUNWIND *pUnwind;
+    DWORD nRow;
+
+    pUnwind = (TSYMUNWIND *) pHead;
+
+    printf("HTYPE_UNWIND\n");
+    printf("  nRows = %d\n", pUnwind->nRows);
+
+    for( nRow=0; nRow<pUnwind->nRows; nRow++)
+    {
+        // Rows have to be sorted for the binary search
+        if( nRow && pUnwind->list[nRow].dwAddress <= pUnwind->list[nRow-1].dwAddress )
+        {
+            printf("ERROR: Unwind rows not sorted\n");
+            return( FALSE );
+        }
+
+        printf("  %08X  cfa=%d+%d  ebp=cfa-%d\n",
+            pUnwind->list[nRow].dwAddress,
+            pUnwind->list[nRow].bCfaReg,
+            pUnwind->list[nRow].wCfaOffset,
+            pUnwind->list[nRow].bEbpOffset );
+    }
+
+    return( TRUE );
+}
+
 static BOOL CheckSymStructure(char *pBuf, DWORD nLen)
 {
     TSYMTAB *pSym;                      // Symbol file header
@@ -400,6 +429,10 @@ static BOOL CheckSymStructure(char *pBuf, DWORD nLen)
                     fTest = ChkReloc(pHead, pStr);
                     break;
 
+                case HTYPE_UNWIND:
+                    fTest = ChkUnwind(pHead, pStr);
+                    break;
+
                 case HTYPE__END:
                     printf("HTYPE__END\n");
                     printf("  dwSize=%d d\n", pHead->dwSize);
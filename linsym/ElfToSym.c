@@ -81,6 +81,7 @@ extern BOOL ParseFunctionLines(int fd, int fs, BYTE *pElf);
 extern BOOL ParseFunctionScope(int fd, int fs, BYTE *pElf);
 extern BOOL ParseTypedefs(int fd, int fs, BYTE *pElf);
 extern BOOL ParseReloc(int fd, int fs, BYTE *pElf);
+extern BOOL ParseUnwind(int fd, int fs, BYTE *pElf);
 
 
 /******************************************************************************
@@ -330,38 +331,44 @@ BOOL ElfToSym(BYTE *pElf, char *pSymName, char *pTableName)
                                                 // Relocation information, written only for object files (kernel modules)
                                                 if( ParseReloc(fd, fs, pElf) )
                                                 {
-                                                    // Add the terminating section HTYPE__END
-                                                    write(fd, &HeaderEnd, sizeof(HeaderEnd));
+                                                    // Stack unwind rows from the call frame information
+                                                    if( ParseUnwind(fd, fs, pElf) )
+                                                    {
+                                                        // Add the terminating section HTYPE__END
+                                                        write(fd, &HeaderEnd, sizeof(HeaderEnd));
 
-                                                    // Copy all strings to the end of the headers (append)
+                                                        // Copy all strings to the end of the headers (append)
 
-                                                    // Rewind the strings file and read them all into a buffer
-                                                    lseek(fs, 0, SEEK_SET);
-                                                    pBuf = (char *) malloc((UINT) dfs);
-                                                    if( pBuf!=NULL )
-                                                    {
-                                                        // Store the offset to the strings (current top of the fd file)
-                                                        SymTab.dStrings = lseek(fd, 0, SEEK_CUR);
+                                                        // Rewind the strings file and read them all into a buffer
+                                                        lseek(fs, 0, SEEK_SET);
+                                                        pBuf = (char *) malloc((UINT) dfs);
+                                                        if( pBuf!=NULL )
+                                                        {
+                                                            // Store the offset to the strings (current top of the fd file)
+                                                            SymTab.dStrings = lseek(fd, 0, SEEK_CUR);
 
-                                                        read(fs, pBuf, (UINT) dfs);
-                                                        write(fd, pBuf, (UINT) dfs);
+                                                            read(fs, pBuf, (UINT) dfs);
+                                                            write(fd, pBuf, (UINT) dfs);
 
-                                                        // Total size is headers + strings
-                                                        SymTab.dwSize = SymTab.dStrings + (UINT) dfs;
+                                                            // Total size is headers + strings
+                                                            SymTab.dwSize = SymTab.dStrings + (UINT) dfs;
 
-                                                        // Write out the symbol header
-                                                        lseek(fd, 0, SEEK_SET);
-                                                        write(fd, &SymTab, sizeof(TSYMTAB)-sizeof(TSYMHEADER));
+                                                            // Write out the symbol header
+                                                            lseek(fd, 0, SEEK_SET);
+                                                            write(fd, &SymTab, sizeof(TSYMTAB)-sizeof(TSYMHEADER));
 
-                                                        // Close the symbol file
-                                                        close(fd);
+                                                            // Close the symbol file
+                                                            close(fd);
 
-                                                        free(pBuf);
+                                                            free(pBuf);
 
-                                                        return( TRUE );
+                                                            return( TRUE );
+                                                        }
+                                                        else
+                                                            fprintf(stderr, "Unable to allocate memory\n");
                                                     }
                                                     else
-                                                        fprintf(stderr, "Unable to allocate memory\n");
+                                                        fprintf(stderr, "Error parsing call frame information\n");
                                                 }
                                                 else
                                                     fprintf(stderr, "Error parsing relocation data\n");
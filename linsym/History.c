@@ -42,8 +42,11 @@
 
 #include <fcntl.h>                      // Include file control file
 #include <stdio.h>                      // Include standard io file
+#include <stdlib.h>                     // Include standard library header
+#include <string.h>                     // Include strings header file
 #include <unistd.h>                     // Include standard UNIX header file
 #include <sys/ioctl.h>                  // Include ioctl header file
+#include <sys/mman.h>                   // Include memory mapping header file
 
 #include "Common.h"                     // Include platform specific set
 
@@ -59,6 +62,12 @@
 
 static char Buf[MAX_STRING+1];          // History buffer line to fill in
 
+#define HISBUF_BULK_SIZE    (64 * 1024) // Size of the buffer for bulk fetches
+#define FOLLOW_POLL_USEC    100000      // How often do we look for new lines
+#define FOLLOW_RETRY        8           // Read retries before we use the ioctl instead
+
+static char BulkBuf[HISBUF_BULK_SIZE];  // Buffer receiving multiple history lines
+
 
 /******************************************************************************
 *                                                                             *
@@ -66,6 +75,204 @@ static char Buf[MAX_STRING+1];          // History buffer line to fill in
 *                                                                             *
 ******************************************************************************/
 
+/******************************************************************************
+*                                                                             *
+*   static int FetchHistory(int hIce, FILE *fp, THISBUFPACKET *pPacket)       *
+*                                                                             *
+*******************************************************************************
+*
+*   Fetches all history lines starting with the line number pPacket->dwLine,
+*   many lines per call, and writes them into a file.
+*
+*   Where:
+*       hIce is the open debugger device
+*       fp is the output file
+*       pPacket is the fetch packet; on return, dwLine is the next line number
+*
+*   Returns:
+*       0 on success
+*       -1 if the debugger does not support bulk fetches
+*
+******************************************************************************/
+static int FetchHistory(int hIce, FILE *fp, THISBUFPACKET *pPacket)
+{
+    char *pLine;
+    DWORD dwLine;
+    DWORD i;
+
+    do
+    {
+        dwLine = pPacket->dwLine;
+        pPacket->dwSize = sizeof(BulkBuf);
+        pPacket->pBuf = BulkBuf;
+
+        if( ioctl(hIce, ICE_IOCTL_HISBUF_BULK, pPacket) )
+            return( -1 );
+
+        if( dwLine && pPacket->dwFirst > dwLine )
+            fprintf(stderr, "*** %d history lines lost\n", pPacket->dwFirst - dwLine);
+
+        for(i=0, pLine=BulkBuf; i<pPacket->nLines; i++, pLine += strlen(pLine)+1)
+            fprintf(fp, "%s\n", pLine);
+    }
+    while( pPacket->dwLine < pPacket->dwLines );
+
+    return( 0 );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static int ReadMappedHistory(THISHEADER *pHeader, FILE *fp, DWORD *pdw)   *
+*                                                                             *
+*******************************************************************************
+*
+*   Reads new history lines directly from the mapped history buffer. Lines
+*   are first copied out and only written if the buffer did not change while
+*   we were reading it. The mapping may change under us at any time, so
+*   every record offset is checked before it is used.
+*
+*   Where:
+*       pHeader is the mapped history buffer
+*       fp is the output file
+*       pdw is the number of the next line to read; it is updated
+*
+*   Returns:
+*       TRUE if the new lines have been written
+*       FALSE if the buffer changed while reading; retry
+*
+******************************************************************************/
+static int ReadMappedHistory(volatile THISHEADER *pHeader, FILE *fp, DWORD *pdw)
+{
+    BYTE *pBase = (BYTE *) pHeader;
+    THISLINE *pRec;
+    DWORD dwGen, dwLines, dwHead, dwOffset, dwSize, len, used = 0;
+    DWORD n, nNew, nLines = 0, nCopied;
+
+    dwGen = pHeader->dwGen;
+    if( dwGen & 1 )
+        return( FALSE );
+
+    dwLines  = pHeader->dwLines;
+    dwSize   = pHeader->dwSize;
+    dwHead   = pHeader->dwHead;
+    dwOffset = dwHead;
+
+    if( dwOffset + sizeof(THISLINE) > dwSize )
+        return( FALSE );
+
+    // Walk back from the head to the first new line (or to the oldest one)
+    nNew = dwLines - *pdw;
+
+    for(n=nNew; n && dwOffset!=pHeader->dwTail; n--)
+    {
+        pRec = (THISLINE *)(pBase + dwOffset);
+        dwOffset = pRec->prev - pHeader->dwBase;
+
+        if( dwOffset + sizeof(THISLINE) > dwSize )
+            return( FALSE );
+    }
+
+    // Copy the lines out, up to the head
+    while( dwOffset!=dwHead )
+    {
+        pRec = (THISLINE *)(pBase + dwOffset);
+
+        len = strnlen(pRec->line, MIN(MAX_STRING, dwSize - dwOffset - sizeof(THISLINE) + 1));
+        if( used + len + 1 > sizeof(BulkBuf) )
+            break;
+
+        memcpy(BulkBuf + used, pRec->line, len);
+        BulkBuf[used + len] = 0;
+        used += len + 1;
+        nLines++;
+
+        dwOffset = pRec->next - pHeader->dwBase;
+        if( dwOffset + sizeof(THISLINE) > dwSize )
+            return( FALSE );
+    }
+
+    if( pHeader->dwGen!=dwGen )
+        return( FALSE );
+
+    if( n )
+        fprintf(stderr, "*** %d history lines lost\n", n);
+
+    for(used=0, nCopied=nLines; nCopied--; used += strlen(BulkBuf + used) + 1)
+        fprintf(fp, "%s\n", BulkBuf + used);
+
+    // If we filled up our buffer, the rest is read the next time
+    *pdw = dwLines - (nNew - n) + nLines;
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void OptFollowHistory(void)                                               *
+*                                                                             *
+*******************************************************************************
+*
+*   Prints all history lines and then follows new ones as they are added,
+*   until interrupted. The history buffer is mapped read-only and polled
+*   through its generation counter, so we do not make any calls into the
+*   debugger while it is idle.
+*
+******************************************************************************/
+void OptFollowHistory(void)
+{
+    THISBUFPACKET Packet;               // Bulk fetch packet
+    volatile THISHEADER *pHeader;       // Mapped history buffer
+    DWORD dwMapSize;                    // Size of the mapping
+    DWORD dwLine;                       // Number of the next line to print
+    int hIce;
+    int nRetry;
+
+    hIce = open("/dev/"DEVICE_NAME, O_RDONLY);
+    if( hIce>=0 )
+    {
+        memset(&Packet, 0, sizeof(Packet));
+
+        if( FetchHistory(hIce, stdout, &Packet)==0 )
+        {
+            dwMapSize = (Packet.dwHistorySize + getpagesize() - 1) & ~(getpagesize() - 1);
+
+            pHeader = mmap(NULL, dwMapSize, PROT_READ, MAP_SHARED, hIce, ICE_MMAP_HISTORY);
+            if( pHeader!=MAP_FAILED )
+            {
+                while( TRUE )
+                {
+                    fflush(stdout);
+
+                    while( pHeader->dwLines==Packet.dwLine )
+                        usleep(FOLLOW_POLL_USEC);
+
+                    dwLine = Packet.dwLine;
+
+                    for(nRetry=0; nRetry<FOLLOW_RETRY; nRetry++)
+                    {
+                        if( ReadMappedHistory(pHeader, stdout, &dwLine) )
+                            break;
+                    }
+
+                    Packet.dwLine = dwLine;
+
+                    // If the debugger keeps writing, let it copy the lines for us
+                    if( nRetry==FOLLOW_RETRY )
+                        FetchHistory(hIce, stdout, &Packet);
+                }
+            }
+            else
+                fprintf(stderr, "Cannot map the Linice history buffer\n");
+        }
+        else
+            fprintf(stderr, "This version of Linice does not support following the history\n");
+
+        close(hIce);
+    }
+    else
+        fprintf(stderr, "Cannot communicate with the Linice module - is Linice loaded?!\n");
+}
+
 /******************************************************************************
 *                                                                             *
 *   void OptLogHistory(void)                                                  *
@@ -78,6 +285,7 @@ static char Buf[MAX_STRING+1];          // History buffer line to fill in
 ******************************************************************************/
 void OptLogHistory(void)
 {
+    THISBUFPACKET Packet;               // Bulk fetch packet
     int hIce;
     int status;
     FILE *fp;                           // Output file structure
@@ -103,16 +311,23 @@ void OptLogHistory(void)
         hIce = open("/dev/"DEVICE_NAME, O_RDONLY);
         if( hIce>=0 )
         {
-            // Reset the history buffer reading pointer inside the linice
-            // We ignore the return value from this call as it should be 0
-            status = ioctl(hIce, ICE_IOCTL_HISBUF_RESET, 0);
-
-            memset(Buf, 0, sizeof(Buf));    // Just in case - zero terminate string(s)
+            // Fetch as many lines per call as we can; older versions of
+            // Linice return one line at a time
+            memset(&Packet, 0, sizeof(Packet));
 
-            // Loop and get all the lines available, until we are signalled end
-            while( (status = ioctl(hIce, ICE_IOCTL_HISBUF, &Buf))==0 )
+            if( FetchHistory(hIce, fp, &Packet) )
             {
-                fprintf(fp, "%s\n", Buf);
+                // Reset the history buffer reading pointer inside the linice
+                // We ignore the return value from this call as it should be 0
+                status = ioctl(hIce, ICE_IOCTL_HISBUF_RESET, 0);
+
+                memset(Buf, 0, sizeof(Buf));    // Just in case - zero terminate string(s)
+
+                // Loop and get all the lines available, until we are signalled end
+                while( (status = ioctl(hIce, ICE_IOCTL_HISBUF, &Buf))==0 )
+                {
+                    fprintf(fp, "%s\n", Buf);
+                }
             }
 
             close(hIce);
@@ -76,6 +76,8 @@ char *pSym       = NULL;                // Default symbol table to load/unload
 char *pLogfile   = "linice.log";        // Default logfile name
 char *pSystemMap = NULL;                // User supplied System.map file
 char *pCheck     = NULL;                // Check symbol file
+char *pFolded    = NULL;                // Call stack profile output file
+char *pScreen    = NULL;                // Headless screen output file
 unsigned int opt = 0;                   // Various option flags
 int nVerbose     = 0;                   // Verbose level
 
@@ -94,7 +96,10 @@ extern void OptAddSymbolTable(char *sName);
 extern void OptRemoveSymbolTable(char *sName);
 extern void OptTranslate(char *pathOut, char *pathIn, char *pPathSubst);
 extern void OptLogHistory(void);
+extern void OptFollowHistory(void);
 extern void OptCheck(char *pFile);
+extern void OptFoldedProfile(char *pFile);
+extern void OptScreen(char *pFile);
 
 /******************************************************************************
 *                                                                             *
@@ -214,6 +219,15 @@ void OptHelp(BOOL fLong)
         printf("  -l, --logfile [<filename>][,append] Save the Linice history buffer\n");
         printf("       Example: --logfile Mylog.log,append\n");
 
+        printf("  -f, --follow                        Print the Linice history as it is added\n");
+        printf("       Example: --follow\n");
+
+        printf("  -g, --folded <filename>             Save the sampled call stacks as folded stacks\n");
+        printf("       Example: --folded kernel.folded\n");
+
+        printf("  -d, --screen <filename>             Save the headless debugger screen\n");
+        printf("       Example: --screen screen.txt\n");
+
         printf("  -v, --verbose {0-3}                 Verbose level (0=silent)\n");
         printf("       Example: --verbose 3\n");
 
@@ -403,6 +417,46 @@ int main(int argn, char *argp[])
             VERBOSE1 printf("LOGFILE %s %s\n", pLogfile, (opt & OPT_LOGFILE_APPEND)? "APPEND":"");
         }
         else
+        if( !strcmpi(argp[i], "--follow") || !strcmpi(argp[i], "-f") )
+        {
+            // --follow     print the history buffer and follow new lines
+            opt |= OPT_FOLLOW;
+
+            VERBOSE1 printf("FOLLOW\n");
+        }
+        else
+        if( !strcmpi(argp[i], "--folded") || !strcmpi(argp[i], "-g") )
+        {
+            // --folded <file>  save the sampled call stacks for flame graphs
+            opt |= OPT_FOLDED;
+
+            if( i+1<argn )
+            {
+                i++;
+                pFolded = argp[i];
+
+                VERBOSE1 printf("FOLDED %s\n", pFolded);
+            }
+            else
+                opt |= OPT_HELP;
+        }
+        else
+        if( !strcmpi(argp[i], "--screen") || !strcmpi(argp[i], "-d") )
+        {
+            // --screen <file>  save the headless output screen
+            opt |= OPT_SCREEN;
+
+            if( i+1<argn )
+            {
+                i++;
+                pScreen = argp[i];
+
+                VERBOSE1 printf("SCREEN %s\n", pScreen);
+            }
+            else
+                opt |= OPT_HELP;
+        }
+        else
         if( !strcmpi(argp[i], "--verbose") || !strcmpi(argp[i], "-v") )
         {
             // --verbose {0,1,2,3}   display more output information
@@ -534,6 +588,24 @@ int main(int argn, char *argp[])
         OptLogHistory();
     }
 
+    // Save the sampled call stacks
+    if( opt & OPT_FOLDED )
+    {
+        OptFoldedProfile(pFolded);
+    }
+
+    // Save the headless debugger screen
+    if( opt & OPT_SCREEN )
+    {
+        OptScreen(pScreen);
+    }
+
+    // Follow the history buffer; this does not return until interrupted
+    if( opt & OPT_FOLLOW )
+    {
+        OptFollowHistory();
+    }
+
     // If uninstall debugger is needed, do it last
     if( opt & OPT_UNINSTALL )
         OptUninstall();
@@ -0,0 +1,837 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     ParseUnwind.c                                                 *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains parsing code to make the unwind section.
+
+        The DWARF call frame information (.debug_frame, or .eh_frame if
+        there is no .debug_frame) is executed for every function, and the
+        resulting rules are reduced to what the debugger needs to unwind a
+        frame on i386: how to compute the CFA (from ESP or EBP) and where
+        the caller's EBP was saved. The return address is always at CFA-4.
+        Rows of all functions are stored sorted by address so the debugger
+        can binary search them.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include "Common.h"                     // Include platform specific set
+
+#include "loader.h"                     // Include global protos
+
+#include <stdlib.h>
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+#ifndef R_386_32
+#define R_386_32            1           // Direct 32 bit relocation
+#define R_386_PC32          2           // PC relative 32 bit relocation
+#endif
+
+// DWARF register numbers on i386
+
+#define DW_REG_ESP          4
+#define DW_REG_EBP          5
+
+// Pointer encodings used in .eh_frame
+
+#define DW_EH_PE_absptr     0x00
+#define DW_EH_PE_udata4     0x03
+#define DW_EH_PE_sdata4     0x0B
+#define DW_EH_PE_pcrel      0x10
+#define DW_EH_PE_omit       0xFF
+
+#define MAX_STATE_STACK     8           // Depth of the remember_state stack
+
+// Common information entry, as much of it as we need
+
+typedef struct
+{
+    DWORD dwCodeAlign;                  // Code alignment factor
+    int nDataAlign;                     // Data alignment factor
+    BYTE bEncoding;                     // Encoding of the FDE addresses
+    BYTE *pInit;                        // Initial instructions
+    BYTE *pEnd;                         // End of the initial instructions
+
+} TCIE;
+
+// Rules at a single address
+
+typedef struct
+{
+    int nCfaReg;                        // DWARF register of the CFA, -1 if unknown
+    int nCfaOffset;                     // CFA offset from that register
+    int nEbpOffset;                     // EBP saved at CFA+offset, 0 if not saved
+    BOOL fEbpUnknown;                   // EBP was saved in a way we can not describe
+
+} TCFASTATE;
+
+typedef struct
+{
+    Elf32_Ehdr *pElfHeader;             // ELF file header
+    Elf32_Shdr *pSec;                   // Frame section being parsed
+    BOOL fEhFrame;                      // Parsing .eh_frame instead of .debug_frame
+    Elf32_Rel *pRel;                    // Relocations of the frame section (objects only)
+    int nRel;                           // Number of relocations
+    Elf32_Sym *pSymbols;                // Symbol table that the relocations refer to
+    int nText;                          // Index of the .text section
+
+} TFRAMEPARSE;
+
+static TSYMUNWIND1 *pRows = NULL;       // Rows that we are collecting
+static int nRows = 0;                   // Number of rows collected
+static int nRowsMax = 0;                // Size of the rows array
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+static DWORD ReadULEB(BYTE **pp)
+{
+    DWORD value = 0;
+    int shift = 0;
+    BYTE b;
+
+    do
+    {
+        b = *(*pp)++;
+        value |= (DWORD)(b & 0x7F) << shift;
+        shift += 7;
+    }
+    while( b & 0x80 );
+
+    return( value );
+}
+
+static int ReadSLEB(BYTE **pp)
+{
+    DWORD value = 0;
+    int shift = 0;
+    BYTE b;
+
+    do
+    {
+        b = *(*pp)++;
+        value |= (DWORD)(b & 0x7F) << shift;
+        shift += 7;
+    }
+    while( b & 0x80 );
+
+    if( shift < 32 && (b & 0x40) )
+        value |= ~0U << shift;
+
+    return( (int) value );
+}
+
+static DWORD ReadDword(BYTE **pp)
+{
+    DWORD value;
+
+    memcpy(&value, *pp, sizeof(DWORD));
+    *pp += sizeof(DWORD);
+
+    return( value );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL ReadAddress(TFRAMEPARSE *pParse, BYTE **pp, BYTE bEncoding,   *
+*                           DWORD *pAddress)                                  *
+*                                                                             *
+*******************************************************************************
+*
+*   Reads the initial location of a function from an FDE.
+*
+*   For object files, the field is relocated against a symbol. Both the
+*   absolute and the PC relative relocations resolve to the symbol value
+*   plus the value stored in the field, since the PC relative encoding
+*   cancels the PC relative relocation. Only functions in .text are used.
+*
+*   Where:
+*       pParse is the parsing state
+*       pp is the pointer to the field; it is advanced past it
+*       bEncoding is the pointer encoding (DW_EH_PE_*)
+*       pAddress receives the address
+*
+*   Returns:
+*       TRUE - address read
+*       FALSE - address can not be used
+*
+******************************************************************************/
+static BOOL ReadAddress(TFRAMEPARSE *pParse, BYTE **pp, BYTE bEncoding, DWORD *pAddress)
+{
+    DWORD dwOffset;                     // Offset of the field within the section
+    Elf32_Sym *pSym;
+    int i;
+
+    if( (bEncoding & 0x0F)!=DW_EH_PE_absptr && (bEncoding & 0x0F)!=DW_EH_PE_udata4 && (bEncoding & 0x0F)!=DW_EH_PE_sdata4 )
+        return( FALSE );
+
+    if( (bEncoding & 0x70)!=DW_EH_PE_absptr && (bEncoding & 0x70)!=DW_EH_PE_pcrel )
+        return( FALSE );
+
+    dwOffset = *pp - ((BYTE *) pParse->pElfHeader + pParse->pSec->sh_offset);
+    *pAddress = ReadDword(pp);
+
+    if( pParse->pElfHeader->e_type==ET_REL )
+    {
+        for(i=0; i<pParse->nRel; i++)
+        {
+            if( pParse->pRel[i].r_offset==dwOffset )
+            {
+                if( ELF32_R_TYPE(pParse->pRel[i].r_info)!=R_386_32 && ELF32_R_TYPE(pParse->pRel[i].r_info)!=R_386_PC32 )
+                    return( FALSE );
+
+                pSym = &pParse->pSymbols[ELF32_R_SYM(pParse->pRel[i].r_info)];
+
+                if( pSym->st_shndx!=pParse->nText )
+                    return( FALSE );
+
+                *pAddress += pSym->st_value;
+
+                return( TRUE );
+            }
+        }
+
+        // A field that is not relocated does not point into .text
+        return( FALSE );
+    }
+
+    if( (bEncoding & 0x70)==DW_EH_PE_pcrel )
+        *pAddress += pParse->pSec->sh_addr + dwOffset;
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void AddRow(DWORD dwAddress, TCFASTATE *pState, BOOL fEnd)         *
+*                                                                             *
+*******************************************************************************
+*
+*   Appends a row to the unwind table. Rules that we can not describe are
+*   stored as rows without information.
+*
+*   Where:
+*       dwAddress is the first address that the row applies to
+*       pState is the state at that address
+*       fEnd is TRUE to store the end of a function
+*
+******************************************************************************/
+static void AddRow(DWORD dwAddress, TCFASTATE *pState, BOOL fEnd)
+{
+    TSYMUNWIND1 Row;
+
+    memset(&Row, 0, sizeof(Row));
+
+    Row.dwAddress = dwAddress;
+    Row.bCfaReg = UNWIND_CFA_NONE;
+
+    if( !fEnd && !pState->fEbpUnknown && pState->nCfaOffset>=0 && pState->nCfaOffset<=0xFFFF
+     && pState->nEbpOffset<=0 && pState->nEbpOffset>=-255 )
+    {
+        if( pState->nCfaReg==DW_REG_ESP )
+            Row.bCfaReg = UNWIND_CFA_ESP;
+        if( pState->nCfaReg==DW_REG_EBP )
+            Row.bCfaReg = UNWIND_CFA_EBP;
+
+        Row.wCfaOffset = pState->nCfaOffset;
+        Row.bEbpOffset = -pState->nEbpOffset;
+    }
+
+    // Do not repeat the same rules
+    if( nRows && pRows[nRows-1].bCfaReg==Row.bCfaReg && pRows[nRows-1].wCfaOffset==Row.wCfaOffset
+     && pRows[nRows-1].bEbpOffset==Row.bEbpOffset && !fEnd )
+        return;
+
+    // Several rows at the same address keep only the last one
+    if( nRows && pRows[nRows-1].dwAddress==dwAddress )
+        nRows--;
+
+    if( nRows==nRowsMax )
+    {
+        nRowsMax = nRowsMax? nRowsMax * 2 : 1024;
+        pRows = (TSYMUNWIND1 *) realloc(pRows, nRowsMax * sizeof(TSYMUNWIND1));
+        if( pRows==NULL )
+        {
+            fprintf(stderr, "Unable to allocate memory\n");
+            exit(-1);
+        }
+    }
+
+    pRows[nRows++] = Row;
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL Execute(TCIE *pCie, BYTE *p, BYTE *pEnd, TCFASTATE *pState,   *
+*                       TCFASTATE *pInitial, DWORD *pLoc, BOOL fRows)         *
+*                                                                             *
+*******************************************************************************
+*
+*   Executes call frame instructions, adding a row every time the location
+*   advances.
+*
+*   Where:
+*       pCie is the CIE of the instructions
+*       p is the first instruction
+*       pEnd is the end of the instructions
+*       pState is the current state
+*       pInitial is the state after the CIE initial instructions
+*       pLoc is the current location
+*       fRows is FALSE while executing the CIE initial instructions
+*
+*   Returns:
+*       TRUE - instructions executed
+*       FALSE - unsupported instruction found
+*
+******************************************************************************/
+static BOOL Execute(TCIE *pCie, BYTE *p, BYTE *pEnd, TCFASTATE *pState, TCFASTATE *pInitial, DWORD *pLoc, BOOL fRows)
+{
+    TCFASTATE Stack[MAX_STATE_STACK];   // Remembered states
+    int nStack = 0;
+    DWORD dwReg, dwAdvance;
+    int nOffset;
+    BYTE op;
+
+    while( p < pEnd )
+    {
+        op = *p++;
+        dwAdvance = 0;
+
+        switch( op >> 6 )
+        {
+            case 1:                     // DW_CFA_advance_loc
+                dwAdvance = (op & 0x3F) * pCie->dwCodeAlign;
+                break;
+
+            case 2:                     // DW_CFA_offset
+                nOffset = ReadULEB(&p) * pCie->nDataAlign;
+                if( (op & 0x3F)==DW_REG_EBP )
+                    pState->nEbpOffset = nOffset, pState->fEbpUnknown = FALSE;
+                break;
+
+            case 3:                     // DW_CFA_restore
+                if( (op & 0x3F)==DW_REG_EBP )
+                    pState->nEbpOffset = pInitial->nEbpOffset, pState->fEbpUnknown = pInitial->fEbpUnknown;
+                break;
+
+            default:
+                switch( op )
+                {
+                    case 0x00:          // DW_CFA_nop
+                        break;
+
+                    case 0x02:          // DW_CFA_advance_loc1
+                        dwAdvance = *p++ * pCie->dwCodeAlign;
+                        break;
+
+                    case 0x03:          // DW_CFA_advance_loc2
+                        dwAdvance = (p[0] | (p[1] << 8)) * pCie->dwCodeAlign;
+                        p += 2;
+                        break;
+
+                    case 0x04:          // DW_CFA_advance_loc4
+                        dwAdvance = ReadDword(&p) * pCie->dwCodeAlign;
+                        break;
+
+                    case 0x05:          // DW_CFA_offset_extended
+                        dwReg = ReadULEB(&p);
+                        nOffset = ReadULEB(&p) * pCie->nDataAlign;
+                        if( dwReg==DW_REG_EBP )
+                            pState->nEbpOffset = nOffset, pState->fEbpUnknown = FALSE;
+                        break;
+
+                    case 0x11:          // DW_CFA_offset_extended_sf
+                        dwReg = ReadULEB(&p);
+                        nOffset = ReadSLEB(&p) * pCie->nDataAlign;
+                        if( dwReg==DW_REG_EBP )
+                            pState->nEbpOffset = nOffset, pState->fEbpUnknown = FALSE;
+                        break;
+
+                    case 0x2F:          // DW_CFA_GNU_negative_offset_extended
+                        dwReg = ReadULEB(&p);
+                        nOffset = -(int)ReadULEB(&p) * pCie->nDataAlign;
+                        if( dwReg==DW_REG_EBP )
+                            pState->nEbpOffset = nOffset, pState->fEbpUnknown = FALSE;
+                        break;
+
+                    case 0x06:          // DW_CFA_restore_extended
+                    case 0x08:          // DW_CFA_same_value
+                        dwReg = ReadULEB(&p);
+                        if( dwReg==DW_REG_EBP )
+                        {
+                            if( op==0x06 )
+                                pState->nEbpOffset = pInitial->nEbpOffset, pState->fEbpUnknown = pInitial->fEbpUnknown;
+                            else
+                                pState->nEbpOffset = 0, pState->fEbpUnknown = FALSE;
+                        }
+                        break;
+
+                    case 0x07:          // DW_CFA_undefined
+                        dwReg = ReadULEB(&p);
+                        if( dwReg==DW_REG_EBP )
+                            pState->fEbpUnknown = TRUE;
+                        break;
+
+                    case 0x09:          // DW_CFA_register
+                        dwReg = ReadULEB(&p);
+                        ReadULEB(&p);
+                        if( dwReg==DW_REG_EBP )
+                            pState->fEbpUnknown = TRUE;
+                        break;
+
+                    case 0x0A:          // DW_CFA_remember_state
+                        if( nStack==MAX_STATE_STACK )
+                            return( FALSE );
+                        Stack[nStack++] = *pState;
+                        break;
+
+                    case 0x0B:          // DW_CFA_restore_state
+                        if( nStack==0 )
+                            return( FALSE );
+                        *pState = Stack[--nStack];
+                        break;
+
+                    case 0x0C:          // DW_CFA_def_cfa
+                        pState->nCfaReg = ReadULEB(&p);
+                        pState->nCfaOffset = ReadULEB(&p);
+                        break;
+
+                    case 0x12:          // DW_CFA_def_cfa_sf
+                        pState->nCfaReg = ReadULEB(&p);
+                        pState->nCfaOffset = ReadSLEB(&p) * pCie->nDataAlign;
+                        break;
+
+                    case 0x0D:          // DW_CFA_def_cfa_register
+                        pState->nCfaReg = ReadULEB(&p);
+                        break;
+
+                    case 0x0E:          // DW_CFA_def_cfa_offset
+                        pState->nCfaOffset = ReadULEB(&p);
+                        break;
+
+                    case 0x13:          // DW_CFA_def_cfa_offset_sf
+                        pState->nCfaOffset = ReadSLEB(&p) * pCie->nDataAlign;
+                        break;
+
+                    case 0x0F:          // DW_CFA_def_cfa_expression
+                        nOffset = ReadULEB(&p);
+                        p += nOffset;
+                        pState->nCfaReg = -1;
+                        break;
+
+                    case 0x10:          // DW_CFA_expression
+                    case 0x16:          // DW_CFA_val_expression
+                        dwReg = ReadULEB(&p);
+                        nOffset = ReadULEB(&p);
+                        p += nOffset;
+                        if( dwReg==DW_REG_EBP )
+                            pState->fEbpUnknown = TRUE;
+                        break;
+
+                    case 0x14:          // DW_CFA_val_offset
+                    case 0x15:          // DW_CFA_val_offset_sf
+                        dwReg = ReadULEB(&p);
+                        if( op==0x14 )
+                            ReadULEB(&p);
+                        else
+                            ReadSLEB(&p);
+                        if( dwReg==DW_REG_EBP )
+                            pState->fEbpUnknown = TRUE;
+                        break;
+
+                    case 0x2E:          // DW_CFA_GNU_args_size
+                        ReadULEB(&p);
+                        break;
+
+                    default:            // DW_CFA_set_loc and anything else we do not know
+                        return( FALSE );
+                }
+        }
+
+        if( dwAdvance && fRows )
+        {
+            AddRow(*pLoc, pState, FALSE);
+            *pLoc += dwAdvance;
+        }
+    }
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL ParseCie(TFRAMEPARSE *pParse, BYTE *p, BYTE *pEnd, TCIE *pCie)*
+*                                                                             *
+*******************************************************************************
+*
+*   Parses a common information entry.
+*
+*   Where:
+*       pParse is the parsing state
+*       p is the address of the CIE, following its id
+*       pEnd is the end of the CIE
+*       pCie receives the CIE information
+*
+*   Returns:
+*       TRUE - CIE parsed
+*       FALSE - CIE that we do not support
+*
+******************************************************************************/
+static BOOL ParseCie(TFRAMEPARSE *pParse, BYTE *p, BYTE *pEnd, TCIE *pCie)
+{
+    BYTE bVersion;
+    char *pAug;                         // Augmentation string
+    BYTE *pAugEnd = NULL;               // End of the augmentation data
+    DWORD dwAugLen;                     // Length of the augmentation data
+
+    memset(pCie, 0, sizeof(TCIE));
+    pCie->bEncoding = DW_EH_PE_absptr;
+
+    bVersion = *p++;
+    pAug = (char *) p;
+    p += strlen(pAug) + 1;
+
+    // Version 4 of .debug_frame has the address and segment size
+    if( bVersion>=4 )
+    {
+        if( p[0]!=4 || p[1]!=0 )
+            return( FALSE );
+        p += 2;
+    }
+
+    pCie->dwCodeAlign = ReadULEB(&p);
+    pCie->nDataAlign  = ReadSLEB(&p);
+
+    // Return address register
+    if( bVersion==1 )
+        p++;
+    else
+        ReadULEB(&p);
+
+    if( *pAug=='z' )
+    {
+        dwAugLen = ReadULEB(&p);
+        pAugEnd = p + dwAugLen;
+        pAug++;
+
+        while( *pAug )
+        {
+            switch( *pAug++ )
+            {
+                case 'R':               // FDE address encoding
+                    pCie->bEncoding = *p++;
+                    break;
+
+                case 'L':               // LSDA encoding
+                    p++;
+                    break;
+
+                case 'P':               // Personality routine (skipped by the length anyways)
+                case 'S':               // Signal frame
+                    break;
+
+                default:
+                    return( FALSE );
+            }
+        }
+
+        p = pAugEnd;
+    }
+    else
+    if( *pAug )
+        return( FALSE );
+
+    pCie->pInit = p;
+    pCie->pEnd  = pEnd;
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void ParseFrameSection(TFRAMEPARSE *pParse)                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Parses all FDEs of a frame section and adds their rows.
+*
+*   Where:
+*       pParse is the parsing state
+*
+******************************************************************************/
+static void ParseFrameSection(TFRAMEPARSE *pParse)
+{
+    BYTE *pSection, *p, *pEntry, *pEnd;
+    BYTE *pCieEntry;                    // CIE that an FDE refers to
+    DWORD dwLength, dwId;
+    DWORD dwStart, dwRange, dwLoc;      // Function address range and the current location
+    TCIE Cie;
+    TCFASTATE State, Initial;
+    int nFde = 0, nSkipped = 0;
+
+    pSection = (BYTE *) pParse->pElfHeader + pParse->pSec->sh_offset;
+    p = pSection;
+
+    while( p + 4 <= pSection + pParse->pSec->sh_size )
+    {
+        pEntry = p;
+        dwLength = ReadDword(&p);
+
+        // Zero length terminates .eh_frame; we do not support 64 bit DWARF
+        if( dwLength==0 || dwLength==0xFFFFFFFF )
+            break;
+
+        pEnd = p + dwLength;
+        if( pEnd > pSection + pParse->pSec->sh_size )
+            break;
+
+        dwId = ReadDword(&p);
+
+        // Skip CIEs, we parse them as FDEs refer to them
+        if( (pParse->fEhFrame && dwId==0) || (!pParse->fEhFrame && dwId==0xFFFFFFFF) )
+        {
+            p = pEnd;
+            continue;
+        }
+
+        nFde++;
+
+        // Find the CIE of this FDE
+        if( pParse->fEhFrame )
+            pCieEntry = pEntry + 4 - dwId;
+        else
+            pCieEntry = pSection + dwId;
+
+        if( pCieEntry < pSection || pCieEntry + 8 > pEnd )
+        {
+            nSkipped++;
+            p = pEnd;
+            continue;
+        }
+
+        if( !ParseCie(pParse, pCieEntry + 8, pCieEntry + 4 + *(DWORD *)pCieEntry, &Cie)
+         || !ReadAddress(pParse, &p, pParse->fEhFrame? Cie.bEncoding : DW_EH_PE_absptr, &dwStart) )
+        {
+            nSkipped++;
+            p = pEnd;
+            continue;
+        }
+
+        // The range is never relocated
+        dwRange = ReadDword(&p);
+
+        // Skip the augmentation data
+        if( pParse->fEhFrame && *(char *)(pCieEntry + 9)=='z' )
+        {
+            dwLength = ReadULEB(&p);
+            p += dwLength;
+        }
+
+        memset(&State, 0, sizeof(State));
+        State.nCfaReg = -1;
+        dwLoc = dwStart;
+
+        // Initial instructions of the CIE give the state at the function start
+        if( Execute(&Cie, Cie.pInit, Cie.pEnd, &State, &State, &dwLoc, FALSE) )
+        {
+            Initial = State;
+
+            if( Execute(&Cie, p, pEnd, &State, &Initial, &dwLoc, TRUE) )
+            {
+                AddRow(dwLoc, &State, FALSE);
+                AddRow(dwStart + dwRange, &State, TRUE);
+            }
+            else
+            {
+                // Unsupported instruction; keep what we know and end the function there
+                AddRow(dwLoc, &State, TRUE);
+                nSkipped++;
+            }
+        }
+        else
+            nSkipped++;
+
+        p = pEnd;
+    }
+
+    VERBOSE2 printf("Parsed %d FDEs, skipped %d\n", nFde, nSkipped);
+}
+
+/******************************************************************************
+*                                                                             *
+*   static int CompareRows(const void *p1, const void *p2)                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Sorts rows by their address. At the same address, the end of a function
+*   sorts before the start of the next one so that the latter is kept.
+*
+******************************************************************************/
+static int CompareRows(const void *p1, const void *p2)
+{
+    TSYMUNWIND1 *pRow1 = (TSYMUNWIND1 *) p1;
+    TSYMUNWIND1 *pRow2 = (TSYMUNWIND1 *) p2;
+
+    if( pRow1->dwAddress!=pRow2->dwAddress )
+        return( pRow1->dwAddress < pRow2->dwAddress? -1 : 1 );
+
+    return( (pRow1->bCfaReg!=UNWIND_CFA_NONE) - (pRow2->bCfaReg!=UNWIND_CFA_NONE) );
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL ParseUnwind(int fd, int fs, BYTE *pBuf)                              *
+*                                                                             *
+*******************************************************************************
+*
+*   Parses the call frame information of the input file and creates the
+*   unwind symbol file section. Files without call frame information do not
+*   get the section and the debugger falls back to its heuristics.
+*
+*   Where:
+*       fd - symbol table file descriptor (to write to)
+*       fs - strings file (to write to)
+*       pBuf - buffer containing the ELF file
+*
+*   Returns:
+*       TRUE - Unwind data parsed and stored
+*       FALSE - Critical error
+*
+******************************************************************************/
+BOOL ParseUnwind(int fd, int fs, BYTE *pBuf)
+{
+    TFRAMEPARSE Parse;                  // Parsing state
+    TSYMUNWIND Unwind;                  // Unwind section header
+    Elf32_Shdr *Sec;                    // Section header array
+    Elf32_Shdr *SecName;                // Section header string table
+    Elf32_Shdr *SecDebugFrame = NULL;   // Section .debug_frame
+    Elf32_Shdr *SecEhFrame = NULL;      // Section .eh_frame
+    char *pStr;
+    int i, j;
+
+    VERBOSE2 printf("=============================================================================\n");
+    VERBOSE2 printf("||         PARSE CALL FRAME INFORMATION                                    ||\n");
+    VERBOSE2 printf("=============================================================================\n");
+    VERBOSE1 printf("Parsing call frame information.\n");
+
+    memset(&Parse, 0, sizeof(Parse));
+    Parse.pElfHeader = (Elf32_Ehdr *) pBuf;
+
+    Sec = (Elf32_Shdr *) &pBuf[Parse.pElfHeader->e_shoff];
+    SecName = &Sec[Parse.pElfHeader->e_shstrndx];
+
+    for( i=1; i<Parse.pElfHeader->e_shnum; i++ )
+    {
+        pStr = (char *)pBuf + SecName->sh_offset + Sec[i].sh_name;
+
+        if( strcmp(".debug_frame", pStr)==0 )
+            SecDebugFrame = &Sec[i];
+        if( strcmp(".eh_frame", pStr)==0 )
+            SecEhFrame = &Sec[i];
+        if( strcmp(".text", pStr)==0 )
+            Parse.nText = i;
+    }
+
+    Parse.pSec = SecDebugFrame? SecDebugFrame : SecEhFrame;
+    Parse.fEhFrame = SecDebugFrame==NULL;
+
+    if( Parse.pSec==NULL )
+    {
+        VERBOSE1 printf("No call frame information. Section skipped.\n");
+        return( TRUE );
+    }
+
+    // Object files need the relocations of the frame section
+    if( Parse.pElfHeader->e_type==ET_REL )
+    {
+        for( i=1; i<Parse.pElfHeader->e_shnum; i++ )
+        {
+            if( Sec[i].sh_type==SHT_REL && &Sec[Sec[i].sh_info]==Parse.pSec )
+            {
+                Parse.pRel = (Elf32_Rel *) (pBuf + Sec[i].sh_offset);
+                Parse.nRel = Sec[i].sh_size / sizeof(Elf32_Rel);
+                Parse.pSymbols = (Elf32_Sym *) (pBuf + Sec[Sec[i].sh_link].sh_offset);
+            }
+        }
+    }
+
+    nRows = 0;
+
+    ParseFrameSection(&Parse);
+
+    // Sort the rows, drop the ends of functions that the next one starts at
+    // and merge rows that continue the same rules
+    qsort(pRows, nRows, sizeof(TSYMUNWIND1), CompareRows);
+
+    for(i=0, j=0; i<nRows; i++)
+    {
+        if( i+1<nRows && pRows[i].dwAddress==pRows[i+1].dwAddress )
+            continue;
+
+        if( j && pRows[j-1].bCfaReg==pRows[i].bCfaReg && pRows[j-1].wCfaOffset==pRows[i].wCfaOffset
+         && pRows[j-1].bEbpOffset==pRows[i].bEbpOffset )
+            continue;
+
+        pRows[j++] = pRows[i];
+    }
+    nRows = j;
+
+    if( nRows )
+    {
+        Unwind.h.hType  = HTYPE_UNWIND;
+        Unwind.h.dwSize = sizeof(TSYMUNWIND) + sizeof(TSYMUNWIND1) * (nRows-1);
+        Unwind.nRows    = nRows;
+
+        write(fd, &Unwind, sizeof(TSYMUNWIND) - sizeof(TSYMUNWIND1));
+        write(fd, pRows, sizeof(TSYMUNWIND1) * nRows);
+    }
+
+    VERBOSE1 printf("Stored %d unwind rows from %s\n", nRows, Parse.fEhFrame? ".eh_frame":".debug_frame");
+
+    free(pRows);
+    pRows = NULL;
+    nRowsMax = 0;
+
+    return( TRUE );
+}
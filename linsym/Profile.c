@@ -0,0 +1,128 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     Profile.c                                                     *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the code to save the call stacks sampled by the
+        Linice profiler (PROFILE CALLS ON) in the folded stack format, one
+        line per distinct stack, that the flame graph tools read.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include <fcntl.h>                      // Include file control file
+#include <stdio.h>                      // Include standard io file
+#include <stdlib.h>                     // Include standard library header
+#include <string.h>                     // Include strings header file
+#include <unistd.h>                     // Include standard UNIX header file
+#include <sys/ioctl.h>                  // Include ioctl header file
+
+#include "Common.h"                     // Include platform specific set
+
+#include "ice-ioctl.h"                  // Include io control codes
+#include "loader.h"                     // Include loader global protos
+
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+#define FOLDED_BUF_SIZE     (64 * 1024) // Size of the buffer for folded stacks
+
+static char FoldedBuf[FOLDED_BUF_SIZE]; // Buffer receiving folded stack lines
+
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   void OptFoldedProfile(char *pFile)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Fetches the sampled call stacks and saves them into a file as folded
+*   stacks.
+*
+*   Where:
+*       pFile is the name of the output file
+*
+******************************************************************************/
+void OptFoldedProfile(char *pFile)
+{
+    TPROFPACKET Packet;                 // Folded stacks fetch packet
+    int hIce;
+    FILE *fp;                           // Output file structure
+
+    fp = fopen(pFile, "w");
+    if( fp )
+    {
+        hIce = open("/dev/"DEVICE_NAME, O_RDONLY);
+        if( hIce>=0 )
+        {
+            memset(&Packet, 0, sizeof(Packet));
+
+            do
+            {
+                Packet.dwSize = sizeof(FoldedBuf);
+                Packet.pBuf = FoldedBuf;
+
+                if( ioctl(hIce, ICE_IOCTL_PROFILE_FOLDED, &Packet) )
+                {
+                    fprintf(stderr, "Linice does not support the call stack profile\n");
+                    break;
+                }
+
+                fwrite(FoldedBuf, 1, Packet.dwSize, fp);
+            }
+            while( Packet.dwSize && Packet.dwNode < Packet.dwNodes );
+
+            VERBOSE1 printf("%d call stack samples\n", Packet.dwSamples);
+
+            close(hIce);
+        }
+        else
+            fprintf(stderr, "Cannot communicate with the Linice module - is Linice loaded?!\n");
+
+        fclose(fp);
+    }
+    else
+        fprintf(stderr, "Error opening output profile file %s!\n", pFile);
+}
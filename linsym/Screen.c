@@ -0,0 +1,162 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     Screen.c                                                      *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the code to save the screen of the Linice
+        headless output driver (HEADLESS command) into a text file, together
+        with the cost of drawing the last frame.
+
+        ScreenSave() only formats the screen cells; it is also linked into
+        the host harness benchmark runner (tools/Host).
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include <fcntl.h>                      // Include file control file
+#include <stdio.h>                      // Include standard io file
+#include <stdlib.h>                     // Include standard library header
+#include <string.h>                     // Include strings header file
+#include <unistd.h>                     // Include standard UNIX header file
+#include <sys/ioctl.h>                  // Include ioctl header file
+
+#include "Common.h"                     // Include platform specific set
+
+#include "ice-ioctl.h"                  // Include io control codes
+#include "loader.h"                     // Include loader global protos
+
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+static WORD Cells[MAX_OUTPUT_SIZEY * MAX_OUTPUT_SIZEX];
+
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   void ScreenSave(FILE *fp, TSCREENPACKET *pPacket)                         *
+*                                                                             *
+*******************************************************************************
+*
+*   Writes the screen cells that were fetched with ICE_IOCTL_SCREEN into a
+*   file as text, one line per screen row, without the trailing spaces.
+*
+*   Where:
+*       fp is the output file
+*       pPacket is the screen packet with the cells in pBuf
+*
+******************************************************************************/
+void ScreenSave(FILE *fp, TSCREENPACKET *pPacket)
+{
+    char sLine[MAX_OUTPUT_SIZEX + 2];   // Line to be written out
+    DWORD x, y, len;
+
+    for(y=0; y<pPacket->dwSizeY && (y+1) * pPacket->dwSizeX * sizeof(WORD) <= pPacket->dwSize; y++)
+    {
+        for(x=0, len=0; x<pPacket->dwSizeX && x<MAX_OUTPUT_SIZEX; x++)
+        {
+            // Unprintable characters come from the line drawing codes
+            sLine[x] = pPacket->pBuf[y * pPacket->dwSizeX + x] & 0xFF;
+            if( (BYTE) sLine[x] < ' ' || (BYTE) sLine[x] >= 0x7F )
+                sLine[x] = '.';
+
+            if( sLine[x] != ' ' )
+                len = x + 1;
+        }
+
+        sLine[len++] = '\n';
+        fwrite(sLine, 1, len, fp);
+    }
+}
+
+/******************************************************************************
+*                                                                             *
+*   void OptScreen(char *pFile)                                               *
+*                                                                             *
+*******************************************************************************
+*
+*   Fetches the headless output screen and saves it into a file as text,
+*   one line per screen row, without the trailing spaces.
+*
+*   Where:
+*       pFile is the name of the output file
+*
+******************************************************************************/
+void OptScreen(char *pFile)
+{
+    TSCREENPACKET Packet;               // Screen fetch packet
+    int hIce;
+    FILE *fp;                           // Output file structure
+
+    fp = fopen(pFile, "w");
+    if( fp )
+    {
+        hIce = open("/dev/"DEVICE_NAME, O_RDONLY);
+        if( hIce>=0 )
+        {
+            memset(&Packet, 0, sizeof(Packet));
+
+            Packet.dwSize = sizeof(Cells);
+            Packet.pBuf = Cells;
+
+            if( ioctl(hIce, ICE_IOCTL_SCREEN, &Packet)==0 )
+            {
+                ScreenSave(fp, &Packet);
+
+                VERBOSE1 printf("Screen %dx%d, %d frames, last frame %d bytes %d cells\n",
+                    Packet.dwSizeX, Packet.dwSizeY, Packet.dwFrames, Packet.dwFrameBytes, Packet.dwFrameCells);
+            }
+            else
+                fprintf(stderr, "Linice does not support the headless screen\n");
+
+            close(hIce);
+        }
+        else
+            fprintf(stderr, "Cannot communicate with the Linice module - is Linice loaded?!\n");
+
+        fclose(fp);
+    }
+    else
+        fprintf(stderr, "Error opening output screen file %s!\n", pFile);
+}
@@ -49,6 +49,7 @@
 
 #ifndef WIN32
 #include <sys/ioctl.h>                  // Include ioctl header file
+#include <sys/mman.h>                   // Include memory mapping header file
 #include <unistd.h>                     // Include standard UNIX header file
 #define O_BINARY    0
 #else // WIN32
@@ -78,6 +79,89 @@
 *                                                                             *
 ******************************************************************************/
 
+#ifndef WIN32
+/******************************************************************************
+*                                                                             *
+*   static int MapSymbolTable(int hIce, int fd, char *sName, DWORD dwSize)    *
+*                                                                             *
+*******************************************************************************
+*
+*   Loads a symbol table by reading it directly into the debugger's staging
+*   area mapped into our address space. This avoids allocating the table in
+*   the loader and copying it again into the debugger.
+*
+*   Where:
+*       hIce is the open debugger device
+*       fd is the open symbol file
+*       sName is the file name of the symbols to load
+*       dwSize is the size of the symbol file
+*
+*   Returns:
+*       0 symbol table added
+*       1 symbol table could not be loaded - an error has been printed
+*       -1 mapping is not available, use ICE_IOCTL_ADD_SYM instead
+*
+******************************************************************************/
+static int MapSymbolTable(int hIce, int fd, char *sName, DWORD dwSize)
+{
+    TSYMMAPPACKET Packet;               // Staging request
+    void *pMap;                         // Staging area mapped in
+    int status;
+
+    Packet.dwSize = dwSize;
+    Packet.dwMapSize = 0;
+
+    if( ioctl(hIce, ICE_IOCTL_SYM_STAGE, &Packet)==0 )
+    {
+        pMap = mmap(NULL, Packet.dwMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, hIce, ICE_MMAP_SYMBOLS);
+        if( pMap!=MAP_FAILED )
+        {
+            status = read(fd, pMap, dwSize);
+
+            // Make sure it is a valid symbol file
+            if( status==dwSize && !strcmp(pMap, SYMSIG) )
+            {
+                // Debugger does not accept the table while we have it mapped
+                munmap(pMap, Packet.dwMapSize);
+
+                status = ioctl(hIce, ICE_IOCTL_SYM_COMMIT, 0);
+
+                VERBOSE2 printf("AddSymbolTable: mapped, IOCTL=%d\n", status);
+
+                if( status==0 )
+                {
+                    printf("Symbol table '%s' added.\n", sName);
+                    return( 0 );
+                }
+
+                fprintf(stderr, "Error adding symbol table %s\n", sName);
+
+                return( 1 );
+            }
+
+            if( status!=dwSize )
+                fprintf(stderr, "Error reading symbol table %s\n", sName);
+            else
+                fprintf(stderr, "%s is an invalid Linice symbol file!\n", sName);
+
+            munmap(pMap, Packet.dwMapSize);
+
+            status = 1;
+        }
+        else
+            status = -1;
+
+        // Release the staging area
+        Packet.dwSize = 0;
+        ioctl(hIce, ICE_IOCTL_SYM_STAGE, &Packet);
+
+        return( status );
+    }
+
+    return( -1 );
+}
+#endif // WIN32
+
 /******************************************************************************
 *                                                                             *
 *   void OptAddSymbolTable(char *sName)                                       *
@@ -104,6 +188,27 @@ void OptAddSymbolTable(char *sName)
         fd = open(sName, O_RDONLY | O_BINARY);
         if( fd>0 )
         {
+#ifndef WIN32
+            //====================================================
+            // Try to read the symbol file directly into the debugger
+            //====================================================
+            hIce = open("/dev/"DEVICE_NAME, O_RDWR);
+            if( hIce>=0 )
+            {
+                status = MapSymbolTable(hIce, fd, sName, prop.st_size);
+                close(hIce);
+
+                if( status>=0 )
+                {
+                    close(fd);
+                    return;
+                }
+
+                // Older debugger or no mapping support, send the table down instead
+                lseek(fd, 0, SEEK_SET);
+            }
+#endif // WIN32
+
             // Get the total length of the file, allocate memory and load it in
             pBuf = malloc(prop.st_size);
             if( pBuf )
@@ -140,6 +245,8 @@ void OptAddSymbolTable(char *sName)
             }
             else
                 fprintf(stderr, "Error allocating memory\n");
+
+            close(fd);
         }
         else
             fprintf(stderr, "Unable to open symbol file %s\n", sName);
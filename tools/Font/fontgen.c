@@ -0,0 +1,373 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     fontgen.c                                                     *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This is a build time tool that converts a console font into the
+        glyph table of the Linice framebuffer output (font-extra.h).
+
+        Supported are PSF version 1 and 2 fonts (the Linux console fonts,
+        uncompressed) and BDF fonts. The first 256 characters are taken,
+        each glyph is stored as its rows of (width+7)/8 bytes with the
+        leftmost pixel in the MSB of the first byte.
+
+        Characters C4 and CA are swapped, the same way as in the built-in
+        fonts, since the debugger draws the horizontal line with CA.
+
+        Usage:  fontgen <font.psf | font.bdf>  >  font-extra.h
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+#include <stdlib.h>                     // Include standard library
+#include <string.h>                     // Include strings header file
+#include <stdio.h>                      // Include standard io file
+
+#include "ice-limits.h"                 // Include our limits
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+#define PSF1_MAGIC0     0x36
+#define PSF1_MAGIC1     0x04
+#define PSF2_MAGIC      0x864AB572
+
+// Little endian word i of the PSF2 header
+
+#define PSF2_WORD(i)    (pBuf[(i)*4] | (pBuf[(i)*4+1] << 8) | (pBuf[(i)*4+2] << 16) | ((unsigned long)pBuf[(i)*4+3] << 24))
+
+#define MAX_FONT_Y      64              // Tallest font that we convert
+
+static unsigned char Glyph[256][MAX_FONT_Y][MAX_FONT_X / 8];
+static int xsize, ysize;                // Font size in pixels
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   static int SetSize(int width, int height)                                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Checks that the font size can be used by the debugger.
+*
+*   Returns:
+*       0 if the size is good
+*       -1 if the size is not supported
+*
+******************************************************************************/
+static int SetSize(int width, int height)
+{
+    if( width < 1 || width > MAX_FONT_X || height < 1 || height > MAX_FONT_Y )
+    {
+        fprintf(stderr, "Font size %d x %d is not supported (up to %d x %d)\n",
+            width, height, MAX_FONT_X, MAX_FONT_Y);
+        return( -1 );
+    }
+
+    xsize = width;
+    ysize = height;
+
+    return( 0 );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static int LoadPsf(unsigned char *pBuf, long len)                         *
+*                                                                             *
+*******************************************************************************
+*
+*   Loads the glyphs of a PSF version 1 or 2 font.
+*
+*   Returns:
+*       0 on success
+*       1 if the file is not a PSF font
+*       -1 on error
+*
+******************************************************************************/
+static int LoadPsf(unsigned char *pBuf, long len)
+{
+    unsigned long offset, count, size, magic;
+    int width, height, bpl, c, y;
+
+    magic = PSF2_WORD(0);
+
+    if( len >= 4 && pBuf[0]==PSF1_MAGIC0 && pBuf[1]==PSF1_MAGIC1 )
+    {
+        // PSF1: 8 pixels wide, 256 or 512 glyphs of charsize bytes
+        offset = 4;
+        count  = (pBuf[2] & 1)? 512 : 256;
+        size   = pBuf[3];
+        width  = 8;
+        height = pBuf[3];
+    }
+    else
+    if( len >= 32 && magic==PSF2_MAGIC )
+    {
+        // PSF2: little endian header of 8 words
+        offset = PSF2_WORD(2);
+        count  = PSF2_WORD(4);
+        size   = PSF2_WORD(5);
+        height = PSF2_WORD(6);
+        width  = PSF2_WORD(7);
+    }
+    else
+        return( 1 );
+
+    if( SetSize(width, height) )
+        return( -1 );
+
+    bpl = (width + 7) / 8;
+
+    if( size < (unsigned long)(bpl * height) || offset + (count < 256? count : 256) * size > (unsigned long)len )
+    {
+        fprintf(stderr, "PSF font file is truncated\n");
+        return( -1 );
+    }
+
+    for(c=0; c<256 && c<(int)count; c++)
+    {
+        for(y=0; y<height; y++)
+        {
+            memcpy(Glyph[c][y], pBuf + offset + c * size + y * bpl, bpl);
+        }
+    }
+
+    return( 0 );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static int LoadBdf(char *pBuf)                                            *
+*                                                                             *
+*******************************************************************************
+*
+*   Loads the glyphs of a BDF font. Glyphs are placed within the font
+*   bounding box by their own bounding boxes.
+*
+*   Returns:
+*       0 on success
+*       -1 on error
+*
+******************************************************************************/
+static int LoadBdf(char *pBuf)
+{
+    char *pLine, *pNext;
+    int fbbW, fbbH, fbbX, fbbY;         // Font bounding box
+    int bbW, bbH, bbX, bbY;             // Glyph bounding box
+    int enc = -1, row = -1;             // Current glyph and its bitmap row
+    int x, i, bits;
+    unsigned long value;
+
+    fbbW = fbbH = fbbX = fbbY = 0;
+    bbW = bbH = bbX = bbY = 0;
+
+    for(pLine=pBuf; pLine && *pLine; pLine=pNext)
+    {
+        // Terminate the line and find the next one
+        pNext = strchr(pLine, '\n');
+        if( pNext )
+            *pNext++ = 0;
+
+        if( !strncmp(pLine, "FONTBOUNDINGBOX", 15) )
+        {
+            if( sscanf(pLine + 15, "%d %d %d %d", &fbbW, &fbbH, &fbbX, &fbbY) != 4 || SetSize(fbbW, fbbH) )
+                return( -1 );
+        }
+        else
+        if( !strncmp(pLine, "ENCODING", 8) )
+        {
+            enc = atoi(pLine + 8);
+        }
+        else
+        if( !strncmp(pLine, "BBX", 3) )
+        {
+            sscanf(pLine + 3, "%d %d %d %d", &bbW, &bbH, &bbX, &bbY);
+        }
+        else
+        if( !strncmp(pLine, "BITMAP", 6) )
+        {
+            // Bitmap rows follow, place the first one within the font box
+            row = (fbbH + fbbY) - (bbH + bbY);
+        }
+        else
+        if( !strncmp(pLine, "ENDCHAR", 7) )
+        {
+            row = -1;
+            enc = -1;
+        }
+        else
+        if( row >= 0 )
+        {
+            // A bitmap row in hex, padded to whole bytes
+            if( enc >= 0 && enc < 256 && row < ysize )
+            {
+                bits = ((bbW + 7) / 8) * 8;
+                value = strtoul(pLine, NULL, 16);
+
+                for(i=0; i<bbW; i++)
+                {
+                    x = bbX - fbbX + i;
+
+                    if( x >= 0 && x < xsize && (value & (1UL << (bits - 1 - i))) )
+                        Glyph[enc][row][x / 8] |= 0x80 >> (x & 7);
+                }
+            }
+
+            row++;
+        }
+    }
+
+    if( xsize==0 )
+    {
+        fprintf(stderr, "BDF font has no FONTBOUNDINGBOX\n");
+        return( -1 );
+    }
+
+    return( 0 );
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   static void WriteFont(char *pName)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Writes the glyph table as a C header file to the standard output.
+*
+******************************************************************************/
+static void WriteFont(char *pName)
+{
+    unsigned char swap[MAX_FONT_Y][MAX_FONT_X / 8];
+    int bpl, c, y, i;
+
+    bpl = (xsize + 7) / 8;
+
+    // Swap the horizontal line characters C4 and CA
+    memcpy(swap, Glyph[0xC4], sizeof(swap));
+    memcpy(Glyph[0xC4], Glyph[0xCA], sizeof(swap));
+    memcpy(Glyph[0xCA], swap, sizeof(swap));
+
+    printf("// Generated by fontgen from %s - do not edit\n\n", pName);
+    printf("#define FONT_EXTRA_X        %d\n", xsize);
+    printf("#define FONT_EXTRA_Y        %d\n\n", ysize);
+    printf("static const BYTE fontExtra[256 * %d * %d] = {\n", ysize, bpl);
+
+    for(c=0; c<256; c++)
+    {
+        printf("   ");
+
+        for(y=0; y<ysize; y++)
+        {
+            for(i=0; i<bpl; i++)
+            {
+                printf(" 0x%02X%s", Glyph[c][y][i], (c==255 && y==ysize-1 && i==bpl-1)? " " : ",");
+            }
+        }
+
+        printf(" // %d\n", c);
+    }
+
+    printf("};\n");
+}
+
+
+/******************************************************************************
+*                                                                             *
+*   int main(int argc, char *argv[])                                          *
+*                                                                             *
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+    FILE *fp;
+    char *pBuf;
+    long len;
+    int ret;
+
+    if( argc != 2 )
+    {
+        fprintf(stderr, "Usage: fontgen <font.psf | font.bdf>  >  font-extra.h\n");
+        return( 1 );
+    }
+
+    if( (fp = fopen(argv[1], "rb"))==NULL )
+    {
+        fprintf(stderr, "Unable to open %s\n", argv[1]);
+        return( 1 );
+    }
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    // Leave a terminating zero for the BDF parser
+    if( len < 4 || (pBuf = calloc(len + 1, 1))==NULL || fread(pBuf, 1, len, fp) != (size_t)len )
+    {
+        fprintf(stderr, "Unable to read %s\n", argv[1]);
+        fclose(fp);
+        return( 1 );
+    }
+
+    fclose(fp);
+
+    ret = LoadPsf((unsigned char *) pBuf, len);
+
+    if( ret==1 )
+    {
+        if( !strncmp(pBuf, "STARTFONT", 9) )
+            ret = LoadBdf(pBuf);
+        else
+        {
+            fprintf(stderr, "%s is not a PSF or BDF font\n", argv[1]);
+            ret = -1;
+        }
+    }
+
+    if( ret==0 )
+        WriteFont(argv[1]);
+
+    free(pBuf);
+
+    return( ret? 1 : 0 );
+}
@@ -0,0 +1,818 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     bench.c                                                       *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the benchmark runner of the host harness.
+
+        It initializes the debugger core the same way the driver does,
+        loads one or more symbol files through the driver IOCTL, optionally
+        loads a kernel image into the fake memory and a register set, and
+        then times:
+
+            sym_address  - address to symbol name, symbol table globals
+            sym_module   - address to symbol name, fake module exports
+            sym_name     - symbol name evaluation
+            expression   - evaluation of a set of expressions
+            disasm       - disassembly from the current EIP
+            redraw       - redraw of all debugger windows
+            command      - execution of a few commands
+            watch        - evaluation of the watch list across two stops;
+                           values that did not change must not be marked
+
+        The debugger draws into the headless output driver, whose byte and
+        cell counts are reported with the redraw. The final screen can be
+        saved as text to be compared against a known good one.
+
+        Results are printed to stdout as a single JSON object.
+
+        The linice core defines its own sprintf() and string functions;
+        this module uses only the snprintf() and printf() family of the
+        C library for the output.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include <stdlib.h>                     // Include standard library file
+#include <stdio.h>                      // Include standard IO library file
+#include <string.h>                     // Include string header file
+#include <unistd.h>                     // Include standard UNIX header file
+#include <time.h>                       // Include time functions
+#include <elf.h>                        // Include ELF file defines
+#include <sys/types.h>                  // Include file functions
+#include <sys/ioctl.h>                  // Include IO control macros
+
+#include "ice-types.h"                  // Include exended data types
+#include "ice-version.h"                 // Include version file
+#include "iceface.h"                    // Include interface defines
+#include "ice.h"                        // Include main debugger structures
+#include "disassembler.h"               // Include disassembler header file
+
+#include "host.h"                       // Include host harness header file
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+#define MAX_SYMFILES            8       // Maximum number of symbol files
+#define MAX_SAMPLES             4096    // Maximum number of globals sampled
+#define DISASM_WINDOW           4096    // Code bytes disassembled before wrapping
+#define DEFAULT_ITERATIONS      100     // Default number of iterations
+
+static TREGS Regs;                      // Captured register set
+
+static DWORD Samples[MAX_SAMPLES];      // Addresses of the sampled globals
+static char *SampleNames[MAX_SAMPLES];  // And their names
+static int nSamples = 0;
+
+static char *pSymFile[MAX_SYMFILES];
+static int nSymFiles = 0;
+static char *pImage = NULL;
+static char *pScreen = NULL;
+static int nIterations = DEFAULT_ITERATIONS;
+static int nResults = 0;
+static int nErrors = 0;                 // Number of failed checks
+
+static char *Expressions[] =
+{
+    "1+2*3-4/2",
+    "eip",
+    "esp+8",
+    "@esp",
+    "(eax << 4) | (ebx & 0xFF)",
+    "-1 & 0xFFFF",
+    "ecx*4 + edx",
+    NULL
+};
+
+static char *Commands[] =
+{
+    "? eip",
+    "? 1+2",
+    "u eip",
+    "d esp",
+    NULL
+};
+
+static char *Watches[] =
+{
+    "eax",
+    "ebx",
+    "esp",
+    NULL
+};
+
+/******************************************************************************
+*                                                                             *
+*   External Functions                                                        *
+*                                                                             *
+******************************************************************************/
+
+extern int InitPacket(PTINITPACKET pInit);
+extern int DriverIOCTL(void *p1, void *p2, unsigned int ioctl, unsigned long param);
+extern void HeadlessInit(void);
+extern BOOL Evaluate(TExItem *pItem, char *pExpr, char **ppNext, BOOL fSymbolsValueOf);
+
+extern TOUT outHeadless;
+
+extern void ScreenSave(FILE *fp, TSCREENPACKET *pPacket);
+
+int nVerbose = 0;                       // Verbose level of the linsym screen module
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+static unsigned long long NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return( (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void Result(char *pName, unsigned long long ops,                   *
+*                      unsigned long long ns, char *pExtra)                   *
+*                                                                             *
+*******************************************************************************
+*
+*   Prints one element of the results array.
+*
+*   Where:
+*       pName is the name of the benchmark
+*       ops is the number of operations timed
+*       ns is the time they took in nanoseconds
+*       pExtra is an optional string with additional JSON members
+*
+******************************************************************************/
+static void Result(char *pName, unsigned long long ops, unsigned long long ns, char *pExtra)
+{
+    printf("%s\n    {\"name\": \"%s\", \"ops\": %llu, \"ns\": %llu, \"ns_per_op\": %.1f%s%s}",
+        nResults++? ",":"",
+        pName, ops, ns, ops? (double) ns / ops : 0.0,
+        pExtra? ", ":"", pExtra? pExtra:"");
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void *ReadFile(char *pName, long *pSize)                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Reads the complete file into a memory buffer.
+*
+******************************************************************************/
+static void *ReadFile(char *pName, long *pSize)
+{
+    FILE *fp;
+    void *pBuf = NULL;
+
+    if( (fp = fopen(pName, "rb")) != NULL )
+    {
+        fseek(fp, 0, SEEK_END);
+        *pSize = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+
+        if( (pBuf = malloc(*pSize)) != NULL )
+        {
+            if( fread(pBuf, 1, *pSize, fp) != (size_t) *pSize )
+            {
+                free(pBuf);
+                pBuf = NULL;
+            }
+        }
+
+        fclose(fp);
+    }
+
+    if( pBuf==NULL )
+        fprintf(stderr, "Unable to read %s\n", pName);
+
+    return( pBuf );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL LoadImage(char *pName)                                        *
+*                                                                             *
+*******************************************************************************
+*
+*   Loads the PT_LOAD segments of a 32-bit ELF kernel image into the fake
+*   memory. Segments are placed at their virtual address, or at their
+*   physical address above the page offset.
+*
+******************************************************************************/
+static BOOL LoadImage(char *pName)
+{
+    Elf32_Ehdr *pEhdr;
+    Elf32_Phdr *pPhdr;
+    DWORD dwAddress;
+    long size;
+    int i;
+
+    if( (pEhdr = ReadFile(pName, &size)) == NULL )
+        return( FALSE );
+
+    if( memcmp(pEhdr->e_ident, ELFMAG, SELFMAG) || pEhdr->e_ident[EI_CLASS] != ELFCLASS32 )
+    {
+        fprintf(stderr, "%s is not a 32-bit ELF file\n", pName);
+        return( FALSE );
+    }
+
+    for(i=0; i<pEhdr->e_phnum; i++)
+    {
+        pPhdr = (Elf32_Phdr *) ((BYTE *) pEhdr + pEhdr->e_phoff + i * pEhdr->e_phentsize);
+
+        if( pPhdr->p_type != PT_LOAD || pPhdr->p_offset + pPhdr->p_filesz > (DWORD) size )
+            continue;
+
+        dwAddress = pPhdr->p_vaddr;
+
+        if( dwAddress < HOST_PAGE_OFFSET )
+            dwAddress = pPhdr->p_paddr + HOST_PAGE_OFFSET;
+
+        if( dwAddress >= HOST_PAGE_OFFSET && dwAddress - HOST_PAGE_OFFSET + pPhdr->p_memsz <= HOST_MEM_SIZE )
+        {
+            memcpy((BYTE *) dwAddress, (BYTE *) pEhdr + pPhdr->p_offset, pPhdr->p_filesz);
+            memset((BYTE *) dwAddress + pPhdr->p_filesz, 0, pPhdr->p_memsz - pPhdr->p_filesz);
+        }
+        else
+            fprintf(stderr, "Segment at %08X does not fit into the fake memory\n", pPhdr->p_vaddr);
+    }
+
+    free(pEhdr);
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void LoadRegs(char *pName)                                         *
+*                                                                             *
+*******************************************************************************
+*
+*   Loads the register set in the Sim configuration format: "Regs.eax = %08X"
+*
+******************************************************************************/
+static void LoadRegs(char *pName)
+{
+    static struct { char *pName; DWORD *pReg; } Map[] =
+    {
+        { "eax", &Regs.eax }, { "ebx", &Regs.ebx }, { "ecx", &Regs.ecx }, { "edx", &Regs.edx },
+        { "esi", &Regs.esi }, { "edi", &Regs.edi }, { "esp", &Regs.esp }, { "ebp", &Regs.ebp },
+        { "eip", &Regs.eip }, { "eflags", &Regs.eflags },
+        { "cs", &Regs.cs }, { "ds", &Regs.ds }, { "es", &Regs.es },
+        { "fs", &Regs.fs }, { "gs", &Regs.gs }, { "ss", &Regs.ss },
+        { NULL, NULL }
+    };
+    char sLine[80], sReg[8];
+    unsigned int value;
+    FILE *fp;
+    int i;
+
+    if( (fp = fopen(pName, "r")) == NULL )
+    {
+        fprintf(stderr, "Unable to read %s\n", pName);
+        return;
+    }
+
+    while( fgets(sLine, sizeof(sLine), fp) )
+    {
+        if( sscanf(sLine, "Regs.%7[a-z] = %x", sReg, &value)==2 )
+        {
+            for(i=0; Map[i].pName; i++)
+                if( !strcmp(Map[i].pName, sReg) )
+                    *Map[i].pReg = value;
+        }
+    }
+
+    fclose(fp);
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void SampleGlobals(void)                                           *
+*                                                                             *
+*******************************************************************************
+*
+*   Picks up to MAX_SAMPLES globals, evenly spread over all loaded symbol
+*   tables, to be used for the symbol lookups.
+*
+******************************************************************************/
+static void SampleGlobals(void)
+{
+    TSYMTAB *pSymTab;
+    TSYMGLOBAL *pGlobals;
+    TSYMGLOBAL1 *pGlobal;
+    DWORD nTotal = 0, n = 0, stride;
+
+    for(pSymTab = deb.pSymTab; pSymTab; pSymTab = (TSYMTAB *) pSymTab->next)
+        for(pGlobals = SymTabFindSection(pSymTab, HTYPE_GLOBALS); pGlobals;
+            pGlobals = SymTabFindSectionNext(pSymTab, pGlobals, HTYPE_GLOBALS))
+            nTotal += pGlobals->nGlobals;
+
+    stride = nTotal / MAX_SAMPLES + 1;
+
+    for(pSymTab = deb.pSymTab; pSymTab; pSymTab = (TSYMTAB *) pSymTab->next)
+        for(pGlobals = SymTabFindSection(pSymTab, HTYPE_GLOBALS); pGlobals;
+            pGlobals = SymTabFindSectionNext(pSymTab, pGlobals, HTYPE_GLOBALS))
+        {
+            for(pGlobal = pGlobals->list; pGlobal < pGlobals->list + pGlobals->nGlobals; pGlobal++, n++)
+            {
+                if( n % stride==0 && nSamples < MAX_SAMPLES && pGlobal->dwEndAddress > pGlobal->dwStartAddress )
+                {
+                    Samples[nSamples] = pGlobal->dwStartAddress + (pGlobal->dwEndAddress - pGlobal->dwStartAddress) / 2;
+                    SampleNames[nSamples++] = pGlobal->pName;
+                }
+            }
+        }
+}
+
+/******************************************************************************
+*                                                                             *
+*   static BOOL HostInit(void)                                                *
+*                                                                             *
+*******************************************************************************
+*
+*   Initializes the debugger core, loads the symbol tables and sets up the
+*   debugee state.
+*
+******************************************************************************/
+static BOOL HostInit(void)
+{
+    static TINITPACKET Init;
+    char sExpr[MAX_STRING], *pNext;
+    void *pSym[MAX_SYMFILES];
+    long size, nTotal = 0;
+    DWORD dwEip;
+    int i;
+
+    if( !HostMemInit() )
+        return( FALSE );
+
+    HostModulesInit();
+
+    if( pImage && !LoadImage(pImage) )
+        return( FALSE );
+
+    // Read all symbol files first so we know how large the symbol pool should be
+    for(i=0; i<nSymFiles; i++)
+    {
+        if( (pSym[i] = ReadFile(pSymFile[i], &size))==NULL )
+            return( FALSE );
+
+        nTotal += size;
+    }
+
+    // Same defaults that linsym uses
+    memset(&Init, 0, sizeof(Init));
+
+    Init.nSize        = sizeof(TINITPACKET);
+    Init.fLowercase   = 1;
+    Init.nSymbolSize  = nTotal + 128 * 1024;
+    Init.nDrawSize    = 0;
+    Init.nHistorySize = 16 * 1024;
+    Init.nMacros      = 32;
+    Init.nVars        = 64;
+
+    pWin = &Win;
+
+    if( InitPacket(&Init) != 0 )
+    {
+        fprintf(stderr, "Debugger core failed to initialize\n");
+        return( FALSE );
+    }
+
+    // Nobody is there to press a key
+    deb.fPause = FALSE;
+
+    for(i=0; i<nSymFiles; i++)
+    {
+        if( DriverIOCTL(NULL, NULL, ICE_IOCTL_ADD_SYM, (unsigned long) pSym[i]) != 0 )
+        {
+            fprintf(stderr, "Unable to load symbol file %s\n", pSymFile[i]);
+            return( FALSE );
+        }
+
+        free(pSym[i]);
+    }
+
+    // Default register set: kernel selectors and a stack in the fake memory
+    if( Regs.cs==0 )
+    {
+        Regs.cs     = HOST_KERNEL_CS;
+        Regs.ds     = Regs.es = Regs.ss = HOST_KERNEL_DS;
+        Regs.esp    = HOST_PAGE_OFFSET + HOST_STACK - 0x100;
+        Regs.ebp    = Regs.esp + 0x40;
+        Regs.eflags = 0x246;
+    }
+
+    deb.r = &Regs;
+    memcpy(&deb.r_prev, &Regs, sizeof(TREGS));
+
+    SampleGlobals();
+
+    // Use the given EIP, schedule() or the first sampled symbol. Globals are
+    // only visible from within a function scope, so set up a context first
+    if( Regs.eip==0 )
+    {
+        Regs.eip = nSamples? Samples[0] : HOST_PAGE_OFFSET + HOST_MODULE;
+
+        SetSymbolContext(Regs.cs, Regs.eip);
+
+        strcpy(sExpr, "schedule");
+
+        if( Expression(&dwEip, sExpr, &pNext) && !*pNext )
+            Regs.eip = dwEip;
+
+        deb.errorCode = 0;              // NOERROR
+    }
+
+    deb.codeTopAddr.sel = Regs.cs;
+    deb.codeTopAddr.offset = Regs.eip;
+
+    SetSymbolContext(Regs.cs, Regs.eip);
+
+    // Bring up the debugger screen the way the debugger entry does
+    HeadlessInit();
+    pOut = &outHeadless;
+
+    dputc(DP_ENABLE_OUTPUT);
+    dputc(DP_SAVEBACKGROUND);
+    deb.fRunningIce = TRUE;
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   Benchmarks                                                                *
+*                                                                             *
+******************************************************************************/
+
+static void BenchSymAddress(void)
+{
+    unsigned long long t, found = 0;
+    char sExtra[40];
+    UINT range;
+    int n, i;
+
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+        for(i=0; i<nSamples; i++)
+            if( SymAddress2Name(Samples[i], &range) )
+                found++;
+
+    t = NowNs() - t;
+
+    snprintf(sExtra, sizeof(sExtra), "\"found\": %llu", found);
+    Result("sym_address", (unsigned long long) nIterations * nSamples, t, sExtra);
+}
+
+static void BenchSymModule(void)
+{
+    unsigned long long t, found = 0;
+    char sExtra[40];
+    UINT range;
+    int n, i;
+
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+        for(i=0; i<256; i++)
+            if( SymAddress2Name(HOST_PAGE_OFFSET + HOST_MODULE + i * 0x40 + 8, &range) )
+                found++;
+
+    t = NowNs() - t;
+
+    snprintf(sExtra, sizeof(sExtra), "\"found\": %llu", found);
+    Result("sym_module", (unsigned long long) nIterations * 256, t, sExtra);
+}
+
+static void BenchSymName(void)
+{
+    unsigned long long t, found = 0;
+    char sExpr[MAX_STRING], *pNext;
+    char sExtra[40];
+    DWORD dwValue;
+    int n, i;
+
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+        for(i=0; i<nSamples; i++)
+        {
+            // Expression() may modify the string it evaluates
+            strncpy(sExpr, SampleNames[i], sizeof(sExpr) - 1);
+            sExpr[sizeof(sExpr) - 1] = 0;
+
+            if( Expression(&dwValue, sExpr, &pNext) )
+                found++;
+
+            deb.errorCode = 0;              // NOERROR
+        }
+
+    t = NowNs() - t;
+
+    snprintf(sExtra, sizeof(sExtra), "\"found\": %llu", found);
+    Result("sym_name", (unsigned long long) nIterations * nSamples, t, sExtra);
+}
+
+static void BenchExpression(void)
+{
+    unsigned long long t, errors = 0, ops = 0;
+    char sExpr[MAX_STRING], *pNext;
+    char sExtra[40];
+    DWORD dwValue;
+    int n, i;
+
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+        for(i=0; Expressions[i]; i++, ops++)
+        {
+            strcpy(sExpr, Expressions[i]);
+
+            if( !Expression(&dwValue, sExpr, &pNext) )
+                errors++;
+
+            deb.errorCode = 0;              // NOERROR
+        }
+
+    t = NowNs() - t;
+
+    snprintf(sExtra, sizeof(sExtra), "\"errors\": %llu", errors);
+    Result("expression", ops, t, sExtra);
+}
+
+static void BenchDisasm(void)
+{
+    unsigned long long t, ops = 0, bytes = 0;
+    BYTE sDisasm[MAX_STRING];
+    char sExtra[40];
+    TDISASM dis;
+    int n;
+
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+    {
+        dis.dwOffset = Regs.eip;
+
+        while( dis.dwOffset - Regs.eip < DISASM_WINDOW )
+        {
+            dis.bState   = DIS_DATA32 | DIS_ADDRESS32;
+            dis.wSel     = Regs.cs;
+            dis.szDisasm = sDisasm;
+
+            Disassembler(&dis);
+
+            ops++;
+            bytes += dis.bInstrLen;
+            dis.dwOffset += dis.bInstrLen? dis.bInstrLen : 1;
+        }
+    }
+
+    t = NowNs() - t;
+
+    snprintf(sExtra, sizeof(sExtra), "\"bytes\": %llu", bytes);
+    Result("disasm", ops, t, sExtra);
+}
+
+static void BenchRedraw(void)
+{
+    TSCREENPACKET Start, End;
+    unsigned long long t;
+    char sExtra[60];
+    int n;
+
+    memset(&Start, 0, sizeof(Start));
+    DriverIOCTL(NULL, NULL, ICE_IOCTL_SCREEN, (unsigned long) &Start);
+
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+        RecalculateDrawWindows();
+
+    t = NowNs() - t;
+
+    memset(&End, 0, sizeof(End));
+    DriverIOCTL(NULL, NULL, ICE_IOCTL_SCREEN, (unsigned long) &End);
+
+    snprintf(sExtra, sizeof(sExtra), "\"bytes\": %u, \"cells\": %u",
+        (unsigned int) (End.dwBytes - Start.dwBytes), (unsigned int) (End.dwCells - Start.dwCells));
+    Result("redraw", nIterations, t, sExtra);
+}
+
+static void BenchCommand(void)
+{
+    unsigned long long t, ops = 0;
+    char sCmd[MAX_STRING];
+    int n, i;
+
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+        for(i=0; Commands[i]; i++, ops++)
+        {
+            strcpy(sCmd, Commands[i]);
+            CommandExecute(sCmd);
+
+            // The debugger prints and clears the error after every command
+            deb.errorCode = 0;              // NOERROR
+        }
+
+    t = NowNs() - t;
+
+    Result("command", ops, t, NULL);
+}
+
+static void BenchWatch(void)
+{
+    unsigned long long t;
+    char sExpr[MAX_STRING];
+    char sExtra[40];
+    TLISTITEM *pItem;
+    TExItem ExItem;
+    int n, i, nChanged = 0;
+
+    // Add the watches the way cmdWatch() does, without drawing them
+    for(i=0; Watches[i]; i++)
+    {
+        strcpy(sExpr, Watches[i]);
+
+        if( Evaluate(&ExItem, sExpr, NULL, TRUE) && (pItem = ListAdd(&deb.Watch)) )
+        {
+            memcpy(&pItem->Item, &ExItem, sizeof(TExItem));
+            strcpy(pItem->Name, Watches[i]);
+        }
+
+        deb.errorCode = 0;              // NOERROR
+    }
+
+    // Evaluate once per stop and leave the debugger in between; nothing
+    // changes, so none of the values may be marked changed
+    t = NowNs();
+
+    for(n=0; n<nIterations; n++)
+    {
+        ListEvaluate(&deb.Watch);
+        ListClearChanged(&deb.Watch);
+    }
+
+    ListEvaluate(&deb.Watch);
+
+    t = NowNs() - t;
+
+    for(pItem = deb.Watch.pList; pItem; pItem = (TLISTITEM *) pItem->pNext)
+        if( pItem->fChanged )
+        {
+            fprintf(stderr, "Watch %s is marked changed but its value is the same\n", pItem->Name);
+            nChanged++;
+        }
+
+    nErrors += nChanged;
+
+    ListDelAll(&deb.Watch);
+
+    snprintf(sExtra, sizeof(sExtra), "\"changed\": %d", nChanged);
+    Result("watch", (unsigned long long) nIterations + 1, t, sExtra);
+}
+
+/******************************************************************************
+*                                                                             *
+*   static void SaveScreen(char *pName)                                       *
+*                                                                             *
+*******************************************************************************
+*
+*   Saves the headless output screen as text, one line per row, without the
+*   trailing spaces.
+*
+******************************************************************************/
+static void SaveScreen(char *pName)
+{
+    static WORD Cells[MAX_OUTPUT_SIZEY * MAX_OUTPUT_SIZEX];
+    TSCREENPACKET Packet;
+    FILE *fp;
+
+    if( (fp = fopen(pName, "w")) == NULL )
+    {
+        fprintf(stderr, "Unable to write %s\n", pName);
+        return;
+    }
+
+    memset(&Packet, 0, sizeof(Packet));
+    Packet.dwSize = sizeof(Cells);
+    Packet.pBuf = Cells;
+
+    // The rows are written by the same code as linsym -screen
+    if( DriverIOCTL(NULL, NULL, ICE_IOCTL_SCREEN, (unsigned long) &Packet)==0 )
+        ScreenSave(fp, &Packet);
+
+    fclose(fp);
+}
+
+/******************************************************************************
+*                                                                             *
+*   int main(int argc, char *argv[])                                          *
+*                                                                             *
+******************************************************************************/
+int main(int argc, char *argv[])
+{
+    int opt, i;
+
+    while( (opt = getopt(argc, argv, "n:k:r:s:")) != -1 )
+    {
+        switch( opt )
+        {
+            case 'n':   nIterations = atoi(optarg);     break;
+            case 'k':   pImage = optarg;                break;
+            case 'r':   LoadRegs(optarg);               break;
+            case 's':   pScreen = optarg;               break;
+            default:
+                fprintf(stderr, "Usage: %s [-n iterations] [-k vmlinux] [-r regs] [-s screen] symfile ...\n", argv[0]);
+                return( 1 );
+        }
+    }
+
+    while( optind < argc && nSymFiles < MAX_SYMFILES )
+        pSymFile[nSymFiles++] = argv[optind++];
+
+    if( nIterations <= 0 )
+        nIterations = DEFAULT_ITERATIONS;
+
+    if( !HostInit() )
+        return( 1 );
+
+    printf("{\n  \"tool\": \"linice-bench\",\n  \"version\": \"%d.%d\",\n", MAJOR_VERSION, MINOR_VERSION);
+    printf("  \"iterations\": %d,\n  \"globals_sampled\": %d,\n", nIterations, nSamples);
+    printf("  \"image\": %s%s%s,\n", pImage? "\"":"", pImage? pImage:"null", pImage? "\"":"");
+    printf("  \"symbols\": [");
+
+    for(i=0; i<nSymFiles; i++)
+        printf("%s\"%s\"", i? ", ":"", pSymFile[i]);
+
+    printf("],\n  \"eip\": \"%08X\",\n  \"results\": [", (unsigned int) Regs.eip);
+
+    BenchSymAddress();
+    BenchSymModule();
+    BenchSymName();
+    BenchExpression();
+    BenchDisasm();
+    BenchRedraw();
+    BenchCommand();
+    BenchWatch();
+
+    printf("\n  ]\n}\n");
+
+    if( pScreen )
+        SaveScreen(pScreen);
+
+    return( nErrors? 1 : 0 );
+}
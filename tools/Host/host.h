@@ -0,0 +1,87 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     host.h                                                        *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This header file contains major defines for the Linux host harness.
+
+        The harness runs the kernel independent part of Linice as a 32-bit
+        user process. The fake kernel memory is mapped at the address where
+        the kernel would be, so the addresses from the symbol tables and
+        the kernel image can be used directly.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Important Defines                                                         *
+******************************************************************************/
+#ifndef _HOST_H_
+#define _HOST_H_
+
+/******************************************************************************
+*                                                                             *
+*   Global Defines, Variables and Macros                                      *
+*                                                                             *
+******************************************************************************/
+
+// Kernel virtual mapping that the fake memory stands for
+
+#define HOST_PAGE_OFFSET        0xC0000000
+#define HOST_MEM_SIZE           (64 * 1024 * 1024)
+
+// Layout of the fake physical memory
+
+#define HOST_PGDIR              0x00001000  // Page directory (4Mb pages)
+#define HOST_GDT                0x00002000  // Global descriptor table
+#define HOST_IDT                0x00003000  // Interrupt descriptor table
+#define HOST_STACK              0x00080000  // Top of the debugee stack
+#define HOST_MODULE             0x03000000  // Fake module code area
+
+// Selectors of the fake GDT; same as in the 2.6 kernels
+
+#define HOST_KERNEL_CS          0x60
+#define HOST_KERNEL_DS          0x68
+
+extern BYTE *pHostMem;                  // Fake kernel memory
+
+/******************************************************************************
+*                                                                             *
+*   Extern functions                                                          *
+*                                                                             *
+******************************************************************************/
+
+extern BOOL HostMemInit(void);
+extern BOOL HostMemRead(BYTE *pDest, DWORD dwAddress, DWORD len);
+extern BOOL HostMemWrite(DWORD dwAddress, BYTE *pSrc, DWORD len);
+extern void HostModulesInit(void);
+
+#endif  //  _HOST_H_
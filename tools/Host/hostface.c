@@ -0,0 +1,516 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     hostface.c                                                    *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the host interface functions that link with
+        the debugger core in place of the kernel iceface module. It is
+        modelled on the Sim simface.c.
+
+        It also owns the fake kernel memory: a block mapped at the kernel
+        page offset with a page directory of 4Mb pages, a flat GDT and an
+        empty IDT, and a fake loaded module with a set of exported symbols.
+
+        Accesses outside the fake memory (the debugger's own data) are
+        probed with a SIGSEGV handler, which takes the place of the page
+        fault handler that recovers faulting accesses in the driver.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include <stdlib.h>                     // Include standard library file
+#include <stdio.h>                      // Include standard IO library file
+#include <string.h>                     // Include string header file
+#include <sys/types.h>                  // Include file functions
+#include <sys/mman.h>                   // Include memory mapping functions
+#include <signal.h>                     // Include signal handling
+#include <setjmp.h>                     // Include non-local jumps
+
+#include "ice-types.h"                  // Include exended data types
+#include "iceface.h"                    // Include interface defines
+
+#include "host.h"                       // Include host harness header file
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+BYTE *pHostMem = NULL;                  // Fake kernel memory
+
+// Module parameters that linsym would pass on insmod
+
+DWORD kbd = 0;
+DWORD scan = 0;
+DWORD *pmodule = NULL;
+DWORD sys = 0;
+DWORD switchto = 0;
+DWORD *start_sym = NULL;
+DWORD *stop_sym = NULL;
+DWORD *start_sym_gpl = NULL;
+DWORD *stop_sym_gpl = NULL;
+int ice_debug_level = 0;
+
+// The PCI database is not linked in
+
+int ice_PCI_VENTABLE_LEN = 0;
+int ice_PCI_DEVTABLE_LEN = 0;
+int ice_PCI_CLASSCODETABLE_LEN = 0;
+
+int PciVenTable = 0;
+int PciDevTable = 0;
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+// Same as in module-header.h, which can not be mixed with the C library
+
+struct module_symbol
+{
+    unsigned long value;
+    const char *name;
+};
+
+#define HOST_MODULE_NAME        "hostmod"
+#define HOST_MODULE_SYMS        256     // Number of exported symbols
+#define HOST_MODULE_STRIDE      0x40    // Code bytes per exported symbol
+
+static struct module_symbol HostSyms[HOST_MODULE_SYMS];
+static char HostSymNames[HOST_MODULE_SYMS][16];
+static TMODULE HostModule;
+
+static sigjmp_buf HostFault;            // Where to resume after a faulting access
+static volatile int fHostProbe = 0;     // We are probing an address
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*                                                                             *
+*   static void HostSegv(int sig)                                             *
+*                                                                             *
+*******************************************************************************
+*
+*   Handles faults: resumes a probing access, otherwise terminates.
+*
+******************************************************************************/
+static void HostSegv(int sig)
+{
+    if( fHostProbe )
+        siglongjmp(HostFault, 1);
+
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL HostMemRead(BYTE *pDest, DWORD dwAddress, DWORD len)                 *
+*   BOOL HostMemWrite(DWORD dwAddress, BYTE *pSrc, DWORD len)                 *
+*                                                                             *
+*******************************************************************************
+*
+*   Copies memory of the host process that may not be mapped.
+*
+*   Returns:
+*       TRUE - memory copied
+*       FALSE - access faulted
+*
+******************************************************************************/
+BOOL HostMemRead(BYTE *pDest, DWORD dwAddress, DWORD len)
+{
+    BOOL fOk = FALSE;
+
+    fHostProbe = 1;
+
+    if( sigsetjmp(HostFault, 0)==0 )
+    {
+        memcpy(pDest, (BYTE *) dwAddress, len);
+        fOk = TRUE;
+    }
+
+    fHostProbe = 0;
+
+    return( fOk );
+}
+
+BOOL HostMemWrite(DWORD dwAddress, BYTE *pSrc, DWORD len)
+{
+    BOOL fOk = FALSE;
+
+    fHostProbe = 1;
+
+    if( sigsetjmp(HostFault, 0)==0 )
+    {
+        memcpy((BYTE *) dwAddress, pSrc, len);
+        fOk = TRUE;
+    }
+
+    fHostProbe = 0;
+
+    return( fOk );
+}
+
+/******************************************************************************
+*                                                                             *
+*   BOOL HostMemInit(void)                                                    *
+*                                                                             *
+*******************************************************************************
+*
+*   Maps the fake kernel memory at the kernel page offset and builds the
+*   page directory, GDT and IDT within it.
+*
+*   Returns:
+*       TRUE - memory is mapped
+*       FALSE - the address range is not available to this process
+*
+******************************************************************************/
+BOOL HostMemInit(void)
+{
+    struct sigaction sa;
+    DWORD *pPgdir, *pGdt;
+    int i;
+
+    // The handler is left without restoring the signal mask, so do not block it
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = HostSegv;
+    sa.sa_flags = SA_NODEFER;
+
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGBUS, &sa, NULL);
+
+    // Only a hint: we must not replace anything that is already mapped there
+    pHostMem = mmap((void *) HOST_PAGE_OFFSET, HOST_MEM_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if( pHostMem==MAP_FAILED || pHostMem != (BYTE *) HOST_PAGE_OFFSET )
+    {
+        fprintf(stderr, "Unable to map %d Mb of fake kernel memory at %08X\n", HOST_MEM_SIZE >> 20, HOST_PAGE_OFFSET);
+        return( FALSE );
+    }
+
+    // Page directory maps everything with 4Mb pages, present and writable, so
+    // that the accesses to the process memory are left to the probing; the
+    // fake memory starts at physical address 0
+    pPgdir = (DWORD *) (pHostMem + HOST_PGDIR);
+
+    for(i=0; i<1024; i++)
+        pPgdir[i] = (i << 22) | 0x83;
+
+    for(i=0; i<(HOST_MEM_SIZE >> 22); i++)
+        pPgdir[(HOST_PAGE_OFFSET >> 22) + i] = (i << 22) | 0x83;
+
+    // Flat 4Gb code and data descriptors for the kernel selectors
+    pGdt = (DWORD *) (pHostMem + HOST_GDT);
+
+    pGdt[HOST_KERNEL_CS / 4 + 0] = 0x0000FFFF;
+    pGdt[HOST_KERNEL_CS / 4 + 1] = 0x00CF9A00;
+    pGdt[HOST_KERNEL_DS / 4 + 0] = 0x0000FFFF;
+    pGdt[HOST_KERNEL_DS / 4 + 1] = 0x00CF9200;
+
+    return( TRUE );
+}
+
+/******************************************************************************
+*                                                                             *
+*   void HostModulesInit(void)                                                *
+*                                                                             *
+*******************************************************************************
+*
+*   Creates the fake module with exported symbols evenly spread over its
+*   code area. The code is filled with RET instructions.
+*
+******************************************************************************/
+void HostModulesInit(void)
+{
+    int i;
+
+    memset(pHostMem + HOST_MODULE, 0xC3, HOST_MODULE_SYMS * HOST_MODULE_STRIDE);
+
+    for(i=0; i<HOST_MODULE_SYMS; i++)
+    {
+        snprintf(HostSymNames[i], sizeof(HostSymNames[i]), "host_sym_%03d", i);
+
+        HostSyms[i].value = HOST_PAGE_OFFSET + HOST_MODULE + i * HOST_MODULE_STRIDE;
+        HostSyms[i].name  = HostSymNames[i];
+    }
+
+    memset(&HostModule, 0, sizeof(TMODULE));
+
+    HostModule.pmodule   = &HostModule;
+    HostModule.name      = HOST_MODULE_NAME;
+    HostModule.size      = HOST_MODULE_SYMS * HOST_MODULE_STRIDE;
+    HostModule.nsyms     = HOST_MODULE_SYMS;
+    HostModule.syms      = HostSyms;
+    HostModule.use_count = 1;
+}
+
+void ice_printk(char *p)
+{
+    fprintf(stderr, "%s", p);
+}
+
+int ice_get_printk(void)
+{
+    return( 0 );
+}
+
+unsigned int ice_get_flags(void)
+{
+    return( 0 );
+}
+
+void ice_ack_APIC_irq(void)
+{
+}
+
+int ice_get_io_bitmap_size(void)
+{
+    return( 32 );
+}
+
+void ice_smp_call_function(void (*func)(void *), void *info, int retry, int wait)
+{
+}
+
+int ice_smp_processor_id(void)
+{
+    return( 0 );
+}
+
+int ice_get_ipi_regs(void *pStack, TIPIREGS *pIpi)
+{
+    return( 0 );
+}
+
+int ice_smp_num_cpus(void)
+{
+    return( 1 );
+}
+
+int ice_send_nmi_allbutself(void)
+{
+    return( 0 );
+}
+
+unsigned int ice_get_cpu_khz(void)
+{
+    return( 0 );
+}
+
+unsigned int ice_get_cpu_model(void)
+{
+    return( 0 );
+}
+
+unsigned int ice_io_apic_read(int n, unsigned int reg)
+{
+    return( 0 );
+}
+
+void ice_io_apic_write(int n, unsigned int reg, unsigned int val)
+{
+}
+
+int ice_init_proc(int ProcRead, int ProcWrite)
+{
+    return( 0 );
+}
+
+int ice_close_proc(void)
+{
+    return( 0 );
+}
+
+int ice_register_chrdev(char *pDevice)
+{
+    return( 1 );
+}
+
+void ice_unregister_chrdev(int major_device_number, char *pDevice)
+{
+}
+
+int ice_mknod(void *sys_mknod, char *pDevice, int major_device_number)
+{
+    return( 0 );
+}
+
+void ice_rmnod(void *sys_unlink, char *pDevice)
+{
+}
+
+int ice_get__NR_mknod(void)
+{
+    return( 14 );
+}
+
+int ice_get__NR_unlink(void)
+{
+    return( 10 );
+}
+
+void *ice_ioremap(unsigned int mem1, unsigned int mem2)
+{
+    return( NULL );
+}
+
+void ice_iounmap(void *pMemory)
+{
+}
+
+int ice_get_fb_info(TFBINFO *pFb)
+{
+    return( -1 );
+}
+
+int ice_fb_pan(unsigned int yoffset)
+{
+    return( -1 );
+}
+
+unsigned int ice_page_offset(void)
+{
+    return( HOST_PAGE_OFFSET );
+}
+
+unsigned int ice_thread_size(void)
+{
+    return( 8192 );
+}
+
+long ice_copy_to_user(void *p1, void *p2, int len)
+{
+    memcpy(p1, p2, len);
+    return( 0 );
+}
+
+long ice_copy_from_user(void *p1, void *p2, int len)
+{
+    memcpy(p1, p2, len);
+    return( 0 );
+}
+
+void ice_get_pci_info(TPCI *pci, void *ptr)
+{
+}
+
+void *ice_get_pci(void)
+{
+    return( NULL );
+}
+
+void *ice_get_pci_next(void *p)
+{
+    return( NULL );
+}
+
+int ice_is_pci(void *p)
+{
+    return( 0 );
+}
+
+int ice_pci_read_config_dword(void *dev, int where, unsigned int *val)
+{
+    *val = 0xFFFFFFFF;
+    return( -1 );
+}
+
+void *ice_vmalloc(unsigned int size)
+{
+    return( malloc(size) );
+}
+
+void ice_vfree(char *p)
+{
+    free(p);
+}
+
+void *ice_get_module(void *pm, TMODULE *pMod)
+{
+    // There is only one module in the list
+    if( pm==NULL && HostModule.pmodule )
+    {
+        memcpy(pMod, &HostModule, sizeof(TMODULE));
+
+        return( HostModule.pmodule );
+    }
+
+    return( NULL );
+}
+
+void *ice_get_module_init(void *pm)
+{
+    return( NULL );
+}
+
+void ice_for_each_task(int *ref, TTASK *pIceTask, int (ice_for_each_task_cb)(int *,TTASK *))
+{
+}
+
+void *ice_get_current(void)
+{
+    return( NULL );
+}
+
+char *ice_get_current_comm(void)
+{
+    return( "linice-bench" );
+}
+
+int ice_mod_in_use(void)
+{
+    return( 0 );
+}
+
+void ice_mod_inc_use_count(void)
+{
+}
+
+void ice_mod_dec_use_count(void)
+{
+}
+
+unsigned int ice_get_kernel_version(void)
+{
+    return( KERNEL_VERSION_2_6 );
+}
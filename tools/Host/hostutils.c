@@ -0,0 +1,478 @@
+/******************************************************************************
+*                                                                             *
+*   Module:     hostutils.c                                                   *
+*                                                                             *
+*   Date:       10/19/05                                                      *
+*                                                                             *
+*   Copyright (c) 2005 Goran Devic                                            *
+*                                                                             *
+*   Author:     Goran Devic                                                   *
+*                                                                             *
+*   This program is free software; you can redistribute it and/or modify      *
+*   it under the terms of the GNU General Public License as published by      *
+*   the Free Software Foundation; either version 2 of the License, or         *
+*   (at your option) any later version.                                       *
+*                                                                             *
+*   This program is distributed in the hope that it will be useful,           *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*   GNU General Public License for more details.                              *
+*                                                                             *
+*   You should have received a copy of the GNU General Public License         *
+*   along with this program; if not, write to the Free Software               *
+*   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA   *
+*                                                                             *
+*******************************************************************************
+
+    Module Description:
+
+        This module contains the replacements for the assembly functions
+        (i386.asm) and for the Linux specific modules (interrupt.c, proc.c,
+        syscall.c, task.c, extend.c) that are not linked into the host
+        harness.
+
+        It is compiled the same way as the debugger core and does not use
+        the C library.
+
+        All selectors are flat. Accesses to the fake kernel memory are done
+        directly, everything else is probed through the host interface and
+        fails the way a page fault would.
+
+*******************************************************************************
+*                                                                             *
+*   Changes:                                                                  *
+*                                                                             *
+*   DATE     DESCRIPTION OF CHANGES                               AUTHOR      *
+* --------   ---------------------------------------------------  ----------- *
+* 10/19/05   Original                                             Goran Devic *
+* --------   ---------------------------------------------------  ----------- *
+*******************************************************************************
+*   Include Files                                                             *
+******************************************************************************/
+
+#include "module-header.h"              // Versatile module header file
+
+#include "clib.h"                       // Include C library header file
+#include "iceface.h"                    // Include iceface module stub protos
+#include "ice.h"                        // Include main debugger structures
+
+#include "host.h"                       // Include host harness header file
+
+/******************************************************************************
+*                                                                             *
+*   Global Variables                                                          *
+*                                                                             *
+******************************************************************************/
+
+TIDT_Gate LinuxIdt[256] = {{0}};        // Original Linux IDT
+DWORD StackExtraBuffer = 0;             // Current size of the extra buffer
+WORD sel_ice_ds;                        // Kernel DS that i386.asm would use
+
+/******************************************************************************
+*                                                                             *
+*   Local Defines, Variables and Macros                                       *
+*                                                                             *
+******************************************************************************/
+
+// Checks that the access is within the fake kernel memory
+
+#define HOST_VALID(offset, len)                                         \
+    ((offset) >= HOST_PAGE_OFFSET && (offset) - HOST_PAGE_OFFSET + (len) <= HOST_MEM_SIZE)
+
+static BYTE CRTC[256];                  // Content of the VGA CRTC registers
+static BYTE SR[256];                    // Content of the VGA sequencer registers
+static DWORD dwTsc = 0;                 // Fake time stamp counter
+
+/******************************************************************************
+*                                                                             *
+*   Functions                                                                 *
+*                                                                             *
+******************************************************************************/
+
+/******************************************************************************
+*   The following functions have to be in this order:
+******************************************************************************/
+
+void MemAccess_START(void) {}
+
+DWORD GetByte(WORD sel, DWORD offset)
+{
+    BYTE bValue;
+
+    if( HOST_VALID(offset, sizeof(BYTE)) )
+        return( *(BYTE *)offset );
+
+    if( HostMemRead(&bValue, offset, sizeof(BYTE)) )
+        return( bValue );
+
+    return( MEMACCESS_PF );
+}
+
+DWORD GetDWORD(WORD sel, DWORD offset)
+{
+    DWORD dwValue;
+
+    if( HOST_VALID(offset, sizeof(DWORD)) )
+        return( *(DWORD *)offset );
+
+    if( HostMemRead((BYTE *) &dwValue, offset, sizeof(DWORD)) )
+        return( dwValue );
+
+    return( 0xFFFFFFFF );
+}
+
+void SetDWORD(WORD sel, DWORD offset, DWORD value)
+{
+    if( HOST_VALID(offset, sizeof(DWORD)) )
+        *(DWORD *)offset = value;
+    else
+        HostMemWrite(offset, (BYTE *) &value, sizeof(DWORD));
+}
+
+DWORD SetByte(WORD sel, DWORD offset, BYTE value)
+{
+    if( HOST_VALID(offset, sizeof(BYTE)) )
+    {
+        *(BYTE *)offset = value;
+        return( 0 );
+    }
+
+    if( HostMemWrite(offset, &value, sizeof(BYTE)) )
+        return( 0 );
+
+    return( MEMACCESS_PF );
+}
+
+void MemAccess_FAULT(void) {}
+
+void MemBlock_START(void) {}
+
+DWORD GetBlock(WORD sel, DWORD offset, BYTE *pDest, DWORD len)
+{
+    if( len==0 )
+        return( 0 );
+
+    if( HOST_VALID(offset, len) )
+    {
+        memcpy(pDest, (BYTE *)offset, len);
+        return( 0 );
+    }
+
+    if( HostMemRead(pDest, offset, len) )
+        return( 0 );
+
+    return( MEMACCESS_PF );
+}
+
+DWORD SetBlock(WORD sel, DWORD offset, BYTE *pSrc, DWORD len)
+{
+    if( len==0 )
+        return( 0 );
+
+    if( HOST_VALID(offset, len) )
+    {
+        memcpy((BYTE *)offset, pSrc, len);
+        return( 0 );
+    }
+
+    if( HostMemWrite(offset, pSrc, len) )
+        return( 0 );
+
+    return( MEMACCESS_PF );
+}
+
+void MemBlock_FAULT(void) {}
+
+void MemAccess_END(void) {}
+
+/******************************************************************************
+*   End of functions that have to be in that order.
+******************************************************************************/
+
+WORD GetKernelCS(void)
+{
+    return( HOST_KERNEL_CS );
+}
+
+WORD GetKernelDS(void)
+{
+    return( HOST_KERNEL_DS );
+}
+
+DWORD SelLAR(WORD Sel)
+{
+    // Every selector is a flat present data segment
+    return( 0x00CF9300 );
+}
+
+WORD getTR(void)
+{
+    return( 0 );
+}
+
+void GetIDT(TDescriptor *p)
+{
+    p->base  = HOST_PAGE_OFFSET + HOST_IDT;
+    p->limit = 256 * sizeof(TIDT_Gate) - 1;
+}
+
+void GetGDT(TDescriptor *p)
+{
+    p->base  = HOST_PAGE_OFFSET + HOST_GDT;
+    p->limit = 0x100 - 1;
+}
+
+void GetSysreg(TSysreg *pSys)
+{
+    memset(pSys, 0, sizeof(TSysreg));
+
+    pSys->cr0 = 0x80050033;             // PG, WP, NE, ET, MP, PE
+    pSys->cr3 = HOST_PGDIR;
+    pSys->cr4 = BITMASK(PSE_BIT);
+    pSys->dr6 = 0xFFFF0FF0;
+    pSys->dr7 = 0x00000400;
+}
+
+void SetSysreg(TSysreg *pSys)
+{
+}
+
+void SetDebugReg(TSysreg *pSys)
+{
+}
+
+void FlushTLB(void)
+{
+}
+
+DWORD GetRdtsc(BYTE *buffer8)
+{
+    // The counter only needs to move forward
+    dwTsc += 1000;
+    memset(buffer8, 0, 8);
+    *(DWORD *)buffer8 = dwTsc;
+
+    return( dwTsc );
+}
+
+//=============================================================================
+// Spinlocks; the harness runs on a single CPU
+//=============================================================================
+
+void SpinlockReset(DWORD *pSpinlock)
+{
+    *pSpinlock = 0;
+}
+
+DWORD SpinlockTry(DWORD *pSpinlock)
+{
+    DWORD spin = *pSpinlock;
+    *pSpinlock = 1;
+
+    return( spin );
+}
+
+DWORD SpinUntilReset(DWORD *pSpinlock)
+{
+    *pSpinlock = 0;
+
+    return( 0 );
+}
+
+//=============================================================================
+// Hooks of the Linux specific modules; nothing is hooked
+//=============================================================================
+
+void InterruptInit(void)
+{
+    GetIDT(&deb.idt);
+    GetGDT(&deb.gdt);
+    GetSysreg(&deb.sysReg);
+}
+
+void InterruptPoll(void)
+{
+}
+
+void HookDebuger(void)
+{
+}
+
+void UnHookDebuger(void)
+{
+}
+
+void HookNmi(void)
+{
+}
+
+void HookSyscall(void)
+{
+}
+
+void UnHookSyscall(void)
+{
+}
+
+void HookSwitch(void)
+{
+}
+
+void UnHookSwitch(void)
+{
+}
+
+void HookPrintk(void)
+{
+}
+
+void UnhookPrintk(void)
+{
+}
+
+void PrintkDrain(void)
+{
+}
+
+BOOL cmdPrintk(char *args, int subClass)
+{
+    return( TRUE );
+}
+
+int InitProcFs(void)
+{
+    return( 0 );
+}
+
+int CloseProcFs(void)
+{
+    return( 0 );
+}
+
+//=============================================================================
+// Extension modules are not supported
+//=============================================================================
+
+BOOL cmdExtList(char *args, int subClass)
+{
+    return( TRUE );
+}
+
+int DispatchExtCommand(char *pCommand)
+{
+    return( FALSE );
+}
+
+void DispatchExtEnter(void)
+{
+}
+
+void DispatchExtLeave(void)
+{
+}
+
+int QueryExtModule(void)
+{
+    return( 0 );
+}
+
+BOOL QueryExtToken(DWORD *pResult, char **pToken, int len)
+{
+    return( FALSE );
+}
+
+//=============================================================================
+// Port IO; VGA registers are kept so the cursor code works
+//=============================================================================
+
+BYTE ReadCRTC(int index)
+{
+    return( CRTC[index & 0xFF] );
+}
+
+void WriteCRTC(int index, int value)
+{
+    CRTC[index & 0xFF] = value & 0xFF;
+}
+
+void WriteMdaCRTC(int index, int value)
+{
+}
+
+BYTE ReadSR(int index)
+{
+    return( SR[index & 0xFF] );
+}
+
+void WriteSR(int index, int value)
+{
+    SR[index & 0xFF] = value & 0xFF;
+}
+
+void Outpb(DWORD port, DWORD value)
+{
+}
+
+void Outpw(DWORD port, DWORD value)
+{
+}
+
+void Outpd(DWORD port, DWORD value)
+{
+}
+
+DWORD Inpb(DWORD port)
+{
+    return( 0xFF );
+}
+
+DWORD Inpw(DWORD port)
+{
+    return( 0xFFFF );
+}
+
+DWORD Inpd(DWORD port)
+{
+    return( 0xFFFFFFFF );
+}
+
+unsigned char inp(unsigned short port)
+{
+    return( 0xFF );
+}
+
+//=============================================================================
+// Miscellaneous
+//=============================================================================
+
+void memset_w(void *dest, WORD data, int size)
+{
+    WORD *p = (WORD *) dest;
+
+    while( size-- > 0 )
+        *p++ = data;
+}
+
+void memset_d(void *dest, DWORD data, int size)
+{
+    DWORD *p = (DWORD *) dest;
+
+    while( size-- > 0 )
+        *p++ = data;
+}
+
+void machine_restart(char *cmd)
+{
+}
+
+void machine_power_off(void)
+{
+}
+
+void ObjectStart(void)
+{
+}
+
+void ObjectEnd(void)
+{
+}
@@ -135,6 +135,31 @@ int ice_smp_processor_id()
     return( 0 );
 }
 
+int ice_get_ipi_regs(void *pStack, TIPIREGS *pIpi)
+{
+    return( 0 );
+}
+
+int ice_smp_num_cpus(void)
+{
+    return( 1 );
+}
+
+int ice_send_nmi_allbutself(void)
+{
+    return( 0 );
+}
+
+unsigned int ice_get_cpu_khz(void)
+{
+    return( 0 );
+}
+
+unsigned int ice_get_cpu_model(void)
+{
+    return( 0 );
+}
+
 DWORD ice_io_apic_read(int n, DWORD reg)
 {
     return( 0 );
@@ -204,6 +229,18 @@ void ice_iounmap(void *pMemory)
 //    iounmap(pMemory);
 }
 
+int ice_get_fb_info(TFBINFO *pFb)
+{
+    // There is no kernel framebuffer in the simulator
+    return( -1 );
+}
+
+int ice_fb_pan(unsigned int yoffset)
+{
+    assert(0);
+    return( -1 );
+}
+
 unsigned int ice_page_offset(void)
 {
     // This value is used to map all direct memory accesses to the various kernel
@@ -211,6 +248,11 @@ unsigned int ice_page_offset(void)
     return((unsigned int)pPageOffset);
 }
 
+unsigned int ice_thread_size(void)
+{
+    return( 8192 );
+}
+
 long ice_copy_to_user(void *p1, void *p2, int len)
 {
     assert(0);
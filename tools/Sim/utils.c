@@ -236,6 +236,26 @@ DWORD SetByte(WORD sel, DWORD offset, BYTE value)
 
 void MemAccess_FAULT() {}
 
+void MemBlock_START() {}
+
+DWORD GetBlock(WORD sel, DWORD offset, BYTE *pDest, DWORD len)
+{
+    if(offset>=0x0400000 && offset+len<=0x07F00000)
+    {
+        memcpy(pDest, (BYTE *)offset, len);
+        return(0);
+    }
+    return( 0x100 );
+}
+
+DWORD SetBlock(WORD sel, DWORD offset, BYTE *pSrc, DWORD len)
+{
+    assert(0);
+    return(0);
+}
+
+void MemBlock_FAULT() {}
+
 void MemAccess_END() {}
 
 /******************************************************************************
@@ -320,6 +340,13 @@ void  SpinlockReset(DWORD *pSpinlock)
     *pSpinlock = 0;
 }
 
+DWORD SpinlockTry(DWORD *pSpinlock)
+{
+    DWORD spin = *pSpinlock;
+    *pSpinlock = 1;
+    return( spin );
+}
+
 DWORD SpinUntilReset(DWORD *pSpinlock)
 {
     assert(0);
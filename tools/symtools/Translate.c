@@ -62,6 +62,11 @@ void OptLogHistory(void)
     fprintf(stderr, "This option is available only in Linux version of LINSYM.\n\n");
 }
 
+void OptFollowHistory(void)
+{
+    fprintf(stderr, "This option is available only in Linux version of LINSYM.\n\n");
+}
+
 void OptAddSymbolTable(char *sName)
 {
     fprintf(stderr, "This option is available only in Linux version of LINSYM.\n\n");